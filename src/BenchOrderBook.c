@@ -0,0 +1,515 @@
+/* BenchOrderBook.c - Microbenchmark for the OrderBook matching core
+ *
+ * Generates a reproducible stream of synthetic order flow against one OrderBook and
+ * times every call. The flow is a weighted mix of five operations:
+ *  - add:    a passive limit order priced 1..depth ticks away from the mid
+ *  - cancel: OrderBook_remove_order on a randomly chosen order from earlier adds
+ *  - aggr:   a limit order priced at the opposite touch, which trades against it
+ *            (any unfilled remainder is cancelled afterwards, outside the timing)
+ *  - top:    OrderBook_get_top_levels with k levels per side, or with -c the book's
+ *            depth cache of k levels read through OrderBook_peek_top_levels
+ *  - best:   OrderBook_get_best_bid
+ *  - vwap:   OrderBook_estimate_fill for about top_k levels' worth of quantity
+ *            (weight 0 unless -m gives a sixth value)
+ *
+ * The book is pre-filled with `queue` orders at each of `depth` levels per side.
+ * For every operation the benchmark reports count, throughput and p50/p99/p999
+ * latency. The same seed and options always produce the same order flow.
+ * Built with `make bench INSTRUMENT=1` it also prints the per-stage histograms of the
+ * timed phase (see Instrument.h).
+ *
+ * With -B it compares the run against a baseline, the saved output of an earlier run
+ * with the same options, and exits with status 2 if any operation's throughput fell or
+ * its p99 latency rose by more than the -t tolerance (percent, default 10). This is
+ * what `make perf-check` runs.
+ *
+ * Usage: BenchOrderBook [-n ops] [-s seed] [-d depth] [-q queue] [-k top_k]
+ *                       [-m add,cancel,aggr,top,best[,vwap]] [-p uniform|geometric]
+ *                       [-b map|ladder] [-c] [-B baseline] [-t tolerance]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "OrderBook.h"
+#include "Instrument.h"
+
+#define MID_PRICE 100.0
+#define TICK_SIZE 0.01
+#define MAX_QUANTITY 100
+#define USER_COUNT 1000
+
+enum BenchOp { OP_ADD, OP_CANCEL, OP_AGGR, OP_TOP, OP_BEST, OP_VWAP, OP_COUNT };
+static const char *op_names[OP_COUNT] = { "add", "cancel", "aggr", "top", "best", "vwap" };
+
+struct BenchOptions {
+    long ops;                /* Timed operations to run */
+    uint64_t seed;           /* RNG seed */
+    int depth;               /* Price levels per side, in ticks from the mid */
+    int queue;               /* Orders pre-filled at each level */
+    int top_k;               /* Levels per side requested by top */
+    int weights[OP_COUNT];   /* Relative frequency of each operation */
+    int geometric;           /* 1 to concentrate passive prices near the touch */
+    int ladder;              /* 1 for price ladder sides, 0 for OrderedMap sides */
+    int cached;              /* 1 to serve top from a depth cache of top_k levels */
+    const char *baseline;    /* Output of an earlier run to compare against, or NULL */
+    double tolerance;        /* Percent a result may be worse than the baseline's */
+};
+
+/* The reported results of one operation, as compared against a baseline. */
+struct OpResult {
+    size_t count;
+    double mops;
+    uint64_t p99;
+};
+
+/* Growable array of per-call latencies in nanoseconds. */
+struct LatencySamples {
+    uint64_t *ns;
+    size_t count;
+    size_t capacity;
+};
+
+/* Order IDs resting (or possibly since filled) in the book, for cancels. */
+struct LiveOrders {
+    long *ids;
+    size_t count;
+    size_t capacity;
+};
+
+// -------------------------------------------------------------------
+// Deterministic random numbers (xorshift64*)
+// -------------------------------------------------------------------
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+/* Uniform integer in [0, bound). */
+static long rng_below(long bound)
+{
+    return (long)(rng_next() % (uint64_t)bound);
+}
+
+// -------------------------------------------------------------------
+// Helpers
+// -------------------------------------------------------------------
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int push_sample(struct LatencySamples *samples, uint64_t ns)
+{
+    if (samples->count == samples->capacity) {
+        size_t new_capacity = samples->capacity ? samples->capacity * 2 : 4096;
+        uint64_t *new_ns = realloc(samples->ns, new_capacity * sizeof(uint64_t));
+        if (!new_ns) return 0;
+        samples->ns = new_ns;
+        samples->capacity = new_capacity;
+    }
+    samples->ns[samples->count++] = ns;
+    return 1;
+}
+
+static int push_live(struct LiveOrders *live, long id)
+{
+    if (live->count == live->capacity) {
+        size_t new_capacity = live->capacity ? live->capacity * 2 : 4096;
+        long *new_ids = realloc(live->ids, new_capacity * sizeof(long));
+        if (!new_ids) return 0;
+        live->ids = new_ids;
+        live->capacity = new_capacity;
+    }
+    live->ids[live->count++] = id;
+    return 1;
+}
+
+/* Removes and returns a random live order ID, or -1 if there are none. */
+static long take_random_live(struct LiveOrders *live)
+{
+    if (live->count == 0) return -1;
+    size_t index = (size_t)rng_below((long)live->count);
+    long id = live->ids[index];
+    live->ids[index] = live->ids[--live->count];
+    return id;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const struct LatencySamples *sorted, double p)
+{
+    if (sorted->count == 0) return 0;
+    return sorted->ns[(size_t)(p * (double)(sorted->count - 1))];
+}
+
+/* Distance from the mid in ticks for a passive order, in [1, depth]. */
+static int passive_offset(const struct BenchOptions *options)
+{
+    if (!options->geometric) return 1 + (int)rng_below(options->depth);
+
+    /* Each level out is half as likely as the one before, capped at depth. */
+    int offset = 1;
+    while (offset < options->depth && (rng_next() & 1)) offset++;
+    return offset;
+}
+
+static void fill_order(struct Order *order, long id, char side, double price, int quantity)
+{
+    memset(order, 0, sizeof(*order));
+    snprintf(order->order_id, sizeof(order->order_id), "o%ld", id);
+    snprintf(order->user_id, sizeof(order->user_id), "u%ld", rng_below(USER_COUNT));
+    order->side = side;
+    order->price = price;
+    order->quantity = quantity;
+    order->timestamp = id;
+}
+
+static void free_trade_ids(char **trade_ids, int trade_count)
+{
+    if (!trade_ids) return;
+    for (int i = 0; i < trade_count; i++) free(trade_ids[i]);
+    free(trade_ids);
+}
+
+static int parse_mix(const char *arg, int weights[OP_COUNT])
+{
+    int parsed[OP_COUNT] = { 0 };
+    int count = sscanf(arg, "%d,%d,%d,%d,%d,%d", &parsed[0], &parsed[1], &parsed[2], &parsed[3], &parsed[4], &parsed[5]);
+    if (count != OP_COUNT && count != OP_COUNT - 1) {
+        return 0;
+    }
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (parsed[i] < 0) return 0;
+        total += parsed[i];
+    }
+    if (total == 0) return 0;
+    memcpy(weights, parsed, sizeof(parsed));
+    return 1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-n ops] [-s seed] [-d depth] [-q queue] [-k top_k]\n"
+            "          [-m add,cancel,aggr,top,best[,vwap]] [-p uniform|geometric] [-b map|ladder] [-c]\n"
+            "          [-B baseline] [-t tolerance]\n",
+            program);
+}
+
+/* Reports a result worse than the baseline's by more than tolerance percent; returns 1 if it is. */
+static int regressed(const char *op, const char *metric, double baseline, double current,
+                     int higher_is_better, double tolerance)
+{
+    double change = baseline > 0.0 ? (current - baseline) * 100.0 / baseline : 0.0;
+    int worse = higher_is_better ? change < -tolerance : change > tolerance;
+    if (worse) printf("REGRESSION %-8s %-10s %12.3f -> %12.3f (%+.1f%%)\n", op, metric, baseline, current, change);
+    return worse;
+}
+
+/*
+ * Compares this run's results against a baseline file holding an earlier run's output.
+ * Returns the number of regressions, or -1 if the baseline cannot be used.
+ */
+static int check_baseline(const char *path, const char *header, const struct OpResult results[OP_COUNT],
+                          double total_mops, double tolerance)
+{
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Cannot open baseline %s\n", path);
+        return -1;
+    }
+
+    char line[512];
+    if (!fgets(line, sizeof(line), in) || strncmp(line, header, strlen(header)) != 0 ||
+        (line[strlen(header)] != '\n' && line[strlen(header)] != '\0')) {
+        fprintf(stderr, "Baseline %s was run with different options\n", path);
+        fclose(in);
+        return -1;
+    }
+
+    int regressions = 0;
+    int compared = 0;
+    while (fgets(line, sizeof(line), in)) {
+        double mops;
+        if (sscanf(line, "total: %lf", &mops) == 1) {
+            regressions += regressed("total", "Mops/s", mops, total_mops, 1, tolerance);
+            compared++;
+            break; /* Anything after the totals (e.g. instrumentation) is not compared */
+        }
+
+        char name[16];
+        size_t count;
+        unsigned long long p50, p99, p999;
+        if (sscanf(line, "%15s %zu %lf %llu %llu %llu", name, &count, &mops, &p50, &p99, &p999) != 6) continue;
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (strcmp(name, op_names[op]) != 0 || count == 0 || results[op].count == 0) continue;
+            regressions += regressed(name, "Mops/s", mops, results[op].mops, 1, tolerance);
+            regressions += regressed(name, "p99(ns)", (double)p99, (double)results[op].p99, 0, tolerance);
+            compared++;
+        }
+    }
+    fclose(in);
+
+    if (compared == 0) {
+        fprintf(stderr, "Baseline %s holds no results\n", path);
+        return -1;
+    }
+    printf("perf-check: %d regression%s beyond %.1f%% of %s\n", regressions, regressions == 1 ? "" : "s",
+           tolerance, path);
+    return regressions;
+}
+
+// -------------------------------------------------------------------
+// Main: parse options, pre-fill the book, run the timed mix, report.
+// -------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    struct BenchOptions options = {
+        .ops = 1000000,
+        .seed = 1,
+        .depth = 50,
+        .queue = 10,
+        .top_k = 5,
+        .weights = { 60, 25, 10, 3, 2, 0 },
+        .geometric = 0,
+        .ladder = 0,
+        .cached = 0,
+        .baseline = NULL,
+        .tolerance = 10.0,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:d:q:k:m:p:b:cB:t:h")) != -1) {
+        switch (opt) {
+        case 'n': options.ops = atol(optarg); break;
+        case 's': options.seed = strtoull(optarg, NULL, 10); break;
+        case 'd': options.depth = atoi(optarg); break;
+        case 'q': options.queue = atoi(optarg); break;
+        case 'k': options.top_k = atoi(optarg); break;
+        case 'm':
+            if (!parse_mix(optarg, options.weights)) {
+                fprintf(stderr, "Invalid mix: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            if (strcmp(optarg, "uniform") == 0) options.geometric = 0;
+            else if (strcmp(optarg, "geometric") == 0) options.geometric = 1;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'b':
+            if (strcmp(optarg, "map") == 0) options.ladder = 0;
+            else if (strcmp(optarg, "ladder") == 0) options.ladder = 1;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 'c': options.cached = 1; break;
+        case 'B': options.baseline = optarg; break;
+        case 't': options.tolerance = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.ops <= 0 || options.depth <= 0 || options.queue < 0 || options.top_k < 0 ||
+        (options.cached && options.top_k == 0) || options.tolerance < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    rng_state = options.seed ? options.seed : 1;
+
+    struct OrderBookConfig config;
+    memset(&config, 0, sizeof(config));
+    config.order_capacity = (size_t)options.depth * options.queue * 2;
+    if (options.ladder) {
+        config.tick_size = TICK_SIZE;
+        config.min_price = MID_PRICE - (options.depth + 1) * TICK_SIZE;
+        config.max_price = MID_PRICE + (options.depth + 1) * TICK_SIZE;
+    }
+    if (options.cached) {
+        config.depth_cache = options.top_k;
+    }
+    OrderBook book = OrderBook_create_with_config(&config);
+    if (!book) {
+        fprintf(stderr, "Failed to create OrderBook\n");
+        return 1;
+    }
+
+    struct LiveOrders live = { NULL, 0, 0 };
+    struct LatencySamples samples[OP_COUNT];
+    memset(samples, 0, sizeof(samples));
+    long next_id = 0;
+    struct Order order;
+
+    /* Pre-fill both sides (untimed). */
+    for (int level = 1; level <= options.depth; level++) {
+        for (int i = 0; i < options.queue; i++) {
+            for (int side = 0; side < 2; side++) {
+                double price = side ? MID_PRICE - level * TICK_SIZE : MID_PRICE + level * TICK_SIZE;
+                fill_order(&order, next_id, side ? '1' : '0', price, 1 + (int)rng_below(MAX_QUANTITY));
+                OrderBook_add_order(book, &order, NULL);
+                push_live(&live, next_id++);
+            }
+        }
+    }
+
+    int total_weight = 0;
+    for (int i = 0; i < OP_COUNT; i++) total_weight += options.weights[i];
+    Instrument_reset(); /* Histograms cover the timed phase only. */
+
+    long trades = 0;
+    long cancel_hits = 0;
+    uint64_t wall_start = now_ns();
+
+    for (long n = 0; n < options.ops; n++) {
+        /* Pick the operation by weight. */
+        long pick = rng_below(total_weight);
+        int op = 0;
+        while (pick >= options.weights[op]) pick -= options.weights[op++];
+
+        uint64_t start, elapsed;
+        switch (op) {
+        case OP_ADD: {
+            int is_buy = (int)(rng_next() & 1);
+            int offset = passive_offset(&options);
+            double price = is_buy ? MID_PRICE - offset * TICK_SIZE : MID_PRICE + offset * TICK_SIZE;
+            fill_order(&order, next_id, is_buy ? '1' : '0', price, 1 + (int)rng_below(MAX_QUANTITY));
+            push_live(&live, next_id++);
+
+            int trade_count = 0;
+            start = now_ns();
+            char **trade_ids = OrderBook_add_order(book, &order, &trade_count);
+            elapsed = now_ns() - start;
+            free_trade_ids(trade_ids, trade_count);
+            trades += trade_count;
+            break;
+        }
+        case OP_CANCEL: {
+            long id = take_random_live(&live);
+            char order_id[37];
+            snprintf(order_id, sizeof(order_id), "o%ld", id);
+            start = now_ns();
+            int removed = id >= 0 && OrderBook_remove_order(book, order_id);
+            elapsed = now_ns() - start;
+            cancel_hits += removed;
+            break;
+        }
+        case OP_AGGR: {
+            int is_buy = (int)(rng_next() & 1);
+            double touch = is_buy ? OrderBook_get_best_ask(book) : OrderBook_get_best_bid(book);
+            if (touch == 0.0) touch = is_buy ? MID_PRICE + TICK_SIZE : MID_PRICE - TICK_SIZE;
+            fill_order(&order, next_id++, is_buy ? '1' : '0', touch, 1 + (int)rng_below(MAX_QUANTITY));
+
+            int trade_count = 0;
+            start = now_ns();
+            char **trade_ids = OrderBook_add_order(book, &order, &trade_count);
+            elapsed = now_ns() - start;
+            free_trade_ids(trade_ids, trade_count);
+            trades += trade_count;
+
+            /* Behave like an IOC order: drop any remainder that rested. */
+            OrderBook_remove_order(book, order.order_id);
+            break;
+        }
+        case OP_TOP: {
+            struct OrderBookLevelView *bids = NULL, *asks = NULL;
+            int bid_count = 0, ask_count = 0;
+            if (options.cached) {
+                const struct OrderBookLevelView *cached_bids, *cached_asks;
+                start = now_ns();
+                OrderBook_peek_top_levels(book, &cached_bids, &bid_count, &cached_asks, &ask_count);
+                elapsed = now_ns() - start;
+                break;
+            }
+            start = now_ns();
+            int ok = OrderBook_get_top_levels(book, options.top_k, &bids, &bid_count, &asks, &ask_count);
+            elapsed = now_ns() - start;
+            if (ok) {
+                free(bids);
+                free(asks);
+            }
+            break;
+        }
+        case OP_VWAP: {
+            char side = (rng_next() & 1) ? '1' : '0';
+            long quantity = (long)(options.top_k ? options.top_k : 1) * options.queue * MAX_QUANTITY / 2;
+            struct OrderBookFillEstimate estimate;
+            start = now_ns();
+            OrderBook_estimate_fill(book, side, quantity, &estimate);
+            elapsed = now_ns() - start;
+            volatile double vwap = estimate.vwap;
+            (void)vwap;
+            break;
+        }
+        default: {
+            start = now_ns();
+            volatile double best = OrderBook_get_best_bid(book);
+            elapsed = now_ns() - start;
+            (void)best;
+            break;
+        }
+        }
+
+        if (!push_sample(&samples[op], elapsed)) {
+            fprintf(stderr, "Out of memory recording samples\n");
+            return 1;
+        }
+    }
+
+    uint64_t wall_ns = now_ns() - wall_start;
+
+    /* Report */
+    char header[256];
+    snprintf(header, sizeof(header),
+             "BenchOrderBook: ops=%ld seed=%llu depth=%d queue=%d top_k=%d mix=%d,%d,%d,%d,%d,%d prices=%s backend=%s%s",
+             options.ops, (unsigned long long)options.seed, options.depth, options.queue, options.top_k,
+             options.weights[0], options.weights[1], options.weights[2], options.weights[3], options.weights[4], options.weights[5],
+             options.geometric ? "geometric" : "uniform", options.ladder ? "ladder" : "map",
+             options.cached ? " top=cached" : "");
+    printf("%s\n", header);
+    printf("%-8s %10s %12s %10s %10s %10s\n", "op", "count", "Mops/s", "p50(ns)", "p99(ns)", "p999(ns)");
+    struct OpResult results[OP_COUNT];
+    for (int op = 0; op < OP_COUNT; op++) {
+        struct LatencySamples *s = &samples[op];
+        uint64_t total_ns = 0;
+        for (size_t i = 0; i < s->count; i++) total_ns += s->ns[i];
+        if (s->count > 0) qsort(s->ns, s->count, sizeof(uint64_t), compare_u64);
+
+        double mops = total_ns ? (double)s->count * 1000.0 / (double)total_ns : 0.0;
+        printf("%-8s %10zu %12.3f %10llu %10llu %10llu\n", op_names[op], s->count, mops,
+               (unsigned long long)percentile(s, 0.50), (unsigned long long)percentile(s, 0.99),
+               (unsigned long long)percentile(s, 0.999));
+        results[op] = (struct OpResult){ s->count, mops, percentile(s, 0.99) };
+        free(s->ns);
+    }
+    double total_mops = wall_ns ? (double)options.ops * 1000.0 / (double)wall_ns : 0.0;
+    printf("total: %.3f Mops/s wall, %ld trades, %ld/%zu cancels hit\n",
+           total_mops, trades, cancel_hits, samples[OP_CANCEL].count);
+    if (Instrument_enabled()) Instrument_dump(stdout);
+
+    free(live.ids);
+    OrderBook_destroy(&book);
+
+    if (options.baseline) {
+        int regressions = check_baseline(options.baseline, header, results, total_mops, options.tolerance);
+        if (regressions != 0) return regressions < 0 ? 1 : 2;
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+/*******************************************************************************************/
+/* CsvReplay.c - Implementation file for the CsvReplay module
+ *
+ * Each line is split into (pointer, length) fields that point into the mapped file;
+ * nothing is copied until an order's IDs go into its struct Order. Numbers are parsed
+ * by hand: prices as fixed-point with nine decimals, divided into ticks with integer
+ * arithmetic, and tick counts turned back into a double the same way for every order,
+ * so equal prices always produce identical doubles.
+ */
+
+#include "CsvReplay.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CSV_REPLAY_DEFAULT_TICK 0.01
+#define CSV_REPLAY_MAX_FIELDS 8
+#define FIXED_DECIMALS 9
+#define FIXED_SCALE 1000000000LL
+
+// State shared by every line of a replay
+struct Replay {
+    OrderBook book;
+    const struct CsvReplayOptions *options;
+    struct CsvReplayStats *stats;
+    double tick_size;
+    double ticks_per_unit;              // Whole number of ticks per unit, or 0 if not integral
+    long default_timestamp;             // Used for ADD lines without a timestamp column
+    struct OrderBookMatchResult result; // Reused for every ADD
+};
+
+// Helper function prototypes
+static void replay_line(struct Replay *replay, const char *line, size_t length);
+static void copy_id(char *dest, const struct CsvField *field);
+
+// Public function implementations
+int CsvReplay_file(OrderBook book, const char *path, const struct CsvReplayOptions *options, struct CsvReplayStats *stats) {
+    if (!book || !path || !stats) return 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    int ok = CsvReplay_buffer(book, data, (size_t)st.st_size, options, stats);
+    munmap(data, (size_t)st.st_size);
+    return ok;
+}
+
+int CsvReplay_buffer(OrderBook book, const char *data, size_t length, const struct CsvReplayOptions *options, struct CsvReplayStats *stats) {
+    if (!book || (!data && length > 0) || !stats) return 0;
+
+    struct Replay replay;
+    memset(&replay, 0, sizeof(replay));
+    replay.book = book;
+    replay.options = options;
+    replay.stats = stats;
+    replay.tick_size = options && options->tick_size > 0.0 ? options->tick_size : CSV_REPLAY_DEFAULT_TICK;
+    double whole = round(1.0 / replay.tick_size);
+    replay.ticks_per_unit = fabs(1.0 / replay.tick_size - whole) < 1e-9 ? whole : 0.0;
+    replay.default_timestamp = (long)time(NULL);
+
+    const char *end = data + length;
+    const char *line = data;
+    while (line < end) {
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        const char *line_end = newline ? newline : end;
+
+        size_t line_length = (size_t)(line_end - line);
+        if (line_length > 0 && line[line_length - 1] == '\r') line_length--;
+        if (line_length > 0) replay_line(&replay, line, line_length);
+
+        line = line_end + 1;
+    }
+
+    OrderBookMatchResult_free(&replay.result);
+    return 1;
+}
+
+int CsvReplay_parse_ticks(const char *field, size_t length, double tick_size, long *ticks) {
+    if (!field || !ticks || tick_size < 1e-9) return 0;
+
+    // Parse as fixed point with FIXED_DECIMALS digits after the point
+    size_t i = 0;
+    int64_t whole = 0;
+    int digits = 0;
+    for (; i < length && field[i] >= '0' && field[i] <= '9'; i++, digits++) {
+        if (whole > (INT64_MAX / FIXED_SCALE) / 10) return 0;
+        whole = whole * 10 + (field[i] - '0');
+    }
+    int64_t fraction = 0;
+    int decimals = 0;
+    if (i < length && field[i] == '.') {
+        for (i++; i < length && field[i] >= '0' && field[i] <= '9'; i++, digits++) {
+            if (decimals < FIXED_DECIMALS) {
+                fraction = fraction * 10 + (field[i] - '0');
+                decimals++;
+            }
+        }
+    }
+    if (i != length || digits == 0) return 0;
+    while (decimals++ < FIXED_DECIMALS) fraction *= 10;
+
+    int64_t fixed = whole * FIXED_SCALE + fraction;
+    int64_t tick_fixed = llround(tick_size * FIXED_SCALE);
+    *ticks = (long)((fixed + tick_fixed / 2) / tick_fixed);
+    return 1;
+}
+
+int CsvReplay_split_fields(const char *line, size_t length, struct CsvField *fields, int max_fields) {
+    int count = 0;
+    const char *end = line + length;
+    const char *start = line;
+    for (;;) {
+        const char *comma = memchr(start, ',', (size_t)(end - start));
+        const char *field_end = comma ? comma : end;
+        if (count < max_fields) {
+            fields[count].start = start;
+            fields[count].length = (size_t)(field_end - start);
+        }
+        count++;
+        if (!comma) break;
+        start = comma + 1;
+    }
+    return count;
+}
+
+int CsvReplay_field_equals(const struct CsvField *field, const char *word) {
+    return strlen(word) == field->length && strncasecmp(field->start, word, field->length) == 0;
+}
+
+int CsvReplay_parse_long(const struct CsvField *field, long *value) {
+    if (field->length == 0) return 0;
+    long result = 0;
+    for (size_t i = 0; i < field->length; i++) {
+        char c = field->start[i];
+        if (c < '0' || c > '9' || result > (LONG_MAX - 9) / 10) return 0;
+        result = result * 10 + (c - '0');
+    }
+    *value = result;
+    return 1;
+}
+
+// Helper function implementations
+static void replay_line(struct Replay *replay, const char *line, size_t length) {
+    struct CsvReplayStats *stats = replay->stats;
+    struct CsvField fields[CSV_REPLAY_MAX_FIELDS];
+    int count = CsvReplay_split_fields(line, length, fields, CSV_REPLAY_MAX_FIELDS);
+    stats->lines++;
+
+    if (CsvReplay_field_equals(&fields[0], "ADD")) {
+        // ADD,order_id,user_id,side,price,quantity[,timestamp]
+        long ticks, quantity, timestamp = replay->default_timestamp;
+        if (count < 6 || count > 7 ||
+            !CsvReplay_parse_ticks(fields[4].start, fields[4].length, replay->tick_size, &ticks) ||
+            !CsvReplay_parse_long(&fields[5], &quantity) || quantity > INT32_MAX ||
+            (count == 7 && !CsvReplay_parse_long(&fields[6], &timestamp))) {
+            stats->errors++;
+            return;
+        }
+
+        struct Order order;
+        copy_id(order.order_id, &fields[1]);
+        copy_id(order.user_id, &fields[2]);
+        order.side = CsvReplay_field_equals(&fields[3], "buy") ? '1' : '0';
+        order.price = replay->ticks_per_unit ? ticks / replay->ticks_per_unit : ticks * replay->tick_size;
+        order.quantity = (int)quantity;
+        order.timestamp = timestamp;
+        order.order_type = ORDER_TYPE_LIMIT;
+        order.time_in_force = TIME_IN_FORCE_GTC;
+
+        if (OrderBook_add_order_with_result(replay->book, &order, &replay->result)) {
+            stats->adds++;
+        } else {
+            stats->errors++;
+        }
+        stats->trades += replay->result.count;
+
+    } else if (CsvReplay_field_equals(&fields[0], "REMOVE")) {
+        // REMOVE,order_id
+        if (count != 2) {
+            stats->errors++;
+            return;
+        }
+        char order_id[37];
+        copy_id(order_id, &fields[1]);
+        stats->removes += OrderBook_remove_order(replay->book, order_id);
+
+    } else {
+        stats->others++;
+        if (replay->options && replay->options->on_other) {
+            replay->options->on_other(replay->options->context, replay->book, line, length);
+        }
+    }
+}
+
+// Copies an ID field into a 37-byte buffer, truncating like the driver does
+static void copy_id(char *dest, const struct CsvField *field) {
+    size_t length = field->length < 36 ? field->length : 36;
+    memcpy(dest, field->start, length);
+    dest[length] = '\0';
+}
@@ -0,0 +1,111 @@
+/* CsvReplay.h - Header file for the CsvReplay module
+ *
+ * This module replays order CSV files (the OrderBookDriver format) into an OrderBook
+ * as fast as the book can take them. Files are memory-mapped and each line is parsed
+ * in place: fields are located without copying or terminating them, prices are parsed
+ * as fixed-point decimals straight to integer ticks, and timestamps come from an
+ * optional seventh ADD column instead of the wall clock.
+ *
+ * Lines have the same format as the driver's:
+ *   ADD,order_id,user_id,side,price,quantity[,timestamp]
+ *   REMOVE,order_id
+ * Any other command is handed to an optional callback (the driver uses it to print
+ * query results), so replaying never allocates or formats per order.
+ */
+#ifndef CSV_REPLAY_H
+#define CSV_REPLAY_H
+
+#include <stddef.h>
+#include "OrderBook.h"
+
+/* A field of a CSV line, pointing into the line. The field is not NUL-terminated. */
+struct CsvField {
+    const char *start;
+    size_t length;
+};
+
+/* Callback for lines that are not ADD or REMOVE. The line is not NUL-terminated. */
+typedef void (*CsvReplay_LineHandler)(void *context, OrderBook book, const char *line, size_t length);
+
+/* Settings for a replay. A zeroed struct uses a 0.01 tick and ignores other commands. */
+struct CsvReplayOptions {
+    double tick_size;                 /**< Prices are rounded to this tick (0 for 0.01). */
+    CsvReplay_LineHandler on_other;   /**< Called for other commands, or NULL to skip them. */
+    void *context;                    /**< Passed through to on_other. */
+};
+
+/* Counters accumulated by a replay. Zero-initialize before the first call. */
+struct CsvReplayStats {
+    long lines;   /**< Non-empty lines read. */
+    long adds;    /**< ADD lines applied. */
+    long removes; /**< REMOVE lines that removed an order. */
+    long trades;  /**< Trades executed by the ADD lines. */
+    long others;  /**< Lines with any other command. */
+    long errors;  /**< Malformed lines, and ADDs the book failed to apply. */
+};
+
+/**
+ * Memory-maps a CSV file and replays every line into the book.
+ *
+ * @param book The OrderBook instance.
+ * @param path The file to replay.
+ * @param options Replay settings, or NULL for defaults.
+ * @param stats Counters to add this file's results to.
+ * @return 1 if the file was replayed, 0 if it could not be opened or mapped.
+ */
+int CsvReplay_file(OrderBook book, const char *path, const struct CsvReplayOptions *options, struct CsvReplayStats *stats);
+
+/**
+ * Replays CSV lines from a buffer into the book.
+ *
+ * @param book The OrderBook instance.
+ * @param data The CSV text (need not be NUL-terminated).
+ * @param length The length of data in bytes.
+ * @param options Replay settings, or NULL for defaults.
+ * @param stats Counters to add the results to.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int CsvReplay_buffer(OrderBook book, const char *data, size_t length, const struct CsvReplayOptions *options, struct CsvReplayStats *stats);
+
+/**
+ * Parses a decimal price and rounds it to the nearest whole number of ticks.
+ *
+ * @param field The price text, e.g. "100.50" (need not be NUL-terminated).
+ * @param length The length of the field.
+ * @param tick_size The tick size (at least 1e-9).
+ * @param ticks Output pointer to store the price in ticks.
+ * @return 1 if the field is a valid non-negative decimal, 0 otherwise.
+ */
+int CsvReplay_parse_ticks(const char *field, size_t length, double tick_size, long *ticks);
+
+/**
+ * Splits a CSV line on commas into fields that point into the line, without copying.
+ *
+ * @param line The line (need not be NUL-terminated).
+ * @param length The length of the line.
+ * @param fields Output array of max_fields fields. Fields past max_fields are counted
+ *               but not stored.
+ * @param max_fields The number of fields the array holds.
+ * @return The number of fields in the line (at least 1).
+ */
+int CsvReplay_split_fields(const char *line, size_t length, struct CsvField *fields, int max_fields);
+
+/**
+ * Compares a field with a word, ignoring case.
+ *
+ * @param field The field.
+ * @param word The NUL-terminated word to compare with.
+ * @return 1 if they are equal, 0 otherwise.
+ */
+int CsvReplay_field_equals(const struct CsvField *field, const char *word);
+
+/**
+ * Parses a field of decimal digits as a non-negative number.
+ *
+ * @param field The field.
+ * @param value Output pointer to store the number.
+ * @return 1 if the field is a non-empty run of digits that fits a long, 0 otherwise.
+ */
+int CsvReplay_parse_long(const struct CsvField *field, long *value);
+
+#endif // CSV_REPLAY_H
@@ -0,0 +1,138 @@
+/*******************************************************************************************/
+/* DepthSnapshot.c - Implementation file for the DepthSnapshot module
+ *
+ * The version counter is even between publishes and odd during one, and version / 2 is
+ * the number of publishes completed. Each level is packed into two atomic words (the
+ * price's bits, then size and order count), bids first and asks after them. The writer's
+ * release fence orders its odd version before its level stores, and the final release
+ * store orders the level stores before the even version; the reader's acquire fence
+ * mirrors this, so an unchanged even version means no level store overlapped the copy.
+ */
+
+#include "DepthSnapshot.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEPTH_SNAPSHOT_CACHE_LINE 64
+
+// DepthSnapshot structure. The block starts on its own cache line so it shares none with
+// the writer's other state.
+struct DepthSnapshot {
+    alignas(DEPTH_SNAPSHOT_CACHE_LINE) atomic_uint_fast64_t version; // Odd while a publish is in progress
+    atomic_uint_fast64_t sequence; // Sequence of the last publish
+    atomic_uint_fast64_t counts;   // bid_count << 32 | ask_count
+    atomic_uint_fast64_t words[2 * 2 * DEPTH_SNAPSHOT_MAX_LEVELS]; // Packed levels, bids then asks
+    int depth;                     // Levels per side; read-only after creation
+};
+
+// Helper function prototypes
+static void store_levels(DepthSnapshot snapshot, int first_word, const struct OrderBookLevelView *levels, int count);
+static void load_levels(const DepthSnapshot snapshot, int first_word, struct OrderBookLevelView *levels, int count);
+
+// Public function implementations
+DepthSnapshot DepthSnapshot_create(int depth) {
+    if (depth < 1 || depth > DEPTH_SNAPSHOT_MAX_LEVELS) return NULL;
+
+    DepthSnapshot snapshot = aligned_alloc(DEPTH_SNAPSHOT_CACHE_LINE, sizeof(struct DepthSnapshot));
+    if (!snapshot) return NULL;
+    memset(snapshot, 0, sizeof(struct DepthSnapshot));
+
+    atomic_init(&snapshot->version, 0);
+    atomic_init(&snapshot->sequence, 0);
+    atomic_init(&snapshot->counts, 0);
+    for (int i = 0; i < 2 * 2 * DEPTH_SNAPSHOT_MAX_LEVELS; i++) atomic_init(&snapshot->words[i], 0);
+    snapshot->depth = depth;
+    return snapshot;
+}
+
+void DepthSnapshot_destroy(DepthSnapshot *snapshot) {
+    if (!snapshot || !*snapshot) return;
+
+    free(*snapshot);
+    *snapshot = NULL;
+}
+
+int DepthSnapshot_depth(const DepthSnapshot snapshot) {
+    return snapshot ? snapshot->depth : 0;
+}
+
+size_t DepthSnapshot_memory_usage(const DepthSnapshot snapshot) {
+    return snapshot ? sizeof(struct DepthSnapshot) : 0;
+}
+
+void DepthSnapshot_publish(DepthSnapshot snapshot, uint64_t sequence,
+                           const struct OrderBookLevelView *bids, int bid_count,
+                           const struct OrderBookLevelView *asks, int ask_count) {
+    if (!snapshot) return;
+    if (!bids || bid_count < 0) bid_count = 0;
+    if (!asks || ask_count < 0) ask_count = 0;
+    if (bid_count > snapshot->depth) bid_count = snapshot->depth;
+    if (ask_count > snapshot->depth) ask_count = snapshot->depth;
+
+    // Only this thread writes version, so a relaxed load sees its own last store
+    uint64_t version = atomic_load_explicit(&snapshot->version, memory_order_relaxed);
+    atomic_store_explicit(&snapshot->version, version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&snapshot->sequence, sequence, memory_order_relaxed);
+    atomic_store_explicit(&snapshot->counts, (uint64_t)bid_count << 32 | (uint32_t)ask_count, memory_order_relaxed);
+    store_levels(snapshot, 0, bids, bid_count);
+    store_levels(snapshot, 2 * DEPTH_SNAPSHOT_MAX_LEVELS, asks, ask_count);
+
+    atomic_store_explicit(&snapshot->version, version + 2, memory_order_release);
+}
+
+int DepthSnapshot_read(const DepthSnapshot snapshot, struct DepthSnapshotView *view) {
+    if (!snapshot || !view) return 0;
+
+    while (!DepthSnapshot_try_read(snapshot, view)) {
+    }
+    return 1;
+}
+
+int DepthSnapshot_try_read(const DepthSnapshot snapshot, struct DepthSnapshotView *view) {
+    if (!snapshot || !view) return 0;
+
+    uint64_t before = atomic_load_explicit(&snapshot->version, memory_order_acquire);
+    if (before & 1) return 0;
+
+    uint64_t counts = atomic_load_explicit(&snapshot->counts, memory_order_relaxed);
+    view->sequence = atomic_load_explicit(&snapshot->sequence, memory_order_relaxed);
+    view->bid_count = (int)(counts >> 32);
+    view->ask_count = (int)(uint32_t)counts;
+    // Counts from a torn copy are discarded below, but must not overrun the view first
+    if (view->bid_count > snapshot->depth) view->bid_count = snapshot->depth;
+    if (view->ask_count > snapshot->depth) view->ask_count = snapshot->depth;
+    load_levels(snapshot, 0, view->bids, view->bid_count);
+    load_levels(snapshot, 2 * DEPTH_SNAPSHOT_MAX_LEVELS, view->asks, view->ask_count);
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = atomic_load_explicit(&snapshot->version, memory_order_relaxed);
+    if (after != before) return 0;
+
+    view->version = before / 2;
+    return 1;
+}
+
+// Helper function implementations
+static void store_levels(DepthSnapshot snapshot, int first_word, const struct OrderBookLevelView *levels, int count) {
+    for (int i = 0; i < count; i++) {
+        uint64_t price;
+        memcpy(&price, &levels[i].price, sizeof(price));
+        uint64_t quantities = (uint64_t)(uint32_t)levels[i].size << 32 | (uint32_t)levels[i].order_count;
+        atomic_store_explicit(&snapshot->words[first_word + 2 * i], price, memory_order_relaxed);
+        atomic_store_explicit(&snapshot->words[first_word + 2 * i + 1], quantities, memory_order_relaxed);
+    }
+}
+
+static void load_levels(const DepthSnapshot snapshot, int first_word, struct OrderBookLevelView *levels, int count) {
+    for (int i = 0; i < count; i++) {
+        uint64_t price = atomic_load_explicit(&snapshot->words[first_word + 2 * i], memory_order_relaxed);
+        uint64_t quantities = atomic_load_explicit(&snapshot->words[first_word + 2 * i + 1], memory_order_relaxed);
+        memcpy(&levels[i].price, &price, sizeof(price));
+        levels[i].size = (int)(quantities >> 32);
+        levels[i].order_count = (int)(uint32_t)quantities;
+    }
+}
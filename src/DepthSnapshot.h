@@ -0,0 +1,101 @@
+/* DepthSnapshot.h - Header file for the DepthSnapshot module
+ *
+ * This module provides a block holding the best levels of both sides of a book, written
+ * by one thread and read by any number of others without locks. The writer never waits
+ * for readers: it bumps a version counter to an odd value, stores the levels, and bumps
+ * it again (a seqlock). A reader copies the levels out and keeps the copy only if the
+ * version was even and unchanged across the copy, retrying otherwise, so every copy it
+ * returns is a view the writer published as a whole.
+ *
+ * The levels are stored as atomic words, so the copy is race-free even while it overlaps
+ * a write; only the version check decides whether the copy is kept.
+ */
+#ifndef DEPTH_SNAPSHOT_H
+#define DEPTH_SNAPSHOT_H
+
+#include <stdint.h>
+#include "OrderBookSide.h"
+
+#define DEPTH_SNAPSHOT_MAX_LEVELS 32 // Most levels per side a snapshot holds
+
+// DepthSnapshot type definition
+typedef struct DepthSnapshot *DepthSnapshot;
+
+/* A consistent copy of a published snapshot, filled in by DepthSnapshot_read. */
+struct DepthSnapshotView {
+    uint64_t sequence;  /**< Sequence the writer published the levels with. */
+    uint64_t version;   /**< Number of publishes before this one; grows by one per publish. */
+    int bid_count;      /**< Number of entries in bids. */
+    int ask_count;      /**< Number of entries in asks. */
+    struct OrderBookLevelView bids[DEPTH_SNAPSHOT_MAX_LEVELS]; /**< Best bid levels, best first. */
+    struct OrderBookLevelView asks[DEPTH_SNAPSHOT_MAX_LEVELS]; /**< Best ask levels, best first. */
+};
+
+/**
+ * Creates a new DepthSnapshot instance holding no levels.
+ *
+ * @param depth Levels per side to hold, from 1 to DEPTH_SNAPSHOT_MAX_LEVELS.
+ * @return A newly allocated DepthSnapshot instance, or NULL on failure or an invalid depth.
+ */
+DepthSnapshot DepthSnapshot_create(int depth);
+
+/**
+ * Destroys a DepthSnapshot instance. No thread may be using it.
+ *
+ * @param snapshot A pointer to the DepthSnapshot instance to destroy.
+ */
+void DepthSnapshot_destroy(DepthSnapshot *snapshot);
+
+/**
+ * Gets the number of levels per side the snapshot holds.
+ *
+ * @param snapshot The DepthSnapshot instance.
+ * @return The depth, or 0 if snapshot is NULL.
+ */
+int DepthSnapshot_depth(const DepthSnapshot snapshot);
+
+/**
+ * Gets the bytes the snapshot holds. The block is sized for DEPTH_SNAPSHOT_MAX_LEVELS
+ * levels per side whatever its depth.
+ *
+ * @param snapshot The DepthSnapshot instance.
+ * @return The bytes allocated, or 0 if snapshot is NULL.
+ */
+size_t DepthSnapshot_memory_usage(const DepthSnapshot snapshot);
+
+/**
+ * Publishes new levels. Only one thread may publish to a snapshot. Levels beyond the
+ * snapshot's depth are ignored.
+ *
+ * @param snapshot The DepthSnapshot instance.
+ * @param sequence A value readers get back with the levels (e.g. the last message applied).
+ * @param bids Best bid levels, best first.
+ * @param bid_count Number of entries in bids.
+ * @param asks Best ask levels, best first.
+ * @param ask_count Number of entries in asks.
+ */
+void DepthSnapshot_publish(DepthSnapshot snapshot, uint64_t sequence,
+                           const struct OrderBookLevelView *bids, int bid_count,
+                           const struct OrderBookLevelView *asks, int ask_count);
+
+/**
+ * Copies the most recently published levels. Safe to call from any thread while another
+ * publishes; it retries until its copy was not overlapped by a publish.
+ *
+ * @param snapshot The DepthSnapshot instance.
+ * @param view Output copy.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int DepthSnapshot_read(const DepthSnapshot snapshot, struct DepthSnapshotView *view);
+
+/**
+ * Makes a single attempt to copy the most recently published levels, for readers that
+ * would rather do something else than wait out a publish.
+ *
+ * @param snapshot The DepthSnapshot instance.
+ * @param view Output copy, valid only if 1 is returned.
+ * @return 1 if the copy is consistent, 0 if a publish overlapped it or on invalid arguments.
+ */
+int DepthSnapshot_try_read(const DepthSnapshot snapshot, struct DepthSnapshotView *view);
+
+#endif // DEPTH_SNAPSHOT_H
@@ -6,56 +6,191 @@
  * HashTable.c - Implementation File
  * ----------------------------------
  * Implements the HashTable module defined in HashTable.h.
+ *
+ * The table uses open addressing with Robin Hood linear probing over a power-of-two
+ * array of 64-byte slots. Each slot stores the key's full hash, so probes compare
+ * integers before touching key bytes, and keys shorter than HASH_INLINE_KEY bytes
+ * are stored in the slot itself rather than strdup'd. Deletion shifts the following
+ * run back by one, so the main table never holds tombstones.
+ *
+ * Resizing is incremental. A resize allocates the new array and keeps the old one;
+ * every add or remove then migrates a few old slots, and lookups check both arrays
+ * until the old one is drained. No single call rehashes the whole table. The table
+ * doubles when an add would take it past 3/4 full and halves when a remove leaves it
+ * under 1/8 full, but never drops below the capacity it was created with.
  */
 
 #include "HashTable.h"
+#include "Instrument.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Node structure for separate chaining
-typedef struct HashNode {
-    char *key;
+#define HASH_INLINE_KEY 40      // Keys up to 39 characters live inside the slot
+#define HASH_MIN_CAPACITY 8
+#define HASH_MIGRATE_STEP 16    // Old slots migrated per add or remove during a resize
+#define HASH_SHRINK_LOAD 8      // Halve when fewer than 1 in this many slots are used
+
+#define HASH_EMPTY 0            // Reserved hash values; real hashes are remapped above them
+#define HASH_DELETED 1          // Only used in the old array while it is being drained
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)(address))
+#endif
+
+// Slot of the open-addressed array (64 bytes)
+typedef struct HashSlot {
+    uint64_t hash;      // Full hash of the key, or HASH_EMPTY / HASH_DELETED
     void *value;
-    struct HashNode *next;
-} *HashNode;
+    uint32_t key_len;   // Length of the key, excluding the terminator
+    union {
+        char inline_key[HASH_INLINE_KEY];
+        char *heap_key; // Used when key_len >= HASH_INLINE_KEY
+    } key;
+} HashSlot;
 
 // HashTable structure
 struct HashTable {
-    size_t capacity; // Total capacity of the hash table
-    size_t size;     // Current number of elements in the hash table
-    HashNode *buckets; // Array of bucket pointers
+    HashSlot *slots;     // Current array
+    size_t mask;         // Capacity of slots minus one
+    size_t size;         // Elements in slots
+    size_t min_mask;     // Mask of the capacity the table was created with; it never shrinks below
+    size_t key_bytes;    // Bytes of keys too long to store inline
+
+    HashSlot *old_slots; // Array being drained after a resize, or NULL
+    size_t old_mask;     // Capacity of old_slots minus one
+    size_t old_size;     // Elements still in old_slots
+    size_t migrate_pos;  // Next old slot to migrate
 };
 
-// Hash function (djb2 algorithm)
-static unsigned long hash(const char *str) {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;
-    }
-    return hash;
-}
-
-// Helper function to resize the hash table
-static int resize_table(HashTable table) {
-    size_t new_capacity = table->capacity * 2;
-    HashNode *new_buckets = calloc(new_capacity, sizeof(HashNode));
-    if (!new_buckets) return -1;
-
-    for (size_t i = 0; i < table->capacity; ++i) {
-        HashNode node = table->buckets[i];
-        while (node) {
-            HashNode next = node->next;
-            unsigned long new_index = hash(node->key) % new_capacity;
-            node->next = new_buckets[new_index];
-            new_buckets[new_index] = node;
-            node = next;
+// Hash function (64-bit FNV-1a); also returns the key length
+static uint64_t hash(const char *str, uint32_t *len) {
+    uint64_t h = 1469598103934665603ULL;
+    const char *p = str;
+    while (*p) {
+        h ^= (unsigned char)*p++;
+        h *= 1099511628211ULL;
+    }
+    *len = (uint32_t)(p - str);
+    return h < 2 ? h + 2 : h;
+}
+
+static const char *slot_key(const HashSlot *slot) {
+    return slot->key_len < HASH_INLINE_KEY ? slot->key.inline_key : slot->key.heap_key;
+}
+
+static int slot_matches(const HashSlot *slot, uint64_t h, const char *key, uint32_t len) {
+    return slot->hash == h && slot->key_len == len && memcmp(slot_key(slot), key, len) == 0;
+}
+
+static void free_slot_key(HashTable table, HashSlot *slot) {
+    if (slot->key_len >= HASH_INLINE_KEY) {
+        free(slot->key.heap_key);
+        table->key_bytes -= slot->key_len + 1;
+    }
+}
+
+// Distance of the slot at index from its home index
+static size_t probe_distance(const HashTable table, const HashSlot *slot, size_t index) {
+    return (index - (slot->hash & table->mask)) & table->mask;
+}
+
+// Index of key in the current array, or -1 if it is absent
+static long find_current(const HashTable table, uint64_t h, const char *key, uint32_t len) {
+    size_t index = h & table->mask;
+    for (size_t dist = 0;; ++dist) {
+        const HashSlot *slot = &table->slots[index];
+        // Robin Hood ordering: a richer slot means the key would have been placed before it
+        if (slot->hash == HASH_EMPTY || probe_distance(table, slot, index) < dist) return -1;
+        if (slot_matches(slot, h, key, len)) return (long)index;
+        index = (index + 1) & table->mask;
+    }
+}
+
+// Index of key in the old array, or -1 if it is absent
+static long find_old(const HashTable table, uint64_t h, const char *key, uint32_t len) {
+    if (!table->old_slots) return -1;
+    size_t index = h & table->old_mask;
+    for (size_t probes = 0; probes <= table->old_mask; ++probes) {
+        const HashSlot *slot = &table->old_slots[index];
+        if (slot->hash == HASH_EMPTY) return -1;
+        if (slot_matches(slot, h, key, len)) return (long)index;
+        index = (index + 1) & table->old_mask;
+    }
+    return -1;
+}
+
+// Places a slot whose key is known to be absent into the current array
+static void insert_current(HashTable table, HashSlot incoming) {
+    size_t index = incoming.hash & table->mask;
+    size_t dist = 0;
+    for (;;) {
+        HashSlot *slot = &table->slots[index];
+        if (slot->hash == HASH_EMPTY) {
+            *slot = incoming;
+            table->size++;
+            return;
+        }
+        size_t slot_dist = probe_distance(table, slot, index);
+        if (slot_dist < dist) {
+            HashSlot displaced = *slot;
+            *slot = incoming;
+            incoming = displaced;
+            dist = slot_dist;
+        }
+        index = (index + 1) & table->mask;
+        dist++;
+    }
+}
+
+// Removes the slot at index from the current array by shifting its run back
+static void remove_current(HashTable table, size_t index) {
+    for (;;) {
+        size_t next = (index + 1) & table->mask;
+        HashSlot *slot = &table->slots[next];
+        if (slot->hash == HASH_EMPTY || probe_distance(table, slot, next) == 0) break;
+        table->slots[index] = *slot;
+        index = next;
+    }
+    table->slots[index].hash = HASH_EMPTY;
+    table->size--;
+}
+
+// Moves up to count old slots into the current array, freeing the old array once drained
+static void migrate(HashTable table, size_t count) {
+    while (table->old_slots && count-- > 0) {
+        HashSlot *slot = &table->old_slots[table->migrate_pos];
+        if (slot->hash > HASH_DELETED) {
+            insert_current(table, *slot);
+            slot->hash = HASH_DELETED; // Later probes in the old array must continue past it
+            table->old_size--;
+        }
+        if (++table->migrate_pos > table->old_mask || table->old_size == 0) {
+            free(table->old_slots);
+            table->old_slots = NULL;
+            table->old_size = 0;
         }
     }
+}
+
+// Starts an incremental resize to new_capacity, finishing any resize still running
+static int resize_table(HashTable table, size_t new_capacity) {
+    HashSlot *new_slots = calloc(new_capacity, sizeof(HashSlot));
+    if (!new_slots) return -1;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
 
-    free(table->buckets);
-    table->buckets = new_buckets;
-    table->capacity = new_capacity;
+    migrate(table, SIZE_MAX);
+
+    table->old_slots = table->slots;
+    table->old_mask = table->mask;
+    table->old_size = table->size;
+    table->migrate_pos = 0;
+
+    table->slots = new_slots;
+    table->mask = new_capacity - 1;
+    table->size = 0;
     return 0;
 }
 
@@ -64,14 +199,19 @@ HashTable HashTable_create(size_t capacity) {
 
     HashTable table = malloc(sizeof(struct HashTable));
     if (!table) return NULL;
+    memset(table, 0, sizeof(struct HashTable));
 
-    table->capacity = capacity;
-    table->size = 0;
-    table->buckets = calloc(capacity, sizeof(HashNode));
-    if (!table->buckets) {
+    // Room for capacity elements below the 3/4 load factor
+    size_t slots = HASH_MIN_CAPACITY;
+    while (slots * 3 / 4 < capacity) slots *= 2;
+
+    table->slots = calloc(slots, sizeof(HashSlot));
+    if (!table->slots) {
         free(table);
         return NULL;
     }
+    table->mask = slots - 1;
+    table->min_mask = table->mask;
 
     return table;
 }
@@ -80,17 +220,17 @@ void HashTable_destroy(HashTable *table) {
     if (!table || !*table) return;
     HashTable t = *table;
 
-    for (size_t i = 0; i < t->capacity; ++i) {
-        HashNode node = t->buckets[i];
-        while (node) {
-            HashNode next = node->next;
-            free(node->key);
-            free(node);
-            node = next;
+    for (size_t i = 0; i <= t->mask; ++i) {
+        if (t->slots[i].hash > HASH_DELETED) free_slot_key(t, &t->slots[i]);
+    }
+    if (t->old_slots) {
+        for (size_t i = 0; i <= t->old_mask; ++i) {
+            if (t->old_slots[i].hash > HASH_DELETED) free_slot_key(t, &t->old_slots[i]);
         }
     }
 
-    free(t->buckets);
+    free(t->slots);
+    free(t->old_slots);
     free(t);
 
     *table = NULL;
@@ -99,77 +239,105 @@ void HashTable_destroy(HashTable *table) {
 int HashTable_add(HashTable table, const char *key, void *value) {
     if (!table || !key) return -1;
 
-    // Resize if load factor exceeds 0.75
-    if ((double)table->size / table->capacity >= 0.75) {
-        if (resize_table(table) != 0) return -1;
-    }
+    migrate(table, HASH_MIGRATE_STEP);
 
-    unsigned long index = hash(key) % table->capacity;
-    HashNode node = table->buckets[index];
+    uint32_t len;
+    uint64_t h = hash(key, &len);
 
-    while (node) {
-        if (strcmp(node->key, key) == 0) {
-            node->value = value; // Update value if key exists
-            return 0;
-        }
-        node = node->next;
+    // Update value if key exists
+    long index = find_current(table, h, key, len);
+    if (index >= 0) {
+        table->slots[index].value = value;
+        return 0;
+    }
+    index = find_old(table, h, key, len);
+    if (index >= 0) {
+        table->old_slots[index].value = value;
+        return 0;
     }
 
-    node = malloc(sizeof(struct HashNode));
-    if (!node) return -1;
-
-    node->key = strdup(key);
-    if (!node->key) {
-        free(node);
-        return -1;
+    // Resize if load factor would exceed 0.75
+    if ((table->size + table->old_size + 1) * 4 > (table->mask + 1) * 3) {
+        if (resize_table(table, (table->mask + 1) * 2) != 0) return -1;
     }
 
-    node->value = value;
-    node->next = table->buckets[index];
-    table->buckets[index] = node;
-    table->size++;
+    HashSlot slot;
+    slot.hash = h;
+    slot.value = value;
+    slot.key_len = len;
+    if (len < HASH_INLINE_KEY) {
+        memcpy(slot.key.inline_key, key, len + 1);
+    } else {
+        slot.key.heap_key = malloc(len + 1);
+        if (!slot.key.heap_key) return -1;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+        memcpy(slot.key.heap_key, key, len + 1);
+        table->key_bytes += len + 1;
+    }
 
+    insert_current(table, slot);
     return 0;
 }
 
 void *HashTable_get(const HashTable table, const char *key) {
     if (!table || !key) return NULL;
 
-    unsigned long index = hash(key) % table->capacity;
-    HashNode node = table->buckets[index];
+    uint32_t len;
+    uint64_t h = hash(key, &len);
 
-    while (node) {
-        if (strcmp(node->key, key) == 0) {
-            return node->value; // Return value if key matches
-        }
-        node = node->next;
-    }
+    long index = find_current(table, h, key, len);
+    if (index >= 0) return table->slots[index].value;
+    index = find_old(table, h, key, len);
+    if (index >= 0) return table->old_slots[index].value;
 
     return NULL; // Key not found
 }
 
+void HashTable_prefetch(const HashTable table, const char *key) {
+    if (!table || !key) return;
+
+    uint32_t len;
+    uint64_t h = hash(key, &len);
+    PREFETCH(&table->slots[h & table->mask]);
+}
+
 int HashTable_remove(HashTable table, const char *key) {
     if (!table || !key) return -1;
 
-    unsigned long index = hash(key) % table->capacity;
-    HashNode node = table->buckets[index];
-    HashNode prev = NULL;
-
-    while (node) {
-        if (strcmp(node->key, key) == 0) {
-            if (prev) {
-                prev->next = node->next;
-            } else {
-                table->buckets[index] = node->next;
-            }
-            free(node->key);
-            free(node);
-            table->size--;
-            return 0; // Key removed successfully
+    migrate(table, HASH_MIGRATE_STEP);
+
+    uint32_t len;
+    uint64_t h = hash(key, &len);
+
+    long index = find_current(table, h, key, len);
+    if (index >= 0) {
+        free_slot_key(table, &table->slots[index]);
+        remove_current(table, (size_t)index);
+        // Shrinking is best effort; the table stays correct at its current size if it fails
+        if (!table->old_slots && table->mask > table->min_mask &&
+            table->size * HASH_SHRINK_LOAD < table->mask + 1) {
+            resize_table(table, (table->mask + 1) / 2);
         }
-        prev = node;
-        node = node->next;
+        return 0; // Key removed successfully
+    }
+    index = find_old(table, h, key, len);
+    if (index >= 0) {
+        free_slot_key(table, &table->old_slots[index]);
+        table->old_slots[index].hash = HASH_DELETED;
+        table->old_size--;
+        return 0;
     }
 
     return -1; // Key not found
-}
\ No newline at end of file
+}
+
+size_t HashTable_size(const HashTable table) {
+    return table ? table->size + table->old_size : 0;
+}
+
+size_t HashTable_memory_usage(const HashTable table) {
+    if (!table) return 0;
+    size_t bytes = sizeof(struct HashTable) + (table->mask + 1) * sizeof(HashSlot) + table->key_bytes;
+    if (table->old_slots) bytes += (table->old_mask + 1) * sizeof(HashSlot);
+    return bytes;
+}
@@ -3,6 +3,10 @@
  * Date: 01/18/2025
  * HashTable Module
  * Provides an interface for creating and manipulating a hash table, supporting keys as C strings.
+ * Keys are copied into the table (short keys are stored inline, without a separate allocation),
+ * and resizing the table is spread across later calls rather than done in one pass. The
+ * table grows as keys are added and shrinks back as they are removed, though never below
+ * the capacity it was created with.
  *
  */
 #ifndef HASHTABLE_H
@@ -57,6 +61,17 @@ int HashTable_add(HashTable table, const char *key, void *value);
  */
 void *HashTable_get(const HashTable table, const char *key);
 
+/*
+ * Function: HashTable_prefetch
+ * ----------------------------
+ * Hints the CPU to start loading the slot a later lookup of key will probe first,
+ * so that lookup does not stall on a cache miss. Has no other effect.
+ *
+ * @param table: Hash table.
+ * @param key: Pointer to the key (null-terminated string).
+ */
+void HashTable_prefetch(const HashTable table, const char *key);
+
 /*
  * Function: HashTable_remove
  * ---------------------------
@@ -68,4 +83,25 @@ void *HashTable_get(const HashTable table, const char *key);
  */
 int HashTable_remove(HashTable table, const char *key);
 
+/*
+ * Function: HashTable_size
+ * -------------------------
+ * Gets the number of key-value pairs in the hash table.
+ *
+ * @param table: Hash table.
+ * @return: The number of stored keys.
+ */
+size_t HashTable_size(const HashTable table);
+
+/*
+ * Function: HashTable_memory_usage
+ * --------------------------------
+ * Gets the bytes the hash table holds: its slots, out-of-line keys and, while
+ * a resize is in progress, the array being drained.
+ *
+ * @param table: Hash table.
+ * @return: The bytes allocated, or 0 if table is NULL.
+ */
+size_t HashTable_memory_usage(const HashTable table);
+
 #endif // HASHTABLE_H
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*******************************************************************************************/
+/* IdTable.c - Implementation file for the IdTable module
+ *
+ * Handles index an array of entries holding each string and its reference count. A
+ * HashTable maps strings back to their handle. Freed handles are threaded onto a
+ * freelist through their entries and handed out again before the array grows.
+ * Strings that fit an Order's ID field are copied into blocks from a Pool reserved
+ * for the table's capacity, so interning on a warmed table does not call malloc.
+ */
+
+#include "IdTable.h"
+#include "HashTable.h"
+#include "Instrument.h"
+#include "Pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ID_TABLE_DEFAULT_CAPACITY 1024
+#define ID_TABLE_STRING_SIZE 37 // An Order's ID field; longer strings are allocated on their own
+
+struct IdEntry {
+    char *id;           /**< Interned string, or NULL if the handle is free. */
+    uint32_t refs;      /**< References held on the handle. */
+    IdHandle next_free; /**< Next free handle when this one is free. */
+};
+
+struct IdTable {
+    HashTable index;         /**< Interned string -> handle. */
+    Pool strings;            /**< Blocks holding interned strings up to ID_TABLE_STRING_SIZE bytes. */
+    struct IdEntry *entries; /**< Entries indexed by handle; entries[0] is unused. */
+    size_t used;             /**< Handles handed out so far (live or free), plus entry 0. */
+    size_t capacity;         /**< Allocated entries. */
+    IdHandle free_head;      /**< First free handle, or ID_HANDLE_NONE. */
+    size_t count;            /**< Live handles. */
+    size_t string_bytes;     /**< Bytes of the interned strings too long for the pool. */
+};
+
+// Helper function prototypes
+static IdHandle new_handle(IdTable table);
+static struct IdEntry *live_entry(const IdTable table, IdHandle handle);
+static char *copy_string(IdTable table, const char *id);
+static void free_string(IdTable table, char *id);
+
+// Public function implementations
+IdTable IdTable_create(size_t capacity) {
+    if (capacity == 0) capacity = ID_TABLE_DEFAULT_CAPACITY;
+
+    IdTable table = malloc(sizeof(struct IdTable));
+    if (!table) return NULL;
+    memset(table, 0, sizeof(struct IdTable));
+
+    table->index = HashTable_create(capacity);
+    table->entries = calloc(capacity + 1, sizeof(struct IdEntry));
+    table->strings = Pool_create(ID_TABLE_STRING_SIZE, 0);
+    if (!table->index || !table->entries || !table->strings || !Pool_reserve(table->strings, capacity)) {
+        HashTable_destroy(&(table->index));
+        free(table->entries);
+        Pool_destroy(&(table->strings));
+        free(table);
+        return NULL;
+    }
+    table->capacity = capacity + 1;
+    table->used = 1;
+    return table;
+}
+
+void IdTable_destroy(IdTable *table) {
+    if (!table || !*table) return;
+    IdTable t = *table;
+
+    for (size_t i = 1; i < t->used; ++i) {
+        free_string(t, t->entries[i].id);
+    }
+    free(t->entries);
+    Pool_destroy(&(t->strings));
+    HashTable_destroy(&(t->index));
+    free(t);
+
+    *table = NULL;
+}
+
+IdHandle IdTable_intern(IdTable table, const char *id) {
+    if (!table || !id) return ID_HANDLE_NONE;
+
+    IdHandle handle = IdTable_find(table, id);
+    if (handle != ID_HANDLE_NONE) {
+        table->entries[handle].refs++;
+        return handle;
+    }
+
+    handle = new_handle(table);
+    if (handle == ID_HANDLE_NONE) return ID_HANDLE_NONE;
+
+    struct IdEntry *entry = &table->entries[handle];
+    entry->id = copy_string(table, id);
+    if (!entry->id || HashTable_add(table->index, id, (void *)(uintptr_t)handle) != 0) {
+        free_string(table, entry->id);
+        entry->id = NULL;
+        entry->next_free = table->free_head;
+        table->free_head = handle;
+        return ID_HANDLE_NONE;
+    }
+    entry->refs = 1;
+    table->count++;
+    return handle;
+}
+
+IdHandle IdTable_find(const IdTable table, const char *id) {
+    if (!table || !id) return ID_HANDLE_NONE;
+    return (IdHandle)(uintptr_t)HashTable_get(table->index, id);
+}
+
+void IdTable_prefetch(const IdTable table, const char *id) {
+    if (table) HashTable_prefetch(table->index, id);
+}
+
+void IdTable_retain(IdTable table, IdHandle handle) {
+    struct IdEntry *entry = live_entry(table, handle);
+    if (entry) entry->refs++;
+}
+
+void IdTable_release(IdTable table, IdHandle handle) {
+    struct IdEntry *entry = live_entry(table, handle);
+    if (!entry || --entry->refs > 0) return;
+
+    HashTable_remove(table->index, entry->id);
+    free_string(table, entry->id);
+    entry->id = NULL;
+    entry->next_free = table->free_head;
+    table->free_head = handle;
+    table->count--;
+}
+
+const char *IdTable_get(const IdTable table, IdHandle handle) {
+    struct IdEntry *entry = live_entry(table, handle);
+    return entry ? entry->id : NULL;
+}
+
+size_t IdTable_count(const IdTable table) {
+    return table ? table->count : 0;
+}
+
+size_t IdTable_memory_usage(const IdTable table) {
+    if (!table) return 0;
+    return sizeof(struct IdTable) + table->capacity * sizeof(struct IdEntry) + table->string_bytes +
+           Pool_memory_usage(table->strings) + HashTable_memory_usage(table->index);
+}
+
+// Helper function implementations
+
+// Takes a handle off the freelist, or the next unused one, growing the entries if needed
+static IdHandle new_handle(IdTable table) {
+    if (table->free_head != ID_HANDLE_NONE) {
+        IdHandle handle = table->free_head;
+        table->free_head = table->entries[handle].next_free;
+        return handle;
+    }
+
+    if (table->used == UINT32_MAX) return ID_HANDLE_NONE;
+    if (table->used == table->capacity) {
+        size_t new_capacity = table->capacity * 2;
+        struct IdEntry *new_entries = realloc(table->entries, new_capacity * sizeof(struct IdEntry));
+        if (!new_entries) return ID_HANDLE_NONE;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+        memset(new_entries + table->capacity, 0, (new_capacity - table->capacity) * sizeof(struct IdEntry));
+        table->entries = new_entries;
+        table->capacity = new_capacity;
+    }
+    return (IdHandle)table->used++;
+}
+
+static struct IdEntry *live_entry(const IdTable table, IdHandle handle) {
+    if (!table || handle == ID_HANDLE_NONE || handle >= table->used) return NULL;
+    struct IdEntry *entry = &table->entries[handle];
+    return entry->id ? entry : NULL;
+}
+
+// Copies a string into a pool block, or into its own allocation if it is too long for one
+static char *copy_string(IdTable table, const char *id) {
+    size_t size = strlen(id) + 1;
+    char *copy;
+    if (size <= ID_TABLE_STRING_SIZE) {
+        copy = Pool_alloc(table->strings);
+    } else {
+        copy = malloc(size);
+        if (!copy) return NULL;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+        table->string_bytes += size;
+    }
+    if (copy) memcpy(copy, id, size);
+    return copy;
+}
+
+// Returns a string to wherever copy_string took it from (NULL is ignored)
+static void free_string(IdTable table, char *id) {
+    if (!id) return;
+    size_t size = strlen(id) + 1;
+    if (size <= ID_TABLE_STRING_SIZE) {
+        Pool_free(table->strings, id);
+    } else {
+        table->string_bytes -= size;
+        free(id);
+    }
+}
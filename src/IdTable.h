@@ -0,0 +1,112 @@
+/* IdTable.h - Header file for the IdTable module
+ *
+ * This module interns string IDs (order IDs, user IDs) as dense integer handles, so
+ * code past the boundary where an ID is interned can store, compare and index by an
+ * integer instead of a 37-byte string.
+ *
+ * Handles are reference counted. Interning a string takes a reference to its handle,
+ * and the handle stays bound to the string until every reference has been released.
+ * A released handle is reused for the next new string, which keeps handles small
+ * enough to index arrays with.
+ */
+#ifndef ID_TABLE_H
+#define ID_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// IdTable type definition
+typedef struct IdTable *IdTable;
+
+// Interned ID. Handle 0 is never assigned, so it can mean "no ID".
+typedef uint32_t IdHandle;
+#define ID_HANDLE_NONE ((IdHandle)0)
+
+/**
+ * Creates a new IdTable instance.
+ *
+ * @param capacity The number of IDs to size the table for (grows as needed).
+ * @return A newly allocated IdTable instance, or NULL on failure.
+ */
+IdTable IdTable_create(size_t capacity);
+
+/**
+ * Destroys an IdTable instance, freeing every interned string regardless of references.
+ *
+ * @param table A pointer to the IdTable instance to destroy.
+ */
+void IdTable_destroy(IdTable *table);
+
+/**
+ * Interns a string, taking a reference to its handle. A string that is already interned
+ * gets its existing handle back.
+ *
+ * @param table The IdTable instance.
+ * @param id The string to intern (copied internally).
+ * @return The handle for id, or ID_HANDLE_NONE on failure.
+ */
+IdHandle IdTable_intern(IdTable table, const char *id);
+
+/**
+ * Looks up the handle of an interned string without taking a reference.
+ *
+ * @param table The IdTable instance.
+ * @param id The string to look up.
+ * @return The handle for id, or ID_HANDLE_NONE if id is not interned.
+ */
+IdHandle IdTable_find(const IdTable table, const char *id);
+
+/**
+ * Starts loading the index slot a later IdTable_intern or IdTable_find of id will
+ * read first, to overlap its cache miss with other work.
+ *
+ * @param table The IdTable instance.
+ * @param id The string that will be looked up.
+ */
+void IdTable_prefetch(const IdTable table, const char *id);
+
+/**
+ * Takes another reference to a live handle.
+ *
+ * @param table The IdTable instance.
+ * @param handle The handle to retain (ID_HANDLE_NONE is ignored).
+ */
+void IdTable_retain(IdTable table, IdHandle handle);
+
+/**
+ * Releases a reference to a handle. When the last reference goes the string is freed
+ * and the handle may be reused.
+ *
+ * @param table The IdTable instance.
+ * @param handle The handle to release (ID_HANDLE_NONE is ignored).
+ */
+void IdTable_release(IdTable table, IdHandle handle);
+
+/**
+ * Gets the string a handle stands for.
+ *
+ * @param table The IdTable instance.
+ * @param handle The handle to resolve.
+ * @return The interned string (owned by the table, valid while the handle is referenced),
+ *         or NULL if the handle is not live.
+ */
+const char *IdTable_get(const IdTable table, IdHandle handle);
+
+/**
+ * Gets the number of live handles.
+ *
+ * @param table The IdTable instance.
+ * @return The number of interned strings.
+ */
+size_t IdTable_count(const IdTable table);
+
+/**
+ * Gets the bytes the table holds: its entries, the interned strings and the hash
+ * table that maps them back to handles.
+ *
+ * @param table The IdTable instance.
+ * @return The bytes allocated, or 0 if table is NULL.
+ */
+size_t IdTable_memory_usage(const IdTable table);
+
+#endif // ID_TABLE_H
@@ -0,0 +1,188 @@
+/*******************************************************************************************/
+/* Instrument.c - Implementation file for the Instrument module
+ *
+ * A histogram is an array of atomic bucket counts plus a count, total and max. Values
+ * below 16 get a bucket each; a larger value with highest set bit e lands in one of 16
+ * buckets splitting [2^e, 2^(e+1)), chosen by the 4 bits below that bit. Every 64-bit
+ * value has a bucket, so nothing is clamped.
+ *
+ * Without ORDERBOOK_INSTRUMENT the functions still exist, so callers such as the driver
+ * need no #ifdefs; nothing calls the recording functions and the dump says so.
+ */
+
+#include "Instrument.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#ifndef INSTRUMENT_UNITS
+#define INSTRUMENT_UNITS "ns"
+#endif
+
+#define INSTRUMENT_SUB_BITS 4
+#define INSTRUMENT_SUB_BUCKETS (1 << INSTRUMENT_SUB_BITS)
+#define INSTRUMENT_BUCKETS ((64 - INSTRUMENT_SUB_BITS + 1) * INSTRUMENT_SUB_BUCKETS)
+
+struct Histogram {
+    atomic_uint_fast64_t buckets[INSTRUMENT_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t total;
+    atomic_uint_fast64_t max;
+};
+
+static struct Histogram stage_histograms[INSTRUMENT_STAGE_COUNT];
+static struct Histogram counter_histograms[INSTRUMENT_COUNTER_COUNT];
+static _Thread_local uint64_t call_counts[INSTRUMENT_COUNTER_COUNT];
+
+static const char *stage_names[INSTRUMENT_STAGE_COUNT] = {
+    "add_order", "id_lookup", "match", "trade", "rest", "level_lookup", "remove_order",
+    "modify_order", "cancel_user"
+};
+static const char *counter_names[INSTRUMENT_COUNTER_COUNT] = {
+    "levels_touched", "nodes_walked", "allocations"
+};
+
+// Helper function prototypes
+static size_t bucket_of(uint64_t value);
+static uint64_t bucket_low(size_t bucket);
+static void record(struct Histogram *histogram, uint64_t value);
+static void summarize(struct Histogram *histogram, struct InstrumentSummary *summary);
+static uint64_t percentile(struct Histogram *histogram, uint64_t count, double quantile);
+static void print_row(FILE *out, const char *name, const struct InstrumentSummary *summary);
+
+// Public function implementations
+int Instrument_enabled(void) {
+#ifdef ORDERBOOK_INSTRUMENT
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void Instrument_record_stage(enum InstrumentStage stage, uint64_t elapsed) {
+    if ((unsigned)stage < INSTRUMENT_STAGE_COUNT) record(&stage_histograms[stage], elapsed);
+}
+
+void Instrument_begin_call(void) {
+    memset(call_counts, 0, sizeof(call_counts));
+}
+
+void Instrument_end_call(enum InstrumentStage stage, uint64_t elapsed) {
+    Instrument_record_stage(stage, elapsed);
+    for (int i = 0; i < INSTRUMENT_COUNTER_COUNT; i++) {
+        record(&counter_histograms[i], call_counts[i]);
+    }
+}
+
+void Instrument_count(enum InstrumentCounter counter, uint64_t amount) {
+    if ((unsigned)counter < INSTRUMENT_COUNTER_COUNT) call_counts[counter] += amount;
+}
+
+int Instrument_stage_summary(enum InstrumentStage stage, struct InstrumentSummary *summary) {
+    if ((unsigned)stage >= INSTRUMENT_STAGE_COUNT || !summary) return 0;
+    summarize(&stage_histograms[stage], summary);
+    return 1;
+}
+
+int Instrument_counter_summary(enum InstrumentCounter counter, struct InstrumentSummary *summary) {
+    if ((unsigned)counter >= INSTRUMENT_COUNTER_COUNT || !summary) return 0;
+    summarize(&counter_histograms[counter], summary);
+    return 1;
+}
+
+void Instrument_reset(void) {
+    for (int i = 0; i < INSTRUMENT_STAGE_COUNT; i++) {
+        memset(&stage_histograms[i], 0, sizeof(struct Histogram));
+    }
+    for (int i = 0; i < INSTRUMENT_COUNTER_COUNT; i++) {
+        memset(&counter_histograms[i], 0, sizeof(struct Histogram));
+    }
+}
+
+void Instrument_dump(FILE *out) {
+    if (!out) return;
+    if (!Instrument_enabled()) {
+        fprintf(out, "Instrumentation is not compiled in (build with make INSTRUMENT=1).\n");
+        return;
+    }
+
+    struct InstrumentSummary summary;
+    fprintf(out, "%-16s %10s %10s %10s %10s %10s %10s\n",
+            "stage (" INSTRUMENT_UNITS ")", "count", "mean", "p50", "p99", "p999", "max");
+    for (int i = 0; i < INSTRUMENT_STAGE_COUNT; i++) {
+        summarize(&stage_histograms[i], &summary);
+        if (summary.count) print_row(out, stage_names[i], &summary);
+    }
+    fprintf(out, "%-16s %10s %10s %10s %10s %10s %10s\n",
+            "per add", "count", "mean", "p50", "p99", "p999", "max");
+    for (int i = 0; i < INSTRUMENT_COUNTER_COUNT; i++) {
+        summarize(&counter_histograms[i], &summary);
+        if (summary.count) print_row(out, counter_names[i], &summary);
+    }
+}
+
+// Helper function implementations
+static size_t bucket_of(uint64_t value) {
+    if (value < INSTRUMENT_SUB_BUCKETS) return (size_t)value;
+
+#if defined(__GNUC__)
+    int exponent = 63 - __builtin_clzll(value);
+#else
+    int exponent = 0;
+    for (uint64_t v = value; v > 1; v >>= 1) exponent++;
+#endif
+    size_t sub = (size_t)(value >> (exponent - INSTRUMENT_SUB_BITS)) & (INSTRUMENT_SUB_BUCKETS - 1);
+    return (size_t)(exponent - INSTRUMENT_SUB_BITS + 1) * INSTRUMENT_SUB_BUCKETS + sub;
+}
+
+// Smallest value that lands in bucket
+static uint64_t bucket_low(size_t bucket) {
+    if (bucket < INSTRUMENT_SUB_BUCKETS) return (uint64_t)bucket;
+
+    int exponent = (int)(bucket / INSTRUMENT_SUB_BUCKETS) + INSTRUMENT_SUB_BITS - 1;
+    uint64_t sub = bucket % INSTRUMENT_SUB_BUCKETS;
+    return (INSTRUMENT_SUB_BUCKETS + sub) << (exponent - INSTRUMENT_SUB_BITS);
+}
+
+static void record(struct Histogram *histogram, uint64_t value) {
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_of(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total, value, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max, &max, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void summarize(struct Histogram *histogram, struct InstrumentSummary *summary) {
+    summary->count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    summary->total = atomic_load_explicit(&histogram->total, memory_order_relaxed);
+    summary->max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    summary->p50 = percentile(histogram, summary->count, 0.50);
+    summary->p99 = percentile(histogram, summary->count, 0.99);
+    summary->p999 = percentile(histogram, summary->count, 0.999);
+}
+
+// Lower bound of the bucket holding the sample of rank ceil(quantile * count)
+static uint64_t percentile(struct Histogram *histogram, uint64_t count, double quantile) {
+    if (count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(quantile * (double)count);
+    if ((double)rank < quantile * (double)count) rank++;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < INSTRUMENT_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen >= rank) return bucket_low(i);
+    }
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+static void print_row(FILE *out, const char *name, const struct InstrumentSummary *summary) {
+    fprintf(out, "%-16s %10llu %10.1f %10llu %10llu %10llu %10llu\n", name,
+            (unsigned long long)summary->count, (double)summary->total / (double)summary->count,
+            (unsigned long long)summary->p50, (unsigned long long)summary->p99,
+            (unsigned long long)summary->p999, (unsigned long long)summary->max);
+}
@@ -0,0 +1,157 @@
+/* Instrument.h - Header file for the Instrument module
+ *
+ * This module provides optional latency instrumentation for the matching hot path.
+ * Hooks placed at stage boundaries inside the book (ID lookup, level lookup, matching,
+ * trade creation, resting insert) time each stage and count the work one add does:
+ * levels touched, queue nodes walked and calls into the system allocator.
+ *
+ * The hooks are macros that expand to nothing unless the sources are compiled with
+ * -DORDERBOOK_INSTRUMENT (`make INSTRUMENT=1`), so an ordinary build carries no trace of
+ * them. Stage times come from clock_gettime(CLOCK_MONOTONIC) in nanoseconds, or from the
+ * time-stamp counter in cycles when ORDERBOOK_INSTRUMENT_TSC is also defined on x86-64.
+ *
+ * Samples go into process-wide log-linear histograms: exact below 16, then 16 buckets per
+ * power of two (about 6% resolution). Recording is one relaxed atomic increment per
+ * sample, so books on different threads can record at once without locks. Per-call
+ * counters are accumulated in thread-local storage and recorded when the add finishes.
+ */
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Timed stages of the hot path
+enum InstrumentStage {
+    INSTRUMENT_ADD_ORDER,        // A whole add, from interning to resting
+    INSTRUMENT_ID_LOOKUP,        // Interning the order and user IDs
+    INSTRUMENT_MATCH,            // The matching loop against the opposite side, trades included
+    INSTRUMENT_TRADE,            // Creating one trade record
+    INSTRUMENT_REST,             // Resting the remainder, level lookup included
+    INSTRUMENT_LEVEL_LOOKUP,     // Finding or creating the level an order rests on
+    INSTRUMENT_REMOVE_ORDER,     // A whole remove
+    INSTRUMENT_MODIFY_ORDER,     // A whole modify, matching included if the new price crosses
+    INSTRUMENT_CANCEL_USER,      // A whole cancel of one user's orders
+    INSTRUMENT_STAGE_COUNT
+};
+
+// Work counted per add
+enum InstrumentCounter {
+    INSTRUMENT_LEVELS_TOUCHED,   // Levels traded against or rested on
+    INSTRUMENT_NODES_WALKED,     // Resting orders visited by the matching loop
+    INSTRUMENT_ALLOCATIONS,      // Calls into the system allocator
+    INSTRUMENT_COUNTER_COUNT
+};
+
+// Summary of one histogram. Percentiles are the lower bound of the bucket they fall in.
+struct InstrumentSummary {
+    uint64_t count;              /**< Samples recorded. */
+    uint64_t total;              /**< Sum of the samples. */
+    uint64_t max;                /**< Largest sample. */
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+};
+
+/**
+ * Whether this build records anything (Instrument.c compiled with ORDERBOOK_INSTRUMENT).
+ *
+ * @return 1 if instrumentation is compiled in, 0 otherwise.
+ */
+int Instrument_enabled(void);
+
+/**
+ * Records a stage duration. Called through the INSTRUMENT_* macros.
+ *
+ * @param stage The stage.
+ * @param elapsed The duration, in the units of Instrument_now.
+ */
+void Instrument_record_stage(enum InstrumentStage stage, uint64_t elapsed);
+
+/**
+ * Starts a call: clears the calling thread's per-call counters.
+ */
+void Instrument_begin_call(void);
+
+/**
+ * Ends a call: records its duration under stage and the calling thread's per-call
+ * counters into the counter histograms.
+ *
+ * @param stage The stage the whole call is recorded under.
+ * @param elapsed The call's duration.
+ */
+void Instrument_end_call(enum InstrumentStage stage, uint64_t elapsed);
+
+/**
+ * Adds to one of the calling thread's per-call counters.
+ *
+ * @param counter The counter.
+ * @param amount The amount to add.
+ */
+void Instrument_count(enum InstrumentCounter counter, uint64_t amount);
+
+/**
+ * Summarizes a stage's histogram. Safe to call while other threads record; the summary
+ * is then approximate.
+ *
+ * @param stage The stage.
+ * @param summary Output summary.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int Instrument_stage_summary(enum InstrumentStage stage, struct InstrumentSummary *summary);
+
+/**
+ * Summarizes a per-call counter's histogram.
+ *
+ * @param counter The counter.
+ * @param summary Output summary.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int Instrument_counter_summary(enum InstrumentCounter counter, struct InstrumentSummary *summary);
+
+/**
+ * Clears every histogram.
+ */
+void Instrument_reset(void);
+
+/**
+ * Prints every non-empty histogram as a table, or a note that instrumentation is not
+ * compiled in.
+ *
+ * @param out The stream to print to.
+ */
+void Instrument_dump(FILE *out);
+
+#ifdef ORDERBOOK_INSTRUMENT
+
+#if defined(ORDERBOOK_INSTRUMENT_TSC) && defined(__x86_64__)
+#include <x86intrin.h>
+#define INSTRUMENT_UNITS "cycles"
+static inline uint64_t Instrument_now(void) { return __rdtsc(); }
+#else
+#include <time.h>
+#define INSTRUMENT_UNITS "ns"
+static inline uint64_t Instrument_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define INSTRUMENT_TIME(start) uint64_t start = Instrument_now()
+#define INSTRUMENT_STAGE(stage, start) Instrument_record_stage((stage), Instrument_now() - (start))
+#define INSTRUMENT_CALL_BEGIN() Instrument_begin_call()
+#define INSTRUMENT_CALL_END(stage, start) Instrument_end_call((stage), Instrument_now() - (start))
+#define INSTRUMENT_COUNT(counter, amount) Instrument_count((counter), (amount))
+
+#else
+
+#define INSTRUMENT_TIME(start)
+#define INSTRUMENT_STAGE(stage, start) ((void)0)
+#define INSTRUMENT_CALL_BEGIN() ((void)0)
+#define INSTRUMENT_CALL_END(stage, start) ((void)0)
+#define INSTRUMENT_COUNT(counter, amount) ((void)0)
+
+#endif // ORDERBOOK_INSTRUMENT
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,650 @@
+/*******************************************************************************************/
+/* Journal.c - Implementation file for the Journal module
+ *
+ * Each record is a JournalRecordHeader followed by its body, padded to a multiple of
+ * 8 bytes:
+ *  - ADD: a JournalAdd, the order ID and user ID characters, then one JournalFill per fill.
+ *  - REMOVE: the order ID characters.
+ *  - MODIFY: a JournalModify, the order ID characters, then one JournalFill per fill.
+ *  - CANCEL_USER: a JournalCancelUser, then the user ID characters.
+ * The checksum (32-bit FNV-1a) covers everything in the record after the checksum itself.
+ *
+ * Appends build records directly in the journal's buffer. A full or old group is handed
+ * to the flusher thread by swapping buffers, and the flusher calls write() and
+ * fdatasync() once for it, however many records it holds, while appends fill the other
+ * buffer. The matching thread waits only if the flusher is still syncing the previous
+ * group when the next one is ready.
+ */
+
+#include "Journal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOURNAL_ADD 1
+#define JOURNAL_REMOVE 2
+#define JOURNAL_MODIFY 3
+#define JOURNAL_CANCEL_USER 4
+#define JOURNAL_MAX_ID 36
+#define JOURNAL_INITIAL_BUFFER 4096
+#define JOURNAL_CLOCK_CHECK_RECORDS 32  // Appends between checks of sync_interval_ms
+
+// Record header (24 bytes)
+struct JournalRecordHeader {
+    uint32_t checksum;
+    uint32_t length;       // Whole record including the header and padding
+    uint64_t sequence;     // Book message sequence
+    uint8_t type;          // JOURNAL_ADD, JOURNAL_REMOVE, JOURNAL_MODIFY or JOURNAL_CANCEL_USER
+    uint8_t outcome;       // Return value of the add, remove or modify (CANCEL_USER: whether any were cancelled)
+    uint8_t id_length;     // Order ID length
+    uint8_t user_length;   // User ID length (ADD and CANCEL_USER)
+    uint32_t fill_count;   // Fills after the IDs (ADD and MODIFY)
+};
+
+// ADD body, before the ID characters. side used to be 32 bits wide; the type bytes take its
+// zero high bytes, so older journals written on little-endian hosts replay as GTC limit orders.
+struct JournalAdd {
+    int32_t quantity;
+    uint8_t side;
+    uint8_t order_type;
+    uint8_t time_in_force;
+    uint8_t reserved;
+    double price;
+    int64_t timestamp;
+};
+
+// MODIFY body, before the order ID characters
+struct JournalModify {
+    int32_t quantity;
+    int32_t reserved;
+    double price;
+};
+
+// CANCEL_USER body, before the user ID characters
+struct JournalCancelUser {
+    uint64_t cancelled;    // Return value of OrderBook_cancel_all_for_user
+};
+
+// One fill of an ADD or MODIFY
+struct JournalFill {
+    int64_t trade_id;
+    int32_t size;
+    int32_t reserved;
+    double price;
+};
+
+// Journal structure
+struct Journal {
+    int fd;
+    unsigned char *buffer;        // Records not yet handed to the flusher
+    size_t used;
+    size_t capacity;
+    size_t sync_bytes;
+    long sync_interval_ms;        // Negative to commit on size only
+    struct timespec last_commit;
+    unsigned records_unchecked;   // Appends since sync_interval_ms was last checked
+    int failed;                   // Set by a failed append until the next commit reports it
+
+    // Shared with the flusher thread, under lock
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t group_ready;   // Signalled when a group is handed off or the journal closes
+    pthread_cond_t group_done;    // Signalled when the flusher finishes a group
+    unsigned char *flushing;      // Group being written by the flusher
+    size_t flushing_used;
+    size_t flushing_capacity;
+    int flush_pending;            // Whether flushing holds a group not yet synced
+    int flush_failed;             // Set by a failed write or sync until the next commit reports it
+    int stop;                     // Set by Journal_close to end the flusher
+};
+
+// Called for each valid record by scan_records; returns 0 to stop the scan
+typedef int (*RecordVisitor)(void *context, const struct JournalRecordHeader *header, const unsigned char *record);
+
+// Helper function prototypes
+static uint32_t checksum(const unsigned char *data, size_t length);
+static size_t padded(size_t length);
+static unsigned char *reserve_record(Journal journal, size_t length);
+static void finish_record(Journal journal, unsigned char *record);
+static void hand_off_group(Journal journal);
+static void *flush_groups(void *arg);
+static int write_all(int fd, const unsigned char *data, size_t length);
+static long elapsed_ms(const struct timespec *since);
+static size_t scan_records(const unsigned char *data, size_t length, RecordVisitor visitor, void *context);
+static int record_is_valid(const struct JournalRecordHeader *header, size_t available);
+static void write_fills(unsigned char *fills, const struct OrderBookMatchResult *result, uint32_t fill_count);
+static int fills_match(const unsigned char *fills, const struct OrderBookMatchResult *result, uint32_t fill_count);
+static int map_file(const char *path, unsigned char **data, size_t *length);
+
+// Public function implementations
+Journal Journal_open(const char *path, const struct JournalConfig *config) {
+    if (!path) return NULL;
+
+    Journal journal = malloc(sizeof(struct Journal));
+    if (!journal) return NULL;
+    memset(journal, 0, sizeof(struct Journal));
+    journal->sync_bytes = config && config->sync_bytes ? config->sync_bytes : JOURNAL_DEFAULT_SYNC_BYTES;
+    journal->sync_interval_ms = config && config->sync_interval_ms ? config->sync_interval_ms : JOURNAL_DEFAULT_SYNC_INTERVAL_MS;
+    journal->capacity = journal->flushing_capacity = JOURNAL_INITIAL_BUFFER;
+    journal->buffer = malloc(journal->capacity);
+    journal->flushing = malloc(journal->flushing_capacity);
+
+    // Keep only the valid prefix of an existing journal, then append after it
+    unsigned char *data = NULL;
+    size_t length = 0;
+    int mapped = map_file(path, &data, &length);
+    size_t valid = mapped && data ? scan_records(data, length, NULL, NULL) : 0;
+    if (mapped && data) munmap(data, length);
+
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (!journal->buffer || !journal->flushing || journal->fd < 0 ||
+        (valid < length && ftruncate(journal->fd, (off_t)valid) != 0)) {
+        if (journal->fd >= 0) close(journal->fd);
+        free(journal->buffer);
+        free(journal->flushing);
+        free(journal);
+        return NULL;
+    }
+
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->group_ready, NULL);
+    pthread_cond_init(&journal->group_done, NULL);
+    if (pthread_create(&journal->flusher, NULL, flush_groups, journal) != 0) {
+        pthread_cond_destroy(&journal->group_done);
+        pthread_cond_destroy(&journal->group_ready);
+        pthread_mutex_destroy(&journal->lock);
+        close(journal->fd);
+        free(journal->buffer);
+        free(journal->flushing);
+        free(journal);
+        return NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &journal->last_commit);
+    return journal;
+}
+
+int Journal_close(Journal *journal) {
+    if (!journal || !*journal) return 0;
+    Journal j = *journal;
+
+    int ok = Journal_commit(j);
+    pthread_mutex_lock(&j->lock);
+    j->stop = 1;
+    pthread_cond_signal(&j->group_ready);
+    pthread_mutex_unlock(&j->lock);
+    pthread_join(j->flusher, NULL);
+
+    pthread_cond_destroy(&j->group_done);
+    pthread_cond_destroy(&j->group_ready);
+    pthread_mutex_destroy(&j->lock);
+    if (close(j->fd) != 0) ok = 0;
+    free(j->buffer);
+    free(j->flushing);
+    free(j);
+
+    *journal = NULL;
+    return ok;
+}
+
+int Journal_log_add(Journal journal, uint64_t sequence, const Order order, int accepted, const struct OrderBookMatchResult *result) {
+    if (!journal || !order) return 0;
+
+    size_t id_length = strnlen(order->order_id, JOURNAL_MAX_ID);
+    size_t user_length = strnlen(order->user_id, JOURNAL_MAX_ID);
+    uint32_t fill_count = result && result->count > 0 ? (uint32_t)result->count : 0;
+    size_t fills_offset = padded(sizeof(struct JournalRecordHeader) + sizeof(struct JournalAdd) + id_length + user_length);
+
+    unsigned char *record = reserve_record(journal, fills_offset + fill_count * sizeof(struct JournalFill));
+    if (!record) return 0;
+
+    struct JournalRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.length = (uint32_t)(fills_offset + fill_count * sizeof(struct JournalFill));
+    header.sequence = sequence;
+    header.type = JOURNAL_ADD;
+    header.outcome = accepted ? 1 : 0;
+    header.id_length = (uint8_t)id_length;
+    header.user_length = (uint8_t)user_length;
+    header.fill_count = fill_count;
+    memcpy(record, &header, sizeof(header));
+
+    struct JournalAdd add;
+    memset(&add, 0, sizeof(add));
+    add.quantity = order->quantity;
+    add.side = (uint8_t)order->side;
+    add.order_type = (uint8_t)order->order_type;
+    add.time_in_force = (uint8_t)order->time_in_force;
+    add.price = order->price;
+    add.timestamp = order->timestamp;
+    unsigned char *body = record + sizeof(header);
+    memcpy(body, &add, sizeof(add));
+    memcpy(body + sizeof(add), order->order_id, id_length);
+    memcpy(body + sizeof(add) + id_length, order->user_id, user_length);
+
+    write_fills(record + fills_offset, result, fill_count);
+
+    finish_record(journal, record);
+    return 1;
+}
+
+int Journal_log_remove(Journal journal, uint64_t sequence, const char *order_id, int removed) {
+    if (!journal || !order_id) return 0;
+
+    size_t id_length = strnlen(order_id, JOURNAL_MAX_ID);
+    size_t length = padded(sizeof(struct JournalRecordHeader) + id_length);
+    unsigned char *record = reserve_record(journal, length);
+    if (!record) return 0;
+
+    struct JournalRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.length = (uint32_t)length;
+    header.sequence = sequence;
+    header.type = JOURNAL_REMOVE;
+    header.outcome = removed ? 1 : 0;
+    header.id_length = (uint8_t)id_length;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), order_id, id_length);
+
+    finish_record(journal, record);
+    return 1;
+}
+
+int Journal_log_modify(Journal journal, uint64_t sequence, const char *order_id, double price, int quantity,
+                       int modified, const struct OrderBookMatchResult *result) {
+    if (!journal || !order_id) return 0;
+
+    size_t id_length = strnlen(order_id, JOURNAL_MAX_ID);
+    uint32_t fill_count = result && result->count > 0 ? (uint32_t)result->count : 0;
+    size_t fills_offset = padded(sizeof(struct JournalRecordHeader) + sizeof(struct JournalModify) + id_length);
+
+    unsigned char *record = reserve_record(journal, fills_offset + fill_count * sizeof(struct JournalFill));
+    if (!record) return 0;
+
+    struct JournalRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.length = (uint32_t)(fills_offset + fill_count * sizeof(struct JournalFill));
+    header.sequence = sequence;
+    header.type = JOURNAL_MODIFY;
+    header.outcome = modified ? 1 : 0;
+    header.id_length = (uint8_t)id_length;
+    header.fill_count = fill_count;
+    memcpy(record, &header, sizeof(header));
+
+    struct JournalModify modify;
+    memset(&modify, 0, sizeof(modify));
+    modify.quantity = quantity;
+    modify.price = price;
+    memcpy(record + sizeof(header), &modify, sizeof(modify));
+    memcpy(record + sizeof(header) + sizeof(modify), order_id, id_length);
+
+    write_fills(record + fills_offset, result, fill_count);
+
+    finish_record(journal, record);
+    return 1;
+}
+
+int Journal_log_cancel_user(Journal journal, uint64_t sequence, const char *user_id, size_t cancelled) {
+    if (!journal || !user_id) return 0;
+
+    size_t user_length = strnlen(user_id, JOURNAL_MAX_ID);
+    size_t length = padded(sizeof(struct JournalRecordHeader) + sizeof(struct JournalCancelUser) + user_length);
+    unsigned char *record = reserve_record(journal, length);
+    if (!record) return 0;
+
+    struct JournalRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.length = (uint32_t)length;
+    header.sequence = sequence;
+    header.type = JOURNAL_CANCEL_USER;
+    header.outcome = cancelled > 0;
+    header.user_length = (uint8_t)user_length;
+    memcpy(record, &header, sizeof(header));
+
+    struct JournalCancelUser cancel = { cancelled };
+    memcpy(record + sizeof(header), &cancel, sizeof(cancel));
+    memcpy(record + sizeof(header) + sizeof(cancel), user_id, user_length);
+
+    finish_record(journal, record);
+    return 1;
+}
+
+int Journal_commit(Journal journal) {
+    if (!journal) return 0;
+
+    // Hand off what is buffered, then wait until the flusher has synced it
+    if (journal->used > 0) hand_off_group(journal);
+    pthread_mutex_lock(&journal->lock);
+    while (journal->flush_pending) pthread_cond_wait(&journal->group_done, &journal->lock);
+    int ok = !journal->failed && !journal->flush_failed;
+    journal->flush_failed = 0;
+    pthread_mutex_unlock(&journal->lock);
+
+    journal->failed = 0;
+    return ok;
+}
+
+int Journal_checkpoint(Journal journal, OrderBook book, const char *snapshot_path) {
+    if (!journal || !book || !snapshot_path) return 0;
+
+    // Everything up to the snapshot must be durable before the journal is emptied
+    if (!Journal_commit(journal)) return 0;
+    if (!OrderBook_save(book, snapshot_path)) return 0;
+    return ftruncate(journal->fd, 0) == 0 && fsync(journal->fd) == 0;
+}
+
+// Recovery state threaded through scan_records
+struct Recovery {
+    OrderBook book;
+    struct JournalRecoveryStats *stats;
+    struct OrderBookMatchResult result;
+    int gap;                               // Set if the journal skips ahead of the book
+};
+
+// Re-applies one record if the book has not seen it yet
+static int apply_record(void *context, const struct JournalRecordHeader *header, const unsigned char *record) {
+    struct Recovery *recovery = context;
+    struct JournalRecoveryStats *stats = recovery->stats;
+    uint64_t next = OrderBook_message_sequence(recovery->book);
+
+    stats->records++;
+    if (header->sequence < next) {
+        stats->skipped++;
+        return 1;
+    }
+    if (header->sequence > next) {
+        recovery->gap = 1;
+        return 0;
+    }
+
+    const unsigned char *body = record + sizeof(*header);
+    int matches;
+    if (header->type == JOURNAL_ADD) {
+        struct JournalAdd add;
+        memcpy(&add, body, sizeof(add));
+
+        struct Order order;
+        memset(&order, 0, sizeof(order));
+        memcpy(order.order_id, body + sizeof(add), header->id_length);
+        memcpy(order.user_id, body + sizeof(add) + header->id_length, header->user_length);
+        order.quantity = add.quantity;
+        order.side = (char)add.side;
+        order.order_type = (char)add.order_type;
+        order.time_in_force = (char)add.time_in_force;
+        order.price = add.price;
+        order.timestamp = (long)add.timestamp;
+
+        int accepted = OrderBook_add_order_with_result(recovery->book, &order, &recovery->result);
+        matches = accepted == header->outcome && (uint32_t)recovery->result.count == header->fill_count;
+
+        size_t fills_offset = padded(sizeof(*header) + sizeof(add) + header->id_length + header->user_length);
+        matches = matches && fills_match(record + fills_offset, &recovery->result, header->fill_count);
+    } else if (header->type == JOURNAL_MODIFY) {
+        struct JournalModify modify;
+        memcpy(&modify, body, sizeof(modify));
+
+        char order_id[JOURNAL_MAX_ID + 1];
+        memcpy(order_id, body + sizeof(modify), header->id_length);
+        order_id[header->id_length] = '\0';
+
+        int modified = OrderBook_modify_order(recovery->book, order_id, modify.price, modify.quantity, &recovery->result);
+        matches = modified == header->outcome && (uint32_t)recovery->result.count == header->fill_count;
+
+        size_t fills_offset = padded(sizeof(*header) + sizeof(modify) + header->id_length);
+        matches = matches && fills_match(record + fills_offset, &recovery->result, header->fill_count);
+    } else if (header->type == JOURNAL_CANCEL_USER) {
+        struct JournalCancelUser cancel;
+        memcpy(&cancel, body, sizeof(cancel));
+
+        char user_id[JOURNAL_MAX_ID + 1];
+        memcpy(user_id, body + sizeof(cancel), header->user_length);
+        user_id[header->user_length] = '\0';
+        matches = OrderBook_cancel_all_for_user(recovery->book, user_id) == cancel.cancelled;
+    } else {
+        char order_id[JOURNAL_MAX_ID + 1];
+        memcpy(order_id, body, header->id_length);
+        order_id[header->id_length] = '\0';
+        matches = OrderBook_remove_order(recovery->book, order_id) == header->outcome;
+    }
+
+    stats->applied++;
+    if (!matches) stats->mismatches++;
+    return 1;
+}
+
+OrderBook Journal_recover(const char *snapshot_path, const char *journal_path, const struct OrderBookConfig *config, struct JournalRecoveryStats *stats) {
+    if (!journal_path) return NULL;
+
+    struct JournalRecoveryStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    OrderBook book;
+    if (snapshot_path && access(snapshot_path, F_OK) == 0) {
+        book = OrderBook_load(snapshot_path, config);
+    } else {
+        book = OrderBook_create_with_config(config);
+    }
+    if (!book) return NULL;
+
+    unsigned char *data = NULL;
+    size_t length = 0;
+    if (!map_file(journal_path, &data, &length)) {
+        // A missing journal is an empty one
+        if (errno == ENOENT) return book;
+        OrderBook_destroy(&book);
+        return NULL;
+    }
+    if (!data) return book;
+
+    struct Recovery recovery;
+    memset(&recovery, 0, sizeof(recovery));
+    recovery.book = book;
+    recovery.stats = stats;
+
+    size_t valid = scan_records(data, length, apply_record, &recovery);
+    stats->torn_bytes = recovery.gap ? 0 : length - valid;
+
+    OrderBookMatchResult_free(&recovery.result);
+    munmap(data, length);
+    if (recovery.gap) OrderBook_destroy(&book);
+    return book;
+}
+
+// Helper function implementations
+static uint32_t checksum(const unsigned char *data, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t padded(size_t length) {
+    return (length + 7) & ~(size_t)7;
+}
+
+// Makes room for a record of length bytes at the end of the buffer (zeroed, for the padding)
+static unsigned char *reserve_record(Journal journal, size_t length) {
+    if (journal->used + length > journal->capacity) {
+        size_t new_capacity = journal->capacity * 2;
+        while (new_capacity < journal->used + length) new_capacity *= 2;
+        unsigned char *new_buffer = realloc(journal->buffer, new_capacity);
+        if (!new_buffer) {
+            journal->failed = 1;
+            return NULL;
+        }
+        journal->buffer = new_buffer;
+        journal->capacity = new_capacity;
+    }
+    unsigned char *record = journal->buffer + journal->used;
+    memset(record, 0, length);
+    return record;
+}
+
+// Seals a record built by reserve_record and hands the group off if it is full or old enough
+static void finish_record(Journal journal, unsigned char *record) {
+    struct JournalRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    header.checksum = checksum(record + sizeof(header.checksum), header.length - sizeof(header.checksum));
+    memcpy(record, &header.checksum, sizeof(header.checksum));
+    journal->used += header.length;
+
+    // Read the clock only every JOURNAL_CLOCK_CHECK_RECORDS appends
+    int check_clock = journal->sync_interval_ms >= 0 && ++journal->records_unchecked >= JOURNAL_CLOCK_CHECK_RECORDS;
+    if (check_clock) journal->records_unchecked = 0;
+    if (journal->used >= journal->sync_bytes ||
+        (check_clock && elapsed_ms(&journal->last_commit) >= journal->sync_interval_ms)) {
+        hand_off_group(journal);
+    }
+}
+
+// Swaps the buffered records into the flusher's buffer, first waiting for its previous group
+static void hand_off_group(Journal journal) {
+    pthread_mutex_lock(&journal->lock);
+    while (journal->flush_pending) pthread_cond_wait(&journal->group_done, &journal->lock);
+
+    unsigned char *buffer = journal->flushing;
+    size_t capacity = journal->flushing_capacity;
+    journal->flushing = journal->buffer;
+    journal->flushing_capacity = journal->capacity;
+    journal->flushing_used = journal->used;
+    journal->buffer = buffer;
+    journal->capacity = capacity;
+    journal->used = 0;
+
+    journal->flush_pending = 1;
+    pthread_cond_signal(&journal->group_ready);
+    pthread_mutex_unlock(&journal->lock);
+    clock_gettime(CLOCK_MONOTONIC, &journal->last_commit);
+}
+
+// Flusher thread: writes and syncs each group handed off until the journal closes
+static void *flush_groups(void *arg) {
+    Journal journal = arg;
+    pthread_mutex_lock(&journal->lock);
+    for (;;) {
+        while (!journal->flush_pending && !journal->stop) pthread_cond_wait(&journal->group_ready, &journal->lock);
+        if (!journal->flush_pending) break;
+        pthread_mutex_unlock(&journal->lock);
+
+        // The matching thread does not touch flushing while flush_pending is set
+        int ok = write_all(journal->fd, journal->flushing, journal->flushing_used) && fdatasync(journal->fd) == 0;
+
+        pthread_mutex_lock(&journal->lock);
+        if (!ok) journal->flush_failed = 1;
+        journal->flush_pending = 0;
+        pthread_cond_broadcast(&journal->group_done);
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+static long elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+// Visits records from the start of data; returns the length of the valid prefix
+static size_t scan_records(const unsigned char *data, size_t length, RecordVisitor visitor, void *context) {
+    size_t offset = 0;
+    while (length - offset >= sizeof(struct JournalRecordHeader)) {
+        struct JournalRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (!record_is_valid(&header, length - offset)) break;
+        if (checksum(data + offset + sizeof(header.checksum), header.length - sizeof(header.checksum)) != header.checksum) break;
+        if (visitor && !visitor(context, &header, data + offset)) break;
+        offset += header.length;
+    }
+    return offset;
+}
+
+// Whether a header's sizes are consistent with its type and fit in the bytes available
+static int record_is_valid(const struct JournalRecordHeader *header, size_t available) {
+    if (header->length > available || header->length % 8 != 0) return 0;
+    if (header->id_length > JOURNAL_MAX_ID || header->user_length > JOURNAL_MAX_ID) return 0;
+
+    size_t expected;
+    if (header->type == JOURNAL_ADD) {
+        expected = padded(sizeof(*header) + sizeof(struct JournalAdd) + header->id_length + header->user_length) +
+                   (size_t)header->fill_count * sizeof(struct JournalFill);
+    } else if (header->type == JOURNAL_REMOVE) {
+        expected = padded(sizeof(*header) + header->id_length);
+    } else if (header->type == JOURNAL_MODIFY) {
+        expected = padded(sizeof(*header) + sizeof(struct JournalModify) + header->id_length) +
+                   (size_t)header->fill_count * sizeof(struct JournalFill);
+    } else if (header->type == JOURNAL_CANCEL_USER) {
+        expected = padded(sizeof(*header) + sizeof(struct JournalCancelUser) + header->user_length);
+    } else {
+        return 0;
+    }
+    return header->length == expected;
+}
+
+// Maps a whole file read-only; an empty file gives data == NULL. Returns 0 with errno set on failure.
+static int map_file(const char *path, unsigned char **data, size_t *length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    *length = (size_t)st.st_size;
+    *data = NULL;
+    if (*length > 0) {
+        void *mapped = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        *data = mapped;
+        madvise(mapped, *length, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return 1;
+}
+
+static void write_fills(unsigned char *fills, const struct OrderBookMatchResult *result, uint32_t fill_count) {
+    for (uint32_t i = 0; i < fill_count; i++) {
+        struct JournalFill fill;
+        memset(&fill, 0, sizeof(fill));
+        fill.trade_id = result->fills[i].trade_id;
+        fill.size = result->fills[i].size;
+        fill.price = result->fills[i].price;
+        memcpy(fills + i * sizeof(fill), &fill, sizeof(fill));
+    }
+}
+
+// Whether replayed fills are the journaled ones; result must hold at least fill_count fills
+static int fills_match(const unsigned char *fills, const struct OrderBookMatchResult *result, uint32_t fill_count) {
+    for (uint32_t i = 0; i < fill_count; i++) {
+        struct JournalFill fill;
+        memcpy(&fill, fills + i * sizeof(fill), sizeof(fill));
+        const struct OrderBookFill *replayed = &result->fills[i];
+        if (replayed->trade_id != fill.trade_id || replayed->size != fill.size || replayed->price != fill.price) return 0;
+    }
+    return 1;
+}
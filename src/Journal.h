@@ -0,0 +1,152 @@
+/* Journal.h - Header file for the Journal module
+ *
+ * This module is a write-ahead journal for the messages applied to an OrderBook. Once a
+ * journal is attached to a book (OrderBook_attach_journal), every add, remove, modify and
+ * user cancel is appended as a compact binary record, with the fills it produced, stamped
+ * with the book's message sequence.
+ *
+ * Records are buffered in memory and written out by group commit: one write and one
+ * fdatasync for everything buffered, once sync_bytes have accumulated or sync_interval_ms
+ * has passed since the last commit. A journal's flusher thread does the write and sync,
+ * so appending does not wait on the disk unless the previous group is still being synced
+ * when the next is ready. The interval is checked every few appends, so a caller that goes
+ * idle should call Journal_commit itself. Until a commit returns, the buffered messages
+ * are not durable.
+ *
+ * Recovery loads the latest snapshot, skips the journal records the snapshot already
+ * includes, and re-applies the rest. Each record carries a checksum, so a record torn by
+ * a crash ends the readable journal; opening a journal trims such a tail before appending.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Order.h"
+#include "OrderBook.h"
+
+// Journal type definition
+typedef struct Journal *Journal;
+
+#define JOURNAL_DEFAULT_SYNC_BYTES (64 * 1024)
+#define JOURNAL_DEFAULT_SYNC_INTERVAL_MS 10
+
+// Settings for Journal_open. A zeroed config uses the defaults above.
+struct JournalConfig {
+    size_t sync_bytes;      /**< Commit once this many bytes are buffered (0 for the default). */
+    long sync_interval_ms;  /**< Commit when this long has passed since the last commit (0 for the
+                                 default, negative to commit on size only). */
+};
+
+// Results of Journal_recover
+struct JournalRecoveryStats {
+    long records;           /**< Valid records in the journal. */
+    long skipped;           /**< Records already included in the snapshot. */
+    long applied;           /**< Records re-applied to the book. */
+    long mismatches;        /**< Applied records whose outcome differs from the journaled one. */
+    size_t torn_bytes;      /**< Bytes after the last valid record (a torn or damaged tail). */
+};
+
+/**
+ * Opens a journal for appending, creating the file if needed. A damaged tail left by
+ * a crash is truncated away first.
+ *
+ * @param path The journal file.
+ * @param config Group commit settings, or NULL for defaults.
+ * @return A newly allocated Journal instance, or NULL on failure.
+ */
+Journal Journal_open(const char *path, const struct JournalConfig *config);
+
+/**
+ * Commits any buffered records and closes the journal.
+ *
+ * @param journal A pointer to the Journal instance to close.
+ * @return 1 if the final commit succeeded (or there was nothing to commit), 0 otherwise.
+ */
+int Journal_close(Journal *journal);
+
+/**
+ * Appends an add message and its outcome. Called by the book for an attached journal.
+ *
+ * @param journal The Journal instance.
+ * @param sequence The book's message sequence for this add.
+ * @param order The order as it was submitted.
+ * @param accepted The return value of OrderBook_add_order_with_result.
+ * @param result The fills the add produced.
+ * @return 1 if the record was buffered, 0 on failure (also reported by Journal_commit).
+ */
+int Journal_log_add(Journal journal, uint64_t sequence, const Order order, int accepted, const struct OrderBookMatchResult *result);
+
+/**
+ * Appends a remove message and its outcome. Called by the book for an attached journal.
+ *
+ * @param journal The Journal instance.
+ * @param sequence The book's message sequence for this remove.
+ * @param order_id The ID of the order to remove.
+ * @param removed The return value of OrderBook_remove_order.
+ * @return 1 if the record was buffered, 0 on failure (also reported by Journal_commit).
+ */
+int Journal_log_remove(Journal journal, uint64_t sequence, const char *order_id, int removed);
+
+/**
+ * Appends a modify message and its outcome. Called by the book for an attached journal.
+ *
+ * @param journal The Journal instance.
+ * @param sequence The book's message sequence for this modify.
+ * @param order_id The ID of the order to modify.
+ * @param price The new price.
+ * @param quantity The new quantity.
+ * @param modified The return value of OrderBook_modify_order.
+ * @param result The fills the modify produced.
+ * @return 1 if the record was buffered, 0 on failure (also reported by Journal_commit).
+ */
+int Journal_log_modify(Journal journal, uint64_t sequence, const char *order_id, double price, int quantity,
+                       int modified, const struct OrderBookMatchResult *result);
+
+/**
+ * Appends a cancel of all of one user's orders and its outcome. Called by the book for an
+ * attached journal.
+ *
+ * @param journal The Journal instance.
+ * @param sequence The book's message sequence for this cancel.
+ * @param user_id The ID of the user whose orders were cancelled.
+ * @param cancelled The return value of OrderBook_cancel_all_for_user.
+ * @return 1 if the record was buffered, 0 on failure (also reported by Journal_commit).
+ */
+int Journal_log_cancel_user(Journal journal, uint64_t sequence, const char *user_id, size_t cancelled);
+
+/**
+ * Writes and syncs everything buffered so far, waiting for the flusher thread.
+ *
+ * @param journal The Journal instance.
+ * @return 1 if every record appended so far is durable, 0 if a write, sync or earlier
+ *         append failed.
+ */
+int Journal_commit(Journal journal);
+
+/**
+ * Writes a snapshot of the book and then empties the journal, whose records the
+ * snapshot now includes. If the process dies between the two steps, recovery skips
+ * the records the snapshot already holds, so nothing is applied twice.
+ *
+ * @param journal The Journal instance (attached to book).
+ * @param book The OrderBook instance.
+ * @param snapshot_path The snapshot file to write (see OrderBook_save).
+ * @return 1 if successful, 0 on failure.
+ */
+int Journal_checkpoint(Journal journal, OrderBook book, const char *snapshot_path);
+
+/**
+ * Rebuilds a book from a snapshot and journal: loads the snapshot (or starts empty if
+ * there is none), then re-applies the journal records that follow it.
+ *
+ * @param snapshot_path The snapshot file, or NULL to start from an empty book.
+ * @param journal_path The journal file (a missing journal is treated as empty).
+ * @param config Settings for the book, or NULL for defaults.
+ * @param stats Output for recovery counters, or NULL.
+ * @return The recovered book, or NULL if the snapshot is invalid or the journal does
+ *         not continue from it (records are missing between the two).
+ */
+OrderBook Journal_recover(const char *snapshot_path, const char *journal_path, const struct OrderBookConfig *config, struct JournalRecoveryStats *stats);
+
+#endif // JOURNAL_H
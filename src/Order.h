@@ -1,6 +1,22 @@
 #ifndef ORDER_H
 #define ORDER_H
 
+#include <stdint.h>
+
+// How an incoming order prices itself. A zeroed Order is a limit order.
+enum OrderType {
+    ORDER_TYPE_LIMIT = 0,     /**< Trades at its price or better. */
+    ORDER_TYPE_MARKET = 1,    /**< Trades at any price (its price is ignored) and never rests. */
+    ORDER_TYPE_POST_ONLY = 2  /**< A limit order that is rejected instead of trading on arrival. */
+};
+
+// What happens to the part of an incoming order that does not trade on arrival.
+enum TimeInForce {
+    TIME_IN_FORCE_GTC = 0,    /**< Good till cancelled: the remainder rests. */
+    TIME_IN_FORCE_IOC = 1,    /**< Immediate or cancel: the remainder is cancelled. */
+    TIME_IN_FORCE_FOK = 2     /**< Fill or kill: rejected unless the whole quantity trades. */
+};
+
 // Order structure
 typedef struct Order {
     char order_id[37]; /**< Unique ID of the order. */
@@ -9,6 +25,19 @@ typedef struct Order {
     char side;         /**< BUY (1) or SELL (0). */
     double price;      /**< Price of the order. */
     long timestamp;    /**< Timestamp of the order. */
+    char order_type;   /**< An enum OrderType value. */
+    char time_in_force; /**< An enum TimeInForce value. */
 } *Order;
 
+// Compact order stored inside the book. The OrderBook interns order and user IDs on
+// entry (see IdTable.h), so sides and levels key, compare and copy integers.
+typedef struct BookOrder {
+    uint32_t order_id; /**< Interned ID of the order. */
+    uint32_t user_id;  /**< Interned ID of the user. */
+    int quantity;      /**< Quantity of the order. */
+    char side;         /**< BUY (1) or SELL (0). */
+    double price;      /**< Price of the order. */
+    long timestamp;    /**< Timestamp of the order. */
+} *BookOrder;
+
 #endif // ORDER_H
\ No newline at end of file
@@ -14,58 +14,228 @@
  */
 
 #include "OrderBook.h"
-#include "HashTable.h"
+#include "Pool.h"
+#include "IdTable.h"
+#include "Journal.h"
+#include "Instrument.h"
+#include "DepthSnapshot.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* Private struct for the OrderBook */
 struct OrderBook {
     OrderBookSide bid_side;        /* The buy side of the order book */
     OrderBookSide ask_side;        /* The sell side of the order book */
 
-    HashTable trade_map;           /* Map of trade_id to Trade */
-    Trade *executed_trades;        /* Dynamic array of executed trades */
-    int trade_count;               /* Number of executed trades stored */
-    int trade_capacity;            /* Current capacity of executed_trades array */
+    TradeLog trades;               /* Executed trades, numbered by sequence */
+    IdTable ids;                   /* Interned order and user IDs */
+    unsigned char *order_sides;    /* RESTING_BID or RESTING_ASK by order ID handle, RESTING_NONE elsewhere */
+    size_t order_sides_size;       /* Number of entries in order_sides */
+    IdHandle *fill_makers;         /* Maker IDs the last add or modify's fills hold a reference to */
+    size_t fill_maker_count;       /* Entries used in fill_makers */
+    size_t fill_maker_capacity;    /* Entries allocated in fill_makers */
+
+    Pool level_pool;               /* Price levels of both sides */
+
+    uint64_t message_sequence;     /* Adds, removes, modifies and user cancels applied so far */
+    Journal journal;               /* Journal the messages are appended to, or NULL */
+
+    OrderBook_LevelUpdateHandler level_handler; /* Receives level updates, or NULL */
+    void *level_context;                        /* Passed through to level_handler */
+
+    DepthSnapshot depth;           /* Best levels published for other threads, or NULL */
+
+    enum OrderBookClock clock;     /* Source of trade timestamps */
+    OrderBook_ClockFn clock_fn;    /* Clock for ORDER_BOOK_CLOCK_CALLBACK */
+    void *clock_context;           /* Passed through to clock_fn */
+    long logical_time;             /* Latest order timestamp seen (ORDER_BOOK_CLOCK_LOGICAL) */
+    long message_time;             /* Clock reading shared by the current message's trades */
+    int message_time_read;         /* Whether message_time has been read for the current message */
+};
+
+/* Snapshot file layout (host byte order): the header, bid_count bid records, ask_count
+ * ask records, then id_count ID entries. Records refer to IDs by index in the table. */
+#define SNAPSHOT_MAGIC "OBSNAP1"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ID_SIZE 40    /* A NUL-padded ID of up to 36 characters */
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t order_size;       /* sizeof(struct SnapshotOrder) */
+    uint32_t id_size;          /* SNAPSHOT_ID_SIZE */
+    uint32_t id_count;
+    uint64_t bid_count;
+    uint64_t ask_count;
+    int64_t next_trade_sequence;
+    uint64_t message_sequence;
+    int64_t logical_time;      /* Added in version 2 */
 };
 
+/* Version 1 headers end before logical_time; such snapshots load with a logical time of 0. */
+#define SNAPSHOT_V1_HEADER_SIZE offsetof(struct SnapshotHeader, logical_time)
+
+struct SnapshotOrder {
+    uint32_t order_id;         /* Index into the snapshot's ID table */
+    uint32_t user_id;
+    int32_t quantity;
+    int32_t side;
+    double price;
+    int64_t timestamp;
+};
+
+/* State threaded through OrderBookSide_for_each_order while saving. */
+struct SnapshotWriter {
+    FILE *out;
+    uint32_t *index_of;        /* Snapshot ID index + 1 by handle (0 if not yet written) */
+    size_t index_slots;
+    IdHandle *handles;         /* Handle of each snapshot ID index */
+    uint32_t id_count;
+    size_t id_capacity;
+    uint64_t order_count;
+    int failed;
+};
+
+/* Which side an order ID handle rests on, as kept in order_sides. */
+#define RESTING_NONE 0
+#define RESTING_BID 1
+#define RESTING_ASK 2
+
+/* How many orders ahead of the one being matched a batch prefetches lookups for. */
+#define BATCH_PREFETCH_DISTANCE 4
+
 /* Forward declarations of internal (static) helper functions. */
-static void   generate_trade_id(char *buf, size_t len);
-static Trade  create_trade(const Order incoming, const Order matched);
-static void   add_trade_to_book(OrderBook book, const Trade t);
-static time_t get_current_timestamp(void);
+static void   format_trade_id(long id, char *buf, size_t len);
+static int    parse_trade_id(const char *trade_id, long *sequence);
+static int    intern_order(OrderBook book, const Order order, BookOrder interned);
+static void   release_order_ids(OrderBook book, const BookOrder order);
+static void   release_fill_makers(OrderBook book);
+static void   copy_id_string(OrderBook book, uint32_t id, char dest[37]);
+static const char *resolve_trade_id(void *context, uint32_t id);
+static uint32_t intern_trade_id(void *context, const char *id);
+static void   release_trade_id(void *context, uint32_t id);
+static struct TradeRecord *create_trade(OrderBook book, const BookOrder incoming, const BookOrder matched, int size);
+static Trade  copy_trade(OrderBook book, const struct TradeRecord *record);
+static int    record_fill(void *context, const BookOrder maker, int filled_quantity);
+static int    add_order(OrderBook book, const Order order, struct OrderBookMatchResult *result);
+static int    admit_order(OrderBook book, const Order order, double *limit, int *may_trade, int *may_rest);
+static int    remove_order(OrderBook book, const char *order_id);
+static int    modify_order(OrderBook book, const char *order_id, double price, int quantity,
+                           struct OrderBookMatchResult *result);
+static OrderBookSide resting_side(OrderBook book, IdHandle handle);
+static int    cancel_user_order(void *context, const BookOrder order);
+static int    rest_order(OrderBook book, const BookOrder order);
+static void   prefetch_order(OrderBook book, const struct Order *order);
+static void   publish_level(OrderBook book, char side, const struct OrderBookLevelView *level);
+static void   publish_depth(OrderBook book);
+static void   bid_level_changed(void *context, const struct OrderBookLevelView *level);
+static void   ask_level_changed(void *context, const struct OrderBookLevelView *level);
+static void   start_message_clock(OrderBook book, const Order order);
+static long   message_timestamp(OrderBook book);
+static uint32_t snapshot_id(struct SnapshotWriter *writer, IdHandle handle);
+static int    write_snapshot_order(void *context, const BookOrder order);
+static int    write_snapshot(OrderBook book, FILE *out);
+static int    restore_snapshot(OrderBook book, const unsigned char *data, size_t header_size,
+                               const struct SnapshotHeader *header);
 
 /*
  * OrderBook_create
  * ----------------
- * Allocates and initializes a new OrderBook instance.
+ * Allocates and initializes a new OrderBook instance with default settings.
  */
 OrderBook OrderBook_create(void)
+{
+    return OrderBook_create_with_config(NULL);
+}
+
+/*
+ * OrderBook_create_with_config
+ * ----------------------------
+ * Allocates and initializes a new OrderBook instance, creating the level pool
+ * shared by both sides and the trade log, and pre-sizing them if requested.
+ */
+OrderBook OrderBook_create_with_config(const struct OrderBookConfig *config)
 {
     OrderBook book = (OrderBook)malloc(sizeof(*book));
     if (!book) {
         return NULL;
     }
+    memset(book, 0, sizeof(*book));
+
+    size_t order_capacity = config ? config->order_capacity : 0;
+    size_t trade_capacity = config ? config->trade_capacity : 0;
+
+    /* Create the pool before the sides so the sides can borrow it. */
+    book->level_pool = Pool_create(OrderBookLevel_block_size(), 0);
+    book->trades = TradeLog_create(config ? &config->trade_log : NULL);
+    book->ids = IdTable_create(order_capacity);
+    /* A level queues OrderBookLevel_inline_orders() orders in its own block. */
+    size_t inline_orders = OrderBookLevel_inline_orders();
+    if (!book->level_pool || !book->trades || !book->ids ||
+        !Pool_reserve(book->level_pool, (order_capacity + inline_orders - 1) / inline_orders) ||
+        !TradeLog_reserve(book->trades, trade_capacity)) {
+        Pool_destroy(&(book->level_pool));
+        TradeLog_destroy(&(book->trades));
+        IdTable_destroy(&(book->ids));
+        free(book);
+        return NULL;
+    }
+
+    /* Spilled trades store their IDs as strings rather than holding references. */
+    struct TradeLogIdHooks id_hooks = {
+        .resolve = resolve_trade_id,
+        .intern = intern_trade_id,
+        .release = release_trade_id,
+        .context = book->ids,
+    };
+    TradeLog_set_id_hooks(book->trades, &id_hooks);
+
+    /* Create bid and ask sides; their depth caches feed the published depth. */
+    int published_depth = config ? config->published_depth : 0;
+    struct OrderBookSideConfig side_config = {
+        .level_pool = book->level_pool,
+        .tick_size = config ? config->tick_size : 0.0,
+        .min_price = config ? config->min_price : 0.0,
+        .max_price = config ? config->max_price : 0.0,
+        .depth_cache = config ? config->depth_cache : 0,
+    };
+    if (side_config.depth_cache < published_depth) {
+        side_config.depth_cache = published_depth;
+    }
+    book->bid_side = OrderBookSide_create_with_config(/* is_buy_side = */ 1, &side_config);
+    book->ask_side = OrderBookSide_create_with_config(/* is_buy_side = */ 0, &side_config);
 
-    /* Create bid and ask sides */
-    book->bid_side = OrderBookSide_create(/* is_buy_side = */ 1);
-    book->ask_side = OrderBookSide_create(/* is_buy_side = */ 0);
+    if (published_depth > 0) {
+        book->depth = DepthSnapshot_create(published_depth);
+    }
+
+    book->clock = config ? config->clock : ORDER_BOOK_CLOCK_WALL;
+    book->clock_fn = config ? config->clock_fn : NULL;
+    book->clock_context = config ? config->clock_context : NULL;
+    int clock_valid = book->clock >= ORDER_BOOK_CLOCK_WALL && book->clock <= ORDER_BOOK_CLOCK_LOGICAL &&
+                      (book->clock != ORDER_BOOK_CLOCK_CALLBACK || book->clock_fn);
 
-    if (!book->bid_side || !book->ask_side) {
+    if (!book->bid_side || !book->ask_side || published_depth < 0 || (published_depth > 0 && !book->depth) ||
+        !clock_valid) {
         /* Cleanup if side creation fails */
         if (book->bid_side) OrderBookSide_destroy(&(book->bid_side));
         if (book->ask_side) OrderBookSide_destroy(&(book->ask_side));
+        DepthSnapshot_destroy(&(book->depth));
+        Pool_destroy(&(book->level_pool));
+        TradeLog_destroy(&(book->trades));
+        IdTable_destroy(&(book->ids));
         free(book);
         return NULL;
     }
 
-    book->trade_map = HashTable_create(180);
-    book->executed_trades = NULL;
-    book->trade_count = 0;
-    book->trade_capacity = 0;
-
     return book;
 }
 
@@ -79,26 +249,31 @@ void OrderBook_destroy(OrderBook *book) {
     if (!book || !*book) return;
     OrderBook b = *book;
 
-    /* Destroy the sides */
+    /* Destroy the sides (their levels go back to level_pool) */
     OrderBookSide_destroy(&(b->bid_side));
     OrderBookSide_destroy(&(b->ask_side));
-    /* Free executed trades */
-    if (b->executed_trades) {
-        /* Each Trade is allocated as part of the array; freeing the array is sufficient */
-        for (int i = 0; i < b->trade_count; i++) {
-            free(b->executed_trades[i]);
-        }
-        free(b->executed_trades);
-    }
+    /* Free the trade log (closing any spill file) and the interned IDs */
+    TradeLog_destroy(&(b->trades));
+    IdTable_destroy(&(b->ids));
+    free(b->order_sides);
+    free(b->fill_makers);
 
-    /* Free the trade_map */
-    HashTable_destroy(&(b->trade_map));
+    /* Release the pool and every block still held in it */
+    Pool_destroy(&(b->level_pool));
+    DepthSnapshot_destroy(&(b->depth));
 
     /* Free the OrderBook itself */
     free(b);
     *book = NULL;
 }
 
+/* State threaded through OrderBookSide_execute_with_handler for one incoming order. */
+struct MatchContext {
+    OrderBook book;
+    BookOrder incoming;
+    struct OrderBookMatchResult *result;
+};
+
 /*
  * OrderBook_add_order
  * -------------------
@@ -114,131 +289,229 @@ char **OrderBook_add_order(OrderBook book, const Order order, int *trade_count)
         return NULL;
     }
 
-    /* Copy the incoming order so we can modify its quantity if partially filled. */
-    Order incoming = (Order)malloc(sizeof(*incoming));
-    if (!incoming) {
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    int ok = OrderBook_add_order_with_result(book, order, &result);
+
+    if (trade_count) *trade_count = ok ? result.count : 0;
+
+    /* If no trades were executed (or nobody asked for them), there is nothing to return. */
+    if (!ok || result.count == 0 || !trade_count) {
+        OrderBookMatchResult_free(&result);
         return NULL;
     }
-    memcpy(incoming, order, sizeof(*incoming));
-
-    /* Determine if this is a buy ('1') or sell ('0'). */
-    int is_buy = (incoming->side == '1');
 
-    /* We'll store the filled orders from the opposite side. */
-    Order *filled_orders = NULL;
-    int filled_count = 0;
+    /* Format the numeric trade IDs into the string array the caller owns. */
+    char **trade_ids = (char **)malloc(sizeof(char *) * result.count);
+    if (!trade_ids) {
+        *trade_count = 0;
+        OrderBookMatchResult_free(&result);
+        return NULL;
+    }
 
-    /*
-     * Execute against the opposite side if crossing can occur.
-     * - If buy: execute against ask side.
-     * - If sell: execute against bid side.
-     */
-    if (is_buy) {
-        /* Attempt to fill this incoming buy order against the ask side */
-        if (!OrderBookSide_execute_against(book->ask_side, incoming, &filled_orders, &filled_count)) {
-            /* Some error occurred in execution, just clean up and return. */
-            free(incoming);
-            return NULL;
-        }
-    } else {
-        /* Sell order executes against the bid side */
-        if (!OrderBookSide_execute_against(book->bid_side, incoming, &filled_orders, &filled_count)) {
-            /* Some error occurred */
-            free(incoming);
-            return NULL;
+    for (int i = 0; i < result.count; i++) {
+        trade_ids[i] = (char *)malloc(37);
+        if (trade_ids[i]) {
+            format_trade_id(result.fills[i].trade_id, trade_ids[i], 37);
         }
     }
 
-    /*
-     * For every filled order, we create a Trade record.
-     * Then we add it to the book's executed trades array.
-     * We'll also build an array of trade IDs to return.
-     */
-    char **trade_ids = NULL;
-    int num_trades_executed = 0;
-    if (filled_count > 0) {
-        trade_ids = (char **)malloc(sizeof(char *) * filled_count);
-        if (!trade_ids) {
-            /* Cleanup on failure */
-            free(incoming);
-            free(filled_orders);
-            return NULL;
-        }
-        memset(trade_ids, 0, sizeof(char *) * filled_count);
+    OrderBookMatchResult_free(&result);
+    return trade_ids; /* Caller must free each string and then the array. */
+}
 
-        for (int i = 0; i < filled_count; i++) {
-            /* Create a Trade from the perspective of (incoming, filled_orders[i]) */
-            Trade t = create_trade(incoming, filled_orders[i]);
+/*
+ * OrderBook_add_order_with_result
+ * -------------------------------
+ * Adds a new order to the order book, writing a compact record for each fill
+ * into the caller's reusable result buffer instead of allocating trade ID strings.
+ * The add and its outcome are appended to the attached journal, if any.
+ */
+int OrderBook_add_order_with_result(OrderBook book, const Order order, struct OrderBookMatchResult *result)
+{
+    if (!book || !order || !result) {
+        return 0;
+    }
+    result->count = 0;
+    release_fill_makers(book);
 
-            /* Add the trade to the order book's record */
-            add_trade_to_book(book, t);
+    uint64_t sequence = book->message_sequence++;
+    int ok = add_order(book, order, result);
+    if (book->journal) {
+        Journal_log_add(book->journal, sequence, order, ok, result);
+    }
+    publish_depth(book);
+    return ok;
+}
 
-            /* Copy out the trade_id so we can return it to the caller */
-            trade_ids[i] = (char *)malloc(37);
-            if (trade_ids[i]) {
-                strncpy(trade_ids[i], t->trade_id, 37);
-            }
-            num_trades_executed++;
-            free(filled_orders[i]);
-        }
+/*
+ * OrderBookMatchResult_free
+ * -------------------------
+ * Frees a match result's fill storage and resets it to empty.
+ */
+void OrderBookMatchResult_free(struct OrderBookMatchResult *result)
+{
+    if (!result) {
+        return;
+    }
+    free(result->fills);
+    result->fills = NULL;
+    result->count = 0;
+    result->capacity = 0;
+}
 
-        free(filled_orders);
+/*
+ * OrderBook_remove_order
+ * ----------------------
+ * Removes an order from either the bid side or ask side by its ID, and
+ * appends the remove to the attached journal, if any.
+ * Returns 1 if successful, 0 if not found.
+ */
+int OrderBook_remove_order(OrderBook book, const char *order_id)
+{
+    if (!book || !order_id) {
+        return 0;
     }
 
-    /*
-     * If there's still quantity left in the incoming order (partial fill),
-     * place the remainder on the correct side of the book.
-     */
-    if (incoming->quantity > 0) {
-        if (is_buy) {
-            /* Add to bid side */
-            OrderBookSide_add_order(book->bid_side, incoming);
-        } else {
-            /* Add to ask side */
-            OrderBookSide_add_order(book->ask_side, incoming);
-        }
+    uint64_t sequence = book->message_sequence++;
+    INSTRUMENT_TIME(remove_start);
+    int removed = remove_order(book, order_id);
+    INSTRUMENT_STAGE(INSTRUMENT_REMOVE_ORDER, remove_start);
+    if (book->journal) {
+        Journal_log_remove(book->journal, sequence, order_id, removed);
     }
+    publish_depth(book);
+    return removed;
+}
 
-    free(incoming);
+/*
+ * OrderBook_modify_order
+ * ----------------------
+ * Changes the price and quantity of a resting order, writing any fills a
+ * crossing price produces into result, and appends the modify to the attached
+ * journal, if any.
+ * Returns 1 if successful, 0 if not found or not modified.
+ */
+int OrderBook_modify_order(OrderBook book, const char *order_id, double price, int quantity,
+                           struct OrderBookMatchResult *result)
+{
+    if (!book || !order_id) {
+        return 0;
+    }
+    struct OrderBookMatchResult local_result = { NULL, 0, 0 };
+    if (!result) {
+        result = &local_result;
+    }
+    result->count = 0;
+    release_fill_makers(book);
 
-    if (trade_count) *trade_count = num_trades_executed;
+    uint64_t sequence = book->message_sequence++;
+    INSTRUMENT_TIME(modify_start);
+    int modified = modify_order(book, order_id, price, quantity, result);
+    INSTRUMENT_STAGE(INSTRUMENT_MODIFY_ORDER, modify_start);
+    if (book->journal) {
+        Journal_log_modify(book->journal, sequence, order_id, price, quantity, modified, result);
+    }
+    publish_depth(book);
+    OrderBookMatchResult_free(&local_result);
+    return modified;
+}
 
-    /* If no trades were executed, free the trade_ids array (if allocated) and return NULL. */
-    if (num_trades_executed == 0 || !trade_count) {
-        if (trade_ids) {
-            for (int i = 0; i < filled_count; i++) {
-                free(trade_ids[i]);
-            }
-            free(trade_ids);
-        }
-        return NULL;
+/*
+ * OrderBook_cancel_all_for_user
+ * -----------------------------
+ * Removes every resting order of one user from both sides as one message, and
+ * appends it to the attached journal, if any.
+ * Returns the number of orders removed.
+ */
+size_t OrderBook_cancel_all_for_user(OrderBook book, const char *user_id)
+{
+    if (!book || !user_id) {
+        return 0;
     }
 
-    return trade_ids; /* Caller must free each string and then the array. */
+    uint64_t sequence = book->message_sequence++;
+    INSTRUMENT_TIME(cancel_start);
+    size_t cancelled = 0;
+    /* A user that was never interned has nothing resting. */
+    IdHandle handle = IdTable_find(book->ids, user_id);
+    if (handle != ID_HANDLE_NONE) {
+        cancelled += OrderBookSide_delete_orders_for_user(book->bid_side, handle, cancel_user_order, book);
+        cancelled += OrderBookSide_delete_orders_for_user(book->ask_side, handle, cancel_user_order, book);
+    }
+    INSTRUMENT_STAGE(INSTRUMENT_CANCEL_USER, cancel_start);
+    if (book->journal) {
+        Journal_log_cancel_user(book->journal, sequence, user_id, cancelled);
+    }
+    publish_depth(book);
+    return cancelled;
 }
 
 /*
- * OrderBook_remove_order
- * ----------------------
- * Removes an order from either the bid side or ask side by its ID.
- * Returns 1 if successful, 0 if not found.
+ * OrderBook_add_orders
+ * --------------------
+ * Adds a batch of orders in sequence, appending every fill to one result buffer.
+ * Before each order is matched, the ID and level lookups of the order
+ * BATCH_PREFETCH_DISTANCE places later are prefetched so their cache misses
+ * overlap the matching of the orders in between.
  */
-int OrderBook_remove_order(OrderBook book, const char *order_id)
+size_t OrderBook_add_orders(OrderBook book, const struct Order *orders, size_t count,
+                            struct OrderBookMatchResult *result, struct OrderBookBatchStatus *statuses)
 {
-    if (!book || !order_id) {
+    if (!book || !orders || !result) {
         return 0;
     }
+    result->count = 0;
+    release_fill_makers(book);
 
-    /*
-     * Try removing from the bid side first.
-     * If not found, try removing from the ask side.
-     */
-    int removed = OrderBookSide_delete_order_by_id(book->bid_side, order_id);
-    if (!removed) {
-        removed = OrderBookSide_delete_order_by_id(book->ask_side, order_id);
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i + BATCH_PREFETCH_DISTANCE < count) {
+            prefetch_order(book, &orders[i + BATCH_PREFETCH_DISTANCE]);
+        }
+
+        int first_fill = result->count;
+        uint64_t sequence = book->message_sequence++;
+        int ok = add_order(book, (const Order)&orders[i], result);
+        if (book->journal) {
+            /* Journal only this order's share of the batch's fills. */
+            struct OrderBookMatchResult fills = { result->fills + first_fill, result->count - first_fill, 0 };
+            Journal_log_add(book->journal, sequence, (const Order)&orders[i], ok, &fills);
+        }
+        publish_depth(book);
+
+        if (statuses) {
+            statuses[i].accepted = ok;
+            statuses[i].first_fill = first_fill;
+            statuses[i].fill_count = result->count - first_fill;
+        }
+        if (ok) accepted++;
     }
+    return accepted;
+}
 
-    return removed;
+/*
+ * OrderBook_remove_orders
+ * -----------------------
+ * Removes a batch of orders by ID in sequence, prefetching the ID lookup of
+ * the remove BATCH_PREFETCH_DISTANCE places later.
+ */
+size_t OrderBook_remove_orders(OrderBook book, const char *const *order_ids, size_t count, int *removed)
+{
+    if (!book || !order_ids) {
+        return 0;
+    }
+
+    size_t removed_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i + BATCH_PREFETCH_DISTANCE < count) {
+            IdTable_prefetch(book->ids, order_ids[i + BATCH_PREFETCH_DISTANCE]);
+        }
+
+        int ok = OrderBook_remove_order(book, order_ids[i]);
+        if (removed) removed[i] = ok;
+        if (ok) removed_count++;
+    }
+    return removed_count;
 }
 
 /*
@@ -298,10 +571,98 @@ int OrderBook_get_top_levels(OrderBook book,
     return 1;
 }
 
+/*
+ * OrderBook_peek_top_levels
+ * -------------------------
+ * Hands out pointers to the sides' depth caches, which are kept current on
+ * every change, so this is O(1).
+ */
+int OrderBook_peek_top_levels(OrderBook book,
+                              const struct OrderBookLevelView **bid_levels,
+                              int *bid_count,
+                              const struct OrderBookLevelView **ask_levels,
+                              int *ask_count)
+{
+    if (!book || !bid_levels || !bid_count || !ask_levels || !ask_count) {
+        return 0;
+    }
+
+    *bid_levels = OrderBookSide_peek_levels(book->bid_side, bid_count);
+    *ask_levels = OrderBookSide_peek_levels(book->ask_side, ask_count);
+    return *bid_levels != NULL && *ask_levels != NULL;
+}
+
+/*
+ * OrderBook_get_depth_snapshot
+ * ----------------------------
+ * Returns the block the book publishes its best levels to after every message.
+ */
+DepthSnapshot OrderBook_get_depth_snapshot(OrderBook book)
+{
+    return book ? book->depth : NULL;
+}
+
+/*
+ * OrderBook_read_depth
+ * --------------------
+ * Copies the last published levels. Reads only the snapshot block, never the
+ * sides, so it may run on any thread while another applies messages.
+ */
+int OrderBook_read_depth(OrderBook book, struct DepthSnapshotView *view)
+{
+    if (!book || !book->depth) {
+        return 0;
+    }
+    return DepthSnapshot_read(book->depth, view);
+}
+
+/*
+ * OrderBook_estimate_fill
+ * -----------------------
+ * Estimates a sweep of the side opposite an incoming order of the given side.
+ */
+int OrderBook_estimate_fill(OrderBook book, char side, long quantity, struct OrderBookFillEstimate *estimate)
+{
+    if (!book || (side != '0' && side != '1')) {
+        return 0;
+    }
+    return OrderBookSide_estimate_fill(side == '1' ? book->ask_side : book->bid_side, quantity, estimate);
+}
+
+/*
+ * OrderBook_size_through_price
+ * ----------------------------
+ * Sums the opposite side's quantity at prices an incoming order at price crosses.
+ */
+long OrderBook_size_through_price(OrderBook book, char side, double price)
+{
+    if (!book || (side != '0' && side != '1')) {
+        return 0;
+    }
+    return OrderBookSide_size_through_price(side == '1' ? book->ask_side : book->bid_side, price);
+}
+
+/*
+ * OrderBook_set_level_handler
+ * ---------------------------
+ * Sets the level update handler. The sides only get a listener while a handler
+ * is set, so a book without one pays nothing for the feed.
+ */
+void OrderBook_set_level_handler(OrderBook book, OrderBook_LevelUpdateHandler handler, void *context)
+{
+    if (!book) {
+        return;
+    }
+    book->level_handler = handler;
+    book->level_context = context;
+    OrderBookSide_set_level_listener(book->bid_side, handler ? bid_level_changed : NULL, book);
+    OrderBookSide_set_level_listener(book->ask_side, handler ? ask_level_changed : NULL, book);
+}
+
 /*
  * OrderBook_get_all_trades
  * -------------------------
- * Returns all executed trades in chronological order (the order in which
+ * Returns all retained trades in chronological order (the order in which
  * they were added to the order book). The caller is responsible for freeing
  * the returned array of Trade objects.
  */
@@ -311,24 +672,27 @@ int OrderBook_get_all_trades(OrderBook book, Trade **trades, int *trade_count)
         return 0;
     }
 
-    if (book->trade_count == 0) {
+    size_t count = TradeLog_count(book->trades);
+    if (count == 0) {
         *trades = NULL;
         *trade_count = 0;
         return 1;
     }
 
-    /* Allocate a new array of Trade pointers and copy them over. */
-    *trades = (Trade *)malloc(book->trade_count * sizeof(Trade));
+    /* Allocate a new array of Trade pointers and fill it from the log. */
+    *trades = (Trade *)malloc(count * sizeof(Trade));
     if (!*trades) {
         return 0;
     }
 
-    for (int i = 0; i < book->trade_count; i++) {
-        /* Allocate a new Trade struct and copy the fields. */
-        Trade new_t = (Trade)malloc(sizeof(*(book->executed_trades[i])));
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, TradeLog_first_sequence(book->trades));
+    for (size_t i = 0; i < count; i++) {
+        const struct TradeRecord *record = TradeLogCursor_next(book->trades, &cursor);
+        Trade new_t = record ? copy_trade(book, record) : NULL;
         if (!new_t) {
             /* In case of partial allocation failure, free everything so far */
-            for (int j = 0; j < i; j++) {
+            for (size_t j = 0; j < i; j++) {
                 free((*trades)[j]);
             }
             free(*trades);
@@ -336,19 +700,19 @@ int OrderBook_get_all_trades(OrderBook book, Trade **trades, int *trade_count)
             *trade_count = 0;
             return 0;
         }
-        memcpy(new_t, book->executed_trades[i], sizeof(*(book->executed_trades[i])));
         (*trades)[i] = new_t;
     }
 
-    *trade_count = book->trade_count;
+    *trade_count = (int)count;
     return 1;
 }
 
 /*
  * OrderBook_get_trade
  * -------------------
- * Searches executed trades by trade_id. Returns a heap-allocated copy
- * of the matching Trade, or NULL if not found.
+ * Looks a trade up by its string ID. The ID encodes the trade's sequence in
+ * the log, so no search is needed. Returns a heap-allocated copy of the
+ * matching Trade, or NULL if not found.
  */
 Trade OrderBook_get_trade(OrderBook book, const char *trade_id)
 {
@@ -356,128 +720,1072 @@ Trade OrderBook_get_trade(OrderBook book, const char *trade_id)
         return NULL;
     }
 
-    /* Use the trade_map to find the trade by ID */
-    Trade original = (Trade)HashTable_get(book->trade_map, trade_id);
-    if (original) {
-        /* Create a copy to return */
-        Trade copy = (Trade)malloc(sizeof(*copy));
-        if (!copy) {
-            return NULL; /* Allocation failure */
-        }
-        memcpy(copy, original, sizeof(*copy));
-        return copy;
+    long sequence;
+    struct TradeRecord record;
+    if (!parse_trade_id(trade_id, &sequence) ||
+        !TradeLog_get(book->trades, sequence, &record)) {
+        /* Malformed ID, or the trade is not retained */
+        return NULL;
     }
 
-    /* No match found */
-    return NULL;
-} 
-
-/* ======================= */
-/* Internal Helper Methods */
-/* ======================= */
+    return copy_trade(book, &record);
+}
 
 /*
- * generate_trade_id
- * -----------------
- * Generates a pseudo-unique trade ID as a string (36 chars + null terminator).
- * In production, replace with a robust UUID generator.
+ * OrderBook_get_trade_record
+ * --------------------------
+ * Copies the trade with the given numeric trade ID out of the log.
  */
-static void generate_trade_id(char *buf, size_t len)
+int OrderBook_get_trade_record(OrderBook book, long trade_id, struct TradeRecord *record)
 {
-    static int counter = 0;
-    snprintf(buf, len, "TRADE-%08d", counter++);
+    if (!book || !record) {
+        return 0;
+    }
+    return TradeLog_get(book->trades, trade_id, record);
 }
 
 /*
- * create_trade
- * ------------
- * Constructs a Trade from an incoming order and a matched order. The
- * buy order must have side '1', the sell order '0'. If the roles are flipped,
- * this function deduces them automatically.
+ * OrderBook_next_trade
+ * --------------------
+ * Reads the next trade after the cursor's position from the book's log.
  */
-static Trade create_trade(const Order incoming, const Order matched)
+const struct TradeRecord *OrderBook_next_trade(OrderBook book, TradeLogCursor *cursor)
 {
-    Trade t = (Trade)malloc(sizeof(*t));
-    if (!t) {
+    if (!book || !cursor) {
         return NULL;
     }
+    return TradeLogCursor_next(book->trades, cursor);
+}
 
-    memset(t, 0, sizeof(*t));
-    generate_trade_id(t->trade_id, sizeof(t->trade_id));
+/*
+ * OrderBook_get_id_string
+ * -----------------------
+ * Resolves an interned ID handle back to the external string ID.
+ */
+const char *OrderBook_get_id_string(OrderBook book, uint32_t id)
+{
+    return book ? IdTable_get(book->ids, id) : NULL;
+}
 
-    /* If 'incoming' is the buyer, fill buyer fields from incoming, else from matched. */
-    int incoming_is_buy = (incoming->side == '1');
+/*
+ * OrderBook_trade_count
+ * ---------------------
+ * Returns the number of trades still retained by the book.
+ */
+size_t OrderBook_trade_count(OrderBook book)
+{
+    return book ? TradeLog_count(book->trades) : 0;
+}
 
-    if (incoming_is_buy) {
-        strncpy(t->buy_order_id, incoming->order_id, sizeof(t->buy_order_id));
-        strncpy(t->buy_user_id, incoming->user_id, sizeof(t->buy_user_id));
-        strncpy(t->sell_order_id, matched->order_id, sizeof(t->sell_order_id));
-        strncpy(t->sell_user_id, matched->user_id, sizeof(t->sell_user_id));
-    } else {
-        strncpy(t->buy_order_id, matched->order_id, sizeof(t->buy_order_id));
-        strncpy(t->buy_user_id, matched->user_id, sizeof(t->buy_user_id));
-        strncpy(t->sell_order_id, incoming->order_id, sizeof(t->sell_order_id));
-        strncpy(t->sell_user_id, incoming->user_id, sizeof(t->sell_user_id));
-    }
+/*
+ * OrderBook_get_memory_stats
+ * --------------------------
+ * Adds up the memory held by the book's modules. Levels come from the shared
+ * pool, so the sides report everything else they hold and the pool is counted once.
+ */
+int OrderBook_get_memory_stats(OrderBook book, struct OrderBookMemoryStats *stats)
+{
+    if (!book || !stats) return 0;
 
-    /* The matched price is typically the price of the order in the book,
-       but it depends on your matching logic. Usually it's the best in the book
-       or the incoming price, whichever logic you use. We'll use matched->price
-       in this example. */
-    t->price = matched->price;
+    struct OrderBookSideMemory bids, asks;
+    if (!OrderBookSide_get_memory_usage(book->bid_side, &bids) ||
+        !OrderBookSide_get_memory_usage(book->ask_side, &asks)) {
+        return 0;
+    }
 
-    /* The size executed is the difference in quantity, but since the order
-       book side executes partial fills, matched->quantity typically is how
-       much was removed from that matched order in this trade. You might also
-       store partial fill sizes. For a simpler approach, assume that the
-       matched Orders returned each represent the actual fill size. */
-    t->size = matched->quantity;
+    stats->level_bytes = Pool_memory_usage(book->level_pool) + bids.level_bytes + asks.level_bytes;
+    stats->order_bytes = bids.order_bytes + asks.order_bytes + book->order_sides_size;
+    stats->hash_bytes = IdTable_memory_usage(book->ids);
+    stats->trade_bytes = TradeLog_memory_usage(book->trades);
+    stats->other_bytes = sizeof(*book) + bids.other_bytes + asks.other_bytes +
+                         book->fill_maker_capacity * sizeof(IdHandle) + DepthSnapshot_memory_usage(book->depth);
+    stats->total_bytes = stats->level_bytes + stats->order_bytes + stats->hash_bytes +
+                         stats->trade_bytes + stats->other_bytes;
+    return 1;
+}
 
-    /* Record the timestamp */
-    t->timestamp = get_current_timestamp();
+/*
+ * OrderBook_attach_journal
+ * ------------------------
+ * Sets (or with NULL, clears) the journal every message (add, remove, modify or
+ * user cancel) is appended to.
+ */
+void OrderBook_attach_journal(OrderBook book, Journal journal)
+{
+    if (book) {
+        book->journal = journal;
+    }
+}
 
-    return t;
+/*
+ * OrderBook_message_sequence
+ * --------------------------
+ * Returns the number of adds, removes, modifies and user cancels applied to the
+ * book, including those restored from a snapshot.
+ */
+uint64_t OrderBook_message_sequence(OrderBook book)
+{
+    return book ? book->message_sequence : 0;
 }
 
 /*
- * add_trade_to_book
- * -----------------
- * Appends a Trade to the book's executed_trades array, resizing if needed.
+ * OrderBook_save
+ * --------------
+ * Writes a snapshot to a temporary file, syncs it and renames it over path.
  */
-static void add_trade_to_book(OrderBook book, const Trade t)
+int OrderBook_save(OrderBook book, const char *path)
 {
-    if (!book || !t) {
-        return;
+    if (!book || !path) {
+        return 0;
     }
 
-    /* Resize array if needed */
-    if (book->trade_count == book->trade_capacity) {
-        int new_capacity = (book->trade_capacity == 0) ? 8 : book->trade_capacity * 2;
-        Trade *new_array = (Trade *)realloc(book->executed_trades, new_capacity * sizeof(Trade));
-        if (!new_array) {
-            /* If reallocation fails, we simply return (trade is lost).
-               A robust system might handle this more gracefully. */
-            return;
-        }
-        book->executed_trades = new_array;
-        book->trade_capacity = new_capacity;
+    size_t path_len = strlen(path);
+    char *tmp_path = (char *)malloc(path_len + 5);
+    if (!tmp_path) {
+        return 0;
     }
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
 
-    /* Store the Trade pointer in the array */
-    book->executed_trades[book->trade_count] = t;
-    book->trade_count++;
+    FILE *out = fopen(tmp_path, "wb");
+    int ok = out && write_snapshot(book, out);
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if (out && fclose(out) != 0) {
+        ok = 0;
+    }
+    ok = ok && rename(tmp_path, path) == 0;
 
-    /* Add Trade to trade_map */
-    HashTable_add(book->trade_map, t->trade_id, t);
+    if (!ok) {
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return ok;
 }
 
 /*
- * get_current_timestamp
- * ---------------------
- * Returns a simple time-based timestamp. Adjust as needed for
- * higher precision or custom time sources.
+ * OrderBook_load
+ * --------------
+ * Maps a snapshot, checks its header against the file size, and rebuilds a
+ * new book from it.
  */
-static time_t get_current_timestamp(void)
+OrderBook OrderBook_load(const char *path, const struct OrderBookConfig *config)
 {
-    return time(NULL);
-}
\ No newline at end of file
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < SNAPSHOT_V1_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+
+    /* The counts must describe exactly the bytes that follow the header. */
+    struct SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(&header, data, SNAPSHOT_V1_HEADER_SIZE);
+    size_t header_size = header.version == 1 ? SNAPSHOT_V1_HEADER_SIZE : sizeof(header);
+    if (length >= header_size) {
+        memcpy(&header, data, header_size);
+    }
+    size_t body = length >= header_size ? length - header_size : 0;
+    int valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                (header.version == 1 || header.version == SNAPSHOT_VERSION) &&
+                length >= header_size &&
+                header.order_size == sizeof(struct SnapshotOrder) &&
+                header.id_size == SNAPSHOT_ID_SIZE &&
+                header.next_trade_sequence >= 0 &&
+                header.id_count <= body / SNAPSHOT_ID_SIZE &&
+                header.bid_count <= body / sizeof(struct SnapshotOrder) &&
+                header.ask_count <= body / sizeof(struct SnapshotOrder) &&
+                (header.bid_count + header.ask_count) * sizeof(struct SnapshotOrder) +
+                    (size_t)header.id_count * SNAPSHOT_ID_SIZE == body;
+
+    OrderBook book = NULL;
+    if (valid) {
+        struct OrderBookConfig book_config;
+        if (config) {
+            book_config = *config;
+        } else {
+            memset(&book_config, 0, sizeof(book_config));
+        }
+        size_t order_count = (size_t)(header.bid_count + header.ask_count);
+        if (book_config.order_capacity < order_count) {
+            book_config.order_capacity = order_count;
+        }
+
+        book = OrderBook_create_with_config(&book_config);
+        if (book && !restore_snapshot(book, (const unsigned char *)data, header_size, &header)) {
+            OrderBook_destroy(&book);
+        }
+        publish_depth(book);
+    }
+
+    munmap(data, length);
+    return book;
+}
+
+/* ======================= */
+/* Internal Helper Methods */
+/* ======================= */
+
+/*
+ * format_trade_id
+ * ---------------
+ * Formats a numeric trade ID as its string form.
+ */
+static void format_trade_id(long id, char *buf, size_t len)
+{
+    snprintf(buf, len, "TRADE-%08ld", id);
+}
+
+/*
+ * parse_trade_id
+ * --------------
+ * Recovers the numeric trade ID from a string produced by format_trade_id.
+ * Returns 1 on success, 0 if the string is not a trade ID.
+ */
+static int parse_trade_id(const char *trade_id, long *sequence)
+{
+    if (strncmp(trade_id, "TRADE-", 6) != 0) {
+        return 0;
+    }
+
+    const char *digits = trade_id + 6;
+    long value = 0;
+    if (*digits == '\0') {
+        return 0;
+    }
+    for (; *digits; digits++) {
+        if (*digits < '0' || *digits > '9' || value > (LONG_MAX - 9) / 10) {
+            return 0;
+        }
+        value = value * 10 + (*digits - '0');
+    }
+
+    *sequence = value;
+    return 1;
+}
+
+/*
+ * intern_order
+ * ------------
+ * Fills in a compact copy of an external order, interning its order and user
+ * IDs. The copy holds one reference to each. Returns 0 on failure.
+ */
+static int intern_order(OrderBook book, const Order order, BookOrder interned)
+{
+    interned->order_id = IdTable_intern(book->ids, order->order_id);
+    interned->user_id = IdTable_intern(book->ids, order->user_id);
+    if (interned->order_id == ID_HANDLE_NONE || interned->user_id == ID_HANDLE_NONE) {
+        release_order_ids(book, interned);
+        return 0;
+    }
+
+    interned->quantity = order->quantity;
+    interned->side = order->side;
+    interned->price = order->price;
+    interned->timestamp = order->timestamp;
+    return 1;
+}
+
+/*
+ * release_order_ids
+ * -----------------
+ * Drops the references an order holds on its order and user IDs.
+ */
+static void release_order_ids(OrderBook book, const BookOrder order)
+{
+    IdTable_release(book->ids, order->order_id);
+    IdTable_release(book->ids, order->user_id);
+}
+
+/*
+ * release_fill_makers
+ * -------------------
+ * Drops the references the previous add or modify's fills held on their maker
+ * IDs, so a filled maker's ID is freed once nothing else uses it.
+ */
+static void release_fill_makers(OrderBook book)
+{
+    for (size_t i = 0; i < book->fill_maker_count; i++) {
+        IdTable_release(book->ids, book->fill_makers[i]);
+    }
+    book->fill_maker_count = 0;
+}
+
+/*
+ * resolve_trade_id, intern_trade_id, release_trade_id
+ * ---------------------------------------------------
+ * The trade log's ID hooks, over the book's IdTable.
+ */
+static const char *resolve_trade_id(void *context, uint32_t id)
+{
+    return IdTable_get((IdTable)context, id);
+}
+
+static uint32_t intern_trade_id(void *context, const char *id)
+{
+    return IdTable_intern((IdTable)context, id);
+}
+
+static void release_trade_id(void *context, uint32_t id)
+{
+    IdTable_release((IdTable)context, id);
+}
+
+/*
+ * copy_id_string
+ * --------------
+ * Copies an interned ID into a 37-byte field, leaving it empty if the handle
+ * is not live.
+ */
+static void copy_id_string(OrderBook book, uint32_t id, char dest[37])
+{
+    const char *str = IdTable_get(book->ids, id);
+    if (str) {
+        strncpy(dest, str, 36);
+        dest[36] = '\0';
+    }
+}
+
+/*
+ * add_order
+ * ---------
+ * Matches an order against the opposite side and rests any remainder.
+ */
+static int add_order(OrderBook book, const Order order, struct OrderBookMatchResult *result)
+{
+    /* Intern the incoming order's IDs into a compact copy whose quantity we can
+       modify if partially filled. The copy holds one reference to each ID. */
+    INSTRUMENT_CALL_BEGIN();
+    INSTRUMENT_TIME(call_start);
+
+    /* Determine if this is a buy ('1') or sell ('0'). */
+    int is_buy = (order->side == '1');
+    OrderBookSide opposite = is_buy ? book->ask_side : book->bid_side;
+
+    /*
+     * Settle what the order's type and time in force allow before touching
+     * the book: a rejected order, or one that can neither trade nor rest,
+     * never interns its IDs.
+     */
+    start_message_clock(book, order);
+
+    double limit;
+    int may_trade, may_rest;
+    int admitted = admit_order(book, order, &limit, &may_trade, &may_rest);
+    if (!admitted || (!may_trade && !may_rest)) {
+        INSTRUMENT_CALL_END(INSTRUMENT_ADD_ORDER, call_start);
+        return admitted;
+    }
+
+    struct BookOrder incoming_order;
+    INSTRUMENT_TIME(lookup_start);
+    if (!intern_order(book, order, &incoming_order)) {
+        INSTRUMENT_CALL_END(INSTRUMENT_ADD_ORDER, call_start);
+        return 0;
+    }
+    BookOrder incoming = &incoming_order;
+    incoming->price = limit;
+    INSTRUMENT_STAGE(INSTRUMENT_ID_LOOKUP, lookup_start);
+
+    /*
+     * Execute against the opposite side if crossing can occur.
+     * - If buy: execute against ask side.
+     * - If sell: execute against bid side.
+     * Every fill becomes a Trade in the book's history and a record in result.
+     */
+    struct MatchContext context = { book, incoming, result };
+    INSTRUMENT_TIME(match_start);
+    if (!OrderBookSide_execute_with_handler(opposite, incoming, record_fill, &context)) {
+        /* Fills up to the failure stand; the remainder is not rested. */
+        release_order_ids(book, incoming);
+        INSTRUMENT_CALL_END(INSTRUMENT_ADD_ORDER, call_start);
+        return 0;
+    }
+    INSTRUMENT_STAGE(INSTRUMENT_MATCH, match_start);
+
+    /*
+     * If there's still quantity left in the incoming order (partial fill),
+     * place the remainder on the correct side of the book. A resting order
+     * keeps the copy's ID references; otherwise they are released. Admission
+     * made sure the remainder can rest, so only an allocation failure stops it.
+     */
+    int must_rest = incoming->quantity > 0 && may_rest;
+    int rested = 0;
+    if (must_rest) {
+        INSTRUMENT_TIME(rest_start);
+        rested = rest_order(book, incoming);
+        INSTRUMENT_STAGE(INSTRUMENT_REST, rest_start);
+    }
+    if (!rested) {
+        release_order_ids(book, incoming);
+    }
+
+    INSTRUMENT_CALL_END(INSTRUMENT_ADD_ORDER, call_start);
+    return rested || !must_rest;
+}
+
+/*
+ * admit_order
+ * -----------
+ * Applies an incoming order's type and time in force against the opposite
+ * side. Returns 0 if the order is rejected (an unknown type, an order whose ID
+ * already rests, a post-only order that would trade, a fill-or-kill order that
+ * cannot fill, or one whose remainder would rest outside a ladder book's band).
+ * Else sets the price to match at (a market order's is the worst level its
+ * quantity reaches), whether it can trade on arrival, and whether its
+ * remainder may rest. A rejected order never trades.
+ */
+static int admit_order(OrderBook book, const Order order, double *limit, int *may_trade, int *may_rest)
+{
+    *may_trade = 0;
+    *may_rest = 0;
+    *limit = order->price;
+    if (order->time_in_force < TIME_IN_FORCE_GTC || order->time_in_force > TIME_IN_FORCE_FOK) {
+        return 0;
+    }
+    if (resting_side(book, IdTable_find(book->ids, order->order_id))) {
+        return 0;
+    }
+
+    int is_buy = (order->side == '1');
+    OrderBookSide own = is_buy ? book->bid_side : book->ask_side;
+    OrderBookSide opposite = is_buy ? book->ask_side : book->bid_side;
+    /* Only a good-till-cancelled limit or post-only order can leave a remainder to rest. */
+    if (order->order_type != ORDER_TYPE_MARKET && order->time_in_force == TIME_IN_FORCE_GTC &&
+        !OrderBookSide_can_rest_at(own, order->price)) {
+        return 0;
+    }
+
+    switch (order->order_type) {
+    case ORDER_TYPE_MARKET: {
+        struct OrderBookFillEstimate estimate;
+        OrderBookSide_estimate_fill(opposite, order->quantity > 0 ? order->quantity : 0, &estimate);
+        if (order->time_in_force == TIME_IN_FORCE_FOK && estimate.quantity < order->quantity) {
+            return 0;
+        }
+        *limit = estimate.worst_price;
+        *may_trade = estimate.quantity > 0;
+        return 1;
+    }
+    case ORDER_TYPE_POST_ONLY:
+        if (OrderBookSide_crosses_best(opposite, order->price)) {
+            return 0;
+        }
+        *may_rest = order->time_in_force == TIME_IN_FORCE_GTC;
+        /* A post-only IOC can never trade, so it is cancelled at once; a FOK is rejected. */
+        return order->time_in_force != TIME_IN_FORCE_FOK || order->quantity <= 0;
+    case ORDER_TYPE_LIMIT:
+        if (order->time_in_force == TIME_IN_FORCE_FOK &&
+            !OrderBookSide_can_fill(opposite, order->price, order->quantity > 0 ? order->quantity : 0)) {
+            return 0;
+        }
+        *may_trade = OrderBookSide_crosses_best(opposite, order->price);
+        *may_rest = order->time_in_force == TIME_IN_FORCE_GTC;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * remove_order
+ * ------------
+ * Removes a resting order by its ID and releases its ID references.
+ */
+static int remove_order(OrderBook book, const char *order_id)
+{
+    /* An ID that was never interned cannot be resting. */
+    IdHandle handle = IdTable_find(book->ids, order_id);
+    if (handle == ID_HANDLE_NONE) {
+        return 0;
+    }
+
+    /* The book knows which side the order rests on, so only that side is searched. */
+    OrderBookSide side = resting_side(book, handle);
+    struct BookOrder removed;
+    if (!side || !OrderBookSide_get_order_by_id(side, handle, &removed)) {
+        return 0;
+    }
+
+    /* Release the resting order's ID references once it has left the side. */
+    OrderBookSide_delete_order_by_id(side, handle);
+    book->order_sides[handle] = RESTING_NONE;
+    release_order_ids(book, &removed);
+    return 1;
+}
+
+/*
+ * modify_order
+ * ------------
+ * Changes a resting order's price and quantity. A new price that does not cross
+ * the opposite side is applied within the order's own side, in place where the
+ * order keeps its level. One that crosses trades like an arriving limit order,
+ * and any remainder rests at the new price.
+ */
+static int modify_order(OrderBook book, const char *order_id, double price, int quantity,
+                        struct OrderBookMatchResult *result)
+{
+    if (quantity <= 0) {
+        return 0;
+    }
+    IdHandle handle = IdTable_find(book->ids, order_id);
+    OrderBookSide side = resting_side(book, handle);
+    if (!side) {
+        return 0;
+    }
+
+    /* Check the band before anything changes, so a rejected modify leaves the order as it was. */
+    if (!OrderBookSide_can_rest_at(side, price)) {
+        return 0;
+    }
+
+    OrderBookSide opposite = (side == book->bid_side) ? book->ask_side : book->bid_side;
+    start_message_clock(book, NULL);
+    if (!OrderBookSide_crosses_best(opposite, price)) {
+        return OrderBookSide_modify_order(side, handle, price, quantity);
+    }
+
+    /* Take the order off its side; the copy keeps its ID references while it matches. */
+    struct BookOrder incoming;
+    OrderBookSide_get_order_by_id(side, handle, &incoming);
+    OrderBookSide_delete_order_by_id(side, handle);
+    book->order_sides[handle] = RESTING_NONE;
+    incoming.price = price;
+    incoming.quantity = quantity;
+
+    struct MatchContext context = { book, &incoming, result };
+    if (!OrderBookSide_execute_with_handler(opposite, &incoming, record_fill, &context)) {
+        /* As for an add, fills up to the failure stand and the remainder is dropped. */
+        release_order_ids(book, &incoming);
+        return 0;
+    }
+    if (incoming.quantity == 0) {
+        release_order_ids(book, &incoming);
+        return 1;
+    }
+    if (!rest_order(book, &incoming)) {
+        /* Only an allocation failure gets here; the fills stand and the remainder is dropped. */
+        release_order_ids(book, &incoming);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * cancel_user_order
+ * -----------------
+ * Visitor for OrderBookSide_delete_orders_for_user. Forgets the side of an
+ * order that is being cancelled and releases its ID references.
+ */
+static int cancel_user_order(void *context, const BookOrder order)
+{
+    OrderBook book = (OrderBook)context;
+    book->order_sides[order->order_id] = RESTING_NONE;
+    release_order_ids(book, order);
+    return 1;
+}
+
+/*
+ * resting_side
+ * ------------
+ * Gets the side an order rests on by its order ID handle, or NULL if none.
+ */
+static OrderBookSide resting_side(OrderBook book, IdHandle handle)
+{
+    if (handle >= book->order_sides_size) {
+        return NULL;
+    }
+    switch (book->order_sides[handle]) {
+    case RESTING_BID:
+        return book->bid_side;
+    case RESTING_ASK:
+        return book->ask_side;
+    default:
+        return NULL;
+    }
+}
+
+/*
+ * rest_order
+ * ----------
+ * Rests an order on the side its side field names and records which side that is.
+ * Callers have already made sure no order with the same ID rests on either side,
+ * so only an allocation failure makes it fail, leaving the book unchanged.
+ */
+static int rest_order(OrderBook book, const BookOrder order)
+{
+    IdHandle handle = order->order_id;
+    if (handle >= book->order_sides_size) {
+        size_t new_size = book->order_sides_size ? book->order_sides_size : 1024;
+        while (new_size <= handle) {
+            new_size *= 2;
+        }
+        unsigned char *new_sides = (unsigned char *)realloc(book->order_sides, new_size);
+        if (!new_sides) {
+            return 0;
+        }
+        memset(new_sides + book->order_sides_size, RESTING_NONE, new_size - book->order_sides_size);
+        book->order_sides = new_sides;
+        book->order_sides_size = new_size;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+
+    int is_buy = (order->side == '1');
+    if (!OrderBookSide_add_order(is_buy ? book->bid_side : book->ask_side, order)) {
+        return 0;
+    }
+    book->order_sides[handle] = is_buy ? RESTING_BID : RESTING_ASK;
+    return 1;
+}
+
+/*
+ * publish_depth
+ * -------------
+ * Publishes the sides' cached best levels, stamped with the number of messages
+ * applied, once a message has been fully applied. Does nothing without a
+ * published depth.
+ */
+static void publish_depth(OrderBook book)
+{
+    if (!book || !book->depth) {
+        return;
+    }
+    int bid_count, ask_count;
+    const struct OrderBookLevelView *bids = OrderBookSide_peek_levels(book->bid_side, &bid_count);
+    const struct OrderBookLevelView *asks = OrderBookSide_peek_levels(book->ask_side, &ask_count);
+    DepthSnapshot_publish(book->depth, book->message_sequence, bids, bid_count, asks, ask_count);
+}
+
+/*
+ * prefetch_order
+ * --------------
+ * Starts loading what adding an order will look up first: the index slots for
+ * its order and user IDs and the ladder slot of its price on its own side.
+ */
+static void prefetch_order(OrderBook book, const struct Order *order)
+{
+    IdTable_prefetch(book->ids, order->order_id);
+    IdTable_prefetch(book->ids, order->user_id);
+    OrderBookSide_prefetch_level(order->side == '1' ? book->bid_side : book->ask_side, order->price);
+}
+
+/*
+ * publish_level
+ * -------------
+ * Passes a level change to the book's handler, stamped with the sequence of
+ * the message being applied (already advanced past it).
+ */
+static void publish_level(OrderBook book, char side, const struct OrderBookLevelView *level)
+{
+    struct OrderBookLevelUpdate update;
+    update.sequence = book->message_sequence - 1;
+    update.price = level->price;
+    update.size = level->size;
+    update.order_count = level->order_count;
+    update.side = side;
+    book->level_handler(book->level_context, &update);
+}
+
+/*
+ * bid_level_changed / ask_level_changed
+ * -------------------------------------
+ * Level listeners installed on the sides while a level handler is set.
+ */
+static void bid_level_changed(void *context, const struct OrderBookLevelView *level)
+{
+    publish_level((OrderBook)context, '1', level);
+}
+
+static void ask_level_changed(void *context, const struct OrderBookLevelView *level)
+{
+    publish_level((OrderBook)context, '0', level);
+}
+
+/*
+ * record_fill
+ * -----------
+ * Fill handler for OrderBookSide_execute_with_handler. Records the trade in
+ * the book's log and appends a fill to the caller's result, growing it if needed.
+ * Returns 0 (stopping the match before this fill is applied) on allocation failure.
+ */
+static int record_fill(void *context, const BookOrder maker, int filled_quantity)
+{
+    struct MatchContext *match = (struct MatchContext *)context;
+    struct OrderBookMatchResult *result = match->result;
+
+    if (result->count == result->capacity) {
+        int new_capacity = (result->capacity == 0) ? 8 : result->capacity * 2;
+        struct OrderBookFill *new_fills =
+            (struct OrderBookFill *)realloc(result->fills, new_capacity * sizeof(struct OrderBookFill));
+        if (!new_fills) {
+            return 0;
+        }
+        result->fills = new_fills;
+        result->capacity = new_capacity;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+    OrderBook book = match->book;
+    if (book->fill_maker_count == book->fill_maker_capacity) {
+        size_t new_capacity = book->fill_maker_capacity ? book->fill_maker_capacity * 2 : 64;
+        IdHandle *new_makers = (IdHandle *)realloc(book->fill_makers, new_capacity * sizeof(IdHandle));
+        if (!new_makers) {
+            return 0;
+        }
+        book->fill_makers = new_makers;
+        book->fill_maker_capacity = new_capacity;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+
+    INSTRUMENT_TIME(trade_start);
+    struct TradeRecord *t = create_trade(book, match->incoming, maker, filled_quantity);
+    if (!t) {
+        return 0;
+    }
+    INSTRUMENT_STAGE(INSTRUMENT_TRADE, trade_start);
+
+    struct OrderBookFill *fill = &result->fills[result->count++];
+    fill->trade_id = t->sequence;
+    fill->maker_order = maker->order_id;
+    fill->size = filled_quantity;
+    fill->price = maker->price;
+    /* The fill's own reference keeps the maker's ID resolvable until the next add or modify. */
+    IdTable_retain(book->ids, maker->order_id);
+    book->fill_makers[book->fill_maker_count++] = maker->order_id;
+
+    /* A maker that is filled completely leaves the book; its fill and trade keep its ID alive. */
+    if (filled_quantity == maker->quantity) {
+        book->order_sides[maker->order_id] = RESTING_NONE;
+        release_order_ids(book, maker);
+    }
+    return 1;
+}
+
+/*
+ * create_trade
+ * ------------
+ * Appends a trade of the given size between an incoming order and a matched
+ * order to the book's log. Its sequence is the numeric trade ID. The buy order
+ * must have side '1', the sell order '0'. If the roles are flipped, this
+ * function deduces them automatically.
+ *
+ * The record takes a reference to each of its four IDs. A ring log releases
+ * the references of the trade it overwrites; a spilling log writes the IDs out
+ * and releases them through the book's ID hooks.
+ */
+static struct TradeRecord *create_trade(OrderBook book, const BookOrder incoming, const BookOrder matched, int size)
+{
+    const struct TradeRecord *evicted = TradeLog_peek_evicted(book->trades);
+    uint32_t evicted_ids[4] = { 0, 0, 0, 0 };
+    if (evicted) {
+        evicted_ids[0] = evicted->buy_order_id;
+        evicted_ids[1] = evicted->buy_user_id;
+        evicted_ids[2] = evicted->sell_order_id;
+        evicted_ids[3] = evicted->sell_user_id;
+    }
+
+    struct TradeRecord *t = TradeLog_append(book->trades);
+    if (!t) {
+        return NULL;
+    }
+    for (int i = 0; i < 4; i++) {
+        IdTable_release(book->ids, evicted_ids[i]);
+    }
+
+    /* If 'incoming' is the buyer, fill buyer fields from incoming, else from matched. */
+    int incoming_is_buy = (incoming->side == '1');
+
+    const BookOrder buyer = incoming_is_buy ? incoming : matched;
+    const BookOrder seller = incoming_is_buy ? matched : incoming;
+    t->buy_order_id = buyer->order_id;
+    t->buy_user_id = buyer->user_id;
+    t->sell_order_id = seller->order_id;
+    t->sell_user_id = seller->user_id;
+
+    IdTable_retain(book->ids, t->buy_order_id);
+    IdTable_retain(book->ids, t->buy_user_id);
+    IdTable_retain(book->ids, t->sell_order_id);
+    IdTable_retain(book->ids, t->sell_user_id);
+
+    /* The matched price is typically the price of the order in the book,
+       but it depends on your matching logic. Usually it's the best in the book
+       or the incoming price, whichever logic you use. We'll use matched->price
+       in this example. */
+    t->price = matched->price;
+
+    /* The size executed in this fill; matched->quantity is what was resting
+       before it, which may be more for a partial fill. */
+    t->size = size;
+
+    /* Every trade of one message shares one clock reading. */
+    t->timestamp = message_timestamp(book);
+
+    return t;
+}
+
+/*
+ * copy_trade
+ * ----------
+ * Builds a heap-allocated Trade from a log record, formatting its string ID
+ * and resolving its interned order and user IDs.
+ */
+static Trade copy_trade(OrderBook book, const struct TradeRecord *record)
+{
+    Trade t = (Trade)malloc(sizeof(*t));
+    if (!t) {
+        return NULL;
+    }
+    memset(t, 0, sizeof(*t));
+
+    format_trade_id(record->sequence, t->trade_id, sizeof(t->trade_id));
+    copy_id_string(book, record->buy_order_id, t->buy_order_id);
+    copy_id_string(book, record->buy_user_id, t->buy_user_id);
+    copy_id_string(book, record->sell_order_id, t->sell_order_id);
+    copy_id_string(book, record->sell_user_id, t->sell_user_id);
+    t->size = record->size;
+    t->price = record->price;
+    t->timestamp = record->timestamp;
+    return t;
+}
+
+/*
+ * start_message_clock
+ * -------------------
+ * Starts a message that may trade: its trades get a fresh clock reading, and
+ * an added order's timestamp advances the logical clock.
+ */
+static void start_message_clock(OrderBook book, const Order order)
+{
+    book->message_time_read = 0;
+    if (order && order->timestamp > book->logical_time) {
+        book->logical_time = order->timestamp;
+    }
+}
+
+/*
+ * message_timestamp
+ * -----------------
+ * Returns the timestamp for a trade of the current message, reading the
+ * book's clock the first time the message asks.
+ */
+static long message_timestamp(OrderBook book)
+{
+    if (book->message_time_read) {
+        return book->message_time;
+    }
+
+    switch (book->clock) {
+    case ORDER_BOOK_CLOCK_MONOTONIC: {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        book->message_time = (long)now.tv_sec * 1000000000L + now.tv_nsec;
+        break;
+    }
+    case ORDER_BOOK_CLOCK_CALLBACK:
+        book->message_time = book->clock_fn(book->clock_context);
+        break;
+    case ORDER_BOOK_CLOCK_LOGICAL:
+        book->message_time = book->logical_time;
+        break;
+    default:
+        book->message_time = (long)time(NULL);
+        break;
+    }
+    book->message_time_read = 1;
+    return book->message_time;
+}
+
+/*
+ * snapshot_id
+ * -----------
+ * Returns the snapshot ID index for an interned handle, assigning the next
+ * index the first time the handle is seen. Sets writer->failed on allocation
+ * failure.
+ */
+static uint32_t snapshot_id(struct SnapshotWriter *writer, IdHandle handle)
+{
+    if (handle >= writer->index_slots) {
+        size_t new_slots = writer->index_slots ? writer->index_slots : 1024;
+        while (new_slots <= handle) {
+            new_slots *= 2;
+        }
+        uint32_t *new_index = (uint32_t *)realloc(writer->index_of, new_slots * sizeof(uint32_t));
+        if (!new_index) {
+            writer->failed = 1;
+            return 0;
+        }
+        memset(new_index + writer->index_slots, 0, (new_slots - writer->index_slots) * sizeof(uint32_t));
+        writer->index_of = new_index;
+        writer->index_slots = new_slots;
+    }
+    if (writer->index_of[handle]) {
+        return writer->index_of[handle] - 1;
+    }
+
+    if (writer->id_count == writer->id_capacity) {
+        size_t new_capacity = writer->id_capacity ? writer->id_capacity * 2 : 1024;
+        IdHandle *new_handles = (IdHandle *)realloc(writer->handles, new_capacity * sizeof(IdHandle));
+        if (!new_handles) {
+            writer->failed = 1;
+            return 0;
+        }
+        writer->handles = new_handles;
+        writer->id_capacity = new_capacity;
+    }
+    writer->handles[writer->id_count] = handle;
+    writer->index_of[handle] = ++writer->id_count;
+    return writer->id_count - 1;
+}
+
+/*
+ * write_snapshot_order
+ * --------------------
+ * Order visitor for OrderBook_save: writes one resting order as a
+ * SnapshotOrder. Returns 0 to stop the walk once a write has failed.
+ */
+static int write_snapshot_order(void *context, const BookOrder order)
+{
+    struct SnapshotWriter *writer = (struct SnapshotWriter *)context;
+
+    struct SnapshotOrder record;
+    memset(&record, 0, sizeof(record));
+    record.order_id = snapshot_id(writer, order->order_id);
+    record.user_id = snapshot_id(writer, order->user_id);
+    record.quantity = order->quantity;
+    record.side = order->side;
+    record.price = order->price;
+    record.timestamp = order->timestamp;
+
+    if (!writer->failed && fwrite(&record, sizeof(record), 1, writer->out) != 1) {
+        writer->failed = 1;
+    }
+    writer->order_count++;
+    return !writer->failed;
+}
+
+/*
+ * write_snapshot
+ * --------------
+ * Writes a placeholder header, the bids, the asks and the ID table, then
+ * goes back and fills in the header with the counts.
+ */
+static int write_snapshot(OrderBook book, FILE *out)
+{
+    struct SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    if (fwrite(&header, sizeof(header), 1, out) != 1) {
+        return 0;
+    }
+
+    struct SnapshotWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.out = out;
+
+    int ok = OrderBookSide_for_each_order(book->bid_side, write_snapshot_order, &writer);
+    header.bid_count = writer.order_count;
+    ok = ok && OrderBookSide_for_each_order(book->ask_side, write_snapshot_order, &writer);
+    header.ask_count = writer.order_count - header.bid_count;
+
+    for (uint32_t i = 0; ok && i < writer.id_count; i++) {
+        char entry[SNAPSHOT_ID_SIZE];
+        memset(entry, 0, sizeof(entry));
+        const char *id = IdTable_get(book->ids, writer.handles[i]);
+        strncpy(entry, id ? id : "", 36);
+        ok = fwrite(entry, sizeof(entry), 1, out) == 1;
+    }
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.order_size = sizeof(struct SnapshotOrder);
+    header.id_size = SNAPSHOT_ID_SIZE;
+    header.id_count = writer.id_count;
+    header.next_trade_sequence = TradeLog_next_sequence(book->trades);
+    header.message_sequence = book->message_sequence;
+    header.logical_time = book->logical_time;
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+
+    free(writer.index_of);
+    free(writer.handles);
+    return ok;
+}
+
+/*
+ * restore_snapshot
+ * ----------------
+ * Interns the snapshot's ID table, then rests every order on its side in file
+ * order, which recreates each level's queue. Each resting order takes its own
+ * references to its IDs; the table's references are dropped at the end.
+ * Returns 0 on a malformed record or if an order cannot be rested.
+ */
+static int restore_snapshot(OrderBook book, const unsigned char *data, size_t header_size,
+                            const struct SnapshotHeader *header)
+{
+    uint64_t order_count = header->bid_count + header->ask_count;
+    const unsigned char *orders = data + header_size;
+    const char *ids = (const char *)(orders + order_count * sizeof(struct SnapshotOrder));
+
+    if (!TradeLog_start_at(book->trades, (long)header->next_trade_sequence)) {
+        return 0;
+    }
+    book->message_sequence = header->message_sequence;
+    book->logical_time = (long)header->logical_time;
+
+    IdHandle *handles = (IdHandle *)calloc(header->id_count ? header->id_count : 1, sizeof(IdHandle));
+    if (!handles) {
+        return 0;
+    }
+
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < header->id_count; i++) {
+        const char *entry = ids + (size_t)i * SNAPSHOT_ID_SIZE;
+        ok = memchr(entry, '\0', 37) != NULL &&
+             (handles[i] = IdTable_intern(book->ids, entry)) != ID_HANDLE_NONE;
+    }
+
+    for (uint64_t i = 0; ok && i < order_count; i++) {
+        struct SnapshotOrder record;
+        memcpy(&record, orders + i * sizeof(record), sizeof(record));
+
+        int is_bid = i < header->bid_count;
+        if (record.order_id >= header->id_count || record.user_id >= header->id_count ||
+            record.quantity <= 0 || record.side != (is_bid ? '1' : '0') ||
+            resting_side(book, handles[record.order_id])) {
+            ok = 0;
+            break;
+        }
+
+        struct BookOrder order;
+        order.order_id = handles[record.order_id];
+        order.user_id = handles[record.user_id];
+        order.quantity = record.quantity;
+        order.side = (char)record.side;
+        order.price = record.price;
+        order.timestamp = (long)record.timestamp;
+
+        ok = rest_order(book, &order);
+        if (ok) {
+            IdTable_retain(book->ids, order.order_id);
+            IdTable_retain(book->ids, order.user_id);
+        }
+    }
+
+    /* Drop the table's own references, freeing IDs no order uses. */
+    for (uint32_t i = 0; i < header->id_count; i++) {
+        IdTable_release(book->ids, handles[i]);
+    }
+    free(handles);
+    return ok;
+}
@@ -9,6 +9,10 @@
  * the order will return an array of trade IDs for the trades that were executed,
  * or NULL if no trades occurred.
  *
+ * Order and user IDs are interned as integer handles when an order enters the book;
+ * the sides, levels and trade log store and compare the handles, and strings are
+ * only formatted back out for callers.
+ *
  * Author: Adam Rubinstein
  * Date: January 19, 2025
  */
@@ -17,6 +21,8 @@
 #define ORDER_BOOK_H
 
 #include "OrderBookSide.h"
+#include "TradeLog.h"
+#include "DepthSnapshot.h"
 
 /* Forward declaration of the OrderBook structure. */
 typedef struct OrderBook *OrderBook;
@@ -35,6 +41,100 @@ typedef struct Trade {
     long timestamp;           /**< Timestamp of the trade. */
 } *Trade;
 
+/* A single fill produced by OrderBook_add_order_with_result, seen from the incoming order. */
+struct OrderBookFill {
+    long trade_id;              /**< Numeric trade ID; the trade's string ID is "TRADE-" followed by it zero-padded to 8 digits. */
+    uint32_t maker_order;       /**< Interned ID of the resting order that was filled; resolve it with
+                                     OrderBook_get_id_string until the book's next add or modify. */
+    int size;                   /**< Executed quantity. */
+    double price;               /**< Executed price (the resting order's price). */
+};
+
+/* Caller-owned, reusable buffer of fills.
+ * Zero-initialize it, or set fills to a malloc'd array and capacity to its length, before
+ * first use. OrderBook_add_order_with_result only reallocates fills when more than capacity
+ * fills occur, so a buffer reused across calls stops allocating once it is large enough.
+ */
+struct OrderBookMatchResult {
+    struct OrderBookFill *fills; /**< Fill records, in execution order. */
+    int count;                   /**< Number of fills written by the last call. */
+    int capacity;                /**< Number of records fills can hold. */
+};
+
+/* Outcome of one order of an OrderBook_add_orders batch. Its fills are
+ * result->fills[first_fill] through result->fills[first_fill + fill_count - 1]. */
+struct OrderBookBatchStatus {
+    int accepted;                /**< What OrderBook_add_order_with_result would have returned. */
+    int first_fill;              /**< Index of the order's first fill in the batch result. */
+    int fill_count;              /**< Number of fills the order produced. */
+};
+
+/* One incremental market-data (L2) update: the new total quantity resting at a price.
+ * Applying every update in order to a map from (side, price) to size, and erasing a
+ * price when its size reaches 0, reproduces the book's levels at every message. */
+struct OrderBookLevelUpdate {
+    uint64_t sequence;           /**< Message sequence of the call that changed the level. */
+    double price;                /**< The level's price. */
+    int size;                    /**< New total quantity at price, 0 once the level is empty. */
+    int order_count;             /**< New number of orders at price. */
+    char side;                   /**< '1' for a bid level, '0' for an ask level. */
+};
+
+/**
+ * Callback receiving level updates as a side effect of adds, removes, modifies, user
+ * cancels and executions. It runs inside that call, so it must not call back into the book.
+ *
+ * @param context The context pointer passed to OrderBook_set_level_handler.
+ * @param update The update (valid only during the call).
+ */
+typedef void (*OrderBook_LevelUpdateHandler)(void *context, const struct OrderBookLevelUpdate *update);
+
+/* Where a book's trade timestamps come from (struct OrderBookConfig.clock). A clock is
+ * read at most once per message, when its first trade is made, and every trade of that
+ * message shares the reading. */
+enum OrderBookClock {
+    ORDER_BOOK_CLOCK_WALL = 0,   /**< Seconds since the epoch, from time(). */
+    ORDER_BOOK_CLOCK_MONOTONIC,  /**< Nanoseconds from CLOCK_MONOTONIC (the TSC, through the vDSO, on Linux x86-64). */
+    ORDER_BOOK_CLOCK_CALLBACK,   /**< Whatever clock_fn returns. */
+    ORDER_BOOK_CLOCK_LOGICAL     /**< The latest timestamp of any order added so far, so that replaying
+                                      the same orders reproduces the same trades exactly. */
+};
+
+/**
+ * Caller-supplied clock for ORDER_BOOK_CLOCK_CALLBACK. It runs inside the call that trades,
+ * so it must not call back into the book.
+ *
+ * @param context The clock_context from the book's config.
+ * @return The timestamp to give the message's trades.
+ */
+typedef long (*OrderBook_ClockFn)(void *context);
+
+/* Optional settings for OrderBook_create_with_config.
+ * A zeroed config gives the same book as OrderBook_create.
+ */
+struct OrderBookConfig {
+    size_t order_capacity; /**< Resting orders to pre-allocate level and ID storage for (0 to grow on demand). */
+    size_t trade_capacity; /**< Trades to pre-allocate trade storage for (0 to grow on demand). */
+    struct TradeLogConfig trade_log; /**< Trade retention (zeroed keeps every trade in memory). */
+
+    /* Price ladder for both sides (see struct OrderBookSideConfig). With tick_size 0 the
+     * sides use an OrderedMap. Orders priced outside the band do not rest on the book. */
+    double tick_size;      /**< Price increment, or 0 for OrderedMap sides. */
+    double min_price;      /**< Lowest price of the band. */
+    double max_price;      /**< Highest price of the band. */
+
+    int depth_cache;       /**< Best levels per side to keep cached for OrderBook_peek_top_levels (0 for none). */
+
+    /* Best levels per side to publish for reader threads after every message (see
+     * OrderBook_read_depth), up to DEPTH_SNAPSHOT_MAX_LEVELS, or 0 for none. The depth
+     * cache is raised to at least this many levels. */
+    int published_depth;
+
+    enum OrderBookClock clock; /**< Source of trade timestamps (ORDER_BOOK_CLOCK_WALL if zeroed). */
+    OrderBook_ClockFn clock_fn; /**< Clock for ORDER_BOOK_CLOCK_CALLBACK (required with it, else ignored). */
+    void *clock_context;        /**< Passed through to clock_fn. */
+};
+
 /**
  * Creates a new OrderBook instance.
  *
@@ -42,6 +142,19 @@ typedef struct Trade {
  */
 OrderBook OrderBook_create(void);
 
+/**
+ * Creates a new OrderBook instance with the given settings.
+ *
+ * Price levels and interned ID strings are allocated from pools owned by the book and
+ * trades are appended to the book's TradeLog. Pre-sizing them means the matching path does not call the
+ * system allocator until the reserved capacity is exceeded, or a level queues more
+ * orders than fit in its block (see OrderBookLevel_inline_orders).
+ *
+ * @param config Settings for the book, or NULL for defaults.
+ * @return A newly allocated OrderBook instance, or NULL on failure.
+ */
+OrderBook OrderBook_create_with_config(const struct OrderBookConfig *config);
+
 /**
  * Destroys an OrderBook instance, freeing all associated memory.
  *
@@ -53,6 +166,16 @@ void OrderBook_destroy(OrderBook *book);
  * Adds a new order to the OrderBook. If the order crosses with
  * existing orders on the opposite side, trades are executed immediately.
  *
+ * The order's order_type and time_in_force decide what happens on arrival:
+ * - A limit order trades at its price or better; a market order at any price.
+ * - A post-only order is rejected, without trading, if it would trade on arrival.
+ * - A fill-or-kill order is rejected, without trading, unless its whole quantity
+ *   can trade on arrival. Only the levels that quantity needs are read.
+ * - The remainder of a good-till-cancelled limit or post-only order rests. An IOC
+ *   or market order never rests, and one that cannot trade does not touch the book.
+ * - On a ladder book, an order whose remainder would rest outside the band is rejected
+ *   without trading.
+ *
  * @param book The OrderBook instance.
  * @param order The order to add (copied internally).
  * @param trade_count Output pointer for the number of trades executed
@@ -66,6 +189,29 @@ void OrderBook_destroy(OrderBook *book);
  */
 char **OrderBook_add_order(OrderBook book, const Order order, int *trade_count);
 
+/**
+ * Adds a new order to the OrderBook and writes any resulting fills into a caller-owned
+ * buffer. Matching and resting behave exactly as in OrderBook_add_order; the difference
+ * is that no trade ID strings or result arrays are allocated per call.
+ *
+ * @param book The OrderBook instance.
+ * @param order The order to add (copied internally).
+ * @param result The buffer to write fills into. result->count is reset to the number of
+ *               fills from this order. result->fills is grown with realloc if needed;
+ *               release it with OrderBookMatchResult_free when done.
+ * @return 1 if successful, 0 on failure or if the order was rejected by its type, time in
+ *         force or price (see OrderBook_add_order). On failure result->count reflects the fills
+ *         that were executed before the error; a rejected order has none.
+ */
+int OrderBook_add_order_with_result(OrderBook book, const Order order, struct OrderBookMatchResult *result);
+
+/**
+ * Frees the fills storage of a match result and resets it to empty.
+ *
+ * @param result The match result to clear.
+ */
+void OrderBookMatchResult_free(struct OrderBookMatchResult *result);
+
 /**
  * Removes an order from the OrderBook by its ID.
  *
@@ -75,6 +221,71 @@ char **OrderBook_add_order(OrderBook book, const Order order, int *trade_count);
  */
 int OrderBook_remove_order(OrderBook book, const char *order_id);
 
+/**
+ * Changes the price and quantity of a resting order in one message, instead of a remove
+ * followed by an add. The order keeps its ID, user and timestamp:
+ * - If it stays at its price (its tick on a ladder book) and its quantity does not grow,
+ *   it is reduced in place and keeps its time priority.
+ * - If its quantity grows or its price changes, it goes to the back of the queue at its
+ *   new price.
+ * - If the new price crosses the opposite side, it trades like an arriving limit order
+ *   and any remainder rests at the new price.
+ *
+ * @param book The OrderBook instance.
+ * @param order_id The unique ID of the order to modify.
+ * @param price The new price (the current price to change only the quantity).
+ * @param quantity The new quantity, greater than 0 (use OrderBook_remove_order to cancel).
+ * @param result The buffer to write fills into, as in OrderBook_add_order_with_result, or
+ *               NULL if the caller does not need them (trades are still recorded).
+ * @return 1 if the order was modified, 0 if it was not found, the quantity is not positive,
+ *         the new price is outside a ladder book's band, or on failure. A non-crossing modify
+ *         that fails leaves the order as it was.
+ */
+int OrderBook_modify_order(OrderBook book, const char *order_id, double price, int quantity,
+                           struct OrderBookMatchResult *result);
+
+/**
+ * Removes every resting order of one user, e.g. when their session disconnects. Each side
+ * keeps a list of every user's resting orders, so only that user's orders are visited, and
+ * each level they rested on is updated once however many of them it held. The whole cancel
+ * is one message: one journal record and one published depth update.
+ *
+ * @param book The OrderBook instance.
+ * @param user_id The ID of the user whose orders to remove.
+ * @return The number of orders removed (0 if the user has none resting).
+ */
+size_t OrderBook_cancel_all_for_user(OrderBook book, const char *user_id);
+
+/**
+ * Adds a batch of orders, one after another, exactly as the same sequence of
+ * OrderBook_add_order_with_result calls would, but with the fills of the whole batch
+ * written into one result buffer. While an order is matched, the lookups of the
+ * orders a few places behind it are prefetched.
+ *
+ * @param book The OrderBook instance.
+ * @param orders The orders to add, in arrival order (copied internally).
+ * @param count The number of orders.
+ * @param result The buffer to write fills into. result->count is reset to the number of
+ *               fills from the whole batch, in execution order.
+ * @param statuses Output array of count entries for each order's outcome, or NULL.
+ * @return The number of orders accepted.
+ */
+size_t OrderBook_add_orders(OrderBook book, const struct Order *orders, size_t count,
+                            struct OrderBookMatchResult *result, struct OrderBookBatchStatus *statuses);
+
+/**
+ * Removes a batch of orders by ID, one after another, exactly as the same sequence
+ * of OrderBook_remove_order calls would.
+ *
+ * @param book The OrderBook instance.
+ * @param order_ids The IDs of the orders to remove.
+ * @param count The number of IDs.
+ * @param removed Output array of count flags, 1 where the order was removed and 0 where
+ *                it was not found, or NULL.
+ * @return The number of orders removed.
+ */
+size_t OrderBook_remove_orders(OrderBook book, const char *const *order_ids, size_t count, int *removed);
+
 /**
  * Retrieves the current best bid price in the order book.
  *
@@ -93,7 +304,8 @@ double OrderBook_get_best_ask(OrderBook book);
 
 /**
  * Gets the top k bids and top k asks from the order book.
- * If k = 0, returns all available levels on both sides.
+ * If k = 0, returns all available levels on both sides. A side with fewer than k levels
+ * returns the levels it has. To follow depth continuously, prefer OrderBook_set_level_handler.
  *
  * @param book The OrderBook instance.
  * @param k The number of price levels to retrieve on each side (0 for all).
@@ -116,7 +328,88 @@ int OrderBook_get_top_levels(OrderBook book,
                              int *ask_count);
 
 /**
- * Retrieves all executed trades in chronological order.
+ * Reads the cached best levels of both sides without copying or allocating. The book
+ * must have been created with a depth_cache; each side then holds its best
+ * min(depth_cache, levels on the side) levels, best first, updated as the book changes.
+ *
+ * @param book The OrderBook instance.
+ * @param bid_levels Output pointer to the cached bid levels.
+ * @param bid_count Output pointer for the number of cached bid levels.
+ * @param ask_levels Output pointer to the cached ask levels.
+ * @param ask_count Output pointer for the number of cached ask levels.
+ * @return 1 if successful, 0 on invalid arguments or if the book has no depth cache.
+ *
+ * @note The arrays belong to the book and are valid only until its next message.
+ */
+int OrderBook_peek_top_levels(OrderBook book,
+                              const struct OrderBookLevelView **bid_levels,
+                              int *bid_count,
+                              const struct OrderBookLevelView **ask_levels,
+                              int *ask_count);
+
+/**
+ * Copies the best levels the book published after its last message. Unlike the
+ * other queries this may be called from any number of threads while one thread keeps
+ * adding and removing orders: it never blocks the writer, and every copy is a view of
+ * the book between two messages. The book must have been created with a published_depth.
+ *
+ * @param book The OrderBook instance.
+ * @param view Output copy; its sequence is OrderBook_message_sequence after the last
+ *             message applied before the copy was published.
+ * @return 1 if successful, 0 on invalid arguments or if the book publishes no depth.
+ */
+int OrderBook_read_depth(OrderBook book, struct DepthSnapshotView *view);
+
+/**
+ * Gets the block the book publishes its best levels to, for readers that want to poll it
+ * with DepthSnapshot_try_read. It is owned by the book and lives as long as the book.
+ *
+ * @param book The OrderBook instance.
+ * @return The book's DepthSnapshot, or NULL if it publishes no depth.
+ */
+DepthSnapshot OrderBook_get_depth_snapshot(OrderBook book);
+
+/**
+ * Estimates what an incoming order for quantity would pay sweeping the opposite side,
+ * ignoring its limit price: the quantity available, its VWAP, the worst price reached and
+ * the number of levels needed. Reads the book without changing it or allocating.
+ *
+ * @param book The OrderBook instance.
+ * @param side Side of the incoming order: '1' (buy) sweeps the asks, '0' (sell) the bids.
+ * @param quantity The quantity to fill.
+ * @param estimate Output estimate; its quantity is less than asked for if the side runs out.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int OrderBook_estimate_fill(OrderBook book, char side, long quantity, struct OrderBookFillEstimate *estimate);
+
+/**
+ * Gets the quantity an incoming limit order at price could trade immediately: the total
+ * resting on the opposite side at prices the order crosses. Does not allocate.
+ *
+ * @param book The OrderBook instance.
+ * @param side Side of the incoming order: '1' (buy) counts asks at or below price, '0' (sell)
+ *             bids at or above it.
+ * @param price The limit price.
+ * @return The cumulative quantity, or 0 on invalid arguments.
+ */
+long OrderBook_size_through_price(OrderBook book, char side, double price);
+
+/**
+ * Sets (or with NULL, clears) the handler that receives a level update for every change
+ * to the quantity resting at a price. An add produces one update per level it trades
+ * against, best level first, then one for the level its remainder rests on; a remove
+ * produces one. With no handler set the book does no extra work.
+ *
+ * @param book The OrderBook instance.
+ * @param handler Callback invoked once per update, or NULL.
+ * @param context Passed through to handler.
+ */
+void OrderBook_set_level_handler(OrderBook book, OrderBook_LevelUpdateHandler handler, void *context);
+
+/**
+ * Retrieves all retained trades in chronological order. With a ring or spill
+ * trade log this copies every retained trade; prefer OrderBook_next_trade to
+ * follow the log incrementally.
  *
  * @param book The OrderBook instance.
  * @param trades Output pointer to store the array of executed trades
@@ -130,14 +423,131 @@ int OrderBook_get_top_levels(OrderBook book,
 int OrderBook_get_all_trades(OrderBook book, Trade **trades, int *trade_count);
 
 /**
- * Retrieves a single trade from the OrderBook by its trade_id.
+ * Retrieves a single trade from the OrderBook by its trade_id. The ID encodes the
+ * trade's sequence, so the lookup is O(1).
  *
  * @param book The OrderBook instance.
  * @param trade_id The unique ID of the trade to retrieve.
- * @return A newly allocated Trade struct if the trade is found, or NULL otherwise.
+ * @return A newly allocated Trade struct if the trade is found, or NULL otherwise
+ *         (including trades dropped by a ring trade log).
  *
  * @note The caller is responsible for freeing the returned Trade.
  */
 Trade OrderBook_get_trade(OrderBook book, const char *trade_id);
 
+/**
+ * Copies a trade by its numeric trade ID (as reported in struct OrderBookFill),
+ * without allocating.
+ *
+ * @param book The OrderBook instance.
+ * @param trade_id The numeric trade ID.
+ * @param record Output pointer to store a copy of the trade.
+ * @return 1 if the trade is retained, 0 otherwise.
+ */
+int OrderBook_get_trade_record(OrderBook book, long trade_id, struct TradeRecord *record);
+
+/**
+ * Reads trades in order without copying the history. Initialize the cursor with
+ * TradeLogCursor_init(&cursor, since) to read trades from numeric ID `since` on.
+ *
+ * @param book The OrderBook instance.
+ * @param cursor The cursor to read from and advance.
+ * @return A pointer to the next trade, valid until the book executes another trade
+ *         or the cursor is read again, or NULL if there are no more trades.
+ */
+const struct TradeRecord *OrderBook_next_trade(OrderBook book, TradeLogCursor *cursor);
+
+/**
+ * Resolves an interned ID stored in a struct TradeRecord back to its string.
+ *
+ * @param book The OrderBook instance.
+ * @param id An order or user ID from a trade record, or a fill's maker_order.
+ * @return The string ID (owned by the book, valid while the trade is retained, or for a
+ *         fill until the book's next add or modify), or NULL if the ID is unknown. A trade
+ *         read back from a spill file has fresh IDs, valid until the next spilled read.
+ */
+const char *OrderBook_get_id_string(OrderBook book, uint32_t id);
+
+/**
+ * Gets the number of trades the book still retains.
+ *
+ * @param book The OrderBook instance.
+ * @return The number of retained trades.
+ */
+size_t OrderBook_trade_count(OrderBook book);
+
+/* Bytes a book holds, filled in by OrderBook_get_memory_stats. Counts are of bytes asked of
+ * the allocator, not including its own per-allocation overhead. An attached journal belongs
+ * to the caller and is not counted. */
+struct OrderBookMemoryStats {
+    size_t level_bytes;          /**< The level pool's slabs (in use or free), and the ladders or price maps. */
+    size_t order_bytes;          /**< Level queues grown past their inline capacity, and the per-order indexes. */
+    size_t hash_bytes;           /**< Interned order and user IDs: hash buckets, handle entries and strings. */
+    size_t trade_bytes;          /**< Trade history held in memory (spilled trades are not counted). */
+    size_t other_bytes;          /**< The book and its sides themselves, depth caches and the published depth. */
+    size_t total_bytes;          /**< Sum of the above. */
+};
+
+/**
+ * Reports how much memory the book holds, for budgeting many books per process. Walks the
+ * book's levels, so it is meant for monitoring rather than the matching path.
+ *
+ * @param book The OrderBook instance.
+ * @param stats Output breakdown.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int OrderBook_get_memory_stats(OrderBook book, struct OrderBookMemoryStats *stats);
+
+/* Journal type (see Journal.h) */
+struct Journal;
+
+/**
+ * Attaches a journal that every later add, remove, modify and user cancel is appended
+ * to, or detaches the current one. The book does not own the journal; detach it before closing it.
+ *
+ * @param book The OrderBook instance.
+ * @param journal The Journal instance, or NULL to detach.
+ */
+void OrderBook_attach_journal(OrderBook book, struct Journal *journal);
+
+/**
+ * Gets the book's message sequence: the number of add, remove, modify and user cancel
+ * calls applied to it, counting those included in the snapshot it was loaded from.
+ * Journal records are stamped with it.
+ *
+ * @param book The OrderBook instance.
+ * @return The sequence the next message will receive.
+ */
+uint64_t OrderBook_message_sequence(OrderBook book);
+
+/**
+ * Writes the book's resting state to a snapshot file: both sides' orders in price and
+ * time priority, the IDs they use, the next trade ID and the message sequence. Executed
+ * trades are not saved.
+ *
+ * The file is a fixed header followed by fixed-width bid records, ask records and an
+ * ID table, with no pointers or offsets, so it can be mapped anywhere and read in one
+ * pass. It is written to "<path>.tmp" and renamed over path once complete, so a crash
+ * during a save leaves the previous snapshot intact.
+ *
+ * @param book The OrderBook instance.
+ * @param path The file to write.
+ * @return 1 if the snapshot was written, 0 on failure.
+ */
+int OrderBook_save(OrderBook book, const char *path);
+
+/**
+ * Creates a book from a snapshot written by OrderBook_save. Orders are placed straight
+ * back on their levels in their saved order, without matching, and new trades are
+ * numbered from where the saved book left off. A logical clock resumes at the saved time.
+ *
+ * @param path The snapshot file.
+ * @param config Settings for the new book, or NULL for defaults. order_capacity is
+ *               raised to the number of saved orders if it is smaller.
+ * @return A newly allocated OrderBook instance, or NULL if the file cannot be read,
+ *         is not a valid snapshot, or holds an order the configured book cannot rest
+ *         (e.g. outside a ladder's price band).
+ */
+OrderBook OrderBook_load(const char *path, const struct OrderBookConfig *config);
+
 #endif /* ORDER_BOOK_H */
\ No newline at end of file
@@ -6,6 +6,17 @@
 
 #include "Order.h"
 #include "OrderBook.h"
+#include "CsvReplay.h"
+#include "OrderMessage.h"
+#include "OrderBookManager.h"
+#include "OrderEngine.h"
+#include "Instrument.h"
+#include <pthread.h>
+#include <sched.h>
+
+// Best levels per side the driver's book keeps cached, so SHOW_TOP with
+// k up to this many reads them in place instead of walking the book
+#define DRIVER_DEPTH_CACHE 10
 
 // -------------------------------------------------------------------
 // Helper function to convert a textual side ("buy"/"sell") to the
@@ -43,12 +54,13 @@ static void process_csv_line(OrderBook book, const char *line)
 
     // Identify command
     if (strcasecmp(token, "ADD") == 0) {
-        // Expected format: ADD,order_id,user_id,side,price,quantity
+        // Expected format: ADD,order_id,user_id,side,price,quantity[,timestamp]
         char *order_id_str   = strtok(NULL, ",");
         char *user_id_str    = strtok(NULL, ",");
         char *side_str       = strtok(NULL, ",");
         char *price_str      = strtok(NULL, ",");
         char *quantity_str   = strtok(NULL, ",");
+        char *timestamp_str  = strtok(NULL, ",");
 
         if (!order_id_str || !user_id_str || !side_str || 
             !price_str || !quantity_str) {
@@ -66,8 +78,8 @@ static void process_csv_line(OrderBook book, const char *line)
         stack_order.price    = atof(price_str);
         stack_order.quantity = atoi(quantity_str);
         stack_order.side     = convert_side(side_str);
-        // Example timestamp logic (simple):
-        stack_order.timestamp = (long)time(NULL);
+        // Use the timestamp column when present, otherwise the wall clock
+        stack_order.timestamp = timestamp_str ? atol(timestamp_str) : (long)time(NULL);
 
         // Now add the order to the OrderBook
         int trade_count = 0;
@@ -127,10 +139,23 @@ static void process_csv_line(OrderBook book, const char *line)
         int k = atoi(k_str);
         struct OrderBookLevelView *bid_levels = NULL;
         struct OrderBookLevelView *ask_levels = NULL;
+        const struct OrderBookLevelView *cached_bids = NULL;
+        const struct OrderBookLevelView *cached_asks = NULL;
         int bid_count = 0;
         int ask_count = 0;
 
-        if (OrderBook_get_top_levels(book, k,
+        if (k > 0 && k <= DRIVER_DEPTH_CACHE &&
+            OrderBook_peek_top_levels(book, &cached_bids, &bid_count, &cached_asks, &ask_count)) {
+            // The cache holds the best DRIVER_DEPTH_CACHE levels; print the first k
+            printf("Top %d Bid Levels:\n", k);
+            for (int i = 0; i < bid_count && i < k; i++) {
+                printf("  Price: %.2f, Size: %d\n", cached_bids[i].price, cached_bids[i].size);
+            }
+            printf("Top %d Ask Levels:\n", k);
+            for (int i = 0; i < ask_count && i < k; i++) {
+                printf("  Price: %.2f, Size: %d\n", cached_asks[i].price, cached_asks[i].size);
+            }
+        } else if (OrderBook_get_top_levels(book, k,
                                      &bid_levels, &bid_count,
                                      &ask_levels, &ask_count)) {
             printf("Top %d Bid Levels:\n", (k == 0) ? -1 : k);
@@ -208,22 +233,380 @@ static void process_csv_line(OrderBook book, const char *line)
     }
 }
 
+// -------------------------------------------------------------------
+// Replay mode callback: commands other than ADD and REMOVE (the queries)
+// go through process_csv_line so their output matches the normal mode.
+// -------------------------------------------------------------------
+static void replay_other_line(void *context, OrderBook book, const char *line, size_t length)
+{
+    (void)context;
+    char buffer[256];
+    if (length >= sizeof(buffer)) length = sizeof(buffer) - 1;
+    memcpy(buffer, line, length);
+    buffer[length] = '\0';
+    process_csv_line(book, buffer);
+}
+
+// -------------------------------------------------------------------
+// Replays the files with CsvReplay (or, for binary files, OrderMessage)
+// and prints a summary instead of a line per order.
+// -------------------------------------------------------------------
+static int replay_files(OrderBook book, char **paths, int count, double tick_size, int binary)
+{
+    struct CsvReplayOptions options = { tick_size, replay_other_line, NULL };
+    struct CsvReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        printf("Replaying file: %s\n", paths[i]);
+        int ok = binary ? OrderMessage_replay_file(book, paths[i], replay_other_line, NULL, &stats)
+                        : CsvReplay_file(book, paths[i], &options, &stats);
+        if (!ok) {
+            fprintf(stderr, "Could not replay file '%s'. Skipping.\n", paths[i]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Replayed %ld lines: %ld adds, %ld removes, %ld trades, %ld errors\n",
+           stats.lines, stats.adds, stats.removes, stats.trades, stats.errors);
+    printf("Elapsed %.3f s (%.0f lines/s)\n", seconds, seconds > 0 ? stats.lines / seconds : 0.0);
+    return EXIT_SUCCESS;
+}
+
+// -------------------------------------------------------------------
+// Converts the CSV files into one binary message file.
+// -------------------------------------------------------------------
+static int convert_files(const char *output, char **paths, int count, double tick_size)
+{
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        fprintf(stderr, "Could not create file '%s'.\n", output);
+        return EXIT_FAILURE;
+    }
+    OrderMessageWriter writer = OrderMessageWriter_create(out, tick_size);
+    if (!writer) {
+        fprintf(stderr, "Failed to create message writer.\n");
+        fclose(out);
+        return EXIT_FAILURE;
+    }
+
+    long written = 0, skipped = 0;
+    for (int i = 0; i < count; i++) {
+        FILE *fp = fopen(paths[i], "r");
+        if (!fp) {
+            fprintf(stderr, "Could not open file '%s'. Skipping.\n", paths[i]);
+            continue;
+        }
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            size_t length = strcspn(line, "\n");
+            if (length == 0) continue;
+            if (OrderMessageWriter_write_csv(writer, line, length)) {
+                written++;
+            } else {
+                fprintf(stderr, "Skipping line: %.*s\n", (int)length, line);
+                skipped++;
+            }
+        }
+        fclose(fp);
+    }
+
+    int ok = OrderMessageWriter_finish(writer);
+    OrderMessageWriter_destroy(&writer);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Failed to write '%s'.\n", output);
+        return EXIT_FAILURE;
+    }
+    printf("Converted %ld lines (%ld skipped) into %s\n", written, skipped, output);
+    return EXIT_SUCCESS;
+}
+
+// -------------------------------------------------------------------
+// Sharded mode: lines carry a symbol after the command. ADD and REMOVE
+// are routed to the symbol's worker; other commands wait for the
+// workers to catch up and then run on the symbol's book as usual.
+// -------------------------------------------------------------------
+static void process_symbol_line(OrderBookManager manager, const char *line)
+{
+    if (strncasecmp(line, "ADD,", 4) == 0 || strncasecmp(line, "REMOVE,", 7) == 0) {
+        if (!OrderBookManager_route_csv(manager, line, strlen(line))) {
+            fprintf(stderr, "Invalid line. Skipping: %s\n", line);
+        }
+        return;
+    }
+
+    // COMMAND,symbol[,arguments] becomes COMMAND[,arguments] on the symbol's book
+    const char *symbol = strchr(line, ',');
+    char command[256], symbol_buffer[ORDER_BOOK_MANAGER_MAX_SYMBOL + 1];
+    size_t command_length = symbol ? (size_t)(symbol - line) : 0;
+    const char *rest = symbol ? strchr(symbol + 1, ',') : NULL;
+    size_t symbol_length = symbol ? (rest ? (size_t)(rest - symbol - 1) : strlen(symbol + 1)) : 0;
+    if (!symbol || symbol_length == 0 || symbol_length > ORDER_BOOK_MANAGER_MAX_SYMBOL) {
+        fprintf(stderr, "Missing symbol. Skipping line: %s\n", line);
+        return;
+    }
+    memcpy(symbol_buffer, symbol + 1, symbol_length);
+    symbol_buffer[symbol_length] = '\0';
+    snprintf(command, sizeof(command), "%.*s%s", (int)command_length, line, rest ? rest : "");
+
+    OrderBookManager_drain(manager);
+    OrderBook book = OrderBookManager_get_book(manager, symbol_buffer);
+    if (!book) {
+        printf("No book for symbol '%s'\n", symbol_buffer);
+        return;
+    }
+    printf("[%s] ", symbol_buffer);
+    process_csv_line(book, command);
+}
+
+// -------------------------------------------------------------------
+// Runs the files through an OrderBookManager with the given number of
+// worker threads and prints the top of every book at the end.
+// -------------------------------------------------------------------
+static int process_sharded_files(char **paths, int count, int workers)
+{
+    struct OrderBookManagerConfig config;
+    memset(&config, 0, sizeof(config));
+    config.workers = workers;
+    config.pin_threads = 1;
+    OrderBookManager manager = OrderBookManager_create(&config);
+    if (!manager) {
+        fprintf(stderr, "Failed to create OrderBookManager.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        FILE *fp = fopen(paths[i], "r");
+        if (!fp) {
+            fprintf(stderr, "Could not open file '%s'. Skipping.\n", paths[i]);
+            continue;
+        }
+        printf("Processing file: %s\n", paths[i]);
+
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0') process_symbol_line(manager, line);
+        }
+        fclose(fp);
+    }
+    OrderBookManager_drain(manager);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    struct OrderBookManagerStats stats;
+    OrderBookManager_get_stats(manager, &stats);
+    for (size_t i = 0; i < stats.symbols; i++) {
+        const char *symbol = OrderBookManager_get_symbol(manager, i);
+        OrderBook book = OrderBookManager_get_book(manager, symbol);
+        printf("%s (worker %d): best bid %.2f, best ask %.2f, %zu trades\n", symbol,
+               OrderBookManager_get_shard(manager, symbol), OrderBook_get_best_bid(book),
+               OrderBook_get_best_ask(book), OrderBook_trade_count(book));
+    }
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%zu symbols on %d workers: %ld adds, %ld removes, %ld trades, %ld rejected in %.3f s\n",
+           stats.symbols, workers, stats.adds, stats.removes, stats.trades, stats.rejected, seconds);
+
+    OrderBookManager_destroy(&manager);
+    return EXIT_SUCCESS;
+}
+
+// -------------------------------------------------------------------
+// Engine mode: the main thread parses lines and queues them for an
+// OrderEngine thread, and a publisher thread prints the engine's events,
+// so matching never waits on printf. Query lines are not supported,
+// since only the engine thread may read its book while it runs.
+// -------------------------------------------------------------------
+static void *print_engine_events(void *argument)
+{
+    OrderEngine engine = argument;
+    struct OrderEngineEvent events[64];
+    for (;;) {
+        int stopped = OrderEngine_is_stopped(engine);
+        size_t count = OrderEngine_poll_events(engine, 0, events, 64);
+        for (size_t i = 0; i < count; i++) {
+            const struct OrderEngineEvent *e = &events[i];
+            switch (e->type) {
+            case ORDER_ENGINE_ACCEPTED:
+                printf("Accepted order %s: %d @ %.2f\n", e->order_id, e->size, e->price);
+                break;
+            case ORDER_ENGINE_REJECTED:
+                printf("Rejected order %s.\n", e->order_id);
+                break;
+            case ORDER_ENGINE_EXECUTION:
+                printf("  Trade ID: TRADE-%08ld | Order %s filled %d @ %.2f against %s\n",
+                       e->trade_id, e->order_id, e->size, e->price, e->maker_order_id);
+                break;
+            case ORDER_ENGINE_REMOVED:
+                printf("Successfully removed order %s.\n", e->order_id);
+                break;
+            case ORDER_ENGINE_NOT_FOUND:
+                printf("Order %s not found.\n", e->order_id);
+                break;
+            case ORDER_ENGINE_TOP_OF_BOOK:
+                printf("Best Bid: %.2f, Best Ask: %.2f\n", e->best_bid, e->best_ask);
+                break;
+            }
+        }
+        if (count == 0) {
+            if (stopped) break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int process_engine_files(char **paths, int count)
+{
+    OrderEngine engine = OrderEngine_create(NULL);
+    if (!engine) {
+        fprintf(stderr, "Failed to create OrderEngine.\n");
+        return EXIT_FAILURE;
+    }
+    pthread_t publisher;
+    if (pthread_create(&publisher, NULL, print_engine_events, engine) != 0) {
+        fprintf(stderr, "Failed to start publisher thread.\n");
+        OrderEngine_destroy(&engine);
+        return EXIT_FAILURE;
+    }
+
+    long skipped = 0;
+    for (int i = 0; i < count; i++) {
+        FILE *fp = fopen(paths[i], "r");
+        if (!fp) {
+            fprintf(stderr, "Could not open file '%s'. Skipping.\n", paths[i]);
+            continue;
+        }
+
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            char *command = strtok(line, ",");
+            if (!command) continue;
+
+            if (strcasecmp(command, "ADD") == 0) {
+                // ADD,order_id,user_id,side,price,quantity[,timestamp]
+                char *fields[6];
+                int n = 0;
+                while (n < 6 && (fields[n] = strtok(NULL, ",")) != NULL) n++;
+                if (n < 5) {
+                    skipped++;
+                    continue;
+                }
+                struct Order order;
+                memset(&order, 0, sizeof(order));
+                strncpy(order.order_id, fields[0], sizeof(order.order_id) - 1);
+                strncpy(order.user_id, fields[1], sizeof(order.user_id) - 1);
+                order.side = convert_side(fields[2]);
+                order.price = atof(fields[3]);
+                order.quantity = atoi(fields[4]);
+                order.timestamp = n == 6 ? atol(fields[5]) : (long)time(NULL);
+                while (!OrderEngine_submit_add(engine, &order)) sched_yield();
+            } else if (strcasecmp(command, "REMOVE") == 0) {
+                char *order_id = strtok(NULL, ",");
+                if (!order_id) {
+                    skipped++;
+                    continue;
+                }
+                while (!OrderEngine_submit_remove(engine, order_id)) sched_yield();
+            } else {
+                skipped++;
+            }
+        }
+        fclose(fp);
+    }
+
+    OrderEngine_stop(engine);
+    pthread_join(publisher, NULL);
+    printf("Trades executed: %zu (%ld lines skipped: malformed or queries)\n",
+           OrderBook_trade_count(OrderEngine_get_book(engine)), skipped);
+    OrderEngine_destroy(&engine);
+    return EXIT_SUCCESS;
+}
+
+// Prints the hot-path histograms at exit, for --stats
+static void dump_stats(void)
+{
+    Instrument_dump(stderr);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <csv_file1> [csv_file2 ...]\n", argv[0]);
+    // Options: --replay parses with CsvReplay, --binary replays files written by
+    // --convert <output>, and --tick <size> sets the tick size for both.
+    // --workers <n> shards lines carrying a symbol column across n threads, and
+    // --engine matches on an engine thread while another thread prints events, and
+    // --stats prints the hot-path histograms to stderr at exit (make INSTRUMENT=1)
+    int replay = 0;
+    int engine = 0;
+    int workers = 0;
+    int binary = 0;
+    const char *convert_output = NULL;
+    double tick_size = 0.0;
+    int first = 1;
+    while (first < argc && strncmp(argv[first], "--", 2) == 0) {
+        if (strcmp(argv[first], "--replay") == 0) {
+            replay = 1;
+        } else if (strcmp(argv[first], "--binary") == 0) {
+            replay = binary = 1;
+        } else if (strcmp(argv[first], "--convert") == 0 && first + 1 < argc) {
+            convert_output = argv[++first];
+        } else if (strcmp(argv[first], "--engine") == 0) {
+            engine = 1;
+        } else if (strcmp(argv[first], "--workers") == 0 && first + 1 < argc) {
+            workers = atoi(argv[++first]);
+        } else if (strcmp(argv[first], "--tick") == 0 && first + 1 < argc) {
+            tick_size = atof(argv[++first]);
+        } else if (strcmp(argv[first], "--stats") == 0) {
+            atexit(dump_stats);
+        } else {
+            break;
+        }
+        first++;
+    }
+
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [--stats] [--replay | --convert output.bin] [--tick size] <csv_file1> [csv_file2 ...]\n"
+                        "       %s --binary <bin_file1> [bin_file2 ...]\n"
+                        "       %s --workers n <csv_file1> [csv_file2 ...]  (lines are COMMAND,symbol,...)\n"
+                        "       %s --engine <csv_file1> [csv_file2 ...]\n",
+                argv[0], argv[0], argv[0], argv[0]);
         return EXIT_FAILURE;
     }
 
+    if (convert_output) {
+        return convert_files(convert_output, argv + first, argc - first, tick_size);
+    }
+    if (workers > 0) {
+        return process_sharded_files(argv + first, argc - first, workers);
+    }
+    if (engine) {
+        return process_engine_files(argv + first, argc - first);
+    }
+
     // Create the OrderBook
-    OrderBook book = OrderBook_create();
+    struct OrderBookConfig config;
+    memset(&config, 0, sizeof(config));
+    config.depth_cache = DRIVER_DEPTH_CACHE;
+    OrderBook book = OrderBook_create_with_config(&config);
     if (!book) {
         fprintf(stderr, "Failed to create OrderBook.\n");
         return EXIT_FAILURE;
     }
 
+    if (replay) {
+        int status = replay_files(book, argv + first, argc - first, tick_size, binary);
+        OrderBook_destroy(&book);
+        return status;
+    }
+
     // Process each CSV file passed as an argument
-    for (int i = 1; i < argc; i++) {
+    for (int i = first; i < argc; i++) {
         FILE *fp = fopen(argv[i], "r");
         if (!fp) {
             fprintf(stderr, "Could not open file '%s'. Skipping.\n", argv[i]);
@@ -2,170 +2,333 @@
 /* OrderBookLevel.c - Implementation file for the OrderBookLevel module
  *
  * This file implements an OrderBookLevel, which represents a price level in an order book.
- * A level maintains a queue of orders with the same price.
+ * A level keeps its queue as a ring of columns: remaining quantities, order IDs, and off to
+ * the side the user IDs and timestamps that matching never reads. Entries are addressed by
+ * ticket, a counter that grows by one per push, so an order's position survives the ring
+ * growing. A cancelled order in the middle of the queue has its quantity set to 0 (a dead
+ * entry) and is skipped until OrderBookLevel_compact closes the gap; the first and last
+ * entries are always live. Its total quantity and order count are adjusted by every push,
+ * reduction and removal rather than recomputed.
  *
  * Author: Adam Rubinstein
  * Date: January 2025
  */
 
 #include "OrderBookLevel.h"
+#include "Instrument.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-// Order node structure for the queue
-typedef struct OrderNode {
-    struct Order order;
-    struct OrderNode *next;
-} *OrderNode;
+#define LEVEL_INLINE_ORDERS 8 // Queue capacity held in the level's own block
+#define LEVEL_ENTRY_SIZE (sizeof(long) + sizeof(int) + 2 * sizeof(uint32_t)) // Bytes per queued order
+#define LEVEL_MIN_DEAD 8 // Dead entries below which compaction is not worth it
 
 struct OrderBookLevel {
     double price;          /**< Price of the level. */
-    OrderNode head;       /**< Head of the order queue. */
-    OrderNode tail;       /**< Tail of the order queue. */
     int total_quantity;    /**< Total quantity of orders at this level. */
+    int order_count;       /**< Number of orders queued at this level. */
+    uint32_t head;         /**< Ticket of the oldest queued entry (always live unless head == tail). */
+    uint32_t tail;         /**< Ticket the next pushed order gets. */
+    uint32_t mask;         /**< Ring capacity - 1; entry t lives at index t & mask. */
+    char side;             /**< Side of the queued orders. */
+    int *quantity;         /**< Remaining quantity of each entry (0 for a dead entry). */
+    uint32_t *order_id;    /**< Interned order ID of each entry. */
+    uint32_t *user_id;     /**< Interned user ID of each entry. */
+    long *timestamp;       /**< Timestamp of each entry; first column of the ring's storage. */
+    Pool pool;             /**< Pool the level was allocated from, or NULL for malloc. */
+    long storage[LEVEL_INLINE_ORDERS * LEVEL_ENTRY_SIZE / sizeof(long)]; /**< Inline ring columns. */
 };
 
 // Helper function prototypes
-static OrderNode create_order_node(const Order order);
-static void destroy_order_node(OrderNode node);
+static void set_columns(OrderBookLevel level, void *base, uint32_t capacity);
+static int grow_ring(OrderBookLevel level);
+static int is_live(const OrderBookLevel level, uint32_t ticket);
+static void remove_entry(OrderBookLevel level, uint32_t ticket);
+static void copy_entry(const OrderBookLevel level, uint32_t ticket, BookOrder order);
+static int find_entry(const OrderBookLevel level, uint32_t order_id, uint32_t *ticket);
 
 // Public function implementations
 OrderBookLevel OrderBookLevel_create(double price) {
-    OrderBookLevel level = malloc(sizeof(struct OrderBookLevel));
+    return OrderBookLevel_create_with_pool(price, NULL);
+}
+
+OrderBookLevel OrderBookLevel_create_with_pool(double price, Pool level_pool) {
+    OrderBookLevel level = level_pool ? Pool_alloc(level_pool) : malloc(sizeof(struct OrderBookLevel));
     if (!level) return NULL;
+    if (!level_pool) INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
     level->price = price;
-    level->head = NULL;
-    level->tail = NULL;
     level->total_quantity = 0;
+    level->order_count = 0;
+    level->head = 0;
+    level->tail = 0;
+    level->side = 0;
+    level->pool = level_pool;
+    set_columns(level, level->storage, LEVEL_INLINE_ORDERS);
     return level;
 }
 
+size_t OrderBookLevel_block_size(void) {
+    return sizeof(struct OrderBookLevel);
+}
+
+size_t OrderBookLevel_inline_orders(void) {
+    return LEVEL_INLINE_ORDERS;
+}
+
+size_t OrderBookLevel_queue_bytes(const OrderBookLevel level) {
+    if (!level || (void *)level->timestamp == (void *)level->storage) return 0;
+    return ((size_t)level->mask + 1) * LEVEL_ENTRY_SIZE;
+}
+
 void OrderBookLevel_destroy(OrderBookLevel *level) {
     if (!level || !*level) return;
     OrderBookLevel l = *level;
-    OrderNode current = l->head;
-    while (current) {
-        OrderNode next = current->next;
-        destroy_order_node(current);
-        current = next;
+    if ((void *)l->timestamp != (void *)l->storage) free(l->timestamp);
+    if (l->pool) {
+        Pool_free(l->pool, l);
+    } else {
+        free(l);
     }
-    free(l);
     *level = NULL;
 }
 
-int OrderBookLevel_add_order(OrderBookLevel level, const Order order) {
-    if (!level || !order) return 0;
-    OrderNode node = create_order_node(order);
-    if (!node) return 0;
+int OrderBookLevel_add_order(OrderBookLevel level, const BookOrder order) {
+    return OrderBookLevel_push_order(level, order, NULL);
+}
 
-    if (!level->head) {
-        level->head = level->tail = node;
-    } else {
-        level->tail->next = node;
-        level->tail = node;
-    }
+int OrderBookLevel_push_order(OrderBookLevel level, const BookOrder order, OrderSlot *slot) {
+    if (!level || !order || order->quantity <= 0) return 0;
+    if (level->tail - level->head > level->mask && !grow_ring(level)) return 0;
 
+    uint32_t index = level->tail & level->mask;
+    level->quantity[index] = order->quantity;
+    level->order_id[index] = order->order_id;
+    level->user_id[index] = order->user_id;
+    level->timestamp[index] = order->timestamp;
+    level->side = order->side;
+
+    if (slot) {
+        slot->level = level;
+        slot->ticket = level->tail;
+    }
+    level->tail++;
     level->total_quantity += order->quantity;
+    level->order_count++;
+    return 1;
+}
+
+int OrderBookLevel_unlink_order(OrderBookLevel level, OrderSlot slot) {
+    if (!level || slot.level != level || !is_live(level, slot.ticket)) return 0;
+
+    remove_entry(level, slot.ticket);
+    return 1;
+}
+
+int OrderBookLevel_reduce_order(OrderBookLevel level, OrderSlot slot, int quantity) {
+    if (!level || slot.level != level || !is_live(level, slot.ticket)) return 0;
+    int *remaining = &level->quantity[slot.ticket & level->mask];
+    if (quantity <= 0 || quantity >= *remaining) return 0;
+
+    *remaining -= quantity;
+    level->total_quantity -= quantity;
+    return 1;
+}
+
+int OrderBookLevel_read_order(OrderSlot slot, BookOrder order) {
+    if (!slot.level || !is_live(slot.level, slot.ticket)) return 0;
+
+    if (order) copy_entry(slot.level, slot.ticket, order);
     return 1;
 }
 
-// Returns a pointer to the actual Order in the level, not a copy
-int OrderBookLevel_get_order(OrderBookLevel level, Order *order) {
-    if (!level || !level->head) return 0;
+int OrderBookLevel_front(const OrderBookLevel level, OrderSlot *slot) {
+    if (!level || !slot || level->head == level->tail) return 0;
 
-    if (order) *order = &level->head->order;
+    slot->level = level;
+    slot->ticket = level->head;
     return 1;
 }
 
-int OrderBookLevel_get_order_by_id(OrderBookLevel level, const char *order_id, Order *order) {
-    if (!level || !order_id || !level->head) return 0;
+int OrderBookLevel_next(OrderSlot *slot) {
+    if (!slot || !slot->level) return 0;
+    OrderBookLevel level = slot->level;
 
-    OrderNode current = level->head;
-    while (current) {
-        if (strcmp(current->order.order_id, order_id) == 0) {
-            if (order) *order = &current->order;
+    // Offsets from head, so tickets that wrapped around compare correctly
+    uint32_t span = level->tail - level->head;
+    uint32_t offset = slot->ticket - level->head;
+    if (offset >= span) return 0;
+    for (offset++; offset < span; offset++) {
+        if (level->quantity[(level->head + offset) & level->mask] > 0) {
+            slot->ticket = level->head + offset;
             return 1;
         }
-        current = current->next;
     }
-
     return 0;
 }
 
-int OrderBookLevel_remove_order(OrderBookLevel level, Order order) {
-    if (!level || !level->head) return 0;
+int OrderBookLevel_get_order(OrderBookLevel level, BookOrder order) {
+    if (!level || level->head == level->tail) return 0;
+
+    if (order) copy_entry(level, level->head, order);
+    return 1;
+}
 
-    OrderNode node = level->head;
-    if (order) memcpy(order, &node->order, sizeof(struct Order));
+int OrderBookLevel_get_order_by_id(OrderBookLevel level, uint32_t order_id, BookOrder order) {
+    uint32_t ticket;
+    if (!level || !find_entry(level, order_id, &ticket)) return 0;
 
-    level->head = node->next;
-    if (!level->head) level->tail = NULL;
+    if (order) copy_entry(level, ticket, order);
+    return 1;
+}
 
-    level->total_quantity -= node->order.quantity;
-    destroy_order_node(node);
+int OrderBookLevel_remove_order(OrderBookLevel level, BookOrder order) {
+    if (!level || level->head == level->tail) return 0;
 
+    if (order) copy_entry(level, level->head, order);
+    remove_entry(level, level->head);
     return 1;
 }
 
-int OrderBookLevel_delete_order_by_id(OrderBookLevel level, const char *order_id) {
-    if (!level || !order_id || !level->head) return 0;
+int OrderBookLevel_delete_order_by_id(OrderBookLevel level, uint32_t order_id) {
+    uint32_t ticket;
+    if (!level || !find_entry(level, order_id, &ticket)) return 0;
 
-    OrderNode prev = NULL;
-    OrderNode current = level->head;
-    while (current) {
-        if (strcmp(current->order.order_id, order_id) == 0) {
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                level->head = current->next;
-            }
+    remove_entry(level, ticket);
+    return 1;
+}
 
-            if (current == level->tail) {
-                level->tail = prev;
-            }
+int OrderBookLevel_needs_compaction(const OrderBookLevel level) {
+    if (!level) return 0;
+    uint32_t dead = (level->tail - level->head) - (uint32_t)level->order_count;
+    return dead >= LEVEL_MIN_DEAD && dead > (uint32_t)level->order_count;
+}
 
-            level->total_quantity -= current->order.quantity;
-            destroy_order_node(current);
-            return 1;
-        }
+void OrderBookLevel_compact(OrderBookLevel level, OrderBookLevel_RelocateHandler relocated, void *context) {
+    if (!level) return;
 
-        prev = current;
-        current = current->next;
+    // Slide live entries toward the head in queue order; the head entry never moves
+    uint32_t to = level->head;
+    for (uint32_t from = level->head; from != level->tail; from++) {
+        uint32_t src = from & level->mask;
+        if (level->quantity[src] == 0) continue;
+        if (from != to) {
+            uint32_t dst = to & level->mask;
+            level->quantity[dst] = level->quantity[src];
+            level->order_id[dst] = level->order_id[src];
+            level->user_id[dst] = level->user_id[src];
+            level->timestamp[dst] = level->timestamp[src];
+            if (relocated) relocated(context, level->order_id[dst], (OrderSlot){ level, to });
+        }
+        to++;
     }
+    level->tail = to;
+}
 
-    return 0;
+double OrderBookLevel_get_price(const OrderBookLevel level) {
+    return level ? level->price : 0.0;
 }
 
 int OrderBookLevel_get_total_quantity(const OrderBookLevel level) {
     return level ? level->total_quantity : 0;
 }
 
+int OrderBookLevel_get_order_count(const OrderBookLevel level) {
+    return level ? level->order_count : 0;
+}
+
 void OrderBookLevel_reset_total_quantity(OrderBookLevel level) {
     if (level) {
         level->total_quantity = 0;
-        OrderNode current = level->head;
-        while (current) {
-            level->total_quantity += current->order.quantity;
-            current = current->next;
+        level->order_count = 0;
+        for (uint32_t ticket = level->head; ticket != level->tail; ticket++) {
+            int quantity = level->quantity[ticket & level->mask];
+            if (quantity > 0) {
+                level->total_quantity += quantity;
+                level->order_count++;
+            }
         }
     }
 }
 
 
 bool OrderBookLevel_is_empty(const OrderBookLevel level) {
-    return level ? level->head == NULL : true;
+    return level ? level->head == level->tail : true;
 }
 
 // Helper function implementations
-static OrderNode create_order_node(const Order order) {
-    OrderNode node = malloc(sizeof(struct OrderNode));
-    if (!node) return NULL;
-    memcpy(&node->order, order, sizeof(struct Order));
-    node->next = NULL;
-    return node;
+
+// Points the ring's columns into base, which holds capacity entries (a power of two)
+static void set_columns(OrderBookLevel level, void *base, uint32_t capacity) {
+    level->timestamp = base;
+    level->quantity = (int *)(level->timestamp + capacity);
+    level->order_id = (uint32_t *)(level->quantity + capacity);
+    level->user_id = level->order_id + capacity;
+    level->mask = capacity - 1;
+}
+
+// Doubles the ring's capacity, keeping every entry under its ticket
+static int grow_ring(OrderBookLevel level) {
+    uint32_t old_mask = level->mask;
+    uint32_t capacity = (old_mask + 1) * 2;
+    if (capacity == 0) return 0;
+    void *base = malloc((size_t)capacity * LEVEL_ENTRY_SIZE);
+    if (!base) return 0;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+
+    int *old_quantity = level->quantity;
+    uint32_t *old_order_id = level->order_id;
+    uint32_t *old_user_id = level->user_id;
+    long *old_timestamp = level->timestamp;
+    set_columns(level, base, capacity);
+
+    for (uint32_t ticket = level->head; ticket != level->tail; ticket++) {
+        uint32_t src = ticket & old_mask;
+        uint32_t dst = ticket & level->mask;
+        level->quantity[dst] = old_quantity[src];
+        level->order_id[dst] = old_order_id[src];
+        level->user_id[dst] = old_user_id[src];
+        level->timestamp[dst] = old_timestamp[src];
+    }
+    if ((void *)old_timestamp != (void *)level->storage) free(old_timestamp);
+    return 1;
+}
+
+// Whether ticket names a queued, live entry
+static int is_live(const OrderBookLevel level, uint32_t ticket) {
+    return ticket - level->head < level->tail - level->head && level->quantity[ticket & level->mask] > 0;
+}
+
+// Takes a live entry out of the aggregates and marks it dead, then drops dead entries
+// from either end so the first and last entries stay live
+static void remove_entry(OrderBookLevel level, uint32_t ticket) {
+    int *quantity = &level->quantity[ticket & level->mask];
+    level->total_quantity -= *quantity;
+    level->order_count--;
+    *quantity = 0;
+
+    while (level->head != level->tail && level->quantity[level->head & level->mask] == 0) level->head++;
+    while (level->head != level->tail && level->quantity[(level->tail - 1) & level->mask] == 0) level->tail--;
+}
+
+static void copy_entry(const OrderBookLevel level, uint32_t ticket, BookOrder order) {
+    uint32_t index = ticket & level->mask;
+    order->order_id = level->order_id[index];
+    order->user_id = level->user_id[index];
+    order->quantity = level->quantity[index];
+    order->side = level->side;
+    order->price = level->price;
+    order->timestamp = level->timestamp[index];
 }
 
-static void destroy_order_node(OrderNode node) {
-    if (node) free(node);
-}
\ No newline at end of file
+// Finds the live entry of order_id by walking the queue
+static int find_entry(const OrderBookLevel level, uint32_t order_id, uint32_t *ticket) {
+    for (uint32_t t = level->head; t != level->tail; t++) {
+        uint32_t index = t & level->mask;
+        if (level->order_id[index] == order_id && level->quantity[index] > 0) {
+            *ticket = t;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,7 +1,17 @@
 /* OrderBookLevel.h - Header file for the OrderBookLevel module
- * 
+ *
  * This module provides the implementation of an OrderBookLevel, which represents
  * a price level in an order book. A price level represents one or more bid or ask orders at the same price.
+ * Orders are held as compact BookOrders whose IDs are interned integers.
+ *
+ * The level keeps its total quantity and order count current as orders are queued,
+ * reduced and removed, so reading either is O(1) and matching never walks a queue.
+ *
+ * The queue is a ring of columns (quantity, order ID, user ID, timestamp) rather than
+ * a list of nodes, so a sweep through a deep level reads memory in order. Orders are
+ * copied out of it on request; the price and side are the level's. An order in the
+ * middle of the queue is cancelled by marking its entry dead, and once dead entries
+ * outnumber live ones the level can be compacted.
  *
  * Author: Adam Rubinstein
  * Date: January 2025
@@ -12,10 +22,27 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "Order.h"
+#include "Pool.h"
 
 // OrderBookLevel type definition
 typedef struct OrderBookLevel *OrderBookLevel;
 
+// Position of an order in a level queue. Valid until the order leaves the level or the
+// level is compacted (OrderBookLevel_compact reports every position it changes).
+typedef struct OrderSlot {
+    OrderBookLevel level; /**< Level the order is queued in, or NULL for no order. */
+    uint32_t ticket;      /**< Position in the level's queue; later orders have later tickets. */
+} OrderSlot;
+
+/**
+ * Callback invoked by OrderBookLevel_compact for each order it moves.
+ *
+ * @param context The context pointer passed to OrderBookLevel_compact.
+ * @param order_id The interned ID of the moved order.
+ * @param slot The order's new position.
+ */
+typedef void (*OrderBookLevel_RelocateHandler)(void *context, uint32_t order_id, OrderSlot slot);
+
 /**
  * Creates a new OrderBookLevel instance.
  *
@@ -24,6 +51,39 @@ typedef struct OrderBookLevel *OrderBookLevel;
  */
 OrderBookLevel OrderBookLevel_create(double price);
 
+/**
+ * Creates a new OrderBookLevel instance allocated from a Pool.
+ *
+ * @param price The price of the level.
+ * @param level_pool Pool of blocks of at least OrderBookLevel_block_size() bytes, or NULL to use malloc.
+ * @return A newly allocated OrderBookLevel instance, or NULL on failure.
+ */
+OrderBookLevel OrderBookLevel_create_with_pool(double price, Pool level_pool);
+
+/**
+ * Gets the size of the block a level is allocated in. The block holds a queue of
+ * OrderBookLevel_inline_orders() orders; a deeper queue moves to its own allocation.
+ *
+ * @return The size in bytes of one level.
+ */
+size_t OrderBookLevel_block_size(void);
+
+/**
+ * Gets the number of orders a level queues without allocating.
+ *
+ * @return The capacity of a level's inline queue.
+ */
+size_t OrderBookLevel_inline_orders(void);
+
+/**
+ * Gets the bytes of queue storage a level has allocated outside its own block, which
+ * it does once its queue outgrows the inline capacity.
+ *
+ * @param level The OrderBookLevel instance.
+ * @return The bytes allocated, or 0 while the queue fits in the level's block.
+ */
+size_t OrderBookLevel_queue_bytes(const OrderBookLevel level);
+
 /**
  * Destroys an OrderBookLevel instance, freeing all associated memory.
  *
@@ -35,29 +95,88 @@ void OrderBookLevel_destroy(OrderBookLevel *level);
  * Adds an order to the level.
  *
  * @param level The OrderBookLevel instance.
- * @param order The Order to add (copied internally).
+ * @param order The order to add (copied internally).
  * @return 1 if the operation is successful, 0 on failure.
  */
-int OrderBookLevel_add_order(OrderBookLevel level, const Order order);
+int OrderBookLevel_add_order(OrderBookLevel level, const BookOrder order);
+
+/**
+ * Adds an order to the back of the level and reports its position.
+ *
+ * @param level The OrderBookLevel instance.
+ * @param order The order to add (copied internally); its quantity must be at least 1.
+ * @param slot Output position of the order (if not NULL).
+ * @return 1 if the operation is successful, 0 on failure or a quantity below 1.
+ */
+int OrderBookLevel_push_order(OrderBookLevel level, const BookOrder order, OrderSlot *slot);
+
+/**
+ * Removes an order from the level by its position in constant time, leaving a dead
+ * entry in the queue if the order was not at either end.
+ *
+ * @param level The OrderBookLevel instance.
+ * @param slot The position of the order to remove, as reported by OrderBookLevel_push_order.
+ * @return 1 if the order was removed, 0 if the slot holds no order of this level.
+ */
+int OrderBookLevel_unlink_order(OrderBookLevel level, OrderSlot slot);
+
+/**
+ * Reduces a queued order's quantity in place, keeping its time priority, and takes the
+ * reduction out of the level's total. Used for partial fills.
+ *
+ * @param level The OrderBookLevel instance.
+ * @param slot The position of the order to reduce.
+ * @param quantity The amount to take off; must be at least 1 and less than the order's
+ *                 quantity (an order reduced to nothing is removed instead).
+ * @return 1 if the order was reduced, 0 if the slot holds no order of this level or the
+ *         quantity is out of range.
+ */
+int OrderBookLevel_reduce_order(OrderBookLevel level, OrderSlot slot, int quantity);
+
+/**
+ * Copies the order at a position.
+ *
+ * @param slot The position of the order.
+ * @param order Output order (if not NULL), with the level's price.
+ * @return 1 if the slot holds an order, 0 otherwise.
+ */
+int OrderBookLevel_read_order(OrderSlot slot, BookOrder order);
 
 /**
- * Gets the oldest order from the level.
+ * Gets the position of the order at the front (oldest end) of the level's queue.
  *
  * @param level The OrderBookLevel instance.
- * @param order Output pointer to store the retrieved order (if not NULL).
+ * @param slot Output position.
+ * @return 1 if the level has an order, 0 if it is empty or NULL.
+ */
+int OrderBookLevel_front(const OrderBookLevel level, OrderSlot *slot);
+
+/**
+ * Moves a position to the next newer order in its level, to walk a level in time priority.
+ *
+ * @param slot The position to advance.
+ * @return 1 if there is a newer order, 0 at the back of the queue.
+ */
+int OrderBookLevel_next(OrderSlot *slot);
+
+/**
+ * Gets a copy of the oldest order in the level.
+ *
+ * @param level The OrderBookLevel instance.
+ * @param order Output order (if not NULL).
  * @return 1 if an order was retrieved, 0 if the level is empty.
  */
-int OrderBookLevel_get_order(OrderBookLevel level, Order *order);
+int OrderBookLevel_get_order(OrderBookLevel level, BookOrder order);
 
 /**
- * Gets an order by its order_id.
+ * Gets a copy of an order by its order_id.
  *
  * @param level The OrderBookLevel instance.
- * @param order_id The unique ID of the order to retrieve.
- * @param order Output pointer to store the retrieved order (if not NULL).
+ * @param order_id The interned ID of the order to retrieve.
+ * @param order Output order (if not NULL).
  * @return 1 if the order was found, 0 otherwise.
  */
-int OrderBookLevel_get_order_by_id(OrderBookLevel level, const char *order_id, Order *order);
+int OrderBookLevel_get_order_by_id(OrderBookLevel level, uint32_t order_id, BookOrder order);
 
 /**
  * Removes the oldest order from the level.
@@ -66,16 +185,43 @@ int OrderBookLevel_get_order_by_id(OrderBookLevel level, const char *order_id, O
  * @param order Output pointer to store the removed order (if not NULL).
  * @return 1 if an order was removed, 0 if the level is empty.
  */
-int OrderBookLevel_remove_order(OrderBookLevel level, Order order);
+int OrderBookLevel_remove_order(OrderBookLevel level, BookOrder order);
 
 /**
  * Removes an order by its order_id.
- * 
+ *
  * @param level The OrderBookLevel instance.
- * @param order_id The unique ID of the order to remove.
+ * @param order_id The interned ID of the order to remove.
  * @return 1 if the order was successfully removed, 0 otherwise.
  */
-int OrderBookLevel_delete_order_by_id(OrderBookLevel level, const char *order_id);
+int OrderBookLevel_delete_order_by_id(OrderBookLevel level, uint32_t order_id);
+
+/**
+ * Checks whether dead entries left by removals take up more of the queue than live
+ * orders, so that compacting it would pay off.
+ *
+ * @param level The OrderBookLevel instance.
+ * @return 1 if the level should be compacted, 0 otherwise.
+ */
+int OrderBookLevel_needs_compaction(const OrderBookLevel level);
+
+/**
+ * Closes the gaps left by removed orders, keeping the queue order. Orders that move get
+ * new positions, each reported to relocated.
+ *
+ * @param level The OrderBookLevel instance.
+ * @param relocated Callback invoked once per moved order, or NULL.
+ * @param context Passed through to relocated.
+ */
+void OrderBookLevel_compact(OrderBookLevel level, OrderBookLevel_RelocateHandler relocated, void *context);
+
+/**
+ * Gets the price of the level.
+ *
+ * @param level The OrderBookLevel instance.
+ * @return The price of the level, or 0 if level is NULL.
+ */
+double OrderBookLevel_get_price(const OrderBookLevel level);
 
 /**
  * Gets the total quantity of all orders at this price level.
@@ -86,7 +232,16 @@ int OrderBookLevel_delete_order_by_id(OrderBookLevel level, const char *order_id
 int OrderBookLevel_get_total_quantity(const OrderBookLevel level);
 
 /**
- * Recalculates the total quantity of the level.
+ * Gets the number of orders queued at this price level.
+ *
+ * @param level The OrderBookLevel instance.
+ * @return The number of orders, or 0 if level is NULL.
+ */
+int OrderBookLevel_get_order_count(const OrderBookLevel level);
+
+/**
+ * Recalculates the total quantity and order count of the level by walking its queue.
+ * The level's own operations keep both current, so this only checks them.
  *
  * @param level The OrderBookLevel instance.
  */
@@ -100,4 +255,4 @@ void OrderBookLevel_reset_total_quantity(OrderBookLevel level);
  */
 bool OrderBookLevel_is_empty(const OrderBookLevel level);
 
-#endif // ORDER_BOOK_LEVEL_H
\ No newline at end of file
+#endif // ORDER_BOOK_LEVEL_H
@@ -0,0 +1,369 @@
+/*******************************************************************************************/
+/* OrderBookManager.c - Implementation file for the OrderBookManager module
+ *
+ * The producer resolves each symbol to its entry (book and worker) through a HashTable
+ * and pushes a command holding the book pointer and a copy of the order onto that
+ * worker's ring. A book is created by the producer before its first command is pushed;
+ * the ring's release/acquire handoff makes it visible to the worker, which owns it from
+ * then on.
+ *
+ * Workers count the commands they have applied in an atomic; the producer counts what it
+ * pushed to each worker, so draining is waiting until the two agree. Idle workers spin a
+ * little and then yield, and never take a lock.
+ */
+
+#define _GNU_SOURCE
+#include "OrderBookManager.h"
+#include "CsvReplay.h"
+#include "HashTable.h"
+#include "SpscRing.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MANAGER_DEFAULT_TICK 0.01
+#define MANAGER_IDLE_SPINS 256      // Empty polls before a worker starts yielding
+#define MANAGER_COMMAND_BATCH 32    // Commands popped per batch
+#define MANAGER_MAX_FIELDS 9
+#define MANAGER_SYMBOL_CAPACITY 64  // Initial size of the symbol table
+
+enum CommandType { COMMAND_ADD, COMMAND_REMOVE };
+
+// Record passed through a worker's ring
+struct Command {
+    OrderBook book;
+    int type;             // COMMAND_ADD or COMMAND_REMOVE
+    struct Order order;   // The order to add, or just the order_id to remove
+};
+
+// One symbol and the book and worker it belongs to
+struct SymbolEntry {
+    char symbol[ORDER_BOOK_MANAGER_MAX_SYMBOL + 1];
+    OrderBook book;
+    int shard;
+};
+
+// One worker thread and its queue
+struct Worker {
+    alignas(64) atomic_size_t applied;  // Commands applied; written by the worker
+    atomic_int stop;                    // Set by the producer to end the thread
+    size_t pushed;                      // Commands pushed; producer only
+    SpscRing queue;
+    pthread_t thread;
+    int started;
+    int cpu;                            // CPU to pin to, or -1
+    long adds, removes, trades, rejected;
+};
+
+// OrderBookManager structure
+struct OrderBookManager {
+    struct Worker *workers;
+    int worker_count;
+    HashTable symbols;                  // Symbol -> struct SymbolEntry *
+    struct SymbolEntry **entries;       // In order of first use
+    size_t entry_count;
+    size_t entry_capacity;
+    int next_shard;
+    struct OrderBookConfig book_config;
+    double tick_size;
+    double ticks_per_unit;              // Whole number of ticks per unit, or 0 if not integral
+};
+
+// Helper function prototypes
+static void *run_worker(void *argument);
+static void apply_command(struct Worker *worker, struct Command *command, struct OrderBookMatchResult *result);
+static struct SymbolEntry *find_entry(OrderBookManager manager, const char *symbol);
+static struct SymbolEntry *add_entry(OrderBookManager manager, const char *symbol);
+static void push_command(OrderBookManager manager, int shard, const struct Command *command);
+static void stop_workers(OrderBookManager manager);
+static void copy_field(char *dest, size_t size, const struct CsvField *field);
+
+// Public function implementations
+OrderBookManager OrderBookManager_create(const struct OrderBookManagerConfig *config) {
+    int worker_count = config && config->workers > 0 ? config->workers : 1;
+    size_t queue_capacity = config && config->queue_capacity ? config->queue_capacity : ORDER_BOOK_MANAGER_DEFAULT_QUEUE;
+
+    OrderBookManager manager = malloc(sizeof(struct OrderBookManager));
+    if (!manager) return NULL;
+    memset(manager, 0, sizeof(struct OrderBookManager));
+    if (config) manager->book_config = config->book;
+    manager->tick_size = manager->book_config.tick_size > 0.0 ? manager->book_config.tick_size : MANAGER_DEFAULT_TICK;
+    double whole = round(1.0 / manager->tick_size);
+    manager->ticks_per_unit = fabs(1.0 / manager->tick_size - whole) < 1e-9 ? whole : 0.0;
+
+    manager->symbols = HashTable_create(MANAGER_SYMBOL_CAPACITY);
+    manager->workers = aligned_alloc(64, worker_count * sizeof(struct Worker));
+    if (!manager->symbols || !manager->workers) {
+        HashTable_destroy(&(manager->symbols));
+        free(manager->workers);
+        free(manager);
+        return NULL;
+    }
+    memset(manager->workers, 0, worker_count * sizeof(struct Worker));
+    manager->worker_count = worker_count;
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count < 1) cpu_count = 1;
+    int ok = 1;
+    for (int i = 0; i < worker_count && ok; i++) {
+        struct Worker *worker = &manager->workers[i];
+        atomic_init(&worker->applied, 0);
+        atomic_init(&worker->stop, 0);
+        worker->cpu = config && config->pin_threads ? (int)((config->first_cpu + i) % cpu_count) : -1;
+        worker->queue = SpscRing_create(sizeof(struct Command), queue_capacity);
+        ok = worker->queue && pthread_create(&worker->thread, NULL, run_worker, worker) == 0;
+        worker->started = ok;
+    }
+    if (!ok) {
+        OrderBookManager_destroy(&manager);
+        return NULL;
+    }
+    return manager;
+}
+
+void OrderBookManager_destroy(OrderBookManager *manager) {
+    if (!manager || !*manager) return;
+    OrderBookManager m = *manager;
+
+    stop_workers(m);
+    for (int i = 0; i < m->worker_count; i++) {
+        SpscRing_destroy(&(m->workers[i].queue));
+    }
+    for (size_t i = 0; i < m->entry_count; i++) {
+        OrderBook_destroy(&(m->entries[i]->book));
+        free(m->entries[i]);
+    }
+    free(m->entries);
+    free(m->workers);
+    HashTable_destroy(&(m->symbols));
+    free(m);
+
+    *manager = NULL;
+}
+
+int OrderBookManager_add_order(OrderBookManager manager, const char *symbol, const Order order) {
+    if (!manager || !symbol || !order) return 0;
+
+    struct SymbolEntry *entry = find_entry(manager, symbol);
+    if (!entry) entry = add_entry(manager, symbol);
+    if (!entry) return 0;
+
+    struct Command command;
+    command.book = entry->book;
+    command.type = COMMAND_ADD;
+    command.order = *order;
+    push_command(manager, entry->shard, &command);
+    return 1;
+}
+
+int OrderBookManager_remove_order(OrderBookManager manager, const char *symbol, const char *order_id) {
+    if (!manager || !symbol || !order_id) return 0;
+
+    struct SymbolEntry *entry = find_entry(manager, symbol);
+    if (!entry) return 0;
+
+    struct Command command;
+    memset(&command, 0, sizeof(command));
+    command.book = entry->book;
+    command.type = COMMAND_REMOVE;
+    strncpy(command.order.order_id, order_id, sizeof(command.order.order_id) - 1);
+    push_command(manager, entry->shard, &command);
+    return 1;
+}
+
+int OrderBookManager_route_csv(OrderBookManager manager, const char *line, size_t length) {
+    if (!manager || !line) return 0;
+    if (length > 0 && line[length - 1] == '\r') length--;
+
+    struct CsvField fields[MANAGER_MAX_FIELDS];
+    int count = CsvReplay_split_fields(line, length, fields, MANAGER_MAX_FIELDS);
+    if (count < 2 || fields[1].length == 0 || fields[1].length > ORDER_BOOK_MANAGER_MAX_SYMBOL) return 0;
+
+    char symbol[ORDER_BOOK_MANAGER_MAX_SYMBOL + 1];
+    copy_field(symbol, sizeof(symbol), &fields[1]);
+
+    if (CsvReplay_field_equals(&fields[0], "ADD")) {
+        // ADD,symbol,order_id,user_id,side,price,quantity[,timestamp]
+        long ticks, quantity, timestamp = (long)time(NULL);
+        if (count < 7 || count > 8 ||
+            !CsvReplay_parse_ticks(fields[5].start, fields[5].length, manager->tick_size, &ticks) ||
+            !CsvReplay_parse_long(&fields[6], &quantity) || quantity > INT32_MAX ||
+            (count == 8 && !CsvReplay_parse_long(&fields[7], &timestamp))) {
+            return 0;
+        }
+
+        struct Order order;
+        memset(&order, 0, sizeof(order));
+        copy_field(order.order_id, sizeof(order.order_id), &fields[2]);
+        copy_field(order.user_id, sizeof(order.user_id), &fields[3]);
+        order.side = CsvReplay_field_equals(&fields[4], "buy") ? '1' : '0';
+        order.price = manager->ticks_per_unit ? ticks / manager->ticks_per_unit : ticks * manager->tick_size;
+        order.quantity = (int)quantity;
+        order.timestamp = timestamp;
+        return OrderBookManager_add_order(manager, symbol, &order);
+    }
+    if (CsvReplay_field_equals(&fields[0], "REMOVE")) {
+        // REMOVE,symbol,order_id
+        if (count != 3) return 0;
+        char order_id[37];
+        copy_field(order_id, sizeof(order_id), &fields[2]);
+        return OrderBookManager_remove_order(manager, symbol, order_id);
+    }
+    return 0;
+}
+
+void OrderBookManager_drain(OrderBookManager manager) {
+    if (!manager) return;
+
+    for (int i = 0; i < manager->worker_count; i++) {
+        struct Worker *worker = &manager->workers[i];
+        while (atomic_load_explicit(&worker->applied, memory_order_acquire) != worker->pushed) {
+            sched_yield();
+        }
+    }
+}
+
+OrderBook OrderBookManager_get_book(OrderBookManager manager, const char *symbol) {
+    struct SymbolEntry *entry = manager && symbol ? find_entry(manager, symbol) : NULL;
+    return entry ? entry->book : NULL;
+}
+
+int OrderBookManager_get_shard(OrderBookManager manager, const char *symbol) {
+    struct SymbolEntry *entry = manager && symbol ? find_entry(manager, symbol) : NULL;
+    return entry ? entry->shard : -1;
+}
+
+const char *OrderBookManager_get_symbol(OrderBookManager manager, size_t index) {
+    if (!manager || index >= manager->entry_count) return NULL;
+    return manager->entries[index]->symbol;
+}
+
+void OrderBookManager_get_stats(OrderBookManager manager, struct OrderBookManagerStats *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!manager) return;
+
+    for (int i = 0; i < manager->worker_count; i++) {
+        const struct Worker *worker = &manager->workers[i];
+        stats->adds += worker->adds;
+        stats->removes += worker->removes;
+        stats->trades += worker->trades;
+        stats->rejected += worker->rejected;
+    }
+    stats->symbols = manager->entry_count;
+}
+
+// Helper function implementations
+static void *run_worker(void *argument) {
+    struct Worker *worker = argument;
+    if (worker->cpu >= 0) {
+        // Pinning is best effort; an unpinned worker still works
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    struct Command batch[MANAGER_COMMAND_BATCH];
+    int idle = 0;
+    for (;;) {
+        size_t count = SpscRing_pop_batch(worker->queue, batch, MANAGER_COMMAND_BATCH);
+        if (count > 0) {
+            for (size_t i = 0; i < count; i++) {
+                apply_command(worker, &batch[i], &result);
+            }
+            // Publishes the book changes and counters along with the count
+            atomic_store_explicit(&worker->applied, atomic_load_explicit(&worker->applied, memory_order_relaxed) + count,
+                                  memory_order_release);
+            idle = 0;
+        } else if (atomic_load_explicit(&worker->stop, memory_order_acquire)) {
+            break; // The producer stops a worker only once its queue is drained
+        } else if (++idle > MANAGER_IDLE_SPINS) {
+            sched_yield();
+        }
+    }
+
+    OrderBookMatchResult_free(&result);
+    return NULL;
+}
+
+static void apply_command(struct Worker *worker, struct Command *command, struct OrderBookMatchResult *result) {
+    if (command->type == COMMAND_ADD) {
+        if (OrderBook_add_order_with_result(command->book, &command->order, result)) {
+            worker->adds++;
+        } else {
+            worker->rejected++;
+        }
+        worker->trades += result->count;
+    } else {
+        worker->removes += OrderBook_remove_order(command->book, command->order.order_id);
+    }
+}
+
+static struct SymbolEntry *find_entry(OrderBookManager manager, const char *symbol) {
+    return HashTable_get(manager->symbols, symbol);
+}
+
+// Creates the book for a new symbol and assigns it the next worker
+static struct SymbolEntry *add_entry(OrderBookManager manager, const char *symbol) {
+    if (strlen(symbol) > ORDER_BOOK_MANAGER_MAX_SYMBOL) return NULL;
+
+    if (manager->entry_count == manager->entry_capacity) {
+        size_t new_capacity = manager->entry_capacity ? manager->entry_capacity * 2 : 16;
+        struct SymbolEntry **new_entries = realloc(manager->entries, new_capacity * sizeof(struct SymbolEntry *));
+        if (!new_entries) return NULL;
+        manager->entries = new_entries;
+        manager->entry_capacity = new_capacity;
+    }
+
+    struct SymbolEntry *entry = malloc(sizeof(struct SymbolEntry));
+    if (!entry) return NULL;
+    strcpy(entry->symbol, symbol);
+    entry->book = OrderBook_create_with_config(&manager->book_config);
+    entry->shard = manager->next_shard;
+    if (!entry->book || HashTable_add(manager->symbols, symbol, entry) != 0) {
+        OrderBook_destroy(&(entry->book));
+        free(entry);
+        return NULL;
+    }
+
+    manager->entries[manager->entry_count++] = entry;
+    manager->next_shard = (manager->next_shard + 1) % manager->worker_count;
+    return entry;
+}
+
+// Pushes a command to a worker, waiting for room if its queue is full
+static void push_command(OrderBookManager manager, int shard, const struct Command *command) {
+    struct Worker *worker = &manager->workers[shard];
+    while (!SpscRing_push(worker->queue, command)) {
+        sched_yield();
+    }
+    worker->pushed++;
+}
+
+// Drains the queues, then stops and joins every started worker
+static void stop_workers(OrderBookManager manager) {
+    OrderBookManager_drain(manager);
+    for (int i = 0; i < manager->worker_count; i++) {
+        struct Worker *worker = &manager->workers[i];
+        if (!worker->started) continue;
+        atomic_store_explicit(&worker->stop, 1, memory_order_release);
+        pthread_join(worker->thread, NULL);
+        worker->started = 0;
+    }
+}
+
+// Copies a field into a buffer of size bytes, truncating if needed
+static void copy_field(char *dest, size_t size, const struct CsvField *field) {
+    size_t length = field->length < size - 1 ? field->length : size - 1;
+    memcpy(dest, field->start, length);
+    dest[length] = '\0';
+}
@@ -0,0 +1,138 @@
+/* OrderBookManager.h - Header file for the OrderBookManager module
+ *
+ * This module runs one OrderBook per instrument symbol, sharded across a pool of worker
+ * threads. Each symbol is assigned to a worker the first time it is seen (round-robin),
+ * and from then on only that worker touches its book, so books stay single-threaded and
+ * need no locks. Every worker has its own SpscRing of commands fed by the thread that
+ * calls the manager, and workers can be pinned to CPUs.
+ *
+ * The manager's functions must all be called from one thread (the producer). Adds and
+ * removes are queued and return before they are applied; OrderBookManager_drain waits
+ * for everything queued so far, after which the books and stats may be read until the
+ * next add or remove is queued.
+ */
+#ifndef ORDER_BOOK_MANAGER_H
+#define ORDER_BOOK_MANAGER_H
+
+#include <stddef.h>
+#include "Order.h"
+#include "OrderBook.h"
+
+#define ORDER_BOOK_MANAGER_MAX_SYMBOL 15            // Longest symbol, in characters
+#define ORDER_BOOK_MANAGER_DEFAULT_QUEUE 4096       // Commands per worker queue
+
+// OrderBookManager type definition
+typedef struct OrderBookManager *OrderBookManager;
+
+// Settings for OrderBookManager_create. A zeroed config uses one unpinned worker.
+struct OrderBookManagerConfig {
+    int workers;                  /**< Worker threads (0 for 1). */
+    size_t queue_capacity;        /**< Commands each worker's queue holds (0 for the default). */
+    int pin_threads;              /**< 1 to pin worker i to CPU (first_cpu + i) modulo the CPU count. */
+    int first_cpu;                /**< First CPU used when pinning. */
+    struct OrderBookConfig book;  /**< Settings for every book the manager creates (leave
+                                       trade_log.spill_path unset; books would share the file). */
+};
+
+// Counters summed over all workers, as of the last drain
+struct OrderBookManagerStats {
+    long adds;       /**< Adds applied. */
+    long removes;    /**< Removes that removed an order. */
+    long trades;     /**< Trades executed. */
+    long rejected;   /**< Adds the book failed to apply. */
+    size_t symbols;  /**< Symbols (books) seen so far. */
+};
+
+/**
+ * Creates a manager and starts its worker threads.
+ *
+ * @param config Settings, or NULL for defaults.
+ * @return A newly allocated OrderBookManager instance, or NULL on failure.
+ */
+OrderBookManager OrderBookManager_create(const struct OrderBookManagerConfig *config);
+
+/**
+ * Applies everything queued, stops the workers and destroys every book.
+ *
+ * @param manager A pointer to the OrderBookManager instance to destroy.
+ */
+void OrderBookManager_destroy(OrderBookManager *manager);
+
+/**
+ * Queues an add for the symbol's book, creating the book if the symbol is new. Waits
+ * while the worker's queue is full.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param symbol The instrument symbol (at most ORDER_BOOK_MANAGER_MAX_SYMBOL characters).
+ * @param order The order to add (copied).
+ * @return 1 if the add was queued, 0 on invalid arguments or failure to create the book.
+ */
+int OrderBookManager_add_order(OrderBookManager manager, const char *symbol, const Order order);
+
+/**
+ * Queues a remove for the symbol's book. Waits while the worker's queue is full.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param symbol The instrument symbol.
+ * @param order_id The ID of the order to remove.
+ * @return 1 if the remove was queued, 0 on invalid arguments or an unknown symbol.
+ */
+int OrderBookManager_remove_order(OrderBookManager manager, const char *symbol, const char *order_id);
+
+/**
+ * Parses an ADD or REMOVE line with a symbol column and queues it:
+ *   ADD,symbol,order_id,user_id,side,price,quantity[,timestamp]
+ *   REMOVE,symbol,order_id
+ * Prices are rounded to the books' tick size (0.01 if they have none).
+ *
+ * @param manager The OrderBookManager instance.
+ * @param line The CSV line (need not be NUL-terminated; a trailing '\r' is ignored).
+ * @param length The length of the line.
+ * @return 1 if the line was queued, 0 if it is malformed or another command.
+ */
+int OrderBookManager_route_csv(OrderBookManager manager, const char *line, size_t length);
+
+/**
+ * Waits until every add and remove queued so far has been applied.
+ *
+ * @param manager The OrderBookManager instance.
+ */
+void OrderBookManager_drain(OrderBookManager manager);
+
+/**
+ * Gets the book for a symbol. The book may only be used after OrderBookManager_drain
+ * and before the next add or remove is queued.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param symbol The instrument symbol.
+ * @return The symbol's book, or NULL if the symbol has not been seen.
+ */
+OrderBook OrderBookManager_get_book(OrderBookManager manager, const char *symbol);
+
+/**
+ * Gets the worker a symbol is assigned to.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param symbol The instrument symbol.
+ * @return The worker index, or -1 if the symbol has not been seen.
+ */
+int OrderBookManager_get_shard(OrderBookManager manager, const char *symbol);
+
+/**
+ * Gets the symbols seen so far, in the order they were first seen.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param index Index of the symbol, from 0 to stats.symbols - 1.
+ * @return The symbol, or NULL if index is out of range.
+ */
+const char *OrderBookManager_get_symbol(OrderBookManager manager, size_t index);
+
+/**
+ * Sums the workers' counters. Call after OrderBookManager_drain.
+ *
+ * @param manager The OrderBookManager instance.
+ * @param stats Output for the counters.
+ */
+void OrderBookManager_get_stats(OrderBookManager manager, struct OrderBookManagerStats *stats);
+
+#endif // ORDER_BOOK_MANAGER_H
@@ -6,43 +6,181 @@
  * order book. Orders are organized into price levels, and trades are executed by matching
  * orders with the most competitive prices.
  *
+ * Levels are stored in one of two ways, chosen at creation:
+ *  - an OrderedMap keyed by price (the default), or
+ *  - a price ladder: a contiguous array of levels indexed by integer tick over a fixed
+ *    price band, with the index of the best non-empty level cached. Ladder levels are
+ *    allocated the first time their tick is used and kept until the side is destroyed.
+ *
+ * Either way the side caches a pointer to its best level and that level's price. The cache
+ * is updated when a level is created or removed, so reading the best price never searches.
+ * A side can also keep a small array of its best depth_cache level views, patched in place
+ * whenever a level's quantity changes; only losing a cached level needs a step through
+ * the levels, to pull the next one in at the bottom.
+ *
+ * A ladder side also keeps the total quantity of every slot in a flat int vector, so depth
+ * queries (size through a price, the VWAP of sweeping a quantity) scan contiguous memory
+ * eight slots at a time instead of chasing level pointers. Blocks are summed with AVX2
+ * when the CPU has it and with a plain loop otherwise; the answers are identical.
+ *
  * Author: Adam Rubinstein
  * Date: January 2025
  */
 #include "stdio.h"
 
 #include "OrderBookSide.h"
-#include "HashTable.h"
 #include "OrderedMap.h"
 #include "OrderBookLevel.h"
+#include "Instrument.h"
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)(address))
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_AVX2_BLOCKS 1
+#endif
+
+#define SLOT_BLOCK 8 // Ladder slots summed per block by the depth scans
+
+// Aggregates of SLOT_BLOCK consecutive ladder slots
+struct SlotBlock {
+    int64_t size;      // Total quantity
+    int64_t weighted;  // Sum of (slot - first slot) * quantity
+    unsigned nonempty; // Bit j set if slot j holds quantity
+};
+
+typedef void (*SumSlotsFn)(const int *sizes, struct SlotBlock *block);
+
+// Links of a resting order in its user's list, kept by order ID handle
+struct UserLink {
+    uint32_t user_id; // User the order belongs to
+    uint32_t prev;    // Order ID of the user's previous order, or 0 at the head
+    uint32_t next;    // Order ID of the user's next order, or 0 at the tail
+};
 
 struct OrderBookSide {
-    OrderedMap levels; /**< OrderedMap of price levels (price -> OrderBookLevel). */
-    HashTable order_lookup; /**< Hashtable for order ID lookup. */
+    OrderedMap levels; /**< OrderedMap of price levels (price -> OrderBookLevel), or NULL for a ladder side. */
+    OrderSlot *order_index; /**< Resting orders by order ID handle (level NULL where none rests). */
+    size_t index_size; /**< Number of entries in order_index. */
+    struct UserLink *user_links; /**< Each resting order's links in its user's list, by order ID handle (index_size entries). */
+    uint32_t *user_heads; /**< Order ID of each user's most recent resting order, by user ID handle (0 for none). */
+    size_t user_heads_size; /**< Number of entries in user_heads. */
+    OrderBookLevel *touched; /**< Scratch list of the levels a mass delete has unlinked orders from. */
+    size_t touched_capacity; /**< Number of entries touched has room for. */
     int is_buy_side; /**< 1 if this is the buy side, 0 if the sell side. */
+    Pool level_pool; /**< Pool for this side's levels, or NULL. */
+    Pool fill_pool; /**< Pool for filled order records, or NULL. */
+
+    OrderBookLevel best_level; /**< Most competitive non-empty level, or NULL if the side is empty. */
+    double best_price; /**< Price of best_level. */
+
+    OrderBookLevel *ladder; /**< Ladder of levels indexed by tick - min_tick, or NULL for a map side. */
+    long ladder_size; /**< Number of ticks in the ladder. */
+    long min_tick; /**< Tick of ladder[0]. */
+    double tick_size; /**< Price increment between adjacent ladder slots. */
+    double ticks_per_unit; /**< 1 / tick_size, used to turn ticks back into prices. */
+    long best_index; /**< Ladder index of the best non-empty level, or -1 if none. */
+    size_t level_count; /**< Number of non-empty ladder levels. */
+    int *ladder_sizes; /**< Total quantity at each ladder slot (0 where none rests). */
+    SumSlotsFn sum_slots; /**< Block kernel for the depth scans, picked for the CPU at creation. */
+
+    struct OrderBookLevelView *top; /**< Best levels, best first, or NULL without a depth cache. */
+    int top_capacity; /**< Levels the cache holds when full (the configured depth_cache). */
+    int top_count; /**< Levels in the cache: min(top_capacity, number of levels). */
+
+    OrderBookSide_LevelListener level_listener; /**< Told about level quantity changes, or NULL. */
+    void *listener_context; /**< Passed through to level_listener. */
 };
 
 // Helper function prototypes
 static int compare_prices(double price1, double price2, int is_buy_side);
+static size_t count_levels(OrderBookSide side);
+static OrderBookLevel find_or_create_level(OrderBookSide side, double price);
+static int visit_level(OrderBookLevel level, OrderBookSide_OrderVisitor visitor, void *context);
+static OrderBookLevel get_best_level(OrderBookSide side, double *price);
+static int crosses(OrderBookSide side, double level_price, double order_price);
+static void remove_level_if_empty(OrderBookSide side, OrderBookLevel level);
+static void level_changed(OrderBookSide side, OrderBookLevel level);
+static void update_top(OrderBookSide side, const struct OrderBookLevelView *view);
+static void fill_view(OrderBookLevel level, struct OrderBookLevelView *view);
+static int next_level_after(OrderBookSide side, double price, struct OrderBookLevelView *view);
+static long price_to_tick(OrderBookSide side, double price);
+static double tick_to_price(OrderBookSide side, long tick);
+static long next_ladder_index(OrderBookSide side, long index);
+static void set_best_level(OrderBookSide side, OrderBookLevel level);
+static OrderSlot *find_order(OrderBookSide side, uint32_t order_id);
+static int index_order(OrderBookSide side, uint32_t order_id, OrderSlot slot);
+static void reindex_order(void *context, uint32_t order_id, OrderSlot slot);
+static int link_user(OrderBookSide side, uint32_t order_id, uint32_t user_id);
+static void unlink_user(OrderBookSide side, uint32_t order_id);
+static int grow_touched(OrderBookSide side);
+static void finish_touched_levels(OrderBookSide side, OrderBookLevel *levels, size_t count);
+static int compare_levels(const void *a, const void *b);
+static void estimate_ladder_fill(OrderBookSide side, long quantity, struct OrderBookFillEstimate *estimate);
+static long ladder_size_between(OrderBookSide side, long first, long last);
+static void sum_slots_scalar(const int *sizes, struct SlotBlock *block);
+#ifdef HAVE_AVX2_BLOCKS
+static void sum_slots_avx2(const int *sizes, struct SlotBlock *block);
+#endif
+static SumSlotsFn pick_sum_slots(void);
 
 // Public function implementations
 OrderBookSide OrderBookSide_create(int is_buy_side) {
+    return OrderBookSide_create_with_config(is_buy_side, NULL);
+}
+
+OrderBookSide OrderBookSide_create_with_config(int is_buy_side, const struct OrderBookSideConfig *config) {
+    int use_ladder = config && config->tick_size > 0.0;
+    if (use_ladder && config->max_price < config->min_price) return NULL;
+    if (config && config->depth_cache < 0) return NULL;
+
     OrderBookSide side = malloc(sizeof(struct OrderBookSide));
     if (!side) return NULL;
-    side->levels = OrderedMap_create();
-    if (!side->levels) {
-        free(side);
-        return NULL;
+    memset(side, 0, sizeof(struct OrderBookSide));
+    side->best_index = -1;
+
+    if (use_ladder) {
+        side->tick_size = config->tick_size;
+        side->ticks_per_unit = 1.0 / config->tick_size;
+        side->min_tick = price_to_tick(side, config->min_price);
+        side->ladder_size = price_to_tick(side, config->max_price) - side->min_tick + 1;
+        side->ladder = calloc(side->ladder_size, sizeof(OrderBookLevel));
+        side->ladder_sizes = calloc(side->ladder_size, sizeof(int));
+        if (!side->ladder || !side->ladder_sizes) {
+            free(side->ladder);
+            free(side->ladder_sizes);
+            free(side);
+            return NULL;
+        }
+        side->sum_slots = pick_sum_slots();
+    } else {
+        side->levels = OrderedMap_create();
+        if (!side->levels) {
+            free(side);
+            return NULL;
+        }
     }
-    side->order_lookup = HashTable_create(1024); // Added default capacity
-    if (!side->order_lookup) {
-        OrderedMap_destroy(&(side->levels));
-        free(side);
-        return NULL;
+    if (config && config->depth_cache > 0) {
+        side->top = malloc(config->depth_cache * sizeof(struct OrderBookLevelView));
+        if (!side->top) {
+            free(side->ladder);
+            free(side->ladder_sizes);
+            OrderedMap_destroy(&(side->levels));
+            free(side);
+            return NULL;
+        }
+        side->top_capacity = config->depth_cache;
     }
     side->is_buy_side = is_buy_side;
+    side->level_pool = config ? config->level_pool : NULL;
+    side->fill_pool = config ? config->fill_pool : NULL;
     return side;
 }
 
@@ -50,158 +188,493 @@ void OrderBookSide_destroy(OrderBookSide *side) {
     if (!side || !*side) return;
     OrderBookSide s = *side;
 
-    OrderedMapIterator iter = OrderedMap_front(s->levels);
-    char reached_end = 0;
-    while (!reached_end) {
-        double price;
-        OrderBookLevel level;
-        OrderedMapIterator_get(iter, &price, (void **)&level);
-        
-        if (level) OrderBookLevel_destroy(&level);
-        reached_end = !OrderedMapIterator_next(iter);
-    }
+    if (s->ladder) {
+        for (long i = 0; i < s->ladder_size; i++) {
+            if (s->ladder[i]) OrderBookLevel_destroy(&(s->ladder[i]));
+        }
+        free(s->ladder);
+        free(s->ladder_sizes);
+    } else {
+        OrderedMapCursor cursor;
+        OrderedMap_cursor_front(s->levels, &cursor);
+        char reached_end = 0;
+        while (!reached_end) {
+            double price;
+            OrderBookLevel level;
+            OrderedMapCursor_get(&cursor, &price, (void **)&level);
+
+            if (level) OrderBookLevel_destroy(&level);
+            reached_end = !OrderedMapCursor_next(&cursor);
+        }
 
-    OrderedMapIterator_destroy(&iter);
-    OrderedMap_destroy(&(s->levels));
-    HashTable_destroy(&(s->order_lookup));
+        OrderedMap_destroy(&(s->levels));
+    }
+    free(s->order_index);
+    free(s->user_links);
+    free(s->user_heads);
+    free(s->touched);
+    free(s->top);
     free(s);
 
     *side = NULL;
 }
 
-int OrderBookSide_add_order(OrderBookSide side, const Order order) {
+int OrderBookSide_add_order(OrderBookSide side, const BookOrder order) {
     if (!side || !order) return 0;
+    if (find_order(side, order->order_id)) return 0; // Duplicate order ID
 
-    OrderBookLevel level = NULL;
-    if (!OrderedMap_get(side->levels, order->price, (void **)&level)) {
-        level = OrderBookLevel_create(order->price);
-        if (!level) return 0;
-        OrderedMap_insert(side->levels, order->price, level);
+    INSTRUMENT_TIME(lookup_start);
+    OrderBookLevel level = find_or_create_level(side, order->price);
+    if (!level) return 0;
+    INSTRUMENT_STAGE(INSTRUMENT_LEVEL_LOOKUP, lookup_start);
+    INSTRUMENT_COUNT(INSTRUMENT_LEVELS_TOUCHED, 1);
+
+    OrderSlot slot;
+    if (!OrderBookLevel_push_order(level, order, &slot)) {
+        remove_level_if_empty(side, level);
+        return 0;
+    }
+
+    if (!index_order(side, order->order_id, slot)) {
+        OrderBookLevel_unlink_order(level, slot);
+        remove_level_if_empty(side, level);
+        return 0;
     }
+    if (!link_user(side, order->order_id, order->user_id)) {
+        side->order_index[order->order_id].level = NULL;
+        OrderBookLevel_unlink_order(level, slot);
+        remove_level_if_empty(side, level);
+        return 0;
+    }
+    level_changed(side, level);
+    return 1;
+}
 
-    if (!OrderBookLevel_add_order(level, order)) return 0;
+int OrderBookSide_get_order_by_id(OrderBookSide side, uint32_t order_id, BookOrder order) {
+    if (!side) return 0;
 
-    HashTable_add(side->order_lookup, order->order_id, level);
+    OrderSlot *slot = find_order(side, order_id);
+    if (!slot) return 0;
+
+    return OrderBookLevel_read_order(*slot, order);
+}
+
+int OrderBookSide_delete_order_by_id(OrderBookSide side, uint32_t order_id) {
+    if (!side) return 0;
+
+    OrderSlot *slot = find_order(side, order_id);
+    if (!slot) return 0;
+
+    OrderBookLevel level = slot->level;
+    OrderBookLevel_unlink_order(level, *slot);
+    slot->level = NULL;
+    unlink_user(side, order_id);
+    // Gaps left by cancels are closed once they outweigh the orders still queued
+    if (OrderBookLevel_needs_compaction(level)) OrderBookLevel_compact(level, reindex_order, side);
+    level_changed(side, level);
+    remove_level_if_empty(side, level);
     return 1;
 }
 
-int OrderBookSide_get_order_by_id(OrderBookSide side, const char *order_id, Order *order) {
-    if (!side || !order_id) return 0;
+int OrderBookSide_modify_order(OrderBookSide side, uint32_t order_id, double price, int quantity) {
+    if (!side || quantity <= 0) return 0;
 
-    OrderBookLevel level = NULL;
-    if (!(level = HashTable_get(side->order_lookup, order_id))) return 0;
+    OrderSlot *slot = find_order(side, order_id);
+    if (!slot) return 0;
 
-    return OrderBookLevel_get_order_by_id(level, order_id, order);
+    struct BookOrder order;
+    OrderBookLevel_read_order(*slot, &order);
+    OrderBookLevel old_level = slot->level;
+    OrderBookLevel level = find_or_create_level(side, price);
+    if (!level) return 0;
+
+    // Staying on the level without adding quantity keeps the order's place in the queue
+    if (level == old_level && quantity <= order.quantity) {
+        if (quantity < order.quantity) {
+            OrderBookLevel_reduce_order(level, *slot, order.quantity - quantity);
+            level_changed(side, level);
+        }
+        return 1;
+    }
+
+    // Otherwise the entry moves to the back of the new level's queue, keeping its IDs and timestamp
+    order.price = price;
+    order.quantity = quantity;
+    OrderSlot moved;
+    if (!OrderBookLevel_push_order(level, &order, &moved)) {
+        remove_level_if_empty(side, level);
+        return 0;
+    }
+    if (level != old_level) level_changed(side, level);
+
+    OrderBookLevel_unlink_order(old_level, *slot);
+    *slot = moved;
+    if (OrderBookLevel_needs_compaction(old_level)) OrderBookLevel_compact(old_level, reindex_order, side);
+    level_changed(side, old_level);
+    remove_level_if_empty(side, old_level);
+    return 1;
 }
 
-int OrderBookSide_delete_order_by_id(OrderBookSide side, const char *order_id) {
-    if (!side || !order_id) return 0;
+int OrderBookSide_delete_orders_for_user(OrderBookSide side, uint32_t user_id, OrderBookSide_OrderVisitor visitor, void *context) {
+    if (!side || user_id >= side->user_heads_size) return 0;
 
-    OrderBookLevel level = NULL;
-    if (!(level = HashTable_get(side->order_lookup, order_id))) return 0;
+    // Unlink every order first, then settle each level it left once: aggregates patched,
+    // gaps compacted and emptied levels dropped per level rather than per order
+    int deleted = 0;
+    size_t touched = 0;
+    uint32_t order_id = side->user_heads[user_id];
+    while (order_id) {
+        uint32_t next = side->user_links[order_id].next;
+        OrderSlot *slot = &side->order_index[order_id];
+        if (visitor) {
+            struct BookOrder order;
+            OrderBookLevel_read_order(*slot, &order);
+            if (!visitor(context, &order)) break;
+        }
+
+        OrderBookLevel level = slot->level;
+        OrderBookLevel_unlink_order(level, *slot);
+        slot->level = NULL;
+        unlink_user(side, order_id);
+        deleted++;
+        order_id = next;
+
+        // A user's orders at one price tend to sit next to each other in the list
+        if (touched > 0 && side->touched[touched - 1] == level) continue;
+        if (touched == side->touched_capacity && !grow_touched(side)) {
+            // Without room to defer more levels, settle the ones so far and this one now
+            finish_touched_levels(side, side->touched, touched);
+            finish_touched_levels(side, &level, 1);
+            touched = 0;
+            continue;
+        }
+        side->touched[touched++] = level;
+    }
+
+    finish_touched_levels(side, side->touched, touched);
+    return deleted;
+}
+
+// Collects fills into an array of filled order records for OrderBookSide_execute_against
+struct FillCollector {
+    OrderBookSide side;
+    BookOrder *fills;
+    int count;
+    int capacity;
+};
+
+static int collect_fill(void *context, const BookOrder maker, int filled_quantity) {
+    struct FillCollector *collector = context;
+    OrderBookSide side = collector->side;
+
+    if (collector->count == collector->capacity) {
+        int new_capacity = collector->capacity ? collector->capacity * 2 : 8;
+        BookOrder *new_fills = realloc(collector->fills, new_capacity * sizeof(BookOrder));
+        if (!new_fills) return 0;
+        collector->fills = new_fills;
+        collector->capacity = new_capacity;
+    }
 
-    if (!OrderBookLevel_delete_order_by_id(level, order_id)) return 0;
+    BookOrder filled_order = side->fill_pool ? Pool_alloc(side->fill_pool) : malloc(sizeof(struct BookOrder));
+    if (!filled_order) return 0;
+    memcpy(filled_order, maker, sizeof(struct BookOrder));
+    filled_order->quantity = filled_quantity;
 
-    HashTable_remove(side->order_lookup, order_id);
+    collector->fills[collector->count++] = filled_order;
     return 1;
 }
 
-int OrderBookSide_execute_against(OrderBookSide side, Order order, Order **filled_orders, int *filled_count) {
+int OrderBookSide_execute_against(OrderBookSide side, BookOrder order, BookOrder **filled_orders, int *filled_count) {
     if (!side || !order || !filled_orders || !filled_count) return 0;
 
-    *filled_orders = NULL;
-    *filled_count = 0;
+    struct FillCollector collector = { side, NULL, 0, 0 };
+    int ok = OrderBookSide_execute_with_handler(side, order, collect_fill, &collector);
+
+    *filled_orders = collector.fills;
+    *filled_count = collector.count;
+    return ok;
+}
+
+int OrderBookSide_execute_with_handler(OrderBookSide side, BookOrder order, OrderBookSide_FillHandler handler, void *context) {
+    if (!side || !order || !handler) return 0;
 
     double price;
     OrderBookLevel level;
 
-    while (order->quantity > 0 && OrderedMap_size(side->levels) > 0) {
-        if (side->is_buy_side) {
-            OrderedMap_get_max(side->levels, &price, (void **)&level);
-        } else {
-            OrderedMap_get_min(side->levels, &price, (void **)&level);
-        }
+    while (order->quantity > 0 && (level = get_best_level(side, &price))) {
+        if (!crosses(side, price, order->price)) break;
 
-        if (!compare_prices(price, order->price, side->is_buy_side)) break;
+        int traded = 0; // Whether any fill at this level was applied
+        INSTRUMENT_COUNT(INSTRUMENT_LEVELS_TOUCHED, 1);
+        OrderSlot front;
+        struct BookOrder maker;
+        // The front of a non-empty level is always live, so this stops only once the level empties
+        while (order->quantity > 0 && OrderBookLevel_front(level, &front) && OrderBookLevel_read_order(front, &maker)) {
+            INSTRUMENT_COUNT(INSTRUMENT_NODES_WALKED, 1);
 
-        while (order->quantity > 0 && !OrderBookLevel_is_empty(level)) {
-            Order other;
-            OrderBookLevel_get_order(level, &other);
+            int filled_quantity = maker.quantity < order->quantity ? maker.quantity : order->quantity;
+            if (!handler(context, &maker, filled_quantity)) {
+                if (traded) level_changed(side, level);
+                return 0;
+            }
+            traded = 1;
 
-            int filled_quantity = other->quantity < order->quantity ? other->quantity : order->quantity;
             order->quantity -= filled_quantity;
-
-            Order filled_order = malloc(sizeof(struct Order));
             // If the filled order is completely filled, remove it from the level
-            if (other->quantity == filled_quantity) {
-                OrderBookLevel_remove_order(level, filled_order);
-            // Otherwise, update the filled order's quantity
+            if (maker.quantity == filled_quantity) {
+                side->order_index[maker.order_id].level = NULL;
+                unlink_user(side, maker.order_id);
+                OrderBookLevel_remove_order(level, NULL);
+            // Otherwise, reduce the filled order in place; the level adjusts its total
             } else {
-                other->quantity -= filled_quantity;
-                OrderBookLevel_reset_total_quantity(level);
-                memcpy(filled_order, other, sizeof(struct Order));
-                filled_order->quantity = filled_quantity;
+                OrderBookLevel_reduce_order(level, front, filled_quantity);
             }
-
-            *filled_orders = realloc(*filled_orders, (*filled_count + 1) * sizeof(Order)); // vec?
-            (*filled_orders)[*filled_count] = filled_order;
-            (*filled_count)++;
         }
 
-        if (OrderBookLevel_is_empty(level)) {
-            OrderedMap_remove(side->levels, price);
-            OrderBookLevel_destroy(&level);
-        }
+        level_changed(side, level);
+        remove_level_if_empty(side, level);
     }
 
     return 1;
 }
 
+void OrderBookSide_release_filled_orders(OrderBookSide side, BookOrder *filled_orders, int filled_count) {
+    if (!side || !filled_orders) return;
+
+    for (int i = 0; i < filled_count; i++) {
+        if (side->fill_pool) {
+            Pool_free(side->fill_pool, filled_orders[i]);
+        } else {
+            free(filled_orders[i]);
+        }
+    }
+    free(filled_orders);
+}
+
 double OrderBookSide_get_best_price(OrderBookSide side) {
-    if (!side || OrderedMap_size(side->levels) == 0) return 0.0;
+    if (!side || !side->best_level) return 0.0;
+    return side->best_price;
+}
+
+int OrderBookSide_crosses_best(OrderBookSide side, double price) {
+    if (!side || !side->best_level) return 0;
+    return crosses(side, side->best_price, price);
+}
+
+int OrderBookSide_can_fill(OrderBookSide side, double price, long quantity) {
+    struct OrderBookFillEstimate estimate;
+    if (!OrderBookSide_estimate_fill(side, quantity, &estimate) || estimate.quantity < quantity) return 0;
+
+    // Levels are taken best first, so the quantity trades if the last level it needs crosses
+    return estimate.levels == 0 || crosses(side, estimate.worst_price, price);
+}
+
+int OrderBookSide_can_rest_at(OrderBookSide side, double price) {
+    if (!side) return 0;
+    if (!side->ladder) return 1;
+
+    long index = price_to_tick(side, price) - side->min_tick;
+    return index >= 0 && index < side->ladder_size;
+}
+
+void OrderBookSide_prefetch_level(OrderBookSide side, double price) {
+    if (!side) return;
+    if (!side->ladder) {
+        OrderedMap_prefetch(side->levels, price);
+        return;
+    }
+
+    long index = price_to_tick(side, price) - side->min_tick;
+    if (index < 0 || index >= side->ladder_size) return;
+    OrderBookLevel level = side->ladder[index];
+    if (level) PREFETCH(level);
+}
+
+int OrderBookSide_estimate_fill(OrderBookSide side, long quantity, struct OrderBookFillEstimate *estimate) {
+    if (!side || !estimate || quantity < 0) return 0;
+    memset(estimate, 0, sizeof(*estimate));
+    if (quantity == 0 || !side->best_level) return 1;
+
+    if (side->ladder) {
+        estimate_ladder_fill(side, quantity, estimate);
+        return 1;
+    }
+
+    OrderedMapCursor cursor;
+    if (side->is_buy_side) {
+        OrderedMap_cursor_back(side->levels, &cursor);
+    } else {
+        OrderedMap_cursor_front(side->levels, &cursor);
+    }
+    int (*iterate)(OrderedMapCursor *) = side->is_buy_side ? OrderedMapCursor_prev : OrderedMapCursor_next;
+
+    double price;
+    OrderBookLevel level;
+    long remaining = quantity;
+    while (remaining > 0 && OrderedMapCursor_get(&cursor, &price, (void **)&level)) {
+        long size = OrderBookLevel_get_total_quantity(level);
+        if (size > 0) {
+            long take = size < remaining ? size : remaining;
+            remaining -= take;
+            estimate->notional += take * price;
+            estimate->worst_price = price;
+            estimate->levels++;
+        }
+        if (!iterate(&cursor)) break;
+    }
+    estimate->quantity = quantity - remaining;
+    if (estimate->quantity > 0) estimate->vwap = estimate->notional / estimate->quantity;
+    return 1;
+}
+
+long OrderBookSide_size_through_price(OrderBookSide side, double price) {
+    if (!side || !side->best_level) return 0;
 
-    double best_price;
+    if (side->ladder) {
+        // Slots from the best one to the limit's tick, clamped to the band
+        long limit = price_to_tick(side, price) - side->min_tick;
+        if (side->is_buy_side) {
+            if (limit < 0) limit = 0;
+            return ladder_size_between(side, limit, side->best_index);
+        }
+        if (limit >= side->ladder_size) limit = side->ladder_size - 1;
+        return ladder_size_between(side, side->best_index, limit);
+    }
+
+    OrderedMapCursor cursor;
     if (side->is_buy_side) {
-        OrderedMap_get_max(side->levels, &best_price, NULL);
+        OrderedMap_cursor_back(side->levels, &cursor);
     } else {
-        OrderedMap_get_min(side->levels, &best_price, NULL);
+        OrderedMap_cursor_front(side->levels, &cursor);
+    }
+    int (*iterate)(OrderedMapCursor *) = side->is_buy_side ? OrderedMapCursor_prev : OrderedMapCursor_next;
+
+    double level_price;
+    OrderBookLevel level;
+    long total = 0;
+    while (OrderedMapCursor_get(&cursor, &level_price, (void **)&level) && crosses(side, level_price, price)) {
+        total += OrderBookLevel_get_total_quantity(level);
+        if (!iterate(&cursor)) break;
     }
+    return total;
+}
+
+void OrderBookSide_set_level_listener(OrderBookSide side, OrderBookSide_LevelListener listener, void *context) {
+    if (!side) return;
+    side->level_listener = listener;
+    side->listener_context = context;
+}
 
-    return best_price;
+const struct OrderBookLevelView *OrderBookSide_peek_levels(OrderBookSide side, int *level_count) {
+    if (level_count) *level_count = side ? side->top_count : 0;
+    return side ? side->top : NULL;
 }
 
 int OrderBookSide_get_levels(OrderBookSide side, int k, struct OrderBookLevelView **levels, int *level_count) {
-    if (!side || !levels || !level_count) return 0;
+    if (!side || !levels || !level_count || k < 0) return 0;
 
     *levels = NULL;
-    *level_count = k;
+    *level_count = 0;
 
-    if (k == 0) {
-        *level_count = OrderedMap_size(side->levels);
-    }
-    *levels = malloc(*level_count * sizeof(struct OrderBookLevelView));
+    // Never size the array (or report a count) beyond the levels that exist
+    int capacity = (int)count_levels(side);
+    if (k > 0 && k < capacity) capacity = k;
+    *levels = malloc((capacity ? capacity : 1) * sizeof(struct OrderBookLevelView));
     if (!*levels) return 0;
 
     double price;
     OrderBookLevel level;
     int i = 0;
 
-    OrderedMapIterator iter = side->is_buy_side ? OrderedMap_back(side->levels) : OrderedMap_front(side->levels);
-    //function pointer to OrderedMapIterator_prev if buy side, OrderedMapIterator_next if sell side
-    int (*iterate)(OrderedMapIterator) = side->is_buy_side ? OrderedMapIterator_prev : OrderedMapIterator_next;
+    if (side->ladder) {
+        for (long index = side->best_index; index >= 0 && i < capacity; index = next_ladder_index(side, index)) {
+            fill_view(side->ladder[index], &(*levels)[i]);
+            i++;
+        }
+        *level_count = i;
+        return 1;
+    }
+
+    OrderedMapCursor cursor;
+    if (side->is_buy_side) {
+        OrderedMap_cursor_back(side->levels, &cursor);
+    } else {
+        OrderedMap_cursor_front(side->levels, &cursor);
+    }
+    //function pointer to OrderedMapCursor_prev if buy side, OrderedMapCursor_next if sell side
+    int (*iterate)(OrderedMapCursor *) = side->is_buy_side ? OrderedMapCursor_prev : OrderedMapCursor_next;
 
 
-    while (i < *level_count) {
-        if (!OrderedMapIterator_get(iter, &price, (void **)&level)) break;
+    while (i < capacity) {
+        if (!OrderedMapCursor_get(&cursor, &price, (void **)&level)) break;
 
-        (*levels)[i].price = price;
-        (*levels)[i].size = OrderBookLevel_get_total_quantity(level);
+        fill_view(level, &(*levels)[i]);
 
-        iterate(iter);
+        iterate(&cursor);
         i++;
     }
-    OrderedMapIterator_destroy(&iter);
 
+    *level_count = i;
+    return 1;
+}
+
+int OrderBookSide_for_each_order(OrderBookSide side, OrderBookSide_OrderVisitor visitor, void *context) {
+    if (!side || !visitor) return 0;
+
+    if (side->ladder) {
+        for (long index = side->best_index; index >= 0; index = next_ladder_index(side, index)) {
+            if (!visit_level(side->ladder[index], visitor, context)) return 0;
+        }
+        return 1;
+    }
+
+    OrderedMapCursor cursor;
+    if (side->is_buy_side) {
+        OrderedMap_cursor_back(side->levels, &cursor);
+    } else {
+        OrderedMap_cursor_front(side->levels, &cursor);
+    }
+    int (*iterate)(OrderedMapCursor *) = side->is_buy_side ? OrderedMapCursor_prev : OrderedMapCursor_next;
+
+    double price;
+    OrderBookLevel level;
+    while (OrderedMapCursor_get(&cursor, &price, (void **)&level)) {
+        if (!visit_level(level, visitor, context)) return 0;
+        iterate(&cursor);
+    }
+    return 1;
+}
+
+int OrderBookSide_get_memory_usage(const OrderBookSide side, struct OrderBookSideMemory *usage) {
+    if (!side || !usage) return 0;
+
+    usage->level_bytes = 0;
+    usage->order_bytes = side->index_size * (sizeof(OrderSlot) + sizeof(struct UserLink)) +
+                         side->user_heads_size * sizeof(uint32_t);
+    usage->other_bytes = sizeof(struct OrderBookSide) + side->top_capacity * sizeof(struct OrderBookLevelView) +
+                         side->touched_capacity * sizeof(OrderBookLevel);
+    // Levels taken from the pool are counted by its owner
+    size_t level_block = side->level_pool ? 0 : OrderBookLevel_block_size();
+
+    if (side->ladder) {
+        usage->level_bytes += side->ladder_size * (sizeof(OrderBookLevel) + sizeof(int));
+        for (long i = 0; i < side->ladder_size; i++) {
+            if (!side->ladder[i]) continue;
+            usage->level_bytes += level_block;
+            usage->order_bytes += OrderBookLevel_queue_bytes(side->ladder[i]);
+        }
+        return 1;
+    }
+
+    usage->level_bytes += OrderedMap_memory_usage(side->levels) + OrderedMap_size(side->levels) * level_block;
+    OrderedMapCursor cursor;
+    double price;
+    OrderBookLevel level;
+    OrderedMap_cursor_front(side->levels, &cursor);
+    while (OrderedMapCursor_get(&cursor, &price, (void **)&level)) {
+        usage->order_bytes += OrderBookLevel_queue_bytes(level);
+        OrderedMapCursor_next(&cursor);
+    }
     return 1;
 }
 
@@ -209,3 +682,422 @@ int OrderBookSide_get_levels(OrderBookSide side, int k, struct OrderBookLevelVie
 static int compare_prices(double price1, double price2, int is_buy_side) {
     return is_buy_side ? price1 >= price2 : price1 <= price2;
 }
+
+// Number of non-empty levels on the side
+static size_t count_levels(OrderBookSide side) {
+    return side->ladder ? side->level_count : OrderedMap_size(side->levels);
+}
+
+// Visits a level's orders front to back; returns 0 if the visitor stopped
+static int visit_level(OrderBookLevel level, OrderBookSide_OrderVisitor visitor, void *context) {
+    OrderSlot slot;
+    struct BookOrder order;
+    int more = OrderBookLevel_front(level, &slot);
+    while (more) {
+        OrderBookLevel_read_order(slot, &order);
+        if (!visitor(context, &order)) return 0;
+        more = OrderBookLevel_next(&slot);
+    }
+    return 1;
+}
+
+// Returns the level for price, creating it if needed, or NULL on failure (or outside a ladder's band)
+static OrderBookLevel find_or_create_level(OrderBookSide side, double price) {
+    OrderBookLevel level = NULL;
+
+    if (!side->ladder) {
+        if (!OrderedMap_get(side->levels, price, (void **)&level)) {
+            level = OrderBookLevel_create_with_pool(price, side->level_pool);
+            if (!level) return NULL;
+            if (!OrderedMap_insert(side->levels, price, level)) {
+                OrderBookLevel_destroy(&level);
+                return NULL;
+            }
+            if (!side->best_level || compare_prices(price, side->best_price, side->is_buy_side)) {
+                set_best_level(side, level);
+            }
+        }
+        return level;
+    }
+
+    long tick = price_to_tick(side, price);
+    long index = tick - side->min_tick;
+    if (index < 0 || index >= side->ladder_size) return NULL;
+
+    if (!side->ladder[index]) {
+        side->ladder[index] = OrderBookLevel_create_with_pool(tick_to_price(side, tick), side->level_pool);
+        if (!side->ladder[index]) return NULL;
+    }
+    level = side->ladder[index];
+
+    if (OrderBookLevel_is_empty(level)) {
+        side->level_count++;
+        if (side->best_index < 0 ||
+            (side->is_buy_side ? index > side->best_index : index < side->best_index)) {
+            side->best_index = index;
+            set_best_level(side, level);
+        }
+    }
+    return level;
+}
+
+// Returns the most competitive level and its price, or NULL if the side is empty
+static OrderBookLevel get_best_level(OrderBookSide side, double *price) {
+    if (price && side->best_level) *price = side->best_price;
+    return side->best_level;
+}
+
+// Whether an incoming order at order_price can trade with a level on this side at level_price
+static int crosses(OrderBookSide side, double level_price, double order_price) {
+    if (side->ladder) {
+        long level_tick = price_to_tick(side, level_price);
+        long order_tick = price_to_tick(side, order_price);
+        return side->is_buy_side ? level_tick >= order_tick : level_tick <= order_tick;
+    }
+    return compare_prices(level_price, order_price, side->is_buy_side);
+}
+
+// Drops a level from the side once its last order has gone
+static void remove_level_if_empty(OrderBookSide side, OrderBookLevel level) {
+    if (!OrderBookLevel_is_empty(level)) return;
+
+    if (!side->ladder) {
+        OrderedMap_remove(side->levels, OrderBookLevel_get_price(level));
+        if (level == side->best_level) {
+            // Only losing the best level needs a descent to find the new one
+            OrderBookLevel next = NULL;
+            if (side->is_buy_side) {
+                OrderedMap_get_max(side->levels, NULL, (void **)&next);
+            } else {
+                OrderedMap_get_min(side->levels, NULL, (void **)&next);
+            }
+            set_best_level(side, next);
+        }
+        OrderBookLevel_destroy(&level);
+        return;
+    }
+
+    // Ladder levels stay allocated; only the count and cached best move
+    long index = price_to_tick(side, OrderBookLevel_get_price(level)) - side->min_tick;
+    side->level_count--;
+    if (index == side->best_index) {
+        side->best_index = side->level_count ? next_ladder_index(side, index) : -1;
+        set_best_level(side, side->best_index >= 0 ? side->ladder[side->best_index] : NULL);
+    }
+}
+
+// Brings the slot sizes, the depth cache and the listener up to date with a level whose
+// quantity changed. Called while the level is still on the side, even if it has just become empty.
+static void level_changed(OrderBookSide side, OrderBookLevel level) {
+    if (side->ladder_sizes) {
+        long index = price_to_tick(side, OrderBookLevel_get_price(level)) - side->min_tick;
+        side->ladder_sizes[index] = OrderBookLevel_get_total_quantity(level);
+    }
+    if (!side->top && !side->level_listener) return;
+
+    struct OrderBookLevelView view;
+    fill_view(level, &view);
+    if (side->top) update_top(side, &view);
+    if (side->level_listener) side->level_listener(side->listener_context, &view);
+}
+
+// Patches the depth cache for a level now holding view->size (0 if it is going away)
+static void update_top(OrderBookSide side, const struct OrderBookLevelView *view) {
+    struct OrderBookLevelView *top = side->top;
+    double price = view->price;
+    int i = 0;
+    while (i < side->top_count && top[i].price != price) i++;
+
+    if (i < side->top_count) {
+        if (view->size > 0) {
+            top[i] = *view;
+            return;
+        }
+        // A cached level emptied: close the gap and pull in the best level below the cache
+        memmove(&top[i], &top[i + 1], (side->top_count - i - 1) * sizeof(top[0]));
+        side->top_count--;
+        double anchor = side->top_count ? top[side->top_count - 1].price : price;
+        if (next_level_after(side, anchor, &top[side->top_count])) side->top_count++;
+        return;
+    }
+
+    // Every level is cached while the cache has room, so an uncached level is new here,
+    // or lies below a full cache and only matters if it beats the last cached level
+    if (view->size == 0) return;
+    if (side->top_count == side->top_capacity) {
+        if (!compare_prices(price, top[side->top_count - 1].price, side->is_buy_side)) return;
+        side->top_count--;
+    }
+    for (i = side->top_count; i > 0 && compare_prices(price, top[i - 1].price, side->is_buy_side); i--) {
+        top[i] = top[i - 1];
+    }
+    top[i] = *view;
+    side->top_count++;
+}
+
+// Finds the best non-empty level less competitive than price, which must be on the side
+static int next_level_after(OrderBookSide side, double price, struct OrderBookLevelView *view) {
+    OrderBookLevel level = NULL;
+    if (side->ladder) {
+        long index = next_ladder_index(side, price_to_tick(side, price) - side->min_tick);
+        if (index >= 0) level = side->ladder[index];
+    } else {
+        OrderedMapCursor cursor;
+        if (OrderedMap_cursor_find(side->levels, price, &cursor)) {
+            int (*iterate)(OrderedMapCursor *) = side->is_buy_side ? OrderedMapCursor_prev : OrderedMapCursor_next;
+            while (iterate(&cursor) && OrderedMapCursor_get(&cursor, NULL, (void **)&level) &&
+                   OrderBookLevel_is_empty(level)) {
+                level = NULL;
+            }
+        }
+    }
+    if (!level || OrderBookLevel_is_empty(level)) return 0;
+
+    fill_view(level, view);
+    return 1;
+}
+
+// Copies a level's price and aggregates into a view; O(1), the level keeps them current
+static void fill_view(OrderBookLevel level, struct OrderBookLevelView *view) {
+    view->price = OrderBookLevel_get_price(level);
+    view->size = OrderBookLevel_get_total_quantity(level);
+    view->order_count = OrderBookLevel_get_order_count(level);
+}
+
+// Nearest tick to price; prices between ticks are snapped
+static long price_to_tick(OrderBookSide side, double price) {
+    return lround(price * side->ticks_per_unit);
+}
+
+static double tick_to_price(OrderBookSide side, long tick) {
+    // Dividing by a whole number of ticks per unit rounds correctly for decimal ticks like 0.01
+    double whole = round(side->ticks_per_unit);
+    if (fabs(side->ticks_per_unit - whole) < 1e-9) return tick / whole;
+    return tick * side->tick_size;
+}
+
+// Next non-empty ladder index less competitive than index, or -1 if there is none
+static long next_ladder_index(OrderBookSide side, long index) {
+    long step = side->is_buy_side ? -1 : 1;
+    for (index += step; index >= 0 && index < side->ladder_size; index += step) {
+        if (side->ladder[index] && !OrderBookLevel_is_empty(side->ladder[index])) return index;
+    }
+    return -1;
+}
+
+// Updates the cached best level; NULL marks the side as empty
+static void set_best_level(OrderBookSide side, OrderBookLevel level) {
+    side->best_level = level;
+    side->best_price = level ? OrderBookLevel_get_price(level) : 0.0;
+}
+
+// Index entry of the resting order with the given ID handle, or NULL if none rests
+static OrderSlot *find_order(OrderBookSide side, uint32_t order_id) {
+    if (order_id >= side->index_size || !side->order_index[order_id].level) return NULL;
+    return &side->order_index[order_id];
+}
+
+// Records slot as the resting order for order_id, growing the index to cover the handle
+static int index_order(OrderBookSide side, uint32_t order_id, OrderSlot slot) {
+    if (order_id >= side->index_size) {
+        size_t new_size = side->index_size ? side->index_size : 1024;
+        while (new_size <= order_id) new_size *= 2;
+        OrderSlot *new_index = realloc(side->order_index, new_size * sizeof(OrderSlot));
+        if (!new_index) return 0;
+        memset(new_index + side->index_size, 0, (new_size - side->index_size) * sizeof(OrderSlot));
+        side->order_index = new_index;
+        struct UserLink *new_links = realloc(side->user_links, new_size * sizeof(struct UserLink));
+        if (!new_links) return 0;
+        side->user_links = new_links;
+        side->index_size = new_size;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+    side->order_index[order_id] = slot;
+    return 1;
+}
+
+// Follows an order moved by level compaction
+static void reindex_order(void *context, uint32_t order_id, OrderSlot slot) {
+    OrderBookSide side = context;
+    side->order_index[order_id] = slot;
+}
+
+// Sweeps a ladder side from its best slot for quantity. Whole blocks are taken while they
+// hold less than what remains; the block that holds the rest is walked slot by slot.
+static void estimate_ladder_fill(OrderBookSide side, long quantity, struct OrderBookFillEstimate *estimate) {
+    const int *sizes = side->ladder_sizes;
+    long step = side->is_buy_side ? -1 : 1;
+    long best = side->best_index;
+    long index = best;
+    long remaining = quantity;
+    int64_t offsets = 0; // Sum of |slot - best| * quantity taken
+    long last = best;
+    size_t levels_left = side->level_count; // Stops the sweep at the worst level, not the band's edge
+
+    while (remaining > 0 && levels_left > 0 && index >= 0 && index < side->ladder_size) {
+        long first = step > 0 ? index : index - (SLOT_BLOCK - 1);
+        if (first >= 0 && first + SLOT_BLOCK <= side->ladder_size) {
+            struct SlotBlock block;
+            side->sum_slots(sizes + first, &block);
+            if (block.size < remaining) {
+                remaining -= block.size;
+                if (step > 0) {
+                    offsets += (first - best) * block.size + block.weighted;
+                } else {
+                    offsets += (best - first) * block.size - block.weighted;
+                }
+                for (int j = 0; j < SLOT_BLOCK; j++) {
+                    long slot = step > 0 ? first + j : first + SLOT_BLOCK - 1 - j; // In sweep order
+                    if (!(block.nonempty & (1u << (slot - first)))) continue;
+                    estimate->levels++;
+                    levels_left--;
+                    last = slot;
+                }
+                index += step * SLOT_BLOCK;
+                continue;
+            }
+        }
+
+        // This block holds the rest (or the band has no whole block left): walk it slot by slot
+        for (int j = 0; j < SLOT_BLOCK && remaining > 0 && levels_left > 0 && index >= 0 && index < side->ladder_size;
+             j++, index += step) {
+            if (sizes[index] <= 0) continue;
+            long take = sizes[index] < remaining ? sizes[index] : remaining;
+            remaining -= take;
+            offsets += (index - best) * step * take;
+            estimate->levels++;
+            levels_left--;
+            last = index;
+        }
+    }
+
+    // Prices are linear in the slot, so the sweep is the best price plus the average offset
+    estimate->quantity = quantity - remaining;
+    double best_price = tick_to_price(side, side->min_tick + best);
+    estimate->notional = best_price * estimate->quantity + step * side->tick_size * (double)offsets;
+    estimate->vwap = estimate->notional / estimate->quantity;
+    estimate->worst_price = tick_to_price(side, side->min_tick + last);
+}
+
+// Total quantity in ladder slots first..last (inclusive; 0 if the range is empty)
+static long ladder_size_between(OrderBookSide side, long first, long last) {
+    long total = 0;
+    long index = first;
+    struct SlotBlock block;
+    for (; index + SLOT_BLOCK - 1 <= last; index += SLOT_BLOCK) {
+        side->sum_slots(side->ladder_sizes + index, &block);
+        total += block.size;
+    }
+    for (; index <= last; index++) total += side->ladder_sizes[index];
+    return total;
+}
+
+static void sum_slots_scalar(const int *sizes, struct SlotBlock *block) {
+    block->size = 0;
+    block->weighted = 0;
+    block->nonempty = 0;
+    for (int j = 0; j < SLOT_BLOCK; j++) {
+        block->size += sizes[j];
+        block->weighted += (int64_t)j * sizes[j];
+        if (sizes[j] > 0) block->nonempty |= 1u << j;
+    }
+}
+
+#ifdef HAVE_AVX2_BLOCKS
+// The same sums with the eight slots widened to two vectors of four 64-bit lanes
+__attribute__((target("avx2")))
+static void sum_slots_avx2(const int *sizes, struct SlotBlock *block) {
+    __m256i slots = _mm256_loadu_si256((const __m256i *)sizes);
+    __m256i low = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(slots));
+    __m256i high = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(slots, 1));
+
+    __m256i size = _mm256_add_epi64(low, high);
+    __m256i weighted = _mm256_add_epi64(_mm256_mul_epi32(low, _mm256_setr_epi64x(0, 1, 2, 3)),
+                                        _mm256_mul_epi32(high, _mm256_setr_epi64x(4, 5, 6, 7)));
+    __m128i size2 = _mm_add_epi64(_mm256_castsi256_si128(size), _mm256_extracti128_si256(size, 1));
+    __m128i weighted2 = _mm_add_epi64(_mm256_castsi256_si128(weighted), _mm256_extracti128_si256(weighted, 1));
+
+    block->size = _mm_cvtsi128_si64(size2) + _mm_extract_epi64(size2, 1);
+    block->weighted = _mm_cvtsi128_si64(weighted2) + _mm_extract_epi64(weighted2, 1);
+    block->nonempty = (unsigned)_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(slots, _mm256_setzero_si256())));
+}
+#endif
+
+// AVX2 kernel if this CPU runs it, the portable loop otherwise
+static SumSlotsFn pick_sum_slots(void) {
+#ifdef HAVE_AVX2_BLOCKS
+    if (__builtin_cpu_supports("avx2")) return sum_slots_avx2;
+#endif
+    return sum_slots_scalar;
+}
+
+// Puts an order at the head of its user's list on this side, growing the heads if needed
+static int link_user(OrderBookSide side, uint32_t order_id, uint32_t user_id) {
+    if (user_id >= side->user_heads_size) {
+        size_t new_size = side->user_heads_size ? side->user_heads_size : 1024;
+        while (new_size <= user_id) new_size *= 2;
+        uint32_t *new_heads = realloc(side->user_heads, new_size * sizeof(uint32_t));
+        if (!new_heads) return 0;
+        memset(new_heads + side->user_heads_size, 0, (new_size - side->user_heads_size) * sizeof(uint32_t));
+        side->user_heads = new_heads;
+        side->user_heads_size = new_size;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+
+    // New orders go at the head; a user's list is never walked in time order
+    uint32_t head = side->user_heads[user_id];
+    side->user_links[order_id] = (struct UserLink){ user_id, 0, head };
+    if (head) side->user_links[head].prev = order_id;
+    side->user_heads[user_id] = order_id;
+    return 1;
+}
+
+// Takes an order out of its user's list
+static void unlink_user(OrderBookSide side, uint32_t order_id) {
+    struct UserLink *link = &side->user_links[order_id];
+    if (link->prev) {
+        side->user_links[link->prev].next = link->next;
+    } else {
+        side->user_heads[link->user_id] = link->next;
+    }
+    if (link->next) side->user_links[link->next].prev = link->prev;
+}
+
+// Doubles the scratch array of levels a mass delete has touched
+static int grow_touched(OrderBookSide side) {
+    size_t new_capacity = side->touched_capacity ? side->touched_capacity * 2 : 64;
+    OrderBookLevel *new_touched = realloc(side->touched, new_capacity * sizeof(OrderBookLevel));
+    if (!new_touched) return 0;
+    side->touched = new_touched;
+    side->touched_capacity = new_capacity;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    return 1;
+}
+
+// Settles levels a mass delete has unlinked orders from, once each however many orders
+// left them. Every level's view is patched before any level is dropped, so a depth cache
+// refilling from below steps over levels that emptied but are still mapped.
+static void finish_touched_levels(OrderBookSide side, OrderBookLevel *levels, size_t count) {
+    if (count == 0) return;
+
+    qsort(levels, count, sizeof(OrderBookLevel), compare_levels);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || levels[unique - 1] != levels[i]) levels[unique++] = levels[i];
+    }
+    for (size_t i = 0; i < unique; i++) {
+        if (OrderBookLevel_needs_compaction(levels[i])) OrderBookLevel_compact(levels[i], reindex_order, side);
+        level_changed(side, levels[i]);
+    }
+    for (size_t i = 0; i < unique; i++) {
+        remove_level_if_empty(side, levels[i]);
+    }
+}
+
+// Orders levels by address, so qsort puts repeats of a level next to each other
+static int compare_levels(const void *a, const void *b) {
+    uintptr_t left = (uintptr_t)*(const OrderBookLevel *)a;
+    uintptr_t right = (uintptr_t)*(const OrderBookLevel *)b;
+    return (left > right) - (left < right);
+}
@@ -4,6 +4,15 @@
  * (buy or sell) of an order book. It organizes orders into price levels using an
  * OrderedMap and provides functionality to execute trades and manage orders.
  *
+ * Orders are BookOrders: their order and user IDs are integer handles interned by the
+ * caller (the OrderBook), and the side indexes resting orders by order ID handle.
+ *
+ * A side can instead be created as a price ladder: levels live in a contiguous array
+ * indexed by integer tick over a fixed price band, which makes best-price lookups O(1)
+ * and keys prices by tick rather than by exact double equality. A ladder side answers depth
+ * queries (OrderBookSide_estimate_fill, OrderBookSide_size_through_price) by scanning a
+ * flat vector of slot sizes with SIMD where the CPU supports it.
+ *
  * Author: Adam Rubinstein
  * Date: January 2025
  */
@@ -18,7 +27,34 @@ typedef struct OrderBookSide *OrderBookSide;
 
 struct OrderBookLevelView {
     double price;
-    int size;
+    int size;         /**< Total quantity resting at price. */
+    int order_count;  /**< Number of orders resting at price. */
+};
+
+/* What sweeping a side for a quantity would do, as computed by OrderBookSide_estimate_fill. */
+struct OrderBookFillEstimate {
+    long quantity;      /**< Quantity available, at most the quantity asked for. */
+    double notional;    /**< Sum of price * quantity over what is available. */
+    double vwap;        /**< notional / quantity, or 0 if nothing is available. */
+    double worst_price; /**< Price of the least competitive level reached, or 0 if nothing is available. */
+    int levels;         /**< Number of non-empty levels reached. */
+};
+
+/* Optional settings for OrderBookSide_create_with_config.
+ * A zeroed config gives the same side as OrderBookSide_create.
+ */
+struct OrderBookSideConfig {
+    Pool level_pool; /**< Pool for price levels (OrderBookLevel_block_size() blocks), or NULL for malloc. */
+    Pool fill_pool; /**< Pool for filled order records (sizeof(struct BookOrder) blocks), or NULL for malloc. */
+
+    /* Price ladder. If tick_size > 0 levels are stored by tick over [min_price, max_price];
+     * order prices are snapped to the nearest tick and orders outside the band are rejected.
+     * If tick_size is 0 levels are stored in an OrderedMap keyed by exact price. */
+    double tick_size; /**< Price increment between ladder levels, or 0 for an OrderedMap side. */
+    double min_price; /**< Lowest price of the ladder band. */
+    double max_price; /**< Highest price of the ladder band. */
+
+    int depth_cache; /**< Number of best levels to keep in a cache for OrderBookSide_peek_levels (0 for none). */
 };
 
 /**
@@ -29,6 +65,15 @@ struct OrderBookLevelView {
  */
 OrderBookSide OrderBookSide_create(int is_buy_side);
 
+/**
+ * Creates a new OrderBookSide instance with the given settings.
+ *
+ * @param is_buy_side 1 if this side is for bids, 0 if for asks.
+ * @param config Settings for the side, or NULL for defaults. The side does not take ownership of any pools.
+ * @return Newly allocated OrderBookSide instance, or NULL on failure.
+ */
+OrderBookSide OrderBookSide_create_with_config(int is_buy_side, const struct OrderBookSideConfig *config);
+
 /**
  * Destroys an OrderBookSide instance, freeing all associated memory.
  *
@@ -43,37 +88,92 @@ void OrderBookSide_destroy(OrderBookSide *side);
  * @param order Order to add (copied internally).
  * @return 1 if the operation is successful, 0 on failure.
  */
-int OrderBookSide_add_order(OrderBookSide side, const Order order);
+int OrderBookSide_add_order(OrderBookSide side, const BookOrder order);
 
 /**
  * Gets an order by its ID.
  *
  * @param side The OrderBookSide instance.
- * @param order_id The unique ID of the order to retrieve.
- * @param order Output pointer to store the retrieved order (if found).
+ * @param order_id The interned ID of the order to retrieve.
+ * @param order Output copy of the retrieved order (if not NULL).
  * @return 1 if the order exists, 0 otherwise.
  */
-int OrderBookSide_get_order_by_id(OrderBookSide side, const char *order_id, Order *order);
+int OrderBookSide_get_order_by_id(OrderBookSide side, uint32_t order_id, BookOrder order);
 
 /**
  * Deletes an order by its ID.
  *
  * @param side The OrderBookSide instance.
- * @param order_id The unique ID of the order to delete.
+ * @param order_id The interned ID of the order to delete.
  * @return 1 if the order was successfully deleted, 0 otherwise.
  */
-int OrderBookSide_delete_order_by_id(OrderBookSide side, const char *order_id);
+int OrderBookSide_delete_order_by_id(OrderBookSide side, uint32_t order_id);
+
+/**
+ * Changes the price and quantity of a resting order without deleting and re-adding it.
+ * If the order stays on its level (the same price, or the same tick on a ladder side) and
+ * its quantity does not grow, it is reduced in place and keeps its time priority.
+ * Otherwise it moves to the back of the queue at its new level. The caller must make
+ * sure the new price does not cross the opposite side.
+ *
+ * @param side The OrderBookSide instance.
+ * @param order_id The interned ID of the order to modify.
+ * @param price The new price.
+ * @param quantity The new quantity (greater than 0).
+ * @return 1 if the order was modified, 0 if it is not on this side, the quantity is not
+ *         positive, the price is outside a ladder's band or on allocation failure; the
+ *         order is then left as it was.
+ */
+int OrderBookSide_modify_order(OrderBookSide side, uint32_t order_id, double price, int quantity);
 
 /**
  * Executes an incoming order against the most competitive orders on this side.
  *
  * @param side The OrderBookSide instance.
- * @param order The incoming Order to execute (modified in-place).
+ * @param order The incoming order to execute (modified in-place).
  * @param filled_orders Output pointer to store an array of filled orders (allocated internally).
  * @param filled_count Output pointer to store the count of filled orders.
  * @return 1 if the operation is successful, 0 on failure.
+ *
+ * @note Release the filled orders with OrderBookSide_release_filled_orders. If the side has
+ *       no fill pool, freeing each order and then the array is equivalent. On failure, any
+ *       fills already applied are still returned and must be released.
+ */
+int OrderBookSide_execute_against(OrderBookSide side, BookOrder order, BookOrder **filled_orders, int *filled_count);
+
+/**
+ * Callback invoked by OrderBookSide_execute_with_handler for each fill, before the fill
+ * is applied to the book.
+ *
+ * @param context The context pointer passed to OrderBookSide_execute_with_handler.
+ * @param maker A copy of the resting order being filled (valid only during the call).
+ *              Its quantity is the amount resting before this fill.
+ * @param filled_quantity The quantity traded in this fill.
+ * @return 1 to apply the fill and continue matching, 0 to stop without applying it.
  */
-int OrderBookSide_execute_against(OrderBookSide side, Order order, Order **filled_orders, int *filled_count);
+typedef int (*OrderBookSide_FillHandler)(void *context, const BookOrder maker, int filled_quantity);
+
+/**
+ * Executes an incoming order against the most competitive orders on this side, reporting
+ * each fill to a callback instead of allocating filled order records.
+ *
+ * @param side The OrderBookSide instance.
+ * @param order The incoming order to execute (modified in-place).
+ * @param handler Callback invoked once per fill.
+ * @param context Passed through to handler.
+ * @return 1 if the operation is successful, 0 on failure or if the handler stopped matching.
+ *         Fills applied before a stop remain applied.
+ */
+int OrderBookSide_execute_with_handler(OrderBookSide side, BookOrder order, OrderBookSide_FillHandler handler, void *context);
+
+/**
+ * Releases the filled orders returned by OrderBookSide_execute_against, and the array itself.
+ *
+ * @param side The OrderBookSide instance that produced the filled orders.
+ * @param filled_orders The array of filled orders (NULL is ignored).
+ * @param filled_count The count of filled orders.
+ */
+void OrderBookSide_release_filled_orders(OrderBookSide side, BookOrder *filled_orders, int filled_count);
 
 /**
  * Gets the best price level on this side of the order book.
@@ -83,9 +183,142 @@ int OrderBookSide_execute_against(OrderBookSide side, Order order, Order **fille
  */
 double OrderBookSide_get_best_price(OrderBookSide side);
 
+/**
+ * Checks whether an incoming order at price would trade on arrival, i.e. whether it crosses
+ * this side's best level. A ladder side compares by tick, like matching does.
+ *
+ * @param side The OrderBookSide instance.
+ * @param price The incoming order's limit price.
+ * @return 1 if the side is not empty and its best level crosses price, 0 otherwise.
+ */
+int OrderBookSide_crosses_best(OrderBookSide side, double price);
+
+/**
+ * Checks whether an incoming order at price could trade its whole quantity on arrival,
+ * without changing the side or allocating. Only the levels the quantity needs are read.
+ *
+ * @param side The OrderBookSide instance.
+ * @param price The incoming order's limit price.
+ * @param quantity The quantity to fill.
+ * @return 1 if levels crossing price hold at least quantity, 0 otherwise or on invalid arguments.
+ */
+int OrderBookSide_can_fill(OrderBookSide side, double price, long quantity);
+
+/**
+ * Checks whether an order at price could rest on this side: any price can on a map side,
+ * and on a ladder side a price whose tick lies within the band.
+ *
+ * @param side The OrderBookSide instance.
+ * @param price The order's price.
+ * @return 1 if an order at price can rest, 0 otherwise or if side is NULL.
+ */
+int OrderBookSide_can_rest_at(OrderBookSide side, double price);
+
+/**
+ * Starts loading the level for a price that an upcoming add will use, to overlap
+ * its cache misses with other work. A ladder side loads the price's slot and
+ * prefetches the level it points to; an OrderedMap side walks the top of its tree
+ * and prefetches the first node below it (see OrderedMap_prefetch).
+ *
+ * @param side The OrderBookSide instance.
+ * @param price The price of the upcoming order.
+ */
+void OrderBookSide_prefetch_level(OrderBookSide side, double price);
+
+/**
+ * Callback invoked by a side each time the total quantity resting at one of its levels
+ * changes: when an order rests on it or is deleted from it, and once per level an
+ * execution trades against (after the last fill there).
+ *
+ * @param context The context pointer passed to OrderBookSide_set_level_listener.
+ * @param level The level's price (the tick price on a ladder side), new total quantity
+ *              and order count; size and order_count are 0 once its last order has gone.
+ */
+typedef void (*OrderBookSide_LevelListener)(void *context, const struct OrderBookLevelView *level);
+
+/**
+ * Sets (or with NULL, clears) the listener told about level changes on this side.
+ *
+ * @param side The OrderBookSide instance.
+ * @param listener Callback invoked once per level change, or NULL.
+ * @param context Passed through to listener.
+ */
+void OrderBookSide_set_level_listener(OrderBookSide side, OrderBookSide_LevelListener listener, void *context);
+
+/**
+ * Callback invoked by OrderBookSide_for_each_order for each resting order.
+ *
+ * @param context The context pointer passed to OrderBookSide_for_each_order.
+ * @param order A copy of the resting order (valid only during the call; the order must not be removed).
+ * @return 1 to continue, 0 to stop.
+ */
+typedef int (*OrderBookSide_OrderVisitor)(void *context, const BookOrder order);
+
+/**
+ * Visits every resting order on this side, from the most competitive level to the least
+ * and in time priority within each level. Adding the visited orders to an empty side in
+ * the same sequence reproduces the side's queues exactly.
+ *
+ * @param side The OrderBookSide instance.
+ * @param visitor Callback invoked once per order.
+ * @param context Passed through to visitor.
+ * @return 1 if every order was visited, 0 on invalid arguments or if the visitor stopped.
+ */
+int OrderBookSide_for_each_order(OrderBookSide side, OrderBookSide_OrderVisitor visitor, void *context);
+
+/**
+ * Deletes every resting order of one user from this side. The side keeps each user's
+ * resting orders in a list, so only that user's orders are visited, and each level they
+ * rested on is updated (and dropped if emptied) once rather than once per order.
+ *
+ * @param side The OrderBookSide instance.
+ * @param user_id The interned ID of the user.
+ * @param visitor Callback invoked with each order just before it is deleted (the side must
+ *                not be used during the call); returning 0 keeps that order and stops. NULL
+ *                deletes without visiting.
+ * @param context Passed through to visitor.
+ * @return The number of orders deleted.
+ */
+int OrderBookSide_delete_orders_for_user(OrderBookSide side, uint32_t user_id, OrderBookSide_OrderVisitor visitor, void *context);
+
+/**
+ * Reads the side's cache of its most competitive levels without copying or allocating.
+ * The cache holds the best min(depth_cache, number of levels) levels, best first, and is
+ * kept up to date as orders rest, trade and are deleted.
+ *
+ * @param side The OrderBookSide instance.
+ * @param level_count Output pointer to store the number of cached levels.
+ * @return The cached levels, valid until the side next changes, or NULL if the side was
+ *         created without a depth cache (level_count is then 0).
+ */
+const struct OrderBookLevelView *OrderBookSide_peek_levels(OrderBookSide side, int *level_count);
+
+/**
+ * Estimates a sweep of this side for quantity without changing it or allocating: the
+ * quantity available, its VWAP and the levels needed, taking levels best first.
+ *
+ * @param side The OrderBookSide instance.
+ * @param quantity The quantity to sweep for.
+ * @param estimate Output estimate; its quantity is less than asked for if the side runs out.
+ * @return 1 if successful, 0 on invalid arguments or a negative quantity.
+ */
+int OrderBookSide_estimate_fill(OrderBookSide side, long quantity, struct OrderBookFillEstimate *estimate);
+
+/**
+ * Gets the total quantity resting at levels an incoming order at price would cross: priced
+ * at or above price on the buy side, at or below it on the sell side. A ladder side compares
+ * by tick, like matching does. Does not allocate.
+ *
+ * @param side The OrderBookSide instance.
+ * @param price The limit price.
+ * @return The cumulative quantity, or 0 for an empty side or invalid arguments.
+ */
+long OrderBookSide_size_through_price(OrderBookSide side, double price);
+
 /**
  * Gets the k most competitive price levels on this side of the order book. If k is 0 then all levels are returned.
- * 
+ * If the side has fewer than k levels, level_count is the number it has.
+ *
  * @param side The OrderBookSide instance.
  * @param k The number of levels to return, or 0 for all levels.
  * @param levels Output pointer to store the array of levels (allocated internally).
@@ -94,4 +327,22 @@ double OrderBookSide_get_best_price(OrderBookSide side);
  */
 int OrderBookSide_get_levels(OrderBookSide side, int k, struct OrderBookLevelView **levels, int *level_count);
 
+/* Bytes an OrderBookSide holds, filled in by OrderBookSide_get_memory_usage. Level blocks
+ * taken from the side's level_pool belong to the pool and are not counted here. */
+struct OrderBookSideMemory {
+    size_t level_bytes; /**< The ladder or the price map, and level blocks not taken from a pool. */
+    size_t order_bytes; /**< Level queues grown past their inline capacity, and the order and user indexes. */
+    size_t other_bytes; /**< The side itself, its depth cache and its mass-delete scratch list. */
+};
+
+/**
+ * Gets the bytes this side holds. Walks every level, so it is meant for monitoring rather
+ * than the matching path.
+ *
+ * @param side The OrderBookSide instance.
+ * @param usage Output breakdown.
+ * @return 1 if successful, 0 on invalid arguments.
+ */
+int OrderBookSide_get_memory_usage(const OrderBookSide side, struct OrderBookSideMemory *usage);
+
 #endif // ORDER_BOOK_SIDE_H
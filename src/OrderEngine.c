@@ -0,0 +1,280 @@
+/*******************************************************************************************/
+/* OrderEngine.c - Implementation file for the OrderEngine module
+ *
+ * The engine thread pops up to ENGINE_COMMAND_BATCH commands at a time and collects
+ * the events they produce in a local buffer, which is pushed to every event ring with
+ * one batch push per ring when it fills up or the command batch is done.
+ */
+
+#define _GNU_SOURCE
+#include "OrderEngine.h"
+#include "SpscRing.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ENGINE_COMMAND_BATCH 64     // Commands popped per batch
+#define ENGINE_EVENT_BATCH 256      // Events collected before they are pushed
+#define ENGINE_IDLE_SPINS 256       // Empty polls before the engine starts yielding
+#define ENGINE_STOP_GRACE_MS 100    // Once stopping, how long a full ring may make no room
+
+enum CommandType { COMMAND_ADD, COMMAND_REMOVE };
+
+// Record of the command ring
+struct Command {
+    int type;             // COMMAND_ADD or COMMAND_REMOVE
+    struct Order order;   // The order to add, or just the order_id to remove
+};
+
+// OrderEngine structure
+struct OrderEngine {
+    OrderBook book;
+    SpscRing commands;
+    SpscRing outputs[ORDER_ENGINE_MAX_OUTPUTS];
+    int output_count;
+
+    pthread_t thread;
+    int started;
+    int cpu;                                  // CPU to pin to, or -1
+    atomic_int stop;                          // Set by the producer
+    atomic_int stopped;                       // Set by the engine thread when it exits
+
+    // Engine thread only
+    struct OrderBookMatchResult result;
+    struct OrderEngineEvent pending[ENGINE_EVENT_BATCH];
+    size_t pending_count;
+    double best_bid;                          // Last published top of book
+    double best_ask;
+};
+
+// Helper function prototypes
+static void *run_engine(void *argument);
+static void apply_command(OrderEngine engine, const struct Command *command);
+static struct OrderEngineEvent *new_event(OrderEngine engine, int type, uint64_t sequence, const char *order_id);
+static void flush_events(OrderEngine engine);
+static void publish_level(void *context, const struct OrderBookLevelUpdate *update);
+static long elapsed_ms(const struct timespec *since);
+
+// Public function implementations
+OrderEngine OrderEngine_create(const struct OrderEngineConfig *config) {
+    size_t command_capacity = config && config->command_capacity ? config->command_capacity : ORDER_ENGINE_DEFAULT_CAPACITY;
+    size_t event_capacity = config && config->event_capacity ? config->event_capacity : ORDER_ENGINE_DEFAULT_CAPACITY;
+    int outputs = config && config->outputs > 0 ? config->outputs : 1;
+    if (outputs > ORDER_ENGINE_MAX_OUTPUTS) return NULL;
+
+    OrderEngine engine = malloc(sizeof(struct OrderEngine));
+    if (!engine) return NULL;
+    memset(engine, 0, sizeof(struct OrderEngine));
+    atomic_init(&engine->stop, 0);
+    atomic_init(&engine->stopped, 0);
+    engine->output_count = outputs;
+    engine->cpu = -1;
+    if (config && config->pin_thread) {
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        engine->cpu = (int)(config->cpu % (cpu_count > 0 ? cpu_count : 1));
+    }
+
+    engine->book = OrderBook_create_with_config(config ? &config->book : NULL);
+    engine->commands = SpscRing_create(sizeof(struct Command), command_capacity);
+    int ok = engine->book && engine->commands;
+    if (ok && config && config->level_updates) {
+        OrderBook_set_level_handler(engine->book, publish_level, engine);
+    }
+    for (int i = 0; i < outputs && ok; i++) {
+        engine->outputs[i] = SpscRing_create(sizeof(struct OrderEngineEvent), event_capacity);
+        ok = engine->outputs[i] != NULL;
+    }
+    ok = ok && pthread_create(&engine->thread, NULL, run_engine, engine) == 0;
+    engine->started = ok;
+    if (!ok) {
+        OrderEngine_destroy(&engine);
+        return NULL;
+    }
+    return engine;
+}
+
+void OrderEngine_destroy(OrderEngine *engine) {
+    if (!engine || !*engine) return;
+    OrderEngine e = *engine;
+
+    OrderEngine_stop(e);
+    OrderBookMatchResult_free(&(e->result));
+    for (int i = 0; i < e->output_count; i++) {
+        SpscRing_destroy(&(e->outputs[i]));
+    }
+    SpscRing_destroy(&(e->commands));
+    OrderBook_destroy(&(e->book));
+    free(e);
+
+    *engine = NULL;
+}
+
+int OrderEngine_submit_add(OrderEngine engine, const Order order) {
+    if (!engine || !order) return 0;
+
+    struct Command command;
+    command.type = COMMAND_ADD;
+    command.order = *order;
+    return SpscRing_push(engine->commands, &command);
+}
+
+int OrderEngine_submit_remove(OrderEngine engine, const char *order_id) {
+    if (!engine || !order_id) return 0;
+
+    struct Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = COMMAND_REMOVE;
+    strncpy(command.order.order_id, order_id, sizeof(command.order.order_id) - 1);
+    return SpscRing_push(engine->commands, &command);
+}
+
+size_t OrderEngine_poll_events(OrderEngine engine, int output, struct OrderEngineEvent *events, size_t max) {
+    if (!engine || output < 0 || output >= engine->output_count || !events) return 0;
+    return SpscRing_pop_batch(engine->outputs[output], events, max);
+}
+
+void OrderEngine_stop(OrderEngine engine) {
+    if (!engine || !engine->started) return;
+
+    // The engine thread exits only once the command ring is empty
+    atomic_store_explicit(&engine->stop, 1, memory_order_release);
+    pthread_join(engine->thread, NULL);
+    engine->started = 0;
+}
+
+int OrderEngine_is_stopped(OrderEngine engine) {
+    return engine ? atomic_load_explicit(&engine->stopped, memory_order_acquire) : 0;
+}
+
+OrderBook OrderEngine_get_book(OrderEngine engine) {
+    return engine ? engine->book : NULL;
+}
+
+// Helper function implementations
+static void *run_engine(void *argument) {
+    OrderEngine engine = argument;
+    if (engine->cpu >= 0) {
+        // Pinning is best effort; an unpinned engine still works
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(engine->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    struct Command batch[ENGINE_COMMAND_BATCH];
+    int idle = 0;
+    for (;;) {
+        size_t count = SpscRing_pop_batch(engine->commands, batch, ENGINE_COMMAND_BATCH);
+        if (count > 0) {
+            for (size_t i = 0; i < count; i++) {
+                apply_command(engine, &batch[i]);
+            }
+            flush_events(engine);
+            idle = 0;
+        } else if (atomic_load_explicit(&engine->stop, memory_order_acquire)) {
+            // The producer has stopped pushing, so an empty ring stays empty
+            if (SpscRing_size(engine->commands) == 0) break;
+        } else if (++idle > ENGINE_IDLE_SPINS) {
+            sched_yield();
+        }
+    }
+
+    atomic_store_explicit(&engine->stopped, 1, memory_order_release);
+    return NULL;
+}
+
+static void apply_command(OrderEngine engine, const struct Command *command) {
+    OrderBook book = engine->book;
+    uint64_t sequence = OrderBook_message_sequence(book);
+
+    if (command->type == COMMAND_ADD) {
+        const struct Order *order = &command->order;
+        int accepted = OrderBook_add_order_with_result(book, (const Order)order, &engine->result);
+
+        for (int i = 0; i < engine->result.count; i++) {
+            const struct OrderBookFill *fill = &engine->result.fills[i];
+            struct OrderEngineEvent *event = new_event(engine, ORDER_ENGINE_EXECUTION, sequence, order->order_id);
+            event->trade_id = fill->trade_id;
+            event->size = fill->size;
+            event->price = fill->price;
+            // Events outlive the fill's handle and are read on other threads, so they carry the string
+            const char *maker_order_id = OrderBook_get_id_string(book, fill->maker_order);
+            if (maker_order_id) strncpy(event->maker_order_id, maker_order_id, sizeof(event->maker_order_id) - 1);
+        }
+        struct OrderEngineEvent *event = new_event(engine, accepted ? ORDER_ENGINE_ACCEPTED : ORDER_ENGINE_REJECTED,
+                                                   sequence, order->order_id);
+        event->size = order->quantity;
+        event->price = order->price;
+    } else {
+        int removed = OrderBook_remove_order(book, command->order.order_id);
+        new_event(engine, removed ? ORDER_ENGINE_REMOVED : ORDER_ENGINE_NOT_FOUND, sequence, command->order.order_id);
+    }
+
+    double best_bid = OrderBook_get_best_bid(book);
+    double best_ask = OrderBook_get_best_ask(book);
+    if (best_bid != engine->best_bid || best_ask != engine->best_ask) {
+        struct OrderEngineEvent *event = new_event(engine, ORDER_ENGINE_TOP_OF_BOOK, sequence, "");
+        event->best_bid = engine->best_bid = best_bid;
+        event->best_ask = engine->best_ask = best_ask;
+    }
+}
+
+// Appends a zeroed event to the pending buffer, flushing it first if it is full
+static struct OrderEngineEvent *new_event(OrderEngine engine, int type, uint64_t sequence, const char *order_id) {
+    if (engine->pending_count == ENGINE_EVENT_BATCH) flush_events(engine);
+
+    struct OrderEngineEvent *event = &engine->pending[engine->pending_count++];
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    event->sequence = sequence;
+    strncpy(event->order_id, order_id, sizeof(event->order_id) - 1);
+    return event;
+}
+
+// Level handler of the engine's book; runs on the engine thread inside apply_command
+static void publish_level(void *context, const struct OrderBookLevelUpdate *update) {
+    OrderEngine engine = context;
+    struct OrderEngineEvent *event = new_event(engine, ORDER_ENGINE_LEVEL, update->sequence, "");
+    event->side = update->side;
+    event->price = update->price;
+    event->size = update->size;
+}
+
+// Pushes the pending events to every event ring, waiting for room as needed. Once the
+// engine is stopping, a ring that makes no room for ENGINE_STOP_GRACE_MS has lost its
+// publisher, and the events it cannot take are dropped.
+static void flush_events(OrderEngine engine) {
+    for (int i = 0; i < engine->output_count; i++) {
+        size_t pushed = 0;
+        int stalled = 0;
+        struct timespec stalled_since;
+        while (pushed < engine->pending_count) {
+            size_t count = SpscRing_push_batch(engine->outputs[i], engine->pending + pushed, engine->pending_count - pushed);
+            if (count > 0) {
+                stalled = 0;
+            } else if (atomic_load_explicit(&engine->stop, memory_order_acquire)) {
+                if (!stalled) {
+                    clock_gettime(CLOCK_MONOTONIC, &stalled_since);
+                    stalled = 1;
+                } else if (elapsed_ms(&stalled_since) >= ENGINE_STOP_GRACE_MS) {
+                    break;
+                }
+                sched_yield();
+            } else {
+                sched_yield();
+            }
+            pushed += count;
+        }
+    }
+    engine->pending_count = 0;
+}
+
+static long elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
@@ -0,0 +1,144 @@
+/* OrderEngine.h - Header file for the OrderEngine module
+ *
+ * This module runs one OrderBook on a dedicated engine thread, decoupled from the threads
+ * around it by lock-free rings:
+ *  - a command ring (SpscRing) that one producer thread, typically the network or file
+ *    reader, fills with adds and removes, and
+ *  - one or more event rings carrying what each command did (acceptance, executions,
+ *    removals, top-of-book changes and optionally L2 level updates) to publisher threads,
+ *    one thread per ring. Every ring receives every event.
+ *
+ * The engine thread consumes commands in batches and writes events in batches. It never
+ * performs I/O, prints or takes a lock; when it is idle it spins briefly and then yields.
+ * If a publisher falls behind and its ring fills up, the engine waits for room rather
+ * than dropping events, so a slow publisher slows matching. Once the engine is stopping,
+ * a ring that stays full for 100 ms is taken to have lost its publisher, and the events
+ * it cannot take are dropped.
+ */
+#ifndef ORDER_ENGINE_H
+#define ORDER_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Order.h"
+#include "OrderBook.h"
+
+#define ORDER_ENGINE_DEFAULT_CAPACITY 4096   // Records per ring
+#define ORDER_ENGINE_MAX_OUTPUTS 8
+
+// OrderEngine type definition
+typedef struct OrderEngine *OrderEngine;
+
+// Settings for OrderEngine_create. A zeroed config uses the defaults.
+struct OrderEngineConfig {
+    size_t command_capacity;     /**< Commands the command ring holds (0 for the default). */
+    size_t event_capacity;       /**< Events each event ring holds (0 for the default). */
+    int outputs;                 /**< Event rings, one per publisher (0 for 1). */
+    int pin_thread;              /**< 1 to pin the engine thread to cpu. */
+    int cpu;                     /**< CPU to pin to, modulo the CPU count. */
+    int level_updates;           /**< 1 to publish a LEVEL event for every level change. */
+    struct OrderBookConfig book; /**< Settings for the engine's book. */
+};
+
+// Event types
+enum OrderEngineEventType {
+    ORDER_ENGINE_ACCEPTED = 1,   // An add was applied: order_id, size = quantity, price
+    ORDER_ENGINE_REJECTED,       // An add failed: order_id
+    ORDER_ENGINE_EXECUTION,      // A fill of the add with sequence: order_id (taker),
+                                 // maker_order_id, trade_id, size, price
+    ORDER_ENGINE_REMOVED,        // A remove took an order off the book: order_id
+    ORDER_ENGINE_NOT_FOUND,      // A remove found no such order: order_id
+    ORDER_ENGINE_TOP_OF_BOOK,    // Best bid or ask changed: best_bid, best_ask (0 if none)
+    ORDER_ENGINE_LEVEL           // The quantity at a level changed: side, price, size (0 once
+                                 // empty); see struct OrderBookLevelUpdate
+};
+
+// One record of an event ring. Events of one command share its sequence and arrive in
+// this order: any LEVEL updates, executions, then ACCEPTED / REJECTED (or the remove
+// outcome), then any TOP_OF_BOOK.
+struct OrderEngineEvent {
+    int type;                    /**< An enum OrderEngineEventType. */
+    int size;                    /**< Order quantity or fill size. */
+    uint64_t sequence;           /**< The book's message sequence for the command. */
+    long trade_id;               /**< Numeric trade ID of an execution. */
+    double price;                /**< Order or fill price. */
+    double best_bid;             /**< TOP_OF_BOOK only. */
+    double best_ask;             /**< TOP_OF_BOOK only. */
+    char order_id[37];           /**< The command's order. */
+    char maker_order_id[37];     /**< The resting order of an execution. */
+    char side;                   /**< LEVEL only: '1' for a bid level, '0' for an ask level. */
+};
+
+/**
+ * Creates an engine and starts its thread.
+ *
+ * @param config Settings, or NULL for defaults.
+ * @return A newly allocated OrderEngine instance, or NULL on failure.
+ */
+OrderEngine OrderEngine_create(const struct OrderEngineConfig *config);
+
+/**
+ * Stops the engine (see OrderEngine_stop) and frees it and its book. Publishers must have
+ * stopped polling.
+ *
+ * @param engine A pointer to the OrderEngine instance to destroy.
+ */
+void OrderEngine_destroy(OrderEngine *engine);
+
+/**
+ * Queues an add. Producer thread only; never waits.
+ *
+ * @param engine The OrderEngine instance.
+ * @param order The order to add (copied).
+ * @return 1 if the command was queued, 0 if the command ring is full or on invalid arguments.
+ */
+int OrderEngine_submit_add(OrderEngine engine, const Order order);
+
+/**
+ * Queues a remove. Producer thread only; never waits.
+ *
+ * @param engine The OrderEngine instance.
+ * @param order_id The ID of the order to remove.
+ * @return 1 if the command was queued, 0 if the command ring is full or on invalid arguments.
+ */
+int OrderEngine_submit_remove(OrderEngine engine, const char *order_id);
+
+/**
+ * Takes up to max events from one event ring. Only that ring's publisher thread may call it.
+ *
+ * @param engine The OrderEngine instance.
+ * @param output The event ring, from 0 to outputs - 1.
+ * @param events Output buffer for up to max events.
+ * @param max The number of events the buffer holds.
+ * @return The number of events taken, 0 if none are waiting.
+ */
+size_t OrderEngine_poll_events(OrderEngine engine, int output, struct OrderEngineEvent *events, size_t max);
+
+/**
+ * Applies every queued command and stops the engine thread. Call from the producer thread.
+ * Events already written stay in the event rings for the publishers to poll. From the call
+ * on, an event ring that stays full for 100 ms drops the events it cannot take, so the
+ * engine finishes even if no publisher is polling.
+ *
+ * @param engine The OrderEngine instance.
+ */
+void OrderEngine_stop(OrderEngine engine);
+
+/**
+ * Whether the engine thread has finished (after OrderEngine_stop). Publishers poll until
+ * this is true and their ring is empty.
+ *
+ * @param engine The OrderEngine instance.
+ * @return 1 if the engine thread has applied its last command, 0 otherwise.
+ */
+int OrderEngine_is_stopped(OrderEngine engine);
+
+/**
+ * Gets the engine's book. It may only be used once the engine has stopped.
+ *
+ * @param engine The OrderEngine instance.
+ * @return The book, or NULL on invalid arguments.
+ */
+OrderBook OrderEngine_get_book(OrderEngine engine);
+
+#endif // ORDER_ENGINE_H
@@ -0,0 +1,360 @@
+/*******************************************************************************************/
+/* OrderMessage.c - Implementation file for the OrderMessage module
+ *
+ * The writer keeps a HashTable from ID string to slot so repeated IDs are referenced
+ * rather than written again, and the slot array to know which string a reused slot
+ * held. The reader keeps only the slot array: it copies definitions into it and hands
+ * the stored strings straight to the book.
+ */
+
+#include "OrderMessage.h"
+#include "HashTable.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ORDER_MESSAGE_DEFAULT_TICK 0.01
+#define ORDER_MESSAGE_MAX_SLOTS (1u << 24)  // Largest dictionary the reader accepts
+#define ORDER_MESSAGE_MAX_FIELDS 8
+#define ID_LENGTH 36
+#define INLINE_ID_CHARS 16
+
+_Static_assert(sizeof(struct OrderMessageHeader) == 24, "header must be 24 bytes");
+_Static_assert(sizeof(struct OrderMessage) == 24, "records must be 24 bytes");
+_Static_assert(sizeof(struct OrderMessageDefine) == sizeof(struct OrderMessage), "definitions must be record-sized");
+
+// OrderMessageWriter structure
+struct OrderMessageWriter {
+    FILE *out;
+    double tick_size;
+    HashTable slot_by_id;       // ID string -> slot + 1
+    char (*ids)[ID_LENGTH + 1]; // String bound to each slot ("" if unused)
+    uint32_t next_slot;         // Next slot to assign, round-robin
+    long timestamp;             // Timestamp of the last TIMESTAMP record written
+    int failed;                 // Set when a write fails
+};
+
+// Helper function prototypes
+static void write_record(OrderMessageWriter writer, const void *record);
+static uint32_t write_id(OrderMessageWriter writer, const struct CsvField *field);
+static void write_timestamp(OrderMessageWriter writer, long timestamp);
+static long parse_trade_number(const struct CsvField *field);
+static int format_query(const struct OrderMessage *message, char *buffer, size_t size);
+
+// Writer implementations
+OrderMessageWriter OrderMessageWriter_create(FILE *out, double tick_size) {
+    if (!out) return NULL;
+
+    OrderMessageWriter writer = malloc(sizeof(struct OrderMessageWriter));
+    if (!writer) return NULL;
+    memset(writer, 0, sizeof(struct OrderMessageWriter));
+
+    writer->out = out;
+    writer->tick_size = tick_size > 0.0 ? tick_size : ORDER_MESSAGE_DEFAULT_TICK;
+    writer->timestamp = ORDER_MESSAGE_NO_TIMESTAMP;
+    writer->slot_by_id = HashTable_create(ORDER_MESSAGE_ID_SLOTS);
+    writer->ids = calloc(ORDER_MESSAGE_ID_SLOTS, sizeof(*writer->ids));
+    if (!writer->slot_by_id || !writer->ids) {
+        OrderMessageWriter_destroy(&writer);
+        return NULL;
+    }
+
+    struct OrderMessageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ORDER_MESSAGE_MAGIC, sizeof(header.magic));
+    header.version = ORDER_MESSAGE_VERSION;
+    header.record_size = sizeof(struct OrderMessage);
+    header.id_slots = ORDER_MESSAGE_ID_SLOTS;
+    header.tick_size = writer->tick_size;
+    write_record(writer, &header); // Same size as a record
+
+    return writer;
+}
+
+int OrderMessageWriter_write_csv(OrderMessageWriter writer, const char *line, size_t length) {
+    if (!writer || !line) return 0;
+    if (length > 0 && line[length - 1] == '\r') length--;
+    if (length == 0) return 0;
+
+    struct CsvField fields[ORDER_MESSAGE_MAX_FIELDS];
+    int count = CsvReplay_split_fields(line, length, fields, ORDER_MESSAGE_MAX_FIELDS);
+    struct OrderMessage message;
+    memset(&message, 0, sizeof(message));
+
+    if (CsvReplay_field_equals(&fields[0], "ADD")) {
+        // ADD,order_id,user_id,side,price,quantity[,timestamp]
+        long ticks, quantity, timestamp = ORDER_MESSAGE_NO_TIMESTAMP;
+        if (count < 6 || count > 7 ||
+            !CsvReplay_parse_ticks(fields[4].start, fields[4].length, writer->tick_size, &ticks) ||
+            !CsvReplay_parse_long(&fields[5], &quantity) || quantity > INT32_MAX ||
+            (count == 7 && !CsvReplay_parse_long(&fields[6], &timestamp))) {
+            return 0;
+        }
+        message.type = ORDER_MESSAGE_ADD;
+        message.order_id = write_id(writer, &fields[1]);
+        message.user_id = write_id(writer, &fields[2]);
+        message.side = CsvReplay_field_equals(&fields[3], "buy") ? '1' : '0';
+        message.quantity = (int32_t)quantity;
+        message.value = ticks;
+        write_timestamp(writer, timestamp);
+
+    } else if (CsvReplay_field_equals(&fields[0], "REMOVE")) {
+        if (count != 2) return 0;
+        message.type = ORDER_MESSAGE_REMOVE;
+        message.order_id = write_id(writer, &fields[1]);
+
+    } else if (CsvReplay_field_equals(&fields[0], "SHOW_TOP")) {
+        long k;
+        if (count != 2 || !CsvReplay_parse_long(&fields[1], &k) || k > INT32_MAX) return 0;
+        message.type = ORDER_MESSAGE_SHOW_TOP;
+        message.quantity = (int32_t)k;
+
+    } else if (CsvReplay_field_equals(&fields[0], "GET_TRADE")) {
+        if (count != 2) return 0;
+        message.type = ORDER_MESSAGE_GET_TRADE;
+        message.value = parse_trade_number(&fields[1]);
+
+    } else if (CsvReplay_field_equals(&fields[0], "SHOW_BEST")) {
+        message.type = ORDER_MESSAGE_SHOW_BEST;
+    } else if (CsvReplay_field_equals(&fields[0], "BEST_BID")) {
+        message.type = ORDER_MESSAGE_BEST_BID;
+    } else if (CsvReplay_field_equals(&fields[0], "BEST_ASK")) {
+        message.type = ORDER_MESSAGE_BEST_ASK;
+    } else if (CsvReplay_field_equals(&fields[0], "SHOW_ALL_TRADES")) {
+        message.type = ORDER_MESSAGE_SHOW_ALL_TRADES;
+    } else {
+        return 0;
+    }
+
+    write_record(writer, &message);
+    return 1;
+}
+
+int OrderMessageWriter_finish(OrderMessageWriter writer) {
+    if (!writer) return 0;
+    if (fflush(writer->out) != 0) writer->failed = 1;
+    return !writer->failed;
+}
+
+void OrderMessageWriter_destroy(OrderMessageWriter *writer) {
+    if (!writer || !*writer) return;
+    HashTable_destroy(&(*writer)->slot_by_id);
+    free((*writer)->ids);
+    free(*writer);
+    *writer = NULL;
+}
+
+// Reader implementations
+int OrderMessage_replay_file(OrderBook book, const char *path, CsvReplay_LineHandler on_query, void *context, struct CsvReplayStats *stats) {
+    if (!book || !path || !stats) return 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct OrderMessageHeader)) {
+        close(fd);
+        return 0;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    int ok = OrderMessage_replay_buffer(book, data, (size_t)st.st_size, on_query, context, stats);
+    munmap(data, (size_t)st.st_size);
+    return ok;
+}
+
+int OrderMessage_replay_buffer(OrderBook book, const void *data, size_t length, CsvReplay_LineHandler on_query, void *context, struct CsvReplayStats *stats) {
+    if (!book || !data || !stats || length < sizeof(struct OrderMessageHeader)) return 0;
+
+    struct OrderMessageHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ORDER_MESSAGE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ORDER_MESSAGE_VERSION ||
+        header.record_size != sizeof(struct OrderMessage) ||
+        header.id_slots == 0 || header.id_slots > ORDER_MESSAGE_MAX_SLOTS ||
+        !(header.tick_size >= 1e-9)) {
+        return 0;
+    }
+
+    char (*ids)[ID_LENGTH + 1] = calloc(header.id_slots, sizeof(*ids));
+    if (!ids) return 0;
+
+    double whole = round(1.0 / header.tick_size);
+    double ticks_per_unit = fabs(1.0 / header.tick_size - whole) < 1e-9 ? whole : 0.0;
+    long start_time = (long)time(NULL);
+    long timestamp = ORDER_MESSAGE_NO_TIMESTAMP;
+    struct OrderBookMatchResult result;
+    memset(&result, 0, sizeof(result));
+
+    const unsigned char *record = (const unsigned char *)data + sizeof(header);
+    const unsigned char *end = (const unsigned char *)data + length;
+    while (record < end) {
+        if ((size_t)(end - record) < sizeof(struct OrderMessage)) {
+            stats->errors++;
+            break;
+        }
+        struct OrderMessage message;
+        memcpy(&message, record, sizeof(message));
+        record += sizeof(message);
+
+        if (message.type == ORDER_MESSAGE_DEFINE_ID) {
+            struct OrderMessageDefine define;
+            memcpy(&define, &message, sizeof(define));
+            size_t extra = define.length > INLINE_ID_CHARS ? define.length - INLINE_ID_CHARS : 0;
+            size_t extra_records = (extra + sizeof(message) - 1) / sizeof(message);
+            if (define.slot >= header.id_slots || define.length > ID_LENGTH ||
+                (size_t)(end - record) < extra_records * sizeof(message)) {
+                stats->errors++;
+                break;
+            }
+            char *id = ids[define.slot];
+            memcpy(id, define.text, define.length - extra);
+            memcpy(id + define.length - extra, record, extra);
+            id[define.length] = '\0';
+            record += extra_records * sizeof(message);
+            continue;
+        }
+        if (message.type == ORDER_MESSAGE_TIMESTAMP) {
+            timestamp = (long)message.value;
+            continue;
+        }
+
+        stats->lines++;
+        if (message.type == ORDER_MESSAGE_ADD) {
+            if (message.order_id >= header.id_slots || message.user_id >= header.id_slots) {
+                stats->errors++;
+                break;
+            }
+            struct Order order;
+            memcpy(order.order_id, ids[message.order_id], sizeof(order.order_id));
+            memcpy(order.user_id, ids[message.user_id], sizeof(order.user_id));
+            order.side = (char)message.side;
+            order.price = ticks_per_unit ? message.value / ticks_per_unit : message.value * header.tick_size;
+            order.quantity = message.quantity;
+            order.timestamp = timestamp < 0 ? start_time : timestamp;
+            order.order_type = ORDER_TYPE_LIMIT;
+            order.time_in_force = TIME_IN_FORCE_GTC;
+
+            if (OrderBook_add_order_with_result(book, &order, &result)) {
+                stats->adds++;
+            } else {
+                stats->errors++;
+            }
+            stats->trades += result.count;
+
+        } else if (message.type == ORDER_MESSAGE_REMOVE) {
+            if (message.order_id >= header.id_slots) {
+                stats->errors++;
+                break;
+            }
+            stats->removes += OrderBook_remove_order(book, ids[message.order_id]);
+
+        } else {
+            char line[64];
+            int line_length = format_query(&message, line, sizeof(line));
+            if (line_length < 0) {
+                stats->errors++;
+                continue;
+            }
+            stats->others++;
+            if (on_query) on_query(context, book, line, (size_t)line_length);
+        }
+    }
+
+    OrderBookMatchResult_free(&result);
+    free(ids);
+    return 1;
+}
+
+// Helper function implementations
+
+static void write_record(OrderMessageWriter writer, const void *record) {
+    if (fwrite(record, sizeof(struct OrderMessage), 1, writer->out) != 1) writer->failed = 1;
+}
+
+// Returns the slot of an ID, writing a definition first if it is not bound to one
+static uint32_t write_id(OrderMessageWriter writer, const struct CsvField *field) {
+    char id[ID_LENGTH + 1];
+    size_t length = field->length < ID_LENGTH ? field->length : ID_LENGTH;
+    memcpy(id, field->start, length);
+    id[length] = '\0';
+
+    void *found = HashTable_get(writer->slot_by_id, id);
+    if (found) return (uint32_t)((uintptr_t)found - 1);
+
+    uint32_t slot = writer->next_slot;
+    writer->next_slot = (slot + 1) % ORDER_MESSAGE_ID_SLOTS;
+    if (writer->ids[slot][0] != '\0') HashTable_remove(writer->slot_by_id, writer->ids[slot]);
+    memcpy(writer->ids[slot], id, length + 1);
+    if (HashTable_add(writer->slot_by_id, id, (void *)(uintptr_t)(slot + 1)) != 0) writer->failed = 1;
+
+    // Definition record, then the characters that do not fit in it
+    unsigned char records[3 * sizeof(struct OrderMessage)];
+    memset(records, 0, sizeof(records));
+    struct OrderMessageDefine define;
+    memset(&define, 0, sizeof(define));
+    define.type = ORDER_MESSAGE_DEFINE_ID;
+    define.length = (uint8_t)length;
+    define.slot = slot;
+    size_t inline_chars = length < INLINE_ID_CHARS ? length : INLINE_ID_CHARS;
+    memcpy(define.text, id, inline_chars);
+    memcpy(records, &define, sizeof(define));
+    memcpy(records + sizeof(define), id + inline_chars, length - inline_chars);
+
+    size_t extra_records = (length - inline_chars + sizeof(struct OrderMessage) - 1) / sizeof(struct OrderMessage);
+    for (size_t i = 0; i <= extra_records; i++) {
+        write_record(writer, records + i * sizeof(struct OrderMessage));
+    }
+    return slot;
+}
+
+// Writes a TIMESTAMP record if the timestamp differs from the current one
+static void write_timestamp(OrderMessageWriter writer, long timestamp) {
+    if (timestamp == writer->timestamp) return;
+    struct OrderMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = ORDER_MESSAGE_TIMESTAMP;
+    message.value = timestamp;
+    write_record(writer, &message);
+    writer->timestamp = timestamp;
+}
+
+// Parses "TRADE-<digits>"; returns -1 for anything else
+static long parse_trade_number(const struct CsvField *field) {
+    static const char prefix[] = "TRADE-";
+    size_t prefix_length = sizeof(prefix) - 1;
+    if (field->length <= prefix_length || strncmp(field->start, prefix, prefix_length) != 0) return -1;
+    struct CsvField digits = { field->start + prefix_length, field->length - prefix_length };
+    long number;
+    return CsvReplay_parse_long(&digits, &number) ? number : -1;
+}
+
+// Formats a query record as the CSV line it came from; returns its length or -1
+static int format_query(const struct OrderMessage *message, char *buffer, size_t size) {
+    switch (message->type) {
+    case ORDER_MESSAGE_SHOW_BEST:
+        return snprintf(buffer, size, "SHOW_BEST");
+    case ORDER_MESSAGE_BEST_BID:
+        return snprintf(buffer, size, "BEST_BID");
+    case ORDER_MESSAGE_BEST_ASK:
+        return snprintf(buffer, size, "BEST_ASK");
+    case ORDER_MESSAGE_SHOW_TOP:
+        return snprintf(buffer, size, "SHOW_TOP,%d", (int)message->quantity);
+    case ORDER_MESSAGE_SHOW_ALL_TRADES:
+        return snprintf(buffer, size, "SHOW_ALL_TRADES");
+    case ORDER_MESSAGE_GET_TRADE:
+        if (message->value < 0) return snprintf(buffer, size, "GET_TRADE,?");
+        return snprintf(buffer, size, "GET_TRADE,TRADE-%08ld", (long)message->value);
+    default:
+        return -1;
+    }
+}
@@ -0,0 +1,140 @@
+/* OrderMessage.h - Header file for the OrderMessage module
+ *
+ * This module defines a compact binary format for the commands the OrderBookDriver
+ * understands, a writer that converts CSV lines to it, and a reader that replays a
+ * binary file into an OrderBook without parsing anything.
+ *
+ * A file is an OrderMessageHeader followed by 24-byte records. Every record is an
+ * OrderMessage except ID definitions, which use the OrderMessageDefine layout and
+ * carry up to 16 characters inline, with the rest of a longer ID in the raw 24-byte
+ * record(s) that follow. Records are in host byte order.
+ *
+ * Order and user IDs are written once and then referenced by slot number. The writer
+ * assigns slots round-robin from a fixed-size dictionary, so an ID whose slot has
+ * been reused is simply defined again; the reader keeps the same table and needs no
+ * more memory for a long file than for a short one. Prices are stored in ticks of the
+ * header's tick size, and timestamps are records of their own written only when the
+ * timestamp changes.
+ */
+#ifndef ORDER_MESSAGE_H
+#define ORDER_MESSAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "CsvReplay.h"
+#include "OrderBook.h"
+
+#define ORDER_MESSAGE_MAGIC "OBMS"
+#define ORDER_MESSAGE_VERSION 1
+#define ORDER_MESSAGE_ID_SLOTS 65536        // Dictionary size used by the writer
+#define ORDER_MESSAGE_NO_TIMESTAMP (-1)     // TIMESTAMP value meaning "use the replay clock"
+
+// Record types
+enum OrderMessageType {
+    ORDER_MESSAGE_ADD = 1,        // order_id, user_id, side, quantity, value = price in ticks
+    ORDER_MESSAGE_REMOVE,         // order_id
+    ORDER_MESSAGE_SHOW_BEST,
+    ORDER_MESSAGE_BEST_BID,
+    ORDER_MESSAGE_BEST_ASK,
+    ORDER_MESSAGE_SHOW_TOP,       // quantity = k
+    ORDER_MESSAGE_SHOW_ALL_TRADES,
+    ORDER_MESSAGE_GET_TRADE,      // value = numeric trade ID, or -1 if it did not parse
+    ORDER_MESSAGE_TIMESTAMP,      // value = timestamp of the following ADDs
+    ORDER_MESSAGE_DEFINE_ID       // See struct OrderMessageDefine
+};
+
+// File header (24 bytes)
+struct OrderMessageHeader {
+    char magic[4];        /**< ORDER_MESSAGE_MAGIC, not NUL-terminated. */
+    uint16_t version;     /**< ORDER_MESSAGE_VERSION. */
+    uint16_t record_size; /**< sizeof(struct OrderMessage). */
+    uint32_t id_slots;    /**< Size of the ID dictionary. */
+    uint32_t reserved;
+    double tick_size;     /**< Tick size of the prices in ADD records. */
+};
+
+// Command record (24 bytes)
+struct OrderMessage {
+    uint8_t type;         /**< An enum OrderMessageType. */
+    uint8_t side;         /**< '1' for buy, '0' for sell. */
+    uint16_t reserved;
+    uint32_t order_id;    /**< Dictionary slot of the order ID. */
+    uint32_t user_id;     /**< Dictionary slot of the user ID. */
+    int32_t quantity;     /**< Order quantity, or k for SHOW_TOP. */
+    int64_t value;        /**< Price in ticks, trade ID or timestamp, depending on type. */
+};
+
+// ID definition record (24 bytes), followed by ceil((length - 16) / 24) raw records
+struct OrderMessageDefine {
+    uint8_t type;         /**< ORDER_MESSAGE_DEFINE_ID. */
+    uint8_t length;       /**< Length of the ID (at most 36). */
+    uint16_t reserved;
+    uint32_t slot;        /**< Slot the ID is bound to from here on. */
+    char text[16];        /**< The first 16 characters of the ID. */
+};
+
+// OrderMessageWriter type definition
+typedef struct OrderMessageWriter *OrderMessageWriter;
+
+/**
+ * Creates a writer and writes the file header.
+ *
+ * @param out The stream to write to (owned by the caller).
+ * @param tick_size The tick size prices are rounded to (0 for 0.01).
+ * @return A newly allocated OrderMessageWriter instance, or NULL on failure.
+ */
+OrderMessageWriter OrderMessageWriter_create(FILE *out, double tick_size);
+
+/**
+ * Converts one CSV line in the driver's format to binary records.
+ *
+ * @param writer The OrderMessageWriter instance.
+ * @param line The CSV line (need not be NUL-terminated; a trailing '\r' is ignored).
+ * @param length The length of the line.
+ * @return 1 if the line was written, 0 if it was empty, malformed or unrecognized.
+ */
+int OrderMessageWriter_write_csv(OrderMessageWriter writer, const char *line, size_t length);
+
+/**
+ * Flushes the stream and reports whether every write succeeded.
+ *
+ * @param writer The OrderMessageWriter instance.
+ * @return 1 if all records reached the stream, 0 on a write error.
+ */
+int OrderMessageWriter_finish(OrderMessageWriter writer);
+
+/**
+ * Destroys a writer. The stream is not closed.
+ *
+ * @param writer A pointer to the OrderMessageWriter instance to destroy.
+ */
+void OrderMessageWriter_destroy(OrderMessageWriter *writer);
+
+/**
+ * Memory-maps a binary file and replays every record into the book.
+ *
+ * @param book The OrderBook instance.
+ * @param path The file to replay.
+ * @param on_query Called with the equivalent CSV line for each query command, or NULL.
+ * @param context Passed through to on_query.
+ * @param stats Counters to add this file's results to (lines counts commands).
+ * @return 1 if the file was replayed, 0 if it could not be mapped or is not a valid file.
+ */
+int OrderMessage_replay_file(OrderBook book, const char *path, CsvReplay_LineHandler on_query, void *context, struct CsvReplayStats *stats);
+
+/**
+ * Replays binary records from a buffer into the book.
+ *
+ * @param book The OrderBook instance.
+ * @param data The file contents, starting with the header.
+ * @param length The length of data in bytes.
+ * @param on_query Called with the equivalent CSV line for each query command, or NULL.
+ * @param context Passed through to on_query.
+ * @param stats Counters to add the results to.
+ * @return 1 if successful, 0 if the header is invalid. A truncated final record or an
+ *         out-of-range slot counts as an error and stops the replay.
+ */
+int OrderMessage_replay_buffer(OrderBook book, const void *data, size_t length, CsvReplay_LineHandler on_query, void *context, struct CsvReplayStats *stats);
+
+#endif // ORDER_MESSAGE_H
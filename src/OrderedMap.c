@@ -4,14 +4,26 @@
  * This file implements an ordered map using an AVL tree for self-balancing.
  * Internal details are hidden from the interface.
  *
+ * Nodes keep a parent pointer so iterators can step to the successor or predecessor
+ * without re-descending from the root, making a full walk O(n).
+ *
  * Author: Adam Rubinstein
  * Date: January 2025
  */
 
 #include "OrderedMap.h"
+#include "Instrument.h"
 #include <stdlib.h>
 #include <stdio.h>
 
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)(address))
+#endif
+
+#define ORDERED_MAP_PREFETCH_DEPTH 4 // Tree levels walked before prefetching the next node
+
 // AVL Tree node structure
 typedef struct AVLNode {
     double key;
@@ -19,6 +31,7 @@ typedef struct AVLNode {
     int height;
     struct AVLNode *left;
     struct AVLNode *right;
+    struct AVLNode *parent;
 } *AVLNode;
 
 struct OrderedMap {
@@ -28,7 +41,7 @@ struct OrderedMap {
 
 struct OrderedMapIterator {
     OrderedMap map;
-    AVLNode current;
+    OrderedMapCursor cursor;
 };
 
 // Helper function prototypes
@@ -37,6 +50,9 @@ static void destroy_node(AVLNode node);
 static AVLNode insert_node(AVLNode node, double key, void *value, int *inserted);
 static AVLNode remove_node(AVLNode node, double key, int *removed);
 static AVLNode find_min(AVLNode node);
+static AVLNode find_max(AVLNode node);
+static AVLNode successor(AVLNode node);
+static AVLNode predecessor(AVLNode node);
 static int get_height(AVLNode node);
 static int get_balance(AVLNode node);
 static AVLNode rotate_right(AVLNode y);
@@ -66,6 +82,7 @@ int OrderedMap_insert(OrderedMap map, double key, void *value) {
     if (!map) return 0;
     int inserted = 0;
     map->root = insert_node(map->root, key, value, &inserted);
+    if (map->root) map->root->parent = NULL;
     if (inserted) map->size++;
     return inserted;
 }
@@ -74,6 +91,7 @@ int OrderedMap_remove(OrderedMap map, double key) {
     if (!map) return 0;
     int removed = 0;
     map->root = remove_node(map->root, key, &removed);
+    if (map->root) map->root->parent = NULL;
     if (removed) map->size--;
     return removed;
 }
@@ -91,6 +109,19 @@ int OrderedMap_get(const OrderedMap map, double key, void **value) {
     return 0;
 }
 
+void OrderedMap_prefetch(const OrderedMap map, double key) {
+    if (!map) return;
+    AVLNode current = map->root;
+    for (int depth = 0; current && depth < ORDERED_MAP_PREFETCH_DEPTH; depth++) {
+        if (key == current->key) {
+            PREFETCH(current->value);
+            return;
+        }
+        current = (key < current->key) ? current->left : current->right;
+    }
+    if (current) PREFETCH(current);
+}
+
 int OrderedMap_get_min(const OrderedMap map, double *key, void **value) {
     if (!map || !map->root) return 0;
     AVLNode min = find_min(map->root);
@@ -101,8 +132,7 @@ int OrderedMap_get_min(const OrderedMap map, double *key, void **value) {
 
 int OrderedMap_get_max(const OrderedMap map, double *key, void **value) {
     if (!map || !map->root) return 0;
-    AVLNode max = map->root;
-    while (max->right) max = max->right;
+    AVLNode max = find_max(map->root);
     if (key) *key = max->key;
     if (value) *value = max->value;
     return 1;
@@ -112,13 +142,16 @@ size_t OrderedMap_size(const OrderedMap map) {
     return map ? map->size : 0;
 }
 
+size_t OrderedMap_memory_usage(const OrderedMap map) {
+    return map ? sizeof(struct OrderedMap) + map->size * sizeof(struct AVLNode) : 0;
+}
+
 OrderedMapIterator OrderedMap_front(OrderedMap map) {
     if (!map) return NULL;
     OrderedMapIterator iter = malloc(sizeof(struct OrderedMapIterator));
     if (!iter) return NULL;
     iter->map = map;
-    iter->current = map->root;
-    while (iter->current && iter->current->left) iter->current = iter->current->left;
+    OrderedMap_cursor_front(map, &iter->cursor);
     return iter;
 }
 
@@ -127,8 +160,7 @@ OrderedMapIterator OrderedMap_back(OrderedMap map) {
     OrderedMapIterator iter = malloc(sizeof(struct OrderedMapIterator));
     if (!iter) return NULL;
     iter->map = map;
-    iter->current = map->root;
-    while (iter->current && iter->current->right) iter->current = iter->current->right;
+    OrderedMap_cursor_back(map, &iter->cursor);
     return iter;
 }
 
@@ -140,69 +172,71 @@ void OrderedMapIterator_destroy(OrderedMapIterator *iter) {
 
 int OrderedMapIterator_get(OrderedMapIterator iter, double *key, void **value) {
     if (value) *value = NULL;
-    if (!iter || !iter->current) return 0;
-    if (key) *key = iter->current->key;
-    if (value) *value = iter->current->value;
-    return 1;
+    if (!iter) return 0;
+    return OrderedMapCursor_get(&iter->cursor, key, value);
 }
 
 // Returns 0 if the iterator is at the end of the map
 int OrderedMapIterator_next(OrderedMapIterator iter) {
-    if (!iter || !iter->current) return 0;
-    if (iter->current->right) {
-        iter->current = find_min(iter->current->right);
-    } else {
-        AVLNode parent = NULL;
-        AVLNode temp = iter->map->root;
-        // First ancestor of current node whose left child is also ancestor of current node
-        while (temp) {
-            if (iter->current->key < temp->key) {
-                parent = temp;
-                temp = temp->left;
-            } else if (iter->current->key > temp->key) {
-                temp = temp->right;
-            } else {
-                break;
-            }
-        }
-        iter->current = parent;
-    }
-
-    return iter->current ? 1 : 0;
+    return iter ? OrderedMapCursor_next(&iter->cursor) : 0;
 }
 
 int OrderedMapIterator_prev(OrderedMapIterator iter) {
-    if (!iter || !iter->current) return 0;
-    if (iter->current->left) { //Max of left subtree
-        iter->current = iter->current->left;
-        while (iter->current->right) iter->current = iter->current->right;
-    } else {
-        AVLNode parent = NULL;
-        AVLNode temp = iter->map->root;
-        while (temp) {
-            if (iter->current->key > temp->key) {
-                parent = temp;
-                temp = temp->right;
-            } else if (iter->current->key < temp->key) {
-                temp = temp->left;
-            } else {
-                break;
-            }
-        }
-        iter->current = parent;
+    return iter ? OrderedMapCursor_prev(&iter->cursor) : 0;
+}
+
+int OrderedMap_cursor_front(const OrderedMap map, OrderedMapCursor *cursor) {
+    if (!cursor) return 0;
+    cursor->node = map ? find_min(map->root) : NULL;
+    return cursor->node ? 1 : 0;
+}
+
+int OrderedMap_cursor_back(const OrderedMap map, OrderedMapCursor *cursor) {
+    if (!cursor) return 0;
+    cursor->node = map ? find_max(map->root) : NULL;
+    return cursor->node ? 1 : 0;
+}
+
+int OrderedMap_cursor_find(const OrderedMap map, double key, OrderedMapCursor *cursor) {
+    if (!cursor) return 0;
+    AVLNode current = map ? map->root : NULL;
+    while (current && key != current->key) {
+        current = (key < current->key) ? current->left : current->right;
     }
+    cursor->node = current;
+    return current ? 1 : 0;
+}
+
+int OrderedMapCursor_get(const OrderedMapCursor *cursor, double *key, void **value) {
+    if (value) *value = NULL;
+    if (!cursor || !cursor->node) return 0;
+    if (key) *key = cursor->node->key;
+    if (value) *value = cursor->node->value;
+    return 1;
+}
+
+int OrderedMapCursor_next(OrderedMapCursor *cursor) {
+    if (!cursor || !cursor->node) return 0;
+    cursor->node = successor(cursor->node);
+    return cursor->node ? 1 : 0;
+}
 
-    return iter->current ? 1 : 0;
+int OrderedMapCursor_prev(OrderedMapCursor *cursor) {
+    if (!cursor || !cursor->node) return 0;
+    cursor->node = predecessor(cursor->node);
+    return cursor->node ? 1 : 0;
 }
 
 // Helper function implementations
 static AVLNode create_node(double key, void *value) {
     AVLNode node = malloc(sizeof(struct AVLNode));
     if (!node) return NULL;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
     node->key = key;
     node->value = value;
     node->height = 1;
     node->left = node->right = NULL;
+    node->parent = NULL;
     return node;
 }
 
@@ -220,8 +254,10 @@ static AVLNode insert_node(AVLNode node, double key, void *value, int *inserted)
     }
     if (key < node->key) {
         node->left = insert_node(node->left, key, value, inserted);
+        if (node->left) node->left->parent = node;
     } else if (key > node->key) {
         node->right = insert_node(node->right, key, value, inserted);
+        if (node->right) node->right->parent = node;
     } else {
         node->value = value; // Update value if key exists
         *inserted = 0;
@@ -250,8 +286,10 @@ static AVLNode remove_node(AVLNode node, double key, int *removed) {
     if (!node) return NULL;
     if (key < node->key) {
         node->left = remove_node(node->left, key, removed);
+        if (node->left) node->left->parent = node;
     } else if (key > node->key) {
         node->right = remove_node(node->right, key, removed);
+        if (node->right) node->right->parent = node;
     } else {
         *removed = 1;
         if (!node->left || !node->right) {
@@ -263,6 +301,7 @@ static AVLNode remove_node(AVLNode node, double key, int *removed) {
         node->key = temp->key;
         node->value = temp->value;
         node->right = remove_node(node->right, temp->key, removed);
+        if (node->right) node->right->parent = node;
     }
 
     if (!node) return NULL;
@@ -288,6 +327,32 @@ static AVLNode find_min(AVLNode node) {
     return node;
 }
 
+static AVLNode find_max(AVLNode node) {
+    while (node && node->right) node = node->right;
+    return node;
+}
+
+// In-order successor: leftmost of the right subtree, else the first ancestor we reach from its left
+static AVLNode successor(AVLNode node) {
+    if (node->right) return find_min(node->right);
+    AVLNode parent = node->parent;
+    while (parent && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+static AVLNode predecessor(AVLNode node) {
+    if (node->left) return find_max(node->left);
+    AVLNode parent = node->parent;
+    while (parent && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
 static int get_height(AVLNode node) {
     return node ? node->height : 0;
 }
@@ -303,6 +368,10 @@ static AVLNode rotate_right(AVLNode y) {
     x->right = y;
     y->left = T;
 
+    x->parent = y->parent;
+    y->parent = x;
+    if (T) T->parent = y;
+
     y->height = 1 + (get_height(y->left) > get_height(y->right) ? get_height(y->left) : get_height(y->right));
     x->height = 1 + (get_height(x->left) > get_height(x->right) ? get_height(x->left) : get_height(x->right));
 
@@ -316,6 +385,10 @@ static AVLNode rotate_left(AVLNode x) {
     y->left = x;
     x->right = T;
 
+    y->parent = x->parent;
+    x->parent = y;
+    if (T) T->parent = x;
+
     x->height = 1 + (get_height(x->left) > get_height(x->right) ? get_height(x->left) : get_height(x->right));
     y->height = 1 + (get_height(y->left) > get_height(y->right) ? get_height(y->left) : get_height(y->right));
 
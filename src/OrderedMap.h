@@ -5,7 +5,12 @@
  * This module provides an ordered map data structure, supporting keys as doubles. 
  * An OrderedMap stores key-value pairs, allowing for efficient insertion, deletion,
  * and lookup operations while maintaining keys in sorted order.
- * All Operations are performed in O(log n) time complexity.
+ * All Operations are performed in O(log n) time complexity. Stepping an iterator is
+ * amortized O(1), so walking the whole map is O(n).
+ *
+ * Iterators come in two forms: OrderedMapIterator is heap-allocated and must be destroyed,
+ * while OrderedMapCursor is a plain struct that can live on the stack. Both are invalidated
+ * by inserting into or removing from the map.
  * 
  */
 #ifndef ORDERED_MAP_H
@@ -18,6 +23,11 @@ typedef struct OrderedMap *OrderedMap;
 
 typedef struct OrderedMapIterator *OrderedMapIterator;
 
+// Stack-allocatable iterator. Its field is private to OrderedMap.c.
+typedef struct OrderedMapCursor {
+    struct AVLNode *node;
+} OrderedMapCursor;
+
 /**
  * Creates a new OrderedMap instance.
  *
@@ -61,6 +71,17 @@ int OrderedMap_remove(OrderedMap map, double key);
  */
 int OrderedMap_get(const OrderedMap map, double key, void **value);
 
+/**
+ * Starts loading what a later lookup of key will read past the top of the tree, to
+ * overlap its cache misses with other work. The top few levels, which every lookup
+ * passes through, are walked; the node the walk stops at, or the value if key is
+ * found there, is prefetched.
+ *
+ * @param map The OrderedMap instance.
+ * @param key The key that will be looked up.
+ */
+void OrderedMap_prefetch(const OrderedMap map, double key);
+
 /**
  * Retrieves the key-value pair with the minimum key in the map.
  *
@@ -89,6 +110,14 @@ int OrderedMap_get_max(const OrderedMap map, double *key, void **value);
  */
 size_t OrderedMap_size(const OrderedMap map);
 
+/**
+ * Gets the bytes the map holds for its nodes, not counting the values they point to.
+ *
+ * @param map The OrderedMap instance.
+ * @return The bytes allocated, or 0 if map is NULL.
+ */
+size_t OrderedMap_memory_usage(const OrderedMap map);
+
 /**
  * Creates a new iterator for the map, starting at the first key-value pair.
  *
@@ -138,4 +167,58 @@ int OrderedMapIterator_next(OrderedMapIterator iter);
  */
 int OrderedMapIterator_prev(OrderedMapIterator iter);
 
+/**
+ * Positions a cursor at the first key-value pair of the map.
+ *
+ * @param map The OrderedMap instance.
+ * @param cursor The cursor to initialize (typically stack-allocated).
+ * @return 1 if the cursor points at a pair, 0 if the map is empty.
+ */
+int OrderedMap_cursor_front(const OrderedMap map, OrderedMapCursor *cursor);
+
+/**
+ * Positions a cursor at the last key-value pair of the map.
+ *
+ * @param map The OrderedMap instance.
+ * @param cursor The cursor to initialize (typically stack-allocated).
+ * @return 1 if the cursor points at a pair, 0 if the map is empty.
+ */
+int OrderedMap_cursor_back(const OrderedMap map, OrderedMapCursor *cursor);
+
+/**
+ * Positions a cursor at the pair with the given key, to step from there to its neighbors.
+ *
+ * @param map The OrderedMap instance.
+ * @param key The key to find.
+ * @param cursor The cursor to initialize (typically stack-allocated).
+ * @return 1 if the cursor points at the pair, 0 if the key is not in the map.
+ */
+int OrderedMap_cursor_find(const OrderedMap map, double key, OrderedMapCursor *cursor);
+
+/**
+ * Retrieves the key-value pair at the current cursor position.
+ *
+ * @param cursor The cursor.
+ * @param key Output pointer to store the key.
+ * @param value Output pointer to store the value.
+ * @return 1 if the cursor is valid, 0 if the end of the map is reached.
+ */
+int OrderedMapCursor_get(const OrderedMapCursor *cursor, double *key, void **value);
+
+/**
+ * Advances the cursor to the next key-value pair in the map.
+ *
+ * @param cursor The cursor.
+ * @return 1 if the cursor was successfully advanced, 0 if the end of the map is reached.
+ */
+int OrderedMapCursor_next(OrderedMapCursor *cursor);
+
+/**
+ * Moves the cursor to the previous key-value pair in the map.
+ *
+ * @param cursor The cursor.
+ * @return 1 if the cursor was successfully moved, 0 if the beginning of the map is reached.
+ */
+int OrderedMapCursor_prev(OrderedMapCursor *cursor);
+
 #endif // ORDERED_MAP_H
\ No newline at end of file
@@ -0,0 +1,143 @@
+/*******************************************************************************************/
+/* Pool.c - Implementation file for the Pool module
+ *
+ * This file implements a fixed-size block allocator. Each slab is a single malloc'd
+ * region holding a header followed by its blocks. Free blocks are threaded onto an
+ * intrusive singly-linked freelist through their first word.
+ */
+
+#include "Pool.h"
+#include "Instrument.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+#define POOL_DEFAULT_BLOCKS_PER_SLAB 256
+#define POOL_ALIGNMENT (_Alignof(max_align_t))
+
+// Freelist link stored inside each free block
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} *FreeBlock;
+
+// Slab header; the blocks follow it in the same allocation
+typedef struct Slab {
+    struct Slab *next;
+    size_t block_count;
+} *Slab;
+
+struct Pool {
+    size_t block_size;      /**< Size of each block, rounded up to POOL_ALIGNMENT. */
+    size_t blocks_per_slab; /**< Blocks added each time the pool grows. */
+    Slab slabs;             /**< All slabs owned by the pool. */
+    FreeBlock free_list;    /**< Blocks available for reuse. */
+    size_t capacity;        /**< Total blocks across all slabs. */
+    size_t in_use;          /**< Blocks currently handed out. */
+};
+
+// Helper function prototypes
+static int add_slab(Pool pool, size_t block_count);
+static size_t slab_header_size(void);
+
+// Public function implementations
+Pool Pool_create(size_t block_size, size_t blocks_per_slab) {
+    if (block_size == 0) return NULL;
+
+    Pool pool = malloc(sizeof(struct Pool));
+    if (!pool) return NULL;
+
+    if (block_size < sizeof(struct FreeBlock)) block_size = sizeof(struct FreeBlock);
+    pool->block_size = (block_size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+    pool->blocks_per_slab = blocks_per_slab ? blocks_per_slab : POOL_DEFAULT_BLOCKS_PER_SLAB;
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->capacity = 0;
+    pool->in_use = 0;
+    return pool;
+}
+
+void Pool_destroy(Pool *pool) {
+    if (!pool || !*pool) return;
+    Pool p = *pool;
+
+    Slab slab = p->slabs;
+    while (slab) {
+        Slab next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(p);
+
+    *pool = NULL;
+}
+
+int Pool_reserve(Pool pool, size_t count) {
+    if (!pool) return 0;
+    size_t available = pool->capacity - pool->in_use;
+    if (available >= count) return 1;
+    return add_slab(pool, count - available);
+}
+
+void *Pool_alloc(Pool pool) {
+    if (!pool) return NULL;
+    if (!pool->free_list && !add_slab(pool, pool->blocks_per_slab)) return NULL;
+
+    FreeBlock block = pool->free_list;
+    pool->free_list = block->next;
+    pool->in_use++;
+    return block;
+}
+
+void Pool_free(Pool pool, void *block) {
+    if (!pool || !block) return;
+    FreeBlock b = block;
+    b->next = pool->free_list;
+    pool->free_list = b;
+    pool->in_use--;
+}
+
+size_t Pool_block_size(const Pool pool) {
+    return pool ? pool->block_size : 0;
+}
+
+size_t Pool_in_use(const Pool pool) {
+    return pool ? pool->in_use : 0;
+}
+
+size_t Pool_capacity(const Pool pool) {
+    return pool ? pool->capacity : 0;
+}
+
+size_t Pool_memory_usage(const Pool pool) {
+    if (!pool) return 0;
+    size_t bytes = sizeof(struct Pool) + pool->capacity * pool->block_size;
+    for (Slab slab = pool->slabs; slab; slab = slab->next) bytes += slab_header_size();
+    return bytes;
+}
+
+// Helper function implementations
+static size_t slab_header_size(void) {
+    return (sizeof(struct Slab) + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+}
+
+// Allocates a slab of block_count blocks and pushes them all onto the freelist
+static int add_slab(Pool pool, size_t block_count) {
+    if (block_count == 0) return 1;
+    if (block_count > (SIZE_MAX - slab_header_size()) / pool->block_size) return 0;
+
+    Slab slab = malloc(slab_header_size() + block_count * pool->block_size);
+    if (!slab) return 0;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    slab->block_count = block_count;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    // Push in reverse so blocks are handed out in address order
+    char *blocks = (char *)slab + slab_header_size();
+    for (size_t i = block_count; i > 0; --i) {
+        FreeBlock b = (FreeBlock)(blocks + (i - 1) * pool->block_size);
+        b->next = pool->free_list;
+        pool->free_list = b;
+    }
+    pool->capacity += block_count;
+    return 1;
+}
@@ -0,0 +1,92 @@
+/* Pool.h - Header file for the Pool module
+ *
+ * This module provides a fixed-size block allocator. Blocks are carved out of
+ * large slabs obtained from the system allocator, and freed blocks are kept on
+ * a freelist for reuse, so once a pool has grown to its working size, allocating
+ * and freeing blocks never calls malloc or free.
+ *
+ * Modules that accept a Pool treat a NULL pool as "use the system allocator".
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// Pool type definition
+typedef struct Pool *Pool;
+
+/**
+ * Creates a new Pool instance.
+ *
+ * @param block_size The size in bytes of every block handed out by the pool. Must be greater than 0.
+ * @param blocks_per_slab The number of blocks to allocate each time the pool runs dry (0 for a default).
+ * @return A newly allocated Pool instance, or NULL on failure.
+ */
+Pool Pool_create(size_t block_size, size_t blocks_per_slab);
+
+/**
+ * Destroys a Pool instance, releasing every slab back to the system allocator.
+ * Any blocks still in use become invalid.
+ *
+ * @param pool A pointer to the Pool instance to destroy.
+ */
+void Pool_destroy(Pool *pool);
+
+/**
+ * Ensures at least count blocks can be allocated without growing the pool.
+ *
+ * @param pool The Pool instance.
+ * @param count The number of free blocks required.
+ * @return 1 if the operation is successful, 0 on failure.
+ */
+int Pool_reserve(Pool pool, size_t count);
+
+/**
+ * Allocates a block from the pool. The block is not initialized.
+ *
+ * @param pool The Pool instance.
+ * @return A pointer to a block of the pool's block size, or NULL on failure.
+ */
+void *Pool_alloc(Pool pool);
+
+/**
+ * Returns a block to the pool.
+ *
+ * @param pool The Pool instance the block was allocated from.
+ * @param block The block to release (NULL is ignored).
+ */
+void Pool_free(Pool pool, void *block);
+
+/**
+ * Gets the size of the blocks handed out by the pool.
+ *
+ * @param pool The Pool instance.
+ * @return The block size in bytes (rounded up for alignment), or 0 if pool is NULL.
+ */
+size_t Pool_block_size(const Pool pool);
+
+/**
+ * Gets the number of blocks currently allocated from the pool.
+ *
+ * @param pool The Pool instance.
+ * @return The number of blocks in use.
+ */
+size_t Pool_in_use(const Pool pool);
+
+/**
+ * Gets the total number of blocks the pool holds, in use or free.
+ *
+ * @param pool The Pool instance.
+ * @return The number of blocks across all slabs.
+ */
+size_t Pool_capacity(const Pool pool);
+
+/**
+ * Gets the bytes the pool holds: every slab, whether its blocks are in use or free.
+ *
+ * @param pool The Pool instance.
+ * @return The bytes allocated, or 0 if pool is NULL.
+ */
+size_t Pool_memory_usage(const Pool pool);
+
+#endif // POOL_H
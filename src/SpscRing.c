@@ -0,0 +1,130 @@
+/*******************************************************************************************/
+/* SpscRing.c - Implementation file for the SpscRing module
+ *
+ * Head and tail are free-running counters; a record's slot is its counter masked by
+ * capacity - 1, and the ring is full when tail - head == capacity. A batch that wraps
+ * past the end of the array is copied in two pieces.
+ */
+
+#include "SpscRing.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPSC_CACHE_LINE 64
+
+// SpscRing structure. Each group of fields below is on its own cache line.
+struct SpscRing {
+    // Consumer's line
+    alignas(SPSC_CACHE_LINE) atomic_size_t head; // Next record to pop
+    size_t cached_tail;                          // Consumer's last read of tail
+
+    // Producer's line
+    alignas(SPSC_CACHE_LINE) atomic_size_t tail; // Next slot to push
+    size_t cached_head;                          // Producer's last read of head
+
+    // Read-only after creation
+    alignas(SPSC_CACHE_LINE) unsigned char *records;
+    size_t record_size;
+    size_t mask;
+};
+
+// Helper function prototypes
+static void copy_in(SpscRing ring, size_t index, const unsigned char *records, size_t count);
+static void copy_out(SpscRing ring, size_t index, unsigned char *records, size_t count);
+
+// Public function implementations
+SpscRing SpscRing_create(size_t record_size, size_t capacity) {
+    if (record_size == 0 || capacity == 0) return NULL;
+
+    size_t slots = 1;
+    while (slots < capacity) slots <<= 1;
+
+    SpscRing ring = aligned_alloc(SPSC_CACHE_LINE, sizeof(struct SpscRing));
+    if (!ring) return NULL;
+    memset(ring, 0, sizeof(struct SpscRing));
+
+    ring->records = malloc(slots * record_size);
+    if (!ring->records) {
+        free(ring);
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->record_size = record_size;
+    ring->mask = slots - 1;
+    return ring;
+}
+
+void SpscRing_destroy(SpscRing *ring) {
+    if (!ring || !*ring) return;
+
+    free((*ring)->records);
+    free(*ring);
+    *ring = NULL;
+}
+
+int SpscRing_push(SpscRing ring, const void *record) {
+    return SpscRing_push_batch(ring, record, 1) == 1;
+}
+
+int SpscRing_pop(SpscRing ring, void *record) {
+    return SpscRing_pop_batch(ring, record, 1) == 1;
+}
+
+size_t SpscRing_push_batch(SpscRing ring, const void *records, size_t count) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t free_slots = ring->mask + 1 - (tail - ring->cached_head);
+    if (free_slots < count) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        free_slots = ring->mask + 1 - (tail - ring->cached_head);
+    }
+    if (count > free_slots) count = free_slots;
+    if (count == 0) return 0;
+
+    copy_in(ring, tail & ring->mask, records, count);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+size_t SpscRing_pop_batch(SpscRing ring, void *records, size_t max) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t available = ring->cached_tail - head;
+    if (available < max) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        available = ring->cached_tail - head;
+    }
+    if (max > available) max = available;
+    if (max == 0) return 0;
+
+    copy_out(ring, head & ring->mask, records, max);
+    atomic_store_explicit(&ring->head, head + max, memory_order_release);
+    return max;
+}
+
+size_t SpscRing_size(SpscRing ring) {
+    if (!ring) return 0;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
+
+size_t SpscRing_capacity(SpscRing ring) {
+    return ring ? ring->mask + 1 : 0;
+}
+
+// Helper function implementations
+static void copy_in(SpscRing ring, size_t index, const unsigned char *records, size_t count) {
+    size_t first = ring->mask + 1 - index;
+    if (first > count) first = count;
+    memcpy(ring->records + index * ring->record_size, records, first * ring->record_size);
+    memcpy(ring->records, records + first * ring->record_size, (count - first) * ring->record_size);
+}
+
+static void copy_out(SpscRing ring, size_t index, unsigned char *records, size_t count) {
+    size_t first = ring->mask + 1 - index;
+    if (first > count) first = count;
+    memcpy(records, ring->records + index * ring->record_size, first * ring->record_size);
+    memcpy(records + first * ring->record_size, ring->records, (count - first) * ring->record_size);
+}
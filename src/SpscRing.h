@@ -0,0 +1,98 @@
+/* SpscRing.h - Header file for the SpscRing module
+ *
+ * This module provides a bounded, lock-free ring of fixed-size records for exactly one
+ * producer thread and one consumer thread. Records are copied in and out, so neither
+ * side holds a pointer into the ring.
+ *
+ * The producer writes only the tail and the consumer only the head; each lives on its
+ * own cache line so the two threads do not invalidate each other's line on every
+ * operation. A push publishes the record with a release store of the tail, and a pop
+ * reads it after an acquire load, so everything the producer wrote before pushing is
+ * visible to the consumer once it has popped the record.
+ *
+ * Each side also keeps a private copy of the other side's index and re-reads the shared
+ * one only when its copy says the ring is full (or empty), so in steady state a push or
+ * pop touches the other thread's cache line rarely. The batch functions move many
+ * records per index update.
+ */
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+
+// SpscRing type definition
+typedef struct SpscRing *SpscRing;
+
+/**
+ * Creates a new SpscRing instance.
+ *
+ * @param record_size The size in bytes of each record. Must be greater than 0.
+ * @param capacity The number of records the ring holds, rounded up to a power of two.
+ * @return A newly allocated SpscRing instance, or NULL on failure.
+ */
+SpscRing SpscRing_create(size_t record_size, size_t capacity);
+
+/**
+ * Destroys an SpscRing instance. Neither thread may be using it.
+ *
+ * @param ring A pointer to the SpscRing instance to destroy.
+ */
+void SpscRing_destroy(SpscRing *ring);
+
+/**
+ * Copies a record into the ring. Producer thread only.
+ *
+ * @param ring The SpscRing instance.
+ * @param record The record to copy (record_size bytes).
+ * @return 1 if the record was pushed, 0 if the ring is full.
+ */
+int SpscRing_push(SpscRing ring, const void *record);
+
+/**
+ * Copies the oldest record out of the ring and removes it. Consumer thread only.
+ *
+ * @param ring The SpscRing instance.
+ * @param record Output buffer for the record (record_size bytes).
+ * @return 1 if a record was popped, 0 if the ring is empty.
+ */
+int SpscRing_pop(SpscRing ring, void *record);
+
+/**
+ * Copies up to count records into the ring, in order. Producer thread only.
+ *
+ * @param ring The SpscRing instance.
+ * @param records The records to copy (count * record_size bytes).
+ * @param count The number of records offered.
+ * @return The number of records pushed (the first ones offered), 0 if the ring is full.
+ */
+size_t SpscRing_push_batch(SpscRing ring, const void *records, size_t count);
+
+/**
+ * Copies up to max of the oldest records out of the ring and removes them, publishing
+ * the new head once for the whole batch. Consumer thread only.
+ *
+ * @param ring The SpscRing instance.
+ * @param records Output buffer for up to max records.
+ * @param max The number of records the buffer holds.
+ * @return The number of records popped, 0 if the ring is empty.
+ */
+size_t SpscRing_pop_batch(SpscRing ring, void *records, size_t max);
+
+/**
+ * Gets the number of records in the ring. Exact only when called from one of the two
+ * threads while the other is idle; otherwise a snapshot that may already be stale.
+ *
+ * @param ring The SpscRing instance.
+ * @return The number of records waiting to be popped.
+ */
+size_t SpscRing_size(SpscRing ring);
+
+/**
+ * Gets the number of records the ring can hold.
+ *
+ * @param ring The SpscRing instance.
+ * @return The capacity given to SpscRing_create, rounded up to a power of two.
+ */
+size_t SpscRing_capacity(SpscRing ring);
+
+#endif // SPSC_RING_H
@@ -0,0 +1,120 @@
+/* TestCsvReplay.c - Unit tests for the CsvReplay module
+ *
+ * This file contains a main function that tests the CsvReplay module: tick parsing,
+ * replaying ADD and REMOVE lines, optional timestamp columns, malformed lines and the
+ * callback for other commands.
+ */
+
+#include "CsvReplay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+static int parse(const char *text, double tick_size, long expected) {
+    long ticks = -1;
+    return CsvReplay_parse_ticks(text, strlen(text), tick_size, &ticks) && ticks == expected;
+}
+
+static int rejects(const char *text) {
+    long ticks;
+    return !CsvReplay_parse_ticks(text, strlen(text), 0.01, &ticks);
+}
+
+// Records the other-command lines handed to the callback
+struct OtherLines {
+    int count;
+    char last[64];
+};
+
+static void on_other(void *context, OrderBook book, const char *line, size_t length) {
+    (void)book;
+    struct OtherLines *others = context;
+    others->count++;
+    if (length >= sizeof(others->last)) length = sizeof(others->last) - 1;
+    memcpy(others->last, line, length);
+    others->last[length] = '\0';
+}
+
+int main() {
+    // Test 1: Tick parsing
+    print_test_result("Parse whole price", parse("100", 0.01, 10000));
+    print_test_result("Parse decimal price", parse("100.25", 0.01, 10025));
+    print_test_result("Parse rounds to nearest tick", parse("100.256", 0.01, 10026) && parse("100.254", 0.01, 10025));
+    print_test_result("Parse coarse tick", parse("101.3", 0.5, 203) && parse("0.75", 0.25, 3));
+    print_test_result("Parse leading point", parse(".5", 0.01, 50) && parse("7.", 0.01, 700));
+    print_test_result("Parse ignores digits past nine decimals", parse("1.0000000004", 0.000000001, 1000000000));
+    print_test_result("Reject malformed prices", rejects("") && rejects(".") && rejects("-1") && rejects("1.2.3") && rejects("12a"));
+
+    // Test 2: Field splitting and parsing
+    struct CsvField fields[4];
+    const char *line = "add,,42,99999999999999999999,x";
+    int count = CsvReplay_split_fields(line, strlen(line), fields, 4);
+    long number = 0;
+    print_test_result("Split counts every field", count == 5 && fields[1].length == 0 && fields[2].length == 2);
+    print_test_result("Field compare ignores case", CsvReplay_field_equals(&fields[0], "ADD") && !CsvReplay_field_equals(&fields[0], "AD"));
+    print_test_result("Parse number field", CsvReplay_parse_long(&fields[2], &number) && number == 42);
+    print_test_result("Reject empty and overflowing numbers", !CsvReplay_parse_long(&fields[1], &number) &&
+                      !CsvReplay_parse_long(&fields[3], &number) && !CsvReplay_parse_long(&fields[0], &number));
+
+    // Test 3: Replay ADD and REMOVE lines
+    OrderBook book = OrderBook_create();
+    if (!book) {
+        printf("Failed to create OrderBook instance\n");
+        return 1;
+    }
+
+    const char data[] =
+        "ADD,o1,u1,sell,100.50,10,1000\n"
+        "ADD,o2,u2,sell,100.55,5,1001\r\n"
+        "\n"
+        "add,o3,u3,BUY,100.55,12,1002\n"
+        "SHOW_BEST\n"
+        "ADD,o4,u4,buy,99.00,7\n"
+        "REMOVE,o4\n"
+        "REMOVE,missing\n"
+        "ADD,o5,u5,buy,abc,7\n"
+        "ADD,o6,u6,buy,99.00\n"
+        "ADD,o7,u7,buy,99.00,1,2,3\n"
+        "ADD,o8,u8,buy,99.00,4294967297\n"
+        "GET_TRADE,TRADE-00000001";
+
+    struct OtherLines others;
+    memset(&others, 0, sizeof(others));
+    struct CsvReplayOptions options = { 0.01, on_other, &others };
+    struct CsvReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    int ok = CsvReplay_buffer(book, data, sizeof(data) - 1, &options, &stats);
+    print_test_result("Replay buffer", ok);
+    print_test_result("Count lines", stats.lines == 12);
+    print_test_result("Count adds", stats.adds == 4);
+    print_test_result("Count removes", stats.removes == 1);
+    print_test_result("Count trades", stats.trades == 2);
+    print_test_result("Count errors", stats.errors == 4);
+    print_test_result("Other commands go to the callback", stats.others == 2 && others.count == 2 && strcmp(others.last, "GET_TRADE,TRADE-00000001") == 0);
+    print_test_result("Book state after replay", OrderBook_get_best_bid(book) == 0.0 && OrderBook_get_best_ask(book) == 100.55);
+
+    // Test 4: Trades carry tick-rounded prices
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, 0);
+    const struct TradeRecord *first = OrderBook_next_trade(book, &cursor);
+    const struct TradeRecord *second = OrderBook_next_trade(book, &cursor);
+    print_test_result("Trade prices", first && second && first->price == 100.50 && second->price == 100.55);
+    print_test_result("Trade sizes", first && second && first->size == 10 && second->size == 2);
+
+    // Test 5: Invalid arguments and missing files
+    memset(&stats, 0, sizeof(stats));
+    print_test_result("NULL book", !CsvReplay_buffer(NULL, data, sizeof(data) - 1, NULL, &stats));
+    print_test_result("Empty buffer", CsvReplay_buffer(book, "", 0, NULL, &stats) && stats.lines == 0);
+    print_test_result("Missing file", !CsvReplay_file(book, "/nonexistent/file.csv", NULL, &stats));
+
+    // Cleanup
+    OrderBook_destroy(&book);
+    printf("All tests completed.\n");
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+/* TestDepthSnapshot.c - Unit tests for the DepthSnapshot module
+ *
+ * This file contains a main function that tests publishing and reading a DepthSnapshot,
+ * then has reader threads check every view they copy while a writer thread publishes,
+ * both to a bare snapshot and through an OrderBook that is adding and removing orders.
+ */
+
+#include "DepthSnapshot.h"
+#include "OrderBook.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PUBLISHES 200000 // Views the writer publishes to the bare snapshot
+#define BOOK_ORDERS 20000 // Orders the writer adds to the book
+#define READERS 2
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+// The levels of the k-th patterned publish; a reader can recompute them from the sequence
+static void patterned_levels(uint64_t k, struct OrderBookLevelView *bids, int *bid_count,
+                             struct OrderBookLevelView *asks, int *ask_count) {
+    *bid_count = (int)(k % 6);
+    *ask_count = (int)((k / 3) % 6);
+    for (int i = 0; i < 6; i++) {
+        bids[i].price = (double)k - i * 0.5;
+        bids[i].size = (int)(k % 100000) * 7 + i;
+        bids[i].order_count = i + 1;
+        asks[i].price = (double)k + 1 + i * 0.5;
+        asks[i].size = (int)(k % 100000) * 3 + i;
+        asks[i].order_count = i + 2;
+    }
+}
+
+static int same_levels(const struct OrderBookLevelView *a, const struct OrderBookLevelView *b, int count) {
+    for (int i = 0; i < count; i++) {
+        if (a[i].price != b[i].price || a[i].size != b[i].size || a[i].order_count != b[i].order_count) return 0;
+    }
+    return 1;
+}
+
+struct SnapshotReader {
+    DepthSnapshot snapshot;
+    atomic_int *done;
+    atomic_int *ready; // Counts readers that have copied a view
+    long views;        // Views copied
+    long torn;         // Views whose levels do not match their sequence
+    long out_of_order; // Views older than one copied before them
+};
+
+static void *read_patterned(void *arg) {
+    struct SnapshotReader *reader = arg;
+    struct DepthSnapshotView view;
+    struct OrderBookLevelView bids[6], asks[6];
+    int bid_count, ask_count;
+    uint64_t last_version = 0;
+
+    while (!atomic_load(reader->done)) {
+        DepthSnapshot_read(reader->snapshot, &view);
+        if (reader->views++ == 0) atomic_fetch_add(reader->ready, 1);
+        if (view.version < last_version) reader->out_of_order++;
+        last_version = view.version;
+        if (view.version == 0) continue; // Nothing published yet
+
+        patterned_levels(view.sequence, bids, &bid_count, asks, &ask_count);
+        if (bid_count > 5) bid_count = 5;
+        if (ask_count > 5) ask_count = 5;
+        if (view.sequence != view.version || view.bid_count != bid_count || view.ask_count != ask_count ||
+            !same_levels(view.bids, bids, bid_count) || !same_levels(view.asks, asks, ask_count)) {
+            reader->torn++;
+        }
+    }
+    return NULL;
+}
+
+struct BookReader {
+    OrderBook book;
+    atomic_int *done;
+    atomic_int *ready;
+    long views;
+    long invalid;      // Views that could not be the book between two messages
+    long out_of_order;
+};
+
+static void *read_book(void *arg) {
+    struct BookReader *reader = arg;
+    struct DepthSnapshotView view;
+    uint64_t last_sequence = 0;
+
+    while (!atomic_load(reader->done)) {
+        OrderBook_read_depth(reader->book, &view);
+        if (reader->views++ == 0) atomic_fetch_add(reader->ready, 1);
+        if (view.sequence < last_sequence) reader->out_of_order++;
+        last_sequence = view.sequence;
+
+        int valid = view.bid_count <= 3 && view.ask_count <= 3;
+        for (int i = 0; valid && i < view.bid_count; i++) {
+            valid = view.bids[i].size > 0 && view.bids[i].order_count > 0 &&
+                    (i == 0 || view.bids[i].price < view.bids[i - 1].price);
+        }
+        for (int i = 0; valid && i < view.ask_count; i++) {
+            valid = view.asks[i].size > 0 && view.asks[i].order_count > 0 &&
+                    (i == 0 || view.asks[i].price > view.asks[i - 1].price);
+        }
+        // Matching leaves the book uncrossed after every message
+        if (valid && view.bid_count > 0 && view.ask_count > 0) valid = view.bids[0].price < view.asks[0].price;
+        if (!valid) reader->invalid++;
+    }
+    return NULL;
+}
+
+// Waits until every reader has copied a view, so a writer that is quick (or scheduled first
+// on a single CPU) cannot finish before the readers start
+static void wait_for_readers(atomic_int *ready) {
+    while (atomic_load(ready) < READERS) sched_yield();
+}
+
+static void fill_order(struct Order *order, const char *order_id, char side, double price, int quantity) {
+    memset(order, 0, sizeof(*order));
+    strcpy(order->order_id, order_id);
+    strcpy(order->user_id, "user");
+    order->side = side;
+    order->price = price;
+    order->quantity = quantity;
+}
+
+int main() {
+    // Test 1: Publish and read on one thread
+    print_test_result("Invalid depths rejected", !DepthSnapshot_create(0) &&
+                      !DepthSnapshot_create(DEPTH_SNAPSHOT_MAX_LEVELS + 1));
+    DepthSnapshot snapshot = DepthSnapshot_create(5);
+    struct DepthSnapshotView view;
+    print_test_result("New snapshot is empty", DepthSnapshot_read(snapshot, &view) && view.version == 0 &&
+                      view.sequence == 0 && view.bid_count == 0 && view.ask_count == 0 &&
+                      DepthSnapshot_depth(snapshot) == 5);
+
+    struct OrderBookLevelView bids[6], asks[6];
+    int bid_count, ask_count;
+    patterned_levels(5, bids, &bid_count, asks, &ask_count);
+    DepthSnapshot_publish(snapshot, 5, bids, bid_count, asks, ask_count);
+    print_test_result("Read returns what was published", DepthSnapshot_try_read(snapshot, &view) &&
+                      view.version == 1 && view.sequence == 5 && view.bid_count == 5 && view.ask_count == 1 &&
+                      same_levels(view.bids, bids, 5) && same_levels(view.asks, asks, 1));
+    DepthSnapshot_publish(snapshot, 6, bids, 6, NULL, 3);
+    print_test_result("Publish clamps to the depth", DepthSnapshot_read(snapshot, &view) && view.version == 2 &&
+                      view.bid_count == 5 && view.ask_count == 0);
+    print_test_result("Invalid arguments", !DepthSnapshot_read(NULL, &view) && !DepthSnapshot_try_read(snapshot, NULL));
+    DepthSnapshot_destroy(&snapshot);
+    print_test_result("Destroy", snapshot == NULL);
+
+    // Test 2: Readers never see a torn view while a writer publishes
+    snapshot = DepthSnapshot_create(5);
+    atomic_int done = 0;
+    atomic_int ready = 0;
+    pthread_t threads[READERS];
+    struct SnapshotReader snapshot_readers[READERS];
+    for (int i = 0; i < READERS; i++) {
+        snapshot_readers[i] = (struct SnapshotReader){ snapshot, &done, &ready, 0, 0, 0 };
+        pthread_create(&threads[i], NULL, read_patterned, &snapshot_readers[i]);
+    }
+    wait_for_readers(&ready);
+    for (uint64_t k = 1; k <= PUBLISHES; k++) {
+        patterned_levels(k, bids, &bid_count, asks, &ask_count);
+        DepthSnapshot_publish(snapshot, k, bids, bid_count, asks, ask_count);
+    }
+    atomic_store(&done, 1);
+    long torn = 0, out_of_order = 0, views = 0;
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        torn += snapshot_readers[i].torn;
+        out_of_order += snapshot_readers[i].out_of_order;
+        views += snapshot_readers[i].views;
+    }
+    print_test_result("Concurrent views are whole", views > 0 && torn == 0);
+    print_test_result("Concurrent views move forward", out_of_order == 0);
+    DepthSnapshot_destroy(&snapshot);
+
+    // Test 3: A book publishes its depth after every message
+    struct OrderBookConfig config = { .published_depth = 3 };
+    OrderBook book = OrderBook_create_with_config(&config);
+    struct Order order;
+    fill_order(&order, "bid1", '1', 99.0, 10);
+    OrderBook_add_order(book, &order, NULL);
+    fill_order(&order, "bid2", '1', 98.0, 20);
+    OrderBook_add_order(book, &order, NULL);
+    fill_order(&order, "ask1", '0', 101.0, 5);
+    OrderBook_add_order(book, &order, NULL);
+    OrderBook_remove_order(book, "bid2");
+
+    const struct OrderBookLevelView *cached_bids, *cached_asks;
+    OrderBook_peek_top_levels(book, &cached_bids, &bid_count, &cached_asks, &ask_count);
+    print_test_result("Book publishes its depth", OrderBook_read_depth(book, &view) &&
+                      view.sequence == OrderBook_message_sequence(book) && view.version == 4 &&
+                      view.bid_count == bid_count && view.ask_count == ask_count && bid_count == 1 && ask_count == 1 &&
+                      same_levels(view.bids, cached_bids, bid_count) && same_levels(view.asks, cached_asks, ask_count));
+    print_test_result("Book hands out its snapshot", OrderBook_get_depth_snapshot(book) != NULL &&
+                      DepthSnapshot_depth(OrderBook_get_depth_snapshot(book)) == 3);
+    OrderBook_destroy(&book);
+
+    OrderBook plain = OrderBook_create();
+    config.published_depth = DEPTH_SNAPSHOT_MAX_LEVELS + 1;
+    print_test_result("No depth without a published_depth", !OrderBook_read_depth(plain, &view) &&
+                      !OrderBook_get_depth_snapshot(plain) && !OrderBook_create_with_config(&config));
+    OrderBook_destroy(&plain);
+
+    // Test 4: Readers see a valid book while a writer matches and cancels
+    config.published_depth = 3;
+    book = OrderBook_create_with_config(&config);
+    atomic_store(&done, 0);
+    atomic_store(&ready, 0);
+    struct BookReader book_readers[READERS];
+    for (int i = 0; i < READERS; i++) {
+        book_readers[i] = (struct BookReader){ book, &done, &ready, 0, 0, 0 };
+        pthread_create(&threads[i], NULL, read_book, &book_readers[i]);
+    }
+    wait_for_readers(&ready);
+    char order_id[16];
+    uint64_t state = 12345;
+    for (int i = 0; i < BOOK_ORDERS; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        char side = (state >> 33) & 1 ? '1' : '0';
+        double price = 100.0 + (double)((long)((state >> 40) % 11) - 5);
+        snprintf(order_id, sizeof(order_id), "o%d", i);
+        fill_order(&order, order_id, side, price, 1 + (int)((state >> 20) % 50));
+        OrderBook_add_order(book, &order, NULL);
+        if (i >= 10 && (state >> 50) % 3 == 0) {
+            snprintf(order_id, sizeof(order_id), "o%d", i - 10);
+            OrderBook_remove_order(book, order_id);
+        }
+    }
+    atomic_store(&done, 1);
+    long invalid = 0;
+    out_of_order = 0;
+    views = 0;
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        invalid += book_readers[i].invalid;
+        out_of_order += book_readers[i].out_of_order;
+        views += book_readers[i].views;
+    }
+    print_test_result("Concurrent book views are valid", views > 0 && invalid == 0 && out_of_order == 0);
+    OrderBook_read_depth(book, &view);
+    OrderBook_peek_top_levels(book, &cached_bids, &bid_count, &cached_asks, &ask_count);
+    print_test_result("Last view is the final book", view.sequence == OrderBook_message_sequence(book) &&
+                      view.bid_count == bid_count && view.ask_count == ask_count &&
+                      same_levels(view.bids, cached_bids, bid_count) && same_levels(view.asks, cached_asks, ask_count));
+
+    // Cleanup
+    OrderBook_destroy(&book);
+    printf("All tests completed.\n");
+
+    return 0;
+}
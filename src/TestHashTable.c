@@ -97,6 +97,134 @@ void test_resize() {
     HashTable_destroy(&table);
 }
 
+void test_update_and_long_keys() {
+    printf("Testing value updates and long keys...\n");
+    HashTable table = HashTable_create(4);
+    if (!table) {
+        printf("Failed to create hash table.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *long_key = "a-key-that-is-much-longer-than-the-inline-key-storage-of-a-slot";
+    HashTable_add(table, "short", "value1");
+    HashTable_add(table, long_key, "value2");
+    HashTable_add(table, "short", "updated");
+    if (strcmp(HashTable_get(table, "short"), "updated") != 0 ||
+        strcmp(HashTable_get(table, long_key), "value2") != 0 ||
+        HashTable_size(table) != 2) {
+        printf("Update or long key lookup failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (HashTable_remove(table, long_key) != 0 || HashTable_get(table, long_key) ||
+        HashTable_remove(table, long_key) == 0) {
+        printf("Removing a long key failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Update and long key test passed.\n\n");
+    HashTable_destroy(&table);
+}
+
+void test_incremental_resize() {
+    printf("Testing adds and removes across incremental resizes...\n");
+    HashTable table = HashTable_create(8);
+    if (!table) {
+        printf("Failed to create hash table.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Interleave removals with growth so some keys are removed while resizes are in progress
+    static int values[20000];
+    for (int i = 0; i < 20000; ++i) {
+        char key[32];
+        values[i] = i;
+        snprintf(key, sizeof(key), "order-%d", i);
+        if (HashTable_add(table, key, &values[i]) != 0) {
+            printf("Failed to add %s.\n", key);
+            exit(EXIT_FAILURE);
+        }
+        if (i % 3 == 0) {
+            snprintf(key, sizeof(key), "order-%d", i / 2);
+            HashTable_remove(table, key);
+        }
+    }
+
+    size_t expected = 0;
+    for (int i = 0; i < 20000; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "order-%d", i);
+        int *value = HashTable_get(table, key);
+        int removed = i < 10000 && (2 * i) % 3 == 0;
+        if (i < 10000 && (2 * i + 1) % 3 == 0 && 2 * i + 1 < 20000) removed = 1;
+        if (removed ? value != NULL : (value == NULL || *value != i)) {
+            printf("Wrong lookup result for %s.\n", key);
+            exit(EXIT_FAILURE);
+        }
+        if (!removed) expected++;
+    }
+    if (HashTable_size(table) != expected) {
+        printf("Expected size %zu, got %zu.\n", expected, HashTable_size(table));
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Incremental resize test passed.\n\n");
+    HashTable_destroy(&table);
+}
+
+void test_shrink() {
+    printf("Testing shrinking after removals...\n");
+    HashTable table = HashTable_create(16);
+    if (!table) {
+        printf("Failed to create hash table.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t created = HashTable_memory_usage(table);
+    static int values[10000];
+    char key[64];
+    for (int i = 0; i < 10000; ++i) {
+        values[i] = i;
+        snprintf(key, sizeof(key), "order-%d-with-a-key-too-long-to-store-inline", i);
+        HashTable_add(table, key, &values[i]);
+    }
+    size_t grown = HashTable_memory_usage(table);
+    for (int i = 0; i < 10000; ++i) {
+        if (i % 100 == 0) continue;
+        snprintf(key, sizeof(key), "order-%d-with-a-key-too-long-to-store-inline", i);
+        HashTable_remove(table, key);
+    }
+    size_t shrunk = HashTable_memory_usage(table);
+    if (grown <= created || shrunk * 8 > grown || HashTable_size(table) != 100) {
+        printf("Table did not shrink (created %zu, grown %zu, shrunk %zu bytes).\n", created, grown, shrunk);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < 10000; i += 100) {
+        snprintf(key, sizeof(key), "order-%d-with-a-key-too-long-to-store-inline", i);
+        int *value = HashTable_get(table, key);
+        if (!value || *value != i) {
+            printf("Lost %s while shrinking.\n", key);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Emptying the table takes it back to its created size, and no further
+    for (int i = 0; i < 10000; i += 100) {
+        snprintf(key, sizeof(key), "order-%d-with-a-key-too-long-to-store-inline", i);
+        HashTable_remove(table, key);
+    }
+    for (int i = 0; i < 64; ++i) {
+        HashTable_add(table, "churn", &values[0]);
+        HashTable_remove(table, "churn");
+    }
+    if (HashTable_size(table) != 0 || HashTable_memory_usage(table) != created || HashTable_memory_usage(NULL) != 0) {
+        printf("Empty table holds %zu bytes, expected %zu.\n", HashTable_memory_usage(table), created);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Shrink test passed.\n\n");
+    HashTable_destroy(&table);
+}
+
 int main() {
     printf("Starting HashTable Tests...\n\n");
 
@@ -104,6 +232,9 @@ int main() {
     test_add_get();
     test_remove();
     test_resize();
+    test_update_and_long_keys();
+    test_incremental_resize();
+    test_shrink();
 
     printf("All tests passed!\n");
     return 0;
@@ -0,0 +1,94 @@
+/* TestIdTable.c - Unit tests for the IdTable module
+ *
+ * This file contains a main function that tests the IdTable module: interning,
+ * lookup, reference counting and reuse of released handles.
+ */
+
+#include "IdTable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+int main() {
+    IdTable table = IdTable_create(4);
+    if (!table) {
+        printf("Failed to create IdTable instance\n");
+        return 1;
+    }
+
+    // Test 1: Interning assigns dense handles and resolves them back
+    IdHandle order1 = IdTable_intern(table, "order1");
+    IdHandle user1 = IdTable_intern(table, "user1");
+    print_test_result("Intern assigns handles", order1 != ID_HANDLE_NONE && user1 != ID_HANDLE_NONE && order1 != user1);
+    print_test_result("Handles are dense", order1 == 1 && user1 == 2);
+    print_test_result("Resolve handle", strcmp(IdTable_get(table, order1), "order1") == 0);
+    print_test_result("Interning again returns the same handle", IdTable_intern(table, "order1") == order1);
+    print_test_result("Find without interning", IdTable_find(table, "user1") == user1 && IdTable_find(table, "nobody") == ID_HANDLE_NONE);
+    print_test_result("Count live handles", IdTable_count(table) == 2);
+
+    // Test 2: A handle lives until its last reference goes
+    IdTable_release(table, order1);
+    print_test_result("Handle kept while referenced", strcmp(IdTable_get(table, order1), "order1") == 0);
+    IdTable_retain(table, order1);
+    IdTable_release(table, order1);
+    IdTable_release(table, order1);
+    print_test_result("Handle freed after last release", IdTable_get(table, order1) == NULL && IdTable_find(table, "order1") == ID_HANDLE_NONE);
+    print_test_result("Count after release", IdTable_count(table) == 1);
+
+    // Test 3: Released handles are reused
+    IdHandle order2 = IdTable_intern(table, "order2");
+    print_test_result("Released handle reused", order2 == order1 && strcmp(IdTable_get(table, order2), "order2") == 0);
+
+    // Test 4: Growing past the initial capacity
+    int passed = 1;
+    char id[37];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(id, sizeof(id), "id%d", i);
+        passed &= IdTable_intern(table, id) == (IdHandle)(i + 3);
+    }
+    print_test_result("Intern 1000 IDs", passed);
+    passed = 1;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(id, sizeof(id), "id%d", i);
+        const char *resolved = IdTable_get(table, (IdHandle)(i + 3));
+        passed &= resolved && strcmp(resolved, id) == 0;
+    }
+    print_test_result("Resolve 1000 IDs", passed && IdTable_count(table) == 1002);
+
+    // Test 5: Invalid handles
+    IdTable_release(table, ID_HANDLE_NONE);
+    IdTable_release(table, 5000);
+    print_test_result("Invalid handles resolve to NULL", IdTable_get(table, ID_HANDLE_NONE) == NULL && IdTable_get(table, 5000) == NULL);
+    print_test_result("NULL table", IdTable_intern(NULL, "x") == ID_HANDLE_NONE && IdTable_count(NULL) == 0);
+
+    // Test 6: Strings longer than an Order's ID field are interned too
+    char long_id[80];
+    memset(long_id, 'x', sizeof(long_id) - 1);
+    long_id[sizeof(long_id) - 1] = '\0';
+    IdHandle long_handle = IdTable_intern(table, long_id);
+    print_test_result("Intern long ID", long_handle != ID_HANDLE_NONE && strcmp(IdTable_get(table, long_handle), long_id) == 0);
+    IdTable_release(table, long_handle);
+    print_test_result("Release long ID", IdTable_find(table, long_id) == ID_HANDLE_NONE);
+
+    // Cleanup
+    IdTable_destroy(&table);
+    print_test_result("Destroy clears pointer", table == NULL);
+
+    // Test 7: A table sized for its IDs interns them without growing
+    table = IdTable_create(256);
+    size_t reserved = IdTable_memory_usage(table);
+    passed = 1;
+    for (int i = 0; i < 256; i++) {
+        snprintf(id, sizeof(id), "order-%030d", i);
+        passed &= IdTable_intern(table, id) != ID_HANDLE_NONE;
+    }
+    print_test_result("Reserved table does not grow", passed && IdTable_memory_usage(table) == reserved);
+    IdTable_destroy(&table);
+    printf("All tests completed.\n");
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/* TestInstrument.c - Unit tests for the Instrument module
+ *
+ * This file contains a main function that runs a small order flow through a book built
+ * with its hooks compiled in, and checks the stage and per-call counts it records. It
+ * also checks the histogram percentiles on known samples.
+ */
+
+#include "Instrument.h"
+#include "OrderBook.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+static void fill_order(struct Order *order, const char *order_id, char side, double price, int quantity) {
+    memset(order, 0, sizeof(*order));
+    strcpy(order->order_id, order_id);
+    strcpy(order->user_id, "user");
+    order->side = side;
+    order->price = price;
+    order->quantity = quantity;
+}
+
+static uint64_t stage_count(enum InstrumentStage stage) {
+    struct InstrumentSummary summary;
+    return Instrument_stage_summary(stage, &summary) ? summary.count : 0;
+}
+
+int main() {
+    print_test_result("Compiled in", Instrument_enabled());
+
+    // Test 1: Stage counts of a flow
+    Instrument_reset();
+    OrderBook book = OrderBook_create();
+    struct Order order;
+    char order_id[16];
+    for (int level = 0; level < 3; level++) {
+        for (int i = 0; i < 2; i++) {
+            snprintf(order_id, sizeof(order_id), "ask%d_%d", level, i);
+            fill_order(&order, order_id, '0', 100.0 + level, 5);
+            OrderBook_add_order(book, &order, NULL);
+        }
+    }
+    // Trades 5, 5 at 100 and 5, 3 at 101, then nothing is left to rest
+    fill_order(&order, "bid", '1', 101.5, 18);
+    OrderBook_add_order(book, &order, NULL);
+    OrderBook_remove_order(book, "ask2_0");
+    OrderBook_remove_order(book, "missing");
+
+    print_test_result("Every add is timed", stage_count(INSTRUMENT_ADD_ORDER) == 7 &&
+                      stage_count(INSTRUMENT_ID_LOOKUP) == 7 && stage_count(INSTRUMENT_MATCH) == 7);
+    print_test_result("One trade stage per fill", stage_count(INSTRUMENT_TRADE) == 4 &&
+                      OrderBook_trade_count(book) == 4);
+    print_test_result("Only remainders rest", stage_count(INSTRUMENT_REST) == 6 &&
+                      stage_count(INSTRUMENT_LEVEL_LOOKUP) == 6);
+    print_test_result("Every remove is timed", stage_count(INSTRUMENT_REMOVE_ORDER) == 2);
+
+    struct InstrumentSummary levels, nodes, allocations;
+    Instrument_counter_summary(INSTRUMENT_LEVELS_TOUCHED, &levels);
+    Instrument_counter_summary(INSTRUMENT_NODES_WALKED, &nodes);
+    Instrument_counter_summary(INSTRUMENT_ALLOCATIONS, &allocations);
+    print_test_result("Levels touched per add", levels.count == 7 && levels.total == 8 && levels.max == 2 && levels.p50 == 1);
+    print_test_result("Nodes walked per add", nodes.count == 7 && nodes.total == 4 && nodes.max == 4 && nodes.p50 == 0);
+    print_test_result("Allocations counted", allocations.count == 7 && allocations.total > 0);
+
+    struct InstrumentSummary add;
+    Instrument_stage_summary(INSTRUMENT_ADD_ORDER, &add);
+    print_test_result("Summary is ordered", add.p50 <= add.p99 && add.p99 <= add.p999 && add.p999 <= add.max &&
+                      add.total >= add.max);
+
+    // Test 2: Once a map side is warm, a new price level allocates its tree node and nothing else
+    fill_order(&order, "warm", '1', 95.0, 1);
+    OrderBook_add_order(book, &order, NULL);
+    Instrument_reset();
+    fill_order(&order, "node1", '1', 90.0, 1);
+    OrderBook_add_order(book, &order, NULL);
+    fill_order(&order, "node2", '1', 90.0, 1);
+    OrderBook_add_order(book, &order, NULL);
+    Instrument_counter_summary(INSTRUMENT_ALLOCATIONS, &allocations);
+    print_test_result("Tree node allocations counted", allocations.count == 2 && allocations.total == 1 &&
+                      allocations.max == 1);
+
+    // Test 3: Reset clears every histogram
+    Instrument_reset();
+    Instrument_counter_summary(INSTRUMENT_LEVELS_TOUCHED, &levels);
+    print_test_result("Reset", stage_count(INSTRUMENT_ADD_ORDER) == 0 && stage_count(INSTRUMENT_TRADE) == 0 &&
+                      levels.count == 0 && levels.max == 0);
+
+    // Test 4: Percentiles of known samples
+    for (uint64_t v = 1; v <= 100; v++) Instrument_record_stage(INSTRUMENT_TRADE, v);
+    struct InstrumentSummary trade;
+    Instrument_stage_summary(INSTRUMENT_TRADE, &trade);
+    print_test_result("Count, total and max", trade.count == 100 && trade.total == 5050 && trade.max == 100);
+    print_test_result("Percentiles are bucket lower bounds", trade.p50 == 50 && trade.p99 == 96 && trade.p999 == 100);
+
+    Instrument_reset();
+    Instrument_record_stage(INSTRUMENT_TRADE, 7);
+    Instrument_record_stage(INSTRUMENT_TRADE, UINT64_MAX);
+    Instrument_stage_summary(INSTRUMENT_TRADE, &trade);
+    print_test_result("Largest value has a bucket", trade.max == UINT64_MAX && trade.p50 == 7 &&
+                      trade.p999 == (31ull << 59));
+    print_test_result("Invalid arguments", !Instrument_stage_summary(INSTRUMENT_STAGE_COUNT, &trade) &&
+                      !Instrument_counter_summary(INSTRUMENT_ALLOCATIONS, NULL));
+
+    // Cleanup
+    OrderBook_destroy(&book);
+    printf("All tests completed.\n");
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+/* TestJournal.c - Unit tests for the Journal module
+ *
+ * This file contains a main function that tests the Journal module: logging through
+ * an attached book, group commit, recovery from a journal alone and from a snapshot
+ * plus its tail, checkpoints, torn tails, missing records and groups written by the
+ * flusher thread.
+ */
+
+#include "Journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_PATH "TestJournal.journal"
+#define SNAPSHOT_PATH "TestJournal.snapshot"
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+static void add(OrderBook book, const char *order_id, const char *user_id, char side, double price, int quantity) {
+    struct Order order;
+    memset(&order, 0, sizeof(order));
+    snprintf(order.order_id, sizeof(order.order_id), "%s", order_id);
+    snprintf(order.user_id, sizeof(order.user_id), "%s", user_id);
+    order.side = side;
+    order.price = price;
+    order.quantity = quantity;
+    order.timestamp = 1000;
+    OrderBook_add_order(book, &order, NULL);
+}
+
+static void add_typed(OrderBook book, const char *order_id, char side, double price, int quantity,
+                      char order_type, char time_in_force) {
+    struct Order order;
+    memset(&order, 0, sizeof(order));
+    snprintf(order.order_id, sizeof(order.order_id), "%s", order_id);
+    snprintf(order.user_id, sizeof(order.user_id), "%s", "gina");
+    order.side = side;
+    order.price = price;
+    order.quantity = quantity;
+    order.timestamp = 1000;
+    order.order_type = order_type;
+    order.time_in_force = time_in_force;
+    OrderBook_add_order(book, &order, NULL);
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// Whether two books have the same levels, sequence and best prices
+static int same_book(OrderBook a, OrderBook b) {
+    struct OrderBookLevelView *a_bids, *a_asks, *b_bids, *b_asks;
+    int a_bid_count, a_ask_count, b_bid_count, b_ask_count;
+    OrderBook_get_top_levels(a, 0, &a_bids, &a_bid_count, &a_asks, &a_ask_count);
+    OrderBook_get_top_levels(b, 0, &b_bids, &b_bid_count, &b_asks, &b_ask_count);
+
+    int same = OrderBook_message_sequence(a) == OrderBook_message_sequence(b) &&
+               a_bid_count == b_bid_count && a_ask_count == b_ask_count;
+    for (int i = 0; same && i < a_bid_count; i++) {
+        same = a_bids[i].price == b_bids[i].price && a_bids[i].size == b_bids[i].size;
+    }
+    for (int i = 0; same && i < a_ask_count; i++) {
+        same = a_asks[i].price == b_asks[i].price && a_asks[i].size == b_asks[i].size;
+    }
+    free(a_bids);
+    free(a_asks);
+    free(b_bids);
+    free(b_asks);
+    return same;
+}
+
+int main() {
+    remove(JOURNAL_PATH);
+    remove(SNAPSHOT_PATH);
+
+    // Test 1: Group commit through an attached book
+    struct JournalConfig config = { 1 << 20, -1 }; // Commit on size only, so nothing is written until asked
+    Journal journal = Journal_open(JOURNAL_PATH, &config);
+    OrderBook book = OrderBook_create();
+    if (!journal || !book) {
+        printf("Failed to create Journal instance\n");
+        return 1;
+    }
+    OrderBook_attach_journal(book, journal);
+
+    add(book, "ask1", "alice", '0', 101.0, 10);
+    add(book, "ask2", "alice", '0', 102.0, 5);
+    add(book, "bid1", "bob", '1', 99.0, 8);
+    add(book, "take", "carol", '1', 101.0, 4);  // Trades 4 of ask1
+    OrderBook_remove_order(book, "bid1");
+    OrderBook_remove_order(book, "missing");    // Journaled with its outcome
+    print_test_result("Sequence counts messages", OrderBook_message_sequence(book) == 6);
+    print_test_result("Records buffered until commit", file_size(JOURNAL_PATH) == 0);
+    print_test_result("Commit", Journal_commit(journal) && file_size(JOURNAL_PATH) > 0);
+
+    // Test 2: Recovery from the journal alone
+    struct JournalRecoveryStats stats;
+    OrderBook recovered = Journal_recover(NULL, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Recover from journal", recovered && same_book(book, recovered));
+    print_test_result("Recovery stats", stats.records == 6 && stats.applied == 6 && stats.skipped == 0 &&
+                      stats.mismatches == 0 && stats.torn_bytes == 0);
+    print_test_result("Recovered fills match", recovered && OrderBook_trade_count(recovered) == 1);
+    OrderBook_destroy(&recovered);
+
+    // Test 3: Checkpoint, then recovery from the snapshot and the tail after it
+    print_test_result("Checkpoint", Journal_checkpoint(journal, book, SNAPSHOT_PATH) && file_size(JOURNAL_PATH) == 0);
+    add(book, "ask3", "dave", '0', 103.0, 7);
+    add(book, "take2", "erin", '1', 102.0, 9);  // Trades ask1's 6 and 3 of ask2
+    Journal_commit(journal);
+
+    recovered = Journal_recover(SNAPSHOT_PATH, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Recover from snapshot and tail", recovered && same_book(book, recovered));
+    print_test_result("Only the tail is applied", stats.records == 2 && stats.applied == 2 && stats.mismatches == 0);
+    OrderBook_destroy(&recovered);
+
+    // Test 4: Records the snapshot already includes are skipped
+    long before = file_size(JOURNAL_PATH);
+    print_test_result("Save snapshot", OrderBook_save(book, SNAPSHOT_PATH));
+    recovered = Journal_recover(SNAPSHOT_PATH, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Skip records in the snapshot", recovered && same_book(book, recovered) &&
+                      stats.skipped == 2 && stats.applied == 0);
+    OrderBook_destroy(&recovered);
+
+    // Test 5: A torn record ends the journal and is trimmed on open
+    add(book, "ask4", "dave", '0', 104.0, 1);
+    Journal_commit(journal);
+    long after = file_size(JOURNAL_PATH);
+    print_test_result("Truncate to a torn record", truncate(JOURNAL_PATH, (after + before) / 2) == 0);
+    recovered = Journal_recover(SNAPSHOT_PATH, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Torn bytes reported", stats.records == 2 && stats.torn_bytes == (size_t)((after + before) / 2 - before));
+    OrderBook_destroy(&recovered);
+
+    Journal_close(&journal);
+    print_test_result("Close clears pointer", journal == NULL);
+    journal = Journal_open(JOURNAL_PATH, NULL);
+    print_test_result("Open trims the torn tail", journal && file_size(JOURNAL_PATH) == before);
+    Journal_close(&journal);
+
+    // Test 6: Missing records are detected
+    OrderBook_destroy(&book);
+    OrderBook fresh = OrderBook_create();
+    add(fresh, "unjournaled", "frank", '0', 110.0, 1);
+    journal = Journal_open(JOURNAL_PATH, NULL);
+    Journal_checkpoint(journal, fresh, SNAPSHOT_PATH);
+    OrderBook_attach_journal(fresh, journal);
+    add(fresh, "a", "frank", '0', 111.0, 1);
+    Journal_commit(journal);
+    remove(SNAPSHOT_PATH);
+    print_test_result("Gap without the snapshot", Journal_recover(SNAPSHOT_PATH, JOURNAL_PATH, NULL, &stats) == NULL);
+
+    // Test 7: Invalid arguments
+    print_test_result("Reject NULL path", Journal_open(NULL, NULL) == NULL && Journal_recover(NULL, NULL, NULL, NULL) == NULL);
+    recovered = Journal_recover(NULL, "/nonexistent/journal", NULL, &stats);
+    print_test_result("Missing journal is empty", recovered && stats.records == 0);
+
+    // Test 8: Order types, time in force, modifies and user cancels are journaled and replayed
+    Journal_close(&journal);
+    remove(JOURNAL_PATH);
+    journal = Journal_open(JOURNAL_PATH, NULL);
+    OrderBook typed = OrderBook_create();
+    OrderBook_attach_journal(typed, journal);
+    add(typed, "ask1", "alice", '0', 101.0, 5);
+    add(typed, "ask2", "alice", '0', 102.0, 5);
+    add_typed(typed, "ioc", '1', 101.0, 8, ORDER_TYPE_LIMIT, TIME_IN_FORCE_IOC);      // Trades 5, rest dropped
+    add_typed(typed, "fok", '1', 102.0, 9, ORDER_TYPE_LIMIT, TIME_IN_FORCE_FOK);      // Rejected, only 5 left
+    add_typed(typed, "post", '1', 102.0, 1, ORDER_TYPE_POST_ONLY, TIME_IN_FORCE_GTC); // Rejected, would cross
+    add_typed(typed, "mkt", '1', 0.0, 2, ORDER_TYPE_MARKET, TIME_IN_FORCE_IOC);       // Trades 2 of ask2
+    OrderBook_modify_order(typed, "ask2", 101.5, 2, NULL);                            // Reduced and moved
+    add(typed, "bid1", "bob", '1', 100.0, 1);
+    OrderBook_modify_order(typed, "ask2", 100.0, 2, NULL);                            // Crosses bid1
+    OrderBook_modify_order(typed, "gone", 100.0, 2, NULL);                            // Journaled with its outcome
+    add(typed, "cancel1", "henry", '1', 95.0, 1);
+    add(typed, "cancel2", "henry", '0', 120.0, 1);
+    OrderBook_cancel_all_for_user(typed, "henry");
+    Journal_commit(journal);
+    OrderBook typed_recovered = Journal_recover(NULL, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Recover typed orders, modifies and cancels", typed_recovered && same_book(typed, typed_recovered) &&
+                      stats.records == 13 && stats.mismatches == 0 &&
+                      OrderBook_trade_count(typed_recovered) == OrderBook_trade_count(typed));
+    OrderBook_destroy(&typed_recovered);
+    OrderBook_destroy(&typed);
+
+    // Test 9: Small groups are handed to the flusher while appends continue
+    Journal_close(&journal);
+    remove(JOURNAL_PATH);
+    struct JournalConfig small = { 256, -1 };
+    journal = Journal_open(JOURNAL_PATH, &small);
+    OrderBook flushed = OrderBook_create();
+    OrderBook_attach_journal(flushed, journal);
+    char id[16];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(id, sizeof(id), "f%d", i);
+        add(flushed, id, "ivan", i % 2 ? '1' : '0', i % 2 ? 99.0 - i % 7 : 101.0 + i % 7, 1 + i % 3);
+    }
+    int committed = Journal_commit(journal);
+    OrderBook flushed_recovered = Journal_recover(NULL, JOURNAL_PATH, NULL, &stats);
+    print_test_result("Flusher writes every group in order", committed && flushed_recovered &&
+                      stats.records == 2000 && stats.mismatches == 0 && same_book(flushed, flushed_recovered));
+    OrderBook_destroy(&flushed_recovered);
+    OrderBook_destroy(&flushed);
+
+    // Cleanup
+    OrderBook_destroy(&recovered);
+    OrderBook_destroy(&fresh);
+    Journal_close(&journal);
+    remove(JOURNAL_PATH);
+    remove(SNAPSHOT_PATH);
+    printf("All tests completed.\n");
+
+    return 0;
+}
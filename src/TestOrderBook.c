@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
+#include <unistd.h>
 #include "OrderBook.h"
 
 /* Simple pass/fail counters */
@@ -203,6 +205,26 @@ static void test_remove_orders(void)
     removed = OrderBook_remove_order(book, "ask1");
     ASSERT(removed == 1, "Should successfully remove ask1");
 
+    /* Removing the last order at a price removes the level. */
+    ASSERT(OrderBook_get_best_bid(book) == 0.0, "No bids should remain after removal");
+    ASSERT(OrderBook_get_best_ask(book) == 0.0, "No asks should remain after removal");
+
+    /* A fully filled order can no longer be removed. */
+    Order ask2 = createOrder("ask2", "alice", 10, '0', 100.0, time(NULL));
+    OrderBook_add_order(book, ask2, NULL);
+    free(ask2);
+    Order bid2 = createOrder("bid2", "bob", 10, '1', 100.0, time(NULL));
+    int trade_count = 0;
+    char **trade_ids = OrderBook_add_order(book, bid2, &trade_count);
+    free(bid2);
+    ASSERT(trade_count == 1, "bid2 should fill ask2");
+    if (trade_ids) {
+        free(trade_ids[0]);
+        free(trade_ids);
+    }
+    removed = OrderBook_remove_order(book, "ask2");
+    ASSERT(removed == 0, "Removing a filled order should fail (0)");
+
     OrderBook_destroy(&book);
 }
 
@@ -240,6 +262,21 @@ static void test_best_bid_ask(void)
     ASSERT(best_bid == 95.0,  "Best bid should be 95.0");
     ASSERT(best_ask == 100.0, "Best ask should be 100.0");
 
+    /* Removing the best level falls back to the next one. */
+    OrderBook_remove_order(book, "bid2");
+    OrderBook_remove_order(book, "ask1");
+    ASSERT(OrderBook_get_best_bid(book) == 90.0,  "Best bid should fall back to 90.0");
+    ASSERT(OrderBook_get_best_ask(book) == 105.0, "Best ask should fall back to 105.0");
+
+    /* A better price becomes the best immediately; a worse one does not. */
+    Order bid3 = createOrder("bid3", "bob", 5, '1', 92.0, time(NULL));
+    OrderBook_add_order(book, bid3, NULL);
+    free(bid3);
+    Order bid4 = createOrder("bid4", "bob", 5, '1', 91.0, time(NULL));
+    OrderBook_add_order(book, bid4, NULL);
+    free(bid4);
+    ASSERT(OrderBook_get_best_bid(book) == 92.0, "Best bid should improve to 92.0");
+
     OrderBook_destroy(&book);
 }
 
@@ -304,6 +341,19 @@ static void test_top_levels(void)
     free(bid_levels);
     free(ask_levels);
 
+    const struct OrderBookLevelView *peek_bids, *peek_asks;
+    ASSERT(!OrderBook_peek_top_levels(book, &peek_bids, &bid_count, &peek_asks, &ask_count),
+           "A book without a depth cache should refuse to peek");
+
+    /* Asking for more levels than exist returns only the real ones. */
+    ok = OrderBook_get_top_levels(book, 10, &bid_levels, &bid_count, &ask_levels, &ask_count);
+    ASSERT(ok == 1 && bid_count == 4 && ask_count == 4, "k beyond the depth should return every level, unpadded");
+    if (ok && bid_count == 4) {
+        ASSERT(bid_levels[3].price == 95.0 && bid_levels[3].size == 10, "Deepest bid level should be real");
+    }
+    free(bid_levels);
+    free(ask_levels);
+
     OrderBook_destroy(&book);
 }
 
@@ -480,6 +530,1120 @@ static void test_get_trade(void)
     OrderBook_destroy(&book);
 }
 
+/* ===========================
+ * Test: Create With Config
+ * ===========================
+ * A pre-sized book should behave exactly like a default one. */
+static void test_create_with_config(void)
+{
+    struct OrderBookConfig config = { .order_capacity = 64, .trade_capacity = 16 };
+    OrderBook book = OrderBook_create_with_config(&config);
+    ASSERT(book != NULL, "OrderBook_create_with_config returned NULL");
+
+    /* Rest more orders than were reserved, then sweep them all. */
+    for (int i = 0; i < 100; i++) {
+        char ask_id[16];
+        snprintf(ask_id, sizeof(ask_id), "ask%d", i);
+        Order a = createOrder(ask_id, "alice", 1, '0', 100.0 + (i % 5), time(NULL));
+        OrderBook_add_order(book, a, NULL);
+        free(a);
+    }
+
+    Order bid = createOrder("bid1", "bob", 100, '1', 110.0, time(NULL));
+    int trade_count = 0;
+    char **trade_ids = OrderBook_add_order(book, bid, &trade_count);
+    free(bid);
+
+    ASSERT(trade_count == 100, "Sweep should produce one trade per resting ask");
+    ASSERT(OrderBook_get_best_ask(book) == 0.0, "All asks should be consumed");
+    if (trade_ids) {
+        for (int i = 0; i < trade_count; i++) {
+            free(trade_ids[i]);
+        }
+        free(trade_ids);
+    }
+
+    OrderBook_destroy(&book);
+    ASSERT(book == NULL, "OrderBook_destroy should clear the pointer");
+}
+
+/* ===========================
+ * Test: Price Ladder Book
+ * ===========================
+ * A book configured with a tick size matches like the default one. */
+static void test_price_ladder(void)
+{
+    struct OrderBookConfig config = { .tick_size = 0.5, .min_price = 50.0, .max_price = 150.0 };
+    OrderBook book = OrderBook_create_with_config(&config);
+    ASSERT(book != NULL, "Failed to create ladder OrderBook");
+
+    Order ask1 = createOrder("ask1", "alice", 10, '0', 101.0, time(NULL));
+    Order ask2 = createOrder("ask2", "alice", 10, '0', 100.5, time(NULL));
+    Order bid1 = createOrder("bid1", "bob", 10, '1', 99.5, time(NULL));
+    OrderBook_add_order(book, ask1, NULL);
+    OrderBook_add_order(book, ask2, NULL);
+    OrderBook_add_order(book, bid1, NULL);
+    free(ask1);
+    free(ask2);
+    free(bid1);
+
+    ASSERT(OrderBook_get_best_bid(book) == 99.5, "Ladder best bid should be 99.5");
+    ASSERT(OrderBook_get_best_ask(book) == 100.5, "Ladder best ask should be 100.5");
+
+    Order bid2 = createOrder("bid2", "bob", 15, '1', 101.0, time(NULL));
+    int trade_count = 0;
+    char **trade_ids = OrderBook_add_order(book, bid2, &trade_count);
+    free(bid2);
+    ASSERT(trade_count == 2, "Crossing bid should trade at two ladder levels");
+    if (trade_ids) {
+        Trade t = OrderBook_get_trade(book, trade_ids[0]);
+        ASSERT(t && t->price == 100.5 && t->size == 10, "First trade should take the best ask");
+        free(t);
+        for (int i = 0; i < trade_count; i++) {
+            free(trade_ids[i]);
+        }
+        free(trade_ids);
+    }
+    ASSERT(OrderBook_get_best_ask(book) == 101.0, "Remaining ask should be 101.0");
+    ASSERT(OrderBook_remove_order(book, "ask1") == 1, "Partially filled ask should be removable");
+    ASSERT(OrderBook_get_best_ask(book) == 0.0, "No asks should remain");
+
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Ladder Band Rejects
+ * ===========================
+ * An order whose remainder would rest outside a ladder book's band is rejected
+ * before it trades; one that would not rest is matched as usual. */
+static void test_ladder_band(void)
+{
+    struct OrderBookConfig config = { .tick_size = 1.0, .min_price = 90.0, .max_price = 110.0 };
+    OrderBook book = OrderBook_create_with_config(&config);
+    ASSERT(book != NULL, "Failed to create ladder OrderBook in test_ladder_band");
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+
+    Order high = createOrder("high", "bob", 10, '1', 200.0, 1);
+    ASSERT(OrderBook_add_order_with_result(book, high, &result) == 0 && result.count == 0,
+           "A bid above the band should be rejected");
+    ASSERT(OrderBook_get_best_bid(book) == 0.0, "A rejected bid should not rest");
+    free(high);
+
+    Order ask = createOrder("ask", "alice", 5, '0', 100.0, 1);
+    ASSERT(OrderBook_add_order_with_result(book, ask, &result) == 1, "An ask inside the band should rest");
+    free(ask);
+
+    Order crossing = createOrder("cross", "bob", 10, '1', 200.0, 2);
+    ASSERT(OrderBook_add_order_with_result(book, crossing, &result) == 0 && result.count == 0,
+           "A crossing bid whose remainder cannot rest should be rejected without trading");
+    ASSERT(OrderBook_get_best_ask(book) == 100.0 && OrderBook_size_through_price(book, '1', 100.0) == 5,
+           "A rejected bid should leave the ask untouched");
+    ASSERT(OrderBook_remove_order(book, "cross") == 0, "A rejected bid should not be removable");
+
+    /* An IOC never rests, so a limit past the band still trades. */
+    crossing->time_in_force = TIME_IN_FORCE_IOC;
+    ASSERT(OrderBook_add_order_with_result(book, crossing, &result) == 1 && result.count == 1 &&
+           result.fills[0].size == 5, "An IOC past the band should trade");
+    ASSERT(OrderBook_get_best_ask(book) == 0.0 && OrderBook_get_best_bid(book) == 0.0,
+           "An IOC should not rest its remainder");
+    free(crossing);
+
+    OrderBookMatchResult_free(&result);
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Add Order With Result
+ * ===========================
+ * Fills are written into a reusable caller buffer and match the recorded trades. */
+static void test_add_order_with_result(void)
+{
+    OrderBook book = OrderBook_create();
+    ASSERT(book != NULL, "Failed to create OrderBook in test_add_order_with_result");
+
+    Order ask1 = createOrder("ask1", "alice", 10, '0', 100.0, time(NULL));
+    Order ask2 = createOrder("ask2", "carol", 10, '0', 101.0, time(NULL));
+    OrderBook_add_order(book, ask1, NULL);
+    OrderBook_add_order(book, ask2, NULL);
+    free(ask1);
+    free(ask2);
+
+    struct OrderBookFill *storage = (struct OrderBookFill *)malloc(sizeof(struct OrderBookFill));
+    struct OrderBookMatchResult result = { storage, 0, 1 };
+
+    /* A non-crossing order writes no fills. */
+    Order bid1 = createOrder("bid1", "bob", 5, '1', 99.0, time(NULL));
+    ASSERT(OrderBook_add_order_with_result(book, bid1, &result) == 1, "Non-crossing add should succeed");
+    ASSERT(result.count == 0, "Non-crossing add should produce no fills");
+    free(bid1);
+
+    /* Two fills exceed the caller's storage, so the buffer is grown. */
+    Order bid2 = createOrder("bid2", "bob", 15, '1', 101.0, time(NULL));
+    ASSERT(OrderBook_add_order_with_result(book, bid2, &result) == 1, "Crossing add should succeed");
+    free(bid2);
+    ASSERT(result.count == 2, "Crossing add should produce two fills");
+    ASSERT(result.capacity >= 2, "Result buffer should have grown");
+    if (result.count == 2) {
+        ASSERT(strcmp(OrderBook_get_id_string(book, result.fills[0].maker_order), "ask1") == 0, "First maker should be ask1");
+        ASSERT(result.fills[0].size == 10 && result.fills[0].price == 100.0, "First fill should be 10 @ 100.0");
+        ASSERT(strcmp(OrderBook_get_id_string(book, result.fills[1].maker_order), "ask2") == 0, "Second maker should be ask2");
+        ASSERT(result.fills[1].size == 5 && result.fills[1].price == 101.0, "Second fill should be 5 @ 101.0");
+        ASSERT(result.fills[1].trade_id == result.fills[0].trade_id + 1, "Trade IDs should be sequential");
+
+        char trade_id[37];
+        snprintf(trade_id, sizeof(trade_id), "TRADE-%08ld", result.fills[1].trade_id);
+        Trade t = OrderBook_get_trade(book, trade_id);
+        ASSERT(t && t->size == 5 && strcmp(t->sell_order_id, "ask2") == 0, "Fill should match the recorded trade");
+        free(t);
+    }
+
+    /* Reusing the grown buffer overwrites the previous fills. */
+    Order bid3 = createOrder("bid3", "bob", 5, '1', 101.0, time(NULL));
+    ASSERT(OrderBook_add_order_with_result(book, bid3, &result) == 1, "Reused buffer add should succeed");
+    free(bid3);
+    ASSERT(result.count == 1 && result.fills[0].size == 5, "Reused buffer should hold only the new fill");
+    ASSERT(OrderBook_get_best_ask(book) == 0.0, "All asks should be consumed");
+
+    OrderBookMatchResult_free(&result);
+    ASSERT(result.fills == NULL && result.capacity == 0, "Freed result should be empty");
+
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Ring Trade Log
+ * ===========================
+ * A book with a ring trade log keeps only the most recent trades, and a cursor
+ * reads new trades without copying the history. */
+static void test_trade_log_ring(void)
+{
+    struct OrderBookConfig config = { .trade_log = { TRADE_LOG_RING, 4, NULL } };
+    OrderBook book = OrderBook_create_with_config(&config);
+    ASSERT(book != NULL, "Failed to create OrderBook in test_trade_log_ring");
+
+    /* Ten single-lot asks swept by one bid give trades 0..9. */
+    for (int i = 0; i < 10; i++) {
+        char ask_id[16];
+        snprintf(ask_id, sizeof(ask_id), "ask%d", i);
+        Order ask = createOrder(ask_id, "alice", 1, '0', 100.0 + i, time(NULL));
+        OrderBook_add_order(book, ask, NULL);
+        free(ask);
+    }
+    Order bid = createOrder("bid", "bob", 10, '1', 110.0, time(NULL));
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    ASSERT(OrderBook_add_order_with_result(book, bid, &result) == 1 && result.count == 10, "Sweep should produce ten fills");
+    free(bid);
+
+    /* Fills resolve their makers until the next add, even once the ring dropped their trades. */
+    const char *first_maker = OrderBook_get_id_string(book, result.fills[0].maker_order);
+    ASSERT(first_maker && strcmp(first_maker, "ask0") == 0, "A fill's maker should resolve after its trade is dropped");
+    uint32_t first_handle = result.fills[0].maker_order;
+    Order other = createOrder("other", "carol", 1, '1', 90.0, time(NULL));
+    OrderBook_add_order_with_result(book, other, &result);
+    free(other);
+    const char *reused = OrderBook_get_id_string(book, first_handle);
+    ASSERT(!reused || strcmp(reused, "ask0") != 0, "The next add should release the previous fills' makers");
+    OrderBookMatchResult_free(&result);
+
+    ASSERT(OrderBook_trade_count(book) == 4, "Ring should retain four trades");
+    ASSERT(OrderBook_get_trade(book, "TRADE-00000005") == NULL, "Dropped trade should not be found");
+    ASSERT(OrderBook_get_trade(book, "ask9") == NULL, "Malformed trade ID should not be found");
+
+    struct TradeRecord record;
+    ASSERT(OrderBook_get_trade_record(book, 9, &record) == 1, "Newest trade should be retained");
+    const char *seller = OrderBook_get_id_string(book, record.sell_order_id);
+    ASSERT(seller && strcmp(seller, "ask9") == 0 && record.price == 109.0, "Newest trade should be against ask9");
+
+    Trade *trades = NULL;
+    int tcount = 0;
+    ASSERT(OrderBook_get_all_trades(book, &trades, &tcount) == 1 && tcount == 4, "get_all_trades should return retained trades");
+    if (tcount == 4) {
+        ASSERT(strcmp(trades[0]->trade_id, "TRADE-00000006") == 0, "Oldest retained trade should be 6");
+        ASSERT(strcmp(trades[3]->sell_order_id, "ask9") == 0, "Last retained trade should be against ask9");
+    }
+    for (int i = 0; i < tcount; i++) free(trades[i]);
+    free(trades);
+
+    /* A cursor started before the retained window skips to its start. */
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, 0);
+    const struct TradeRecord *next = OrderBook_next_trade(book, &cursor);
+    ASSERT(next && next->sequence == 6, "Cursor should skip to the oldest retained trade");
+    int seen = next ? 1 : 0;
+    while (OrderBook_next_trade(book, &cursor)) seen++;
+    ASSERT(seen == 4, "Cursor should read the four retained trades");
+
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Snapshot Save and Load
+ * ===========================
+ * A loaded book has the same levels and queue order as the saved one, keeps
+ * numbering trades where it left off, and rejects damaged files. */
+#define SNAPSHOT_PATH "TestOrderBook.snapshot"
+
+static void add_test_order(OrderBook book, const char *order_id, const char *user_id, int quantity, char side, double price)
+{
+    Order o = createOrder(order_id, user_id, quantity, side, price, 1000);
+    OrderBook_add_order(book, o, NULL);
+    free(o);
+}
+
+static void test_snapshot(void)
+{
+    OrderBook book = OrderBook_create();
+    ASSERT(book != NULL, "Failed to create OrderBook in test_snapshot");
+
+    add_test_order(book, "bid1", "bob", 10, '1', 99.0);
+    add_test_order(book, "bid2", "carol", 20, '1', 99.0);
+    add_test_order(book, "bid3", "bob", 5, '1', 98.5);
+    add_test_order(book, "ask1", "alice", 10, '0', 101.0);
+    add_test_order(book, "ask2", "dave", 10, '0', 101.0);
+    add_test_order(book, "ask3", "alice", 7, '0', 102.0);
+    add_test_order(book, "gone", "erin", 3, '0', 103.0);
+    OrderBook_remove_order(book, "gone");
+    add_test_order(book, "take", "erin", 4, '1', 101.0); /* Trade 0: leaves ask1 with 6 */
+
+    ASSERT(OrderBook_save(book, SNAPSHOT_PATH) == 1, "Save should succeed");
+    OrderBook loaded = OrderBook_load(SNAPSHOT_PATH, NULL);
+    ASSERT(loaded != NULL, "Load should succeed");
+    if (!loaded) {
+        OrderBook_destroy(&book);
+        remove(SNAPSHOT_PATH);
+        return;
+    }
+
+    ASSERT(OrderBook_get_best_bid(loaded) == 99.0 && OrderBook_get_best_ask(loaded) == 101.0, "Loaded best prices should match");
+    ASSERT(OrderBook_trade_count(loaded) == 0, "Trades themselves are not saved");
+
+    struct OrderBookLevelView *bids, *asks, *loaded_bids, *loaded_asks;
+    int bid_count, ask_count, loaded_bid_count, loaded_ask_count;
+    OrderBook_get_top_levels(book, 0, &bids, &bid_count, &asks, &ask_count);
+    OrderBook_get_top_levels(loaded, 0, &loaded_bids, &loaded_bid_count, &loaded_asks, &loaded_ask_count);
+    int same = bid_count == loaded_bid_count && ask_count == loaded_ask_count;
+    for (int i = 0; same && i < bid_count; i++) {
+        same = bids[i].price == loaded_bids[i].price && bids[i].size == loaded_bids[i].size;
+    }
+    for (int i = 0; same && i < ask_count; i++) {
+        same = asks[i].price == loaded_asks[i].price && asks[i].size == loaded_asks[i].size;
+    }
+    ASSERT(same && bid_count == 2 && ask_count == 2, "Loaded levels should match the saved book");
+    free(bids);
+    free(asks);
+    free(loaded_bids);
+    free(loaded_asks);
+
+    /* Sweeping both asks at 101 fills them in their saved queue order. */
+    Order sweep = createOrder("sweep", "frank", 16, '1', 101.0, 2000);
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    ASSERT(OrderBook_add_order_with_result(loaded, sweep, &result) == 1 && result.count == 2, "Sweep should fill two asks");
+    free(sweep);
+    if (result.count == 2) {
+        ASSERT(strcmp(OrderBook_get_id_string(loaded, result.fills[0].maker_order), "ask1") == 0 && result.fills[0].size == 6, "ask1 keeps its priority and partial size");
+        ASSERT(strcmp(OrderBook_get_id_string(loaded, result.fills[1].maker_order), "ask2") == 0 && result.fills[1].size == 10, "ask2 fills second");
+        ASSERT(result.fills[0].trade_id == 1, "Trade numbering continues after the snapshot");
+    }
+    OrderBookMatchResult_free(&result);
+
+    ASSERT(OrderBook_remove_order(loaded, "bid2") == 1, "Loaded orders should be removable by ID");
+    ASSERT(OrderBook_remove_order(loaded, "gone") == 0, "Removed orders should not be restored");
+
+    /* The same snapshot loads into a ladder book. */
+    struct OrderBookConfig ladder = { .tick_size = 0.5, .min_price = 90.0, .max_price = 110.0 };
+    OrderBook ladder_book = OrderBook_load(SNAPSHOT_PATH, &ladder);
+    ASSERT(ladder_book && OrderBook_get_best_bid(ladder_book) == 99.0 && OrderBook_get_best_ask(ladder_book) == 101.0, "Snapshot should load into a ladder book");
+    OrderBook_destroy(&ladder_book);
+
+    struct OrderBookConfig narrow = { .tick_size = 0.5, .min_price = 100.0, .max_price = 110.0 };
+    ASSERT(OrderBook_load(SNAPSHOT_PATH, &narrow) == NULL, "Orders outside the ladder band should fail the load");
+
+    /* A truncated or damaged file is rejected. */
+    FILE *fp = fopen(SNAPSHOT_PATH, "r+b");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        ASSERT(truncate(SNAPSHOT_PATH, size - 1) == 0, "Truncating the snapshot should succeed");
+        fclose(fp);
+    }
+    ASSERT(OrderBook_load(SNAPSHOT_PATH, NULL) == NULL, "Truncated snapshot should be rejected");
+    ASSERT(OrderBook_load("/nonexistent/snapshot", NULL) == NULL, "Missing snapshot should be rejected");
+
+    /* An empty book round-trips too. */
+    OrderBook empty = OrderBook_create();
+    ASSERT(OrderBook_save(empty, SNAPSHOT_PATH) == 1, "Saving an empty book should succeed");
+    OrderBook_destroy(&empty);
+    empty = OrderBook_load(SNAPSHOT_PATH, NULL);
+    ASSERT(empty && OrderBook_get_best_bid(empty) == 0.0 && OrderBook_get_best_ask(empty) == 0.0, "Empty snapshot should load");
+    OrderBook_destroy(&empty);
+
+    remove(SNAPSHOT_PATH);
+    OrderBook_destroy(&loaded);
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Batch Submission
+ * ===========================
+ * OrderBook_add_orders and OrderBook_remove_orders leave the book, the fills and
+ * the outcomes exactly as the same calls made one at a time would, on both a
+ * map book and a ladder book. */
+#define BATCH_SIZE 300
+
+static void run_batch_comparison(const struct OrderBookConfig *config)
+{
+    OrderBook batched = OrderBook_create_with_config(config);
+    OrderBook single = OrderBook_create_with_config(config);
+    ASSERT(batched != NULL && single != NULL, "Failed to create OrderBooks in test_batch");
+    if (!batched || !single) {
+        OrderBook_destroy(&batched);
+        OrderBook_destroy(&single);
+        return;
+    }
+
+    /* A reproducible mix of passive and crossing orders within ten ticks of 100.00. */
+    struct Order orders[BATCH_SIZE];
+    memset(orders, 0, sizeof(orders));
+    unsigned int state = 12345;
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        state = state * 1103515245u + 12345u;
+        snprintf(orders[i].order_id, sizeof(orders[i].order_id), "b%d", i);
+        snprintf(orders[i].user_id, sizeof(orders[i].user_id), "u%u", (state >> 8) % 7);
+        orders[i].side = (state >> 4) & 1 ? '1' : '0';
+        orders[i].price = 99.90 + 0.01 * (double)((state >> 12) % 21);
+        orders[i].quantity = 1 + (int)((state >> 16) % 20);
+        orders[i].timestamp = 1000 + i;
+    }
+
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    struct OrderBookBatchStatus statuses[BATCH_SIZE];
+    size_t accepted = OrderBook_add_orders(batched, orders, BATCH_SIZE, &result, statuses);
+
+    struct OrderBookMatchResult one = { NULL, 0, 0 };
+    size_t single_accepted = 0;
+    int same = 1;
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        int ok = OrderBook_add_order_with_result(single, &orders[i], &one);
+        if (ok) single_accepted++;
+        same = same && ok == statuses[i].accepted && one.count == statuses[i].fill_count;
+        for (int f = 0; same && f < one.count; f++) {
+            const struct OrderBookFill *fill = &result.fills[statuses[i].first_fill + f];
+            same = fill->trade_id == one.fills[f].trade_id && fill->size == one.fills[f].size &&
+                   fill->price == one.fills[f].price && strcmp(OrderBook_get_id_string(batched, fill->maker_order), OrderBook_get_id_string(single, one.fills[f].maker_order)) == 0;
+        }
+    }
+    ASSERT(accepted == single_accepted, "Batch should accept the same orders");
+    ASSERT(same, "Batch outcomes and fills should match single calls");
+    ASSERT(result.count > 0 && (size_t)result.count == OrderBook_trade_count(single), "Batch result should hold every fill");
+
+    /* Remove every third order, including some already filled, plus an unknown ID. */
+    const char *ids[BATCH_SIZE / 3 + 1];
+    int removed[BATCH_SIZE / 3 + 1];
+    size_t id_count = 0;
+    for (int i = 0; i < BATCH_SIZE; i += 3) {
+        ids[id_count++] = orders[i].order_id;
+    }
+    ids[id_count++] = "unknown";
+    size_t removed_count = OrderBook_remove_orders(batched, ids, id_count, removed);
+    size_t single_removed = 0;
+    same = 1;
+    for (size_t i = 0; i < id_count; i++) {
+        int ok = OrderBook_remove_order(single, ids[i]);
+        if (ok) single_removed++;
+        same = same && ok == removed[i];
+    }
+    ASSERT(removed_count == single_removed && same, "Batch removes should match single removes");
+    ASSERT(removed[id_count - 1] == 0, "Unknown ID should not be removed");
+
+    struct OrderBookLevelView *bids, *asks, *single_bids, *single_asks;
+    int bid_count, ask_count, single_bid_count, single_ask_count;
+    OrderBook_get_top_levels(batched, 0, &bids, &bid_count, &asks, &ask_count);
+    OrderBook_get_top_levels(single, 0, &single_bids, &single_bid_count, &single_asks, &single_ask_count);
+    same = bid_count == single_bid_count && ask_count == single_ask_count;
+    for (int i = 0; same && i < bid_count; i++) {
+        same = bids[i].price == single_bids[i].price && bids[i].size == single_bids[i].size;
+    }
+    for (int i = 0; same && i < ask_count; i++) {
+        same = asks[i].price == single_asks[i].price && asks[i].size == single_asks[i].size;
+    }
+    ASSERT(same, "Batched and single books should end with the same levels");
+    ASSERT(OrderBook_message_sequence(batched) == OrderBook_message_sequence(single), "Each batch message should take a sequence number");
+
+    ASSERT(OrderBook_add_orders(batched, orders, BATCH_SIZE, NULL, NULL) == 0, "NULL result should be rejected");
+    ASSERT(OrderBook_add_orders(batched, orders, 0, &result, NULL) == 0 && result.count == 0, "Empty batch should reset the result");
+
+    free(bids);
+    free(asks);
+    free(single_bids);
+    free(single_asks);
+    OrderBookMatchResult_free(&result);
+    OrderBookMatchResult_free(&one);
+    OrderBook_destroy(&batched);
+    OrderBook_destroy(&single);
+}
+
+static void test_batch(void)
+{
+    run_batch_comparison(NULL);
+
+    struct OrderBookConfig ladder;
+    memset(&ladder, 0, sizeof(ladder));
+    ladder.tick_size = 0.01;
+    ladder.min_price = 99.0;
+    ladder.max_price = 101.0;
+    run_batch_comparison(&ladder);
+}
+
+/* ===========================
+ * Test: Level Update Feed
+ * ===========================
+ * Rebuilds depth from the level updates of a random flow and checks it against
+ * the book's own levels after every message, for both kinds of side. */
+#define FEED_MAX_LEVELS 64
+
+struct DepthCopy {
+    struct OrderBookLevelView levels[2][FEED_MAX_LEVELS]; /* [0] asks, [1] bids, unordered */
+    int counts[2];
+    uint64_t last_sequence;
+    int updates;
+    int in_order;       /* Sequences never decrease */
+    int well_formed;    /* No update for a price that is already at that size */
+};
+
+static void apply_level_update(void *context, const struct OrderBookLevelUpdate *update)
+{
+    struct DepthCopy *depth = (struct DepthCopy *)context;
+    int s = update->side == '1';
+    if (update->sequence < depth->last_sequence) depth->in_order = 0;
+    depth->last_sequence = update->sequence;
+    depth->updates++;
+
+    int i = 0;
+    while (i < depth->counts[s] && depth->levels[s][i].price != update->price) i++;
+    if ((update->size == 0) != (update->order_count == 0)) depth->well_formed = 0;
+    if (i == depth->counts[s]) {
+        if (update->size == 0 || i == FEED_MAX_LEVELS) {
+            depth->well_formed = 0;
+            return;
+        }
+        depth->levels[s][depth->counts[s]++].price = update->price;
+    } else if (update->size == 0) {
+        depth->levels[s][i] = depth->levels[s][--depth->counts[s]];
+        return;
+    }
+    depth->levels[s][i].size = update->size;
+    depth->levels[s][i].order_count = update->order_count;
+}
+
+/* Whether the unordered copy holds exactly the given levels. */
+static int depth_matches(const struct DepthCopy *depth, int s, const struct OrderBookLevelView *levels, int count)
+{
+    if (depth->counts[s] != count) return 0;
+    for (int i = 0; i < count; i++) {
+        int found = 0;
+        for (int j = 0; j < depth->counts[s] && !found; j++) {
+            found = depth->levels[s][j].price == levels[i].price && depth->levels[s][j].size == levels[i].size &&
+                    depth->levels[s][j].order_count == levels[i].order_count;
+        }
+        if (!found) return 0;
+    }
+    return 1;
+}
+
+static void run_level_feed(const struct OrderBookConfig *config)
+{
+    /* Also keep a small depth cache, checked against a fresh walk as the flow runs. */
+    struct OrderBookConfig cached;
+    if (config) {
+        cached = *config;
+    } else {
+        memset(&cached, 0, sizeof(cached));
+    }
+    cached.depth_cache = 3;
+    OrderBook book = OrderBook_create_with_config(&cached);
+    ASSERT(book != NULL, "Failed to create OrderBook in test_level_updates");
+
+    struct DepthCopy depth;
+    memset(&depth, 0, sizeof(depth));
+    depth.in_order = 1;
+    depth.well_formed = 1;
+    OrderBook_set_level_handler(book, apply_level_update, &depth);
+
+    struct Order order;
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    unsigned int state = 777;
+    int matches = 1, cache_matches = 1, fills = 0;
+    for (int i = 0; i < 2000; i++) {
+        state = state * 1103515245u + 12345u;
+        int before = depth.updates;
+        if (i % 4 == 3) {
+            char id[16];
+            snprintf(id, sizeof(id), "f%u", (unsigned int)i - 1 - (state >> 8) % 20);
+            int removed = OrderBook_remove_order(book, id);
+            matches = matches && depth.updates - before == removed;
+        } else {
+            memset(&order, 0, sizeof(order));
+            snprintf(order.order_id, sizeof(order.order_id), "f%d", i);
+            snprintf(order.user_id, sizeof(order.user_id), "u%u", (state >> 8) % 5);
+            order.side = (state >> 4) & 1 ? '1' : '0';
+            order.price = 99.90 + 0.01 * (double)((state >> 12) % 21);
+            order.quantity = 1 + (int)((state >> 16) % 30);
+            order.timestamp = 1000 + i;
+            OrderBook_add_order_with_result(book, &order, &result);
+            fills += result.count;
+        }
+        if (depth.updates > before) {
+            matches = matches && depth.last_sequence == OrderBook_message_sequence(book) - 1;
+        }
+
+        struct OrderBookLevelView *bids, *asks;
+        int bid_count, ask_count;
+        OrderBook_get_top_levels(book, 0, &bids, &bid_count, &asks, &ask_count);
+        matches = matches && depth_matches(&depth, 1, bids, bid_count) && depth_matches(&depth, 0, asks, ask_count);
+
+        const struct OrderBookLevelView *top_bids, *top_asks;
+        int top_bid_count, top_ask_count;
+        cache_matches = cache_matches &&
+                        OrderBook_peek_top_levels(book, &top_bids, &top_bid_count, &top_asks, &top_ask_count) &&
+                        top_bid_count == (bid_count < 3 ? bid_count : 3) &&
+                        top_ask_count == (ask_count < 3 ? ask_count : 3);
+        for (int j = 0; cache_matches && j < top_bid_count; j++) {
+            cache_matches = top_bids[j].price == bids[j].price && top_bids[j].size == bids[j].size &&
+                            top_bids[j].order_count == bids[j].order_count;
+        }
+        for (int j = 0; cache_matches && j < top_ask_count; j++) {
+            cache_matches = top_asks[j].price == asks[j].price && top_asks[j].size == asks[j].size &&
+                            top_asks[j].order_count == asks[j].order_count;
+        }
+        free(bids);
+        free(asks);
+    }
+    ASSERT(cache_matches, "Depth cache should hold the best levels after every message");
+    ASSERT(fills > 0, "Level feed flow should trade");
+    ASSERT(matches, "Depth rebuilt from level updates should match the book after every message, with its sequence");
+    ASSERT(depth.in_order && depth.well_formed, "Level updates should be in sequence and well formed");
+
+    /* After the handler is cleared the book stops reporting. */
+    int updates = depth.updates;
+    OrderBook_set_level_handler(book, NULL, NULL);
+    memset(&order, 0, sizeof(order));
+    strcpy(order.order_id, "quiet");
+    strcpy(order.user_id, "u0");
+    order.side = '1';
+    order.price = 99.0;
+    order.quantity = 1;
+    OrderBook_add_order_with_result(book, &order, &result);
+    ASSERT(depth.updates == updates, "No updates should arrive after the handler is cleared");
+
+    OrderBookMatchResult_free(&result);
+    OrderBook_destroy(&book);
+}
+
+static void test_level_updates(void)
+{
+    run_level_feed(NULL);
+
+    struct OrderBookConfig ladder;
+    memset(&ladder, 0, sizeof(ladder));
+    ladder.tick_size = 0.01;
+    ladder.min_price = 99.0;
+    ladder.max_price = 101.0;
+    run_level_feed(&ladder);
+
+    /* One update per level swept, best first, then the rested remainder. */
+    OrderBook book = OrderBook_create();
+    struct DepthCopy depth;
+    memset(&depth, 0, sizeof(depth));
+    Order a1 = createOrder("a1", "alice", 5, '0', 100.0, 1);
+    Order a2 = createOrder("a2", "alice", 5, '0', 100.0, 2);
+    Order a3 = createOrder("a3", "alice", 5, '0', 101.0, 3);
+    Order b1 = createOrder("b1", "bob", 18, '1', 101.0, 4);
+    OrderBook_add_order(book, a1, NULL);
+    OrderBook_add_order(book, a2, NULL);
+    OrderBook_add_order(book, a3, NULL);
+    OrderBook_set_level_handler(book, apply_level_update, &depth);
+    OrderBook_add_order(book, b1, NULL);
+    ASSERT(depth.updates == 3, "Sweeping two levels and resting should give three updates");
+    ASSERT(depth.counts[1] == 1 && depth.levels[1][0].price == 101.0 && depth.levels[1][0].size == 3 &&
+           depth.levels[1][0].order_count == 1,
+           "The rested remainder should be reported on the bid side");
+    ASSERT(depth.last_sequence == 3, "Updates of the fourth message should carry sequence 3");
+    free(a1);
+    free(a2);
+    free(a3);
+    free(b1);
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Depth Queries
+ * ===========================
+ * Sweep estimates and cumulative size read the side opposite the incoming order. */
+static void test_depth_queries(void)
+{
+    struct OrderBookConfig config = { .tick_size = 0.5, .min_price = 50.0, .max_price = 150.0 };
+    OrderBook books[2] = { OrderBook_create(), OrderBook_create_with_config(&config) };
+
+    for (int b = 0; b < 2; b++) {
+        OrderBook book = books[b];
+        Order ask1 = createOrder("ask1", "alice", 10, '0', 100.5, 1);
+        Order ask2 = createOrder("ask2", "alice", 20, '0', 101.0, 2);
+        Order ask3 = createOrder("ask3", "carol", 5, '0', 101.0, 3);
+        Order bid1 = createOrder("bid1", "bob", 7, '1', 99.0, 4);
+        OrderBook_add_order(book, ask1, NULL);
+        OrderBook_add_order(book, ask2, NULL);
+        OrderBook_add_order(book, ask3, NULL);
+        OrderBook_add_order(book, bid1, NULL);
+        free(ask1);
+        free(ask2);
+        free(ask3);
+        free(bid1);
+
+        struct OrderBookFillEstimate estimate;
+        ASSERT(OrderBook_estimate_fill(book, '1', 20, &estimate) == 1, "Estimating a buy should succeed");
+        ASSERT(estimate.quantity == 20 && estimate.levels == 2 && estimate.worst_price == 101.0,
+               "A buy of 20 should take 10 at 100.5 and 10 at 101.0");
+        ASSERT(fabs(estimate.vwap - 100.75) < 1e-9 && fabs(estimate.notional - 2015.0) < 1e-9,
+               "VWAP of the buy should be 100.75");
+        OrderBook_estimate_fill(book, '1', 100, &estimate);
+        ASSERT(estimate.quantity == 35 && estimate.levels == 2, "A buy larger than the asks should stop at 35");
+        OrderBook_estimate_fill(book, '0', 5, &estimate);
+        ASSERT(estimate.quantity == 5 && estimate.vwap == 99.0, "A sell should sweep the bids");
+        ASSERT(OrderBook_estimate_fill(book, 'x', 5, &estimate) == 0, "An invalid side should be rejected");
+
+        ASSERT(OrderBook_size_through_price(book, '1', 100.5) == 10, "A buy at 100.5 should reach only the best ask");
+        ASSERT(OrderBook_size_through_price(book, '1', 101.0) == 35, "A buy at 101.0 should reach both asks");
+        ASSERT(OrderBook_size_through_price(book, '1', 100.0) == 0, "A buy below the asks should reach nothing");
+        ASSERT(OrderBook_size_through_price(book, '0', 98.0) == 7, "A sell at 98.0 should reach the bid");
+        ASSERT(OrderBook_get_best_ask(book) == 100.5 && OrderBook_trade_count(book) == 0, "Queries should not change the book");
+
+        OrderBook_destroy(&book);
+    }
+}
+
+/* ===========================
+ * Test: Order Types
+ * ===========================
+ * Time in force and order type decide whether an order trades, rests or is rejected. */
+/* Adds an order with the given type and time in force, returning what the book returned. */
+static int add_typed_order(OrderBook book, struct OrderBookMatchResult *result, const char *order_id,
+                           char side, double price, int quantity, char order_type, char time_in_force)
+{
+    Order order = createOrder(order_id, "taker", quantity, side, price, 10);
+    order->order_type = order_type;
+    order->time_in_force = time_in_force;
+    int accepted = OrderBook_add_order_with_result(book, order, result);
+    free(order);
+    return accepted;
+}
+
+static void test_order_types(void)
+{
+    struct OrderBookConfig config = { .tick_size = 0.5, .min_price = 50.0, .max_price = 150.0 };
+    OrderBook books[2] = { OrderBook_create(), OrderBook_create_with_config(&config) };
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+
+    for (int b = 0; b < 2; b++) {
+        OrderBook book = books[b];
+        add_typed_order(book, &result, "ask1", '0', 100.0, 5, ORDER_TYPE_LIMIT, TIME_IN_FORCE_GTC);
+        add_typed_order(book, &result, "ask2", '0', 101.0, 5, ORDER_TYPE_LIMIT, TIME_IN_FORCE_GTC);
+        add_typed_order(book, &result, "bid1", '1', 98.0, 5, ORDER_TYPE_LIMIT, TIME_IN_FORCE_GTC);
+
+        /* IOC: trades what crosses, never rests */
+        ASSERT(add_typed_order(book, &result, "ioc1", '1', 99.0, 4, ORDER_TYPE_LIMIT, TIME_IN_FORCE_IOC) == 1 &&
+               result.count == 0, "An IOC that cannot trade should be accepted without fills");
+        ASSERT(OrderBook_get_best_bid(book) == 98.0 && !OrderBook_remove_order(book, "ioc1"),
+               "An IOC that cannot trade should not rest");
+        ASSERT(add_typed_order(book, &result, "ioc2", '1', 100.0, 8, ORDER_TYPE_LIMIT, TIME_IN_FORCE_IOC) == 1 &&
+               result.count == 1 && result.fills[0].size == 5, "An IOC should trade what crosses");
+        ASSERT(OrderBook_get_best_bid(book) == 98.0 && OrderBook_get_best_ask(book) == 101.0 &&
+               !OrderBook_remove_order(book, "ioc2"), "The rest of an IOC should be cancelled");
+
+        /* FOK: all or nothing, decided before the book changes */
+        add_typed_order(book, &result, "ask3", '0', 102.0, 5, ORDER_TYPE_LIMIT, TIME_IN_FORCE_GTC);
+        size_t trades = OrderBook_trade_count(book);
+        ASSERT(add_typed_order(book, &result, "fok1", '1', 101.0, 6, ORDER_TYPE_LIMIT, TIME_IN_FORCE_FOK) == 0 &&
+               result.count == 0 && OrderBook_trade_count(book) == trades,
+               "A FOK larger than what crosses should be rejected without trading");
+        ASSERT(add_typed_order(book, &result, "fok2", '1', 102.0, 11, ORDER_TYPE_LIMIT, TIME_IN_FORCE_FOK) == 0,
+               "A FOK larger than the whole side should be rejected");
+        ASSERT(add_typed_order(book, &result, "fok3", '1', 102.0, 7, ORDER_TYPE_LIMIT, TIME_IN_FORCE_FOK) == 1 &&
+               result.count == 2 && result.fills[0].price == 101.0 && result.fills[1].size == 2,
+               "A FOK that can fill should trade its whole quantity");
+        ASSERT(OrderBook_get_best_ask(book) == 102.0 && !OrderBook_remove_order(book, "fok3"),
+               "A filled FOK should leave nothing resting");
+
+        /* Market: any price, never rests */
+        add_typed_order(book, &result, "ask4", '0', 110.0, 5, ORDER_TYPE_LIMIT, TIME_IN_FORCE_GTC);
+        ASSERT(add_typed_order(book, &result, "mkt1", '1', 0.0, 20, ORDER_TYPE_MARKET, TIME_IN_FORCE_FOK) == 0 &&
+               result.count == 0, "A market FOK larger than the side should be rejected");
+        ASSERT(add_typed_order(book, &result, "mkt2", '1', 0.0, 6, ORDER_TYPE_MARKET, TIME_IN_FORCE_GTC) == 1 &&
+               result.count == 2 && result.fills[0].price == 102.0 && result.fills[1].price == 110.0 &&
+               result.fills[1].size == 3, "A market buy should sweep the asks whatever its price");
+        ASSERT(add_typed_order(book, &result, "mkt3", '0', 500.0, 10, ORDER_TYPE_MARKET, TIME_IN_FORCE_IOC) == 1 &&
+               result.count == 1 && result.fills[0].price == 98.0 && result.fills[0].size == 5,
+               "A market sell should sweep the bids whatever its price");
+        ASSERT(OrderBook_get_best_bid(book) == 0.0 && !OrderBook_remove_order(book, "mkt3"),
+               "The rest of a market order should be cancelled");
+        ASSERT(add_typed_order(book, &result, "mkt4", '0', 0.0, 10, ORDER_TYPE_MARKET, TIME_IN_FORCE_GTC) == 1 &&
+               result.count == 0, "A market order against an empty side should be accepted without fills");
+
+        /* Post-only: rests, or is rejected if it would trade */
+        trades = OrderBook_trade_count(book);
+        ASSERT(add_typed_order(book, &result, "post1", '1', 110.0, 1, ORDER_TYPE_POST_ONLY, TIME_IN_FORCE_GTC) == 0 &&
+               OrderBook_trade_count(book) == trades, "A crossing post-only order should be rejected");
+        ASSERT(add_typed_order(book, &result, "post2", '1', 109.5, 1, ORDER_TYPE_POST_ONLY, TIME_IN_FORCE_GTC) == 1 &&
+               OrderBook_get_best_bid(book) == 109.5, "A post-only order that does not cross should rest");
+        ASSERT(OrderBook_remove_order(book, "post2") && OrderBook_remove_order(book, "ask4"),
+               "Resting orders should still be removable");
+
+        ASSERT(add_typed_order(book, &result, "bad1", '1', 100.0, 1, 7, TIME_IN_FORCE_GTC) == 0 &&
+               add_typed_order(book, &result, "bad2", '1', 100.0, 1, ORDER_TYPE_LIMIT, 9) == 0 &&
+               OrderBook_get_best_bid(book) == 0.0, "Unknown types should be rejected");
+        OrderBook_destroy(&book);
+    }
+    OrderBookMatchResult_free(&result);
+}
+
+/* ===========================
+ * Test: Modify Orders
+ * ===========================
+ * A reduce keeps queue priority, a new price moves the order, and a crossing
+ * price trades like an arriving order. */
+static void test_modify_order(void)
+{
+    struct OrderBookConfig config = { .tick_size = 0.5, .min_price = 50.0, .max_price = 150.0 };
+    OrderBook books[2] = { OrderBook_create(), OrderBook_create_with_config(&config) };
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+
+    for (int b = 0; b < 2; b++) {
+        OrderBook book = books[b];
+        add_test_order(book, "a1", "maker", 10, '0', 101.0);
+        add_test_order(book, "a2", "maker", 10, '0', 101.0);
+        add_test_order(book, "b1", "maker", 5, '1', 99.0);
+
+        ASSERT(OrderBook_modify_order(book, "a1", 101.0, 4, &result) == 1 && result.count == 0,
+               "A quantity reduce should be accepted without fills");
+        ASSERT(OrderBook_size_through_price(book, '1', 101.0) == 14, "A reduce should shrink its level");
+        ASSERT(OrderBook_modify_order(book, "b1", 100.0, 5, NULL) == 1 && OrderBook_get_best_bid(book) == 100.0,
+               "A new price should move the order's level");
+
+        ASSERT(OrderBook_modify_order(book, "a2", 100.0, 8, &result) == 1 && result.count == 1 &&
+               result.fills[0].size == 5 && result.fills[0].price == 100.0 &&
+               strcmp(OrderBook_get_id_string(book, result.fills[0].maker_order), "b1") == 0, "A crossing price should trade");
+        ASSERT(OrderBook_get_best_bid(book) == 0.0 && OrderBook_get_best_ask(book) == 100.0 &&
+               OrderBook_size_through_price(book, '1', 100.0) == 3, "The rest of a crossing modify should rest");
+
+        ASSERT(!OrderBook_modify_order(book, "missing", 100.0, 1, &result) && result.count == 0,
+               "Modifying a missing order should fail");
+        ASSERT(!OrderBook_modify_order(book, "a1", 101.0, 0, &result) &&
+               OrderBook_size_through_price(book, '1', 101.0) == 7, "A non-positive quantity should be rejected");
+        ASSERT(!OrderBook_modify_order(book, "b1", 100.0, 5, &result), "A filled order cannot be modified");
+
+        add_test_order(book, "b2", "maker", 3, '1', 99.0);
+        ASSERT(OrderBook_modify_order(book, "a2", 99.0, 3, &result) == 1 && result.count == 1 &&
+               result.fills[0].size == 3, "A modify that fills completely should trade");
+        ASSERT(!OrderBook_remove_order(book, "a2") && OrderBook_get_best_bid(book) == 0.0,
+               "A completely filled modify should leave nothing resting");
+
+        /* A reduce keeps a1 ahead of a3; growing it sends it behind */
+        add_test_order(book, "a3", "maker", 5, '0', 101.0);
+        OrderBook_modify_order(book, "a1", 101.0, 3, NULL);
+        Order taker = createOrder("t1", "taker", 1, '1', 101.0, 10);
+        OrderBook_add_order_with_result(book, taker, &result);
+        ASSERT(result.count == 1 && strcmp(OrderBook_get_id_string(book, result.fills[0].maker_order), "a1") == 0,
+               "A reduced order should keep its queue priority");
+        OrderBook_modify_order(book, "a1", 101.0, 5, NULL);
+        OrderBook_add_order_with_result(book, taker, &result);
+        free(taker);
+        ASSERT(result.count == 1 && strcmp(OrderBook_get_id_string(book, result.fills[0].maker_order), "a3") == 0,
+               "A grown order should lose its queue priority");
+        ASSERT(OrderBook_remove_order(book, "a3"), "The order behind should still rest");
+
+        ASSERT(OrderBook_remove_order(book, "a1") && !OrderBook_remove_order(book, "a1"),
+               "A modified order should be removed once");
+
+        /* An ID rests on one side at most */
+        add_test_order(book, "dup", "maker", 1, '1', 90.0);
+        add_test_order(book, "dup", "maker", 1, '0', 120.0);
+        ASSERT(OrderBook_get_best_ask(book) == 0.0 && OrderBook_remove_order(book, "dup") &&
+               OrderBook_get_best_bid(book) == 0.0, "A duplicate ID should not rest on the other side");
+
+        /* A crossing price outside a ladder's band is rejected before anything trades */
+        if (b == 1) {
+            add_test_order(book, "bb", "maker", 2, '1', 99.0);
+            add_test_order(book, "sa", "maker", 5, '0', 100.0);
+            ASSERT(!OrderBook_modify_order(book, "bb", 200.0, 10, &result) && result.count == 0,
+                   "A crossing modify outside the band should be rejected");
+            ASSERT(OrderBook_size_through_price(book, '1', 100.0) == 5 && OrderBook_get_best_bid(book) == 99.0,
+                   "A rejected modify should leave both orders in place");
+            ASSERT(OrderBook_remove_order(book, "bb") && OrderBook_remove_order(book, "sa"),
+                   "Both orders should still rest after a rejected modify");
+        }
+
+        /* A duplicate ID is rejected before it can trade */
+        add_test_order(book, "dupx", "maker", 1, '1', 99.0);
+        add_test_order(book, "s", "maker", 5, '0', 100.0);
+        Order dup = createOrder("dupx", "taker", 10, '1', 101.0, 10);
+        ASSERT(OrderBook_add_order_with_result(book, dup, &result) == 0 && result.count == 0,
+               "A duplicate ID that crosses should be rejected without trading");
+        free(dup);
+        ASSERT(OrderBook_size_through_price(book, '1', 100.0) == 5 && OrderBook_get_best_bid(book) == 99.0,
+               "A rejected duplicate should leave the book as it was");
+        ASSERT(OrderBook_remove_order(book, "dupx") && OrderBook_remove_order(book, "s"),
+               "The original orders should still rest");
+
+        OrderBook_destroy(&book);
+    }
+    OrderBookMatchResult_free(&result);
+}
+
+/* ===========================
+ * Test: Cancel All For User
+ * ===========================
+ * One call removes every resting order of a user from both sides. */
+static void test_cancel_all_for_user(void)
+{
+    struct OrderBookConfig config = { .tick_size = 0.5, .min_price = 50.0, .max_price = 150.0, .depth_cache = 3 };
+    OrderBook books[2] = { OrderBook_create(), OrderBook_create_with_config(&config) };
+    char order_id[16];
+
+    for (int b = 0; b < 2; b++) {
+        OrderBook book = books[b];
+        for (int i = 0; i < 30; i++) {
+            snprintf(order_id, sizeof(order_id), "alice%d", i);
+            add_test_order(book, order_id, "alice", 1 + i, i % 2 ? '1' : '0', i % 2 ? 99.0 - (i % 5) : 101.0 + (i % 5));
+        }
+        add_test_order(book, "bob_bid", "bob", 5, '1', 97.0);
+        add_test_order(book, "bob_ask", "bob", 6, '0', 104.0);
+        OrderBook_modify_order(book, "alice1", 98.5, 50, NULL);
+
+        uint64_t sequence = OrderBook_message_sequence(book);
+        ASSERT(OrderBook_cancel_all_for_user(book, "alice") == 30, "Every one of the user's orders should be cancelled");
+        ASSERT(OrderBook_message_sequence(book) == sequence + 1, "A cancel for a user should be one message");
+        ASSERT(OrderBook_get_best_bid(book) == 97.0 && OrderBook_get_best_ask(book) == 104.0,
+               "Other users' orders should remain");
+
+        struct OrderBookLevelView *bids, *asks;
+        int bid_count, ask_count;
+        OrderBook_get_top_levels(book, 0, &bids, &bid_count, &asks, &ask_count);
+        ASSERT(bid_count == 1 && ask_count == 1 && bids[0].size == 5 && asks[0].size == 6,
+               "Emptied levels should be gone");
+        free(bids);
+        free(asks);
+        const struct OrderBookLevelView *cached_bids, *cached_asks;
+        OrderBook_peek_top_levels(book, &cached_bids, &bid_count, &cached_asks, &ask_count);
+        ASSERT(b == 0 || (bid_count == 1 && cached_bids[0].price == 97.0 && ask_count == 1 && cached_asks[0].price == 104.0),
+               "The depth cache should follow a cancel for a user");
+
+        ASSERT(!OrderBook_remove_order(book, "alice0") && !OrderBook_modify_order(book, "alice1", 98.0, 1, NULL),
+               "Cancelled orders should be gone");
+        ASSERT(OrderBook_cancel_all_for_user(book, "alice") == 0 && OrderBook_cancel_all_for_user(book, "nobody") == 0,
+               "A user with nothing resting should cancel nothing");
+
+        add_test_order(book, "alice0", "alice", 2, '1', 96.0);
+        ASSERT(OrderBook_cancel_all_for_user(book, "alice") == 1 && OrderBook_cancel_all_for_user(book, "bob") == 2 &&
+               OrderBook_get_best_bid(book) == 0.0 && OrderBook_get_best_ask(book) == 0.0,
+               "IDs should be reusable after a cancel for a user");
+
+        OrderBook_destroy(&book);
+    }
+}
+
+/* ===========================
+ * Test: Trade Clocks
+ * ===========================
+ * A book reads its clock once per message, and a logical clock makes trade
+ * timestamps depend only on the orders added. */
+static long counting_clock(void *context)
+{
+    long *calls = (long *)context;
+    return 1000 + (*calls)++;
+}
+
+/* Adds an order with a timestamp, returning the timestamp of its first trade, or -1 if it did not trade. */
+static long add_timed_order(OrderBook book, struct OrderBookMatchResult *result, const char *order_id,
+                            char side, double price, int quantity, long timestamp)
+{
+    Order order = createOrder(order_id, "clock", quantity, side, price, timestamp);
+    OrderBook_add_order_with_result(book, order, result);
+    free(order);
+    struct TradeRecord record;
+    if (result->count == 0 || !OrderBook_get_trade_record(book, result->fills[0].trade_id, &record)) {
+        return -1;
+    }
+    return record.timestamp;
+}
+
+static void test_clocks(void)
+{
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    struct TradeRecord record;
+
+    /* Logical: the latest order timestamp, never running backwards */
+    struct OrderBookConfig config = { .clock = ORDER_BOOK_CLOCK_LOGICAL };
+    OrderBook book = OrderBook_create_with_config(&config);
+    add_timed_order(book, &result, "a1", '0', 100.0, 5, 100);
+    add_timed_order(book, &result, "a2", '0', 100.0, 5, 200);
+    ASSERT(add_timed_order(book, &result, "t1", '1', 100.0, 2, 300) == 300,
+           "A logical clock should stamp a trade with the order's timestamp");
+    ASSERT(add_timed_order(book, &result, "t2", '1', 100.0, 2, 250) == 300,
+           "A logical clock should not run backwards");
+    add_timed_order(book, &result, "b1", '1', 99.0, 1, 400);
+    ASSERT(OrderBook_modify_order(book, "a2", 99.0, 5, &result) && result.count == 1 &&
+           OrderBook_get_trade_record(book, result.fills[0].trade_id, &record) && record.timestamp == 400,
+           "A crossing modify should trade at the current logical time");
+
+    ASSERT(OrderBook_save(book, SNAPSHOT_PATH), "Save should succeed");
+    OrderBook loaded = OrderBook_load(SNAPSHOT_PATH, &config);
+    add_timed_order(loaded, &result, "b2", '1', 98.0, 1, 10);
+    ASSERT(OrderBook_modify_order(loaded, "a2", 98.0, 4, &result) && result.count >= 1 &&
+           OrderBook_get_trade_record(loaded, result.fills[0].trade_id, &record) && record.timestamp == 400,
+           "A loaded book should resume its logical time");
+    OrderBook_destroy(&loaded);
+    OrderBook_destroy(&book);
+    remove(SNAPSHOT_PATH);
+
+    /* Callback: read once per message, shared by its trades */
+    long calls = 0;
+    config = (struct OrderBookConfig){ .clock = ORDER_BOOK_CLOCK_CALLBACK, .clock_fn = counting_clock, .clock_context = &calls };
+    book = OrderBook_create_with_config(&config);
+    add_timed_order(book, &result, "a1", '0', 100.0, 1, 0);
+    add_timed_order(book, &result, "a2", '0', 101.0, 1, 0);
+    add_timed_order(book, &result, "a3", '0', 102.0, 1, 0);
+    ASSERT(calls == 0, "A message without trades should not read the clock");
+    add_timed_order(book, &result, "t1", '1', 102.0, 3, 0);
+    int shared = result.count == 3;
+    for (int i = 0; shared && i < result.count; i++) {
+        shared = OrderBook_get_trade_record(book, result.fills[i].trade_id, &record) && record.timestamp == 1000;
+    }
+    ASSERT(calls == 1 && shared, "The trades of one message should share one clock reading");
+    add_timed_order(book, &result, "a4", '0', 100.0, 1, 0);
+    ASSERT(add_timed_order(book, &result, "t2", '1', 100.0, 1, 0) == 1001, "The next message should read the clock again");
+    OrderBook_destroy(&book);
+
+    /* Monotonic: nanoseconds that do not go backwards */
+    config = (struct OrderBookConfig){ .clock = ORDER_BOOK_CLOCK_MONOTONIC };
+    book = OrderBook_create_with_config(&config);
+    add_timed_order(book, &result, "a1", '0', 100.0, 2, 0);
+    long first = add_timed_order(book, &result, "t1", '1', 100.0, 1, 0);
+    long second = add_timed_order(book, &result, "t2", '1', 100.0, 1, 0);
+    ASSERT(first > 0 && second >= first, "A monotonic clock should not go backwards");
+    OrderBook_destroy(&book);
+
+    config = (struct OrderBookConfig){ .clock = ORDER_BOOK_CLOCK_CALLBACK };
+    ASSERT(OrderBook_create_with_config(&config) == NULL, "A callback clock without a callback should be rejected");
+    config.clock = (enum OrderBookClock)99;
+    ASSERT(OrderBook_create_with_config(&config) == NULL, "An unknown clock should be rejected");
+    OrderBookMatchResult_free(&result);
+}
+
+/* ===========================
+ * Test: Memory Stats
+ * ===========================
+ * The memory a book reports follows what it holds, and the ID tables give
+ * memory back once the orders that filled them are gone. */
+static size_t sum_memory_stats(const struct OrderBookMemoryStats *stats)
+{
+    return stats->level_bytes + stats->order_bytes + stats->hash_bytes + stats->trade_bytes + stats->other_bytes;
+}
+
+static void test_memory_stats(void)
+{
+    struct OrderBookMemoryStats empty, full, drained;
+    OrderBook book = OrderBook_create();
+    ASSERT(OrderBook_get_memory_stats(book, &empty) && empty.total_bytes == sum_memory_stats(&empty) &&
+           empty.level_bytes > 0 && empty.hash_bytes > 0 && empty.other_bytes > 0,
+           "An empty book should report its fixed memory");
+
+    char order_id[32];
+    for (int i = 0; i < 20000; i++) {
+        snprintf(order_id, sizeof(order_id), "mem%d", i);
+        add_test_order(book, order_id, "mem", 1, i % 2 ? '1' : '0', i % 2 ? 90.0 - i % 10 : 110.0 + i % 10);
+    }
+    add_test_order(book, "sweep", "mem", 100, '1', 110.0);
+    ASSERT(OrderBook_get_memory_stats(book, &full) && full.total_bytes == sum_memory_stats(&full),
+           "Memory stats should add up");
+    ASSERT(full.level_bytes >= empty.level_bytes && full.order_bytes > empty.order_bytes &&
+           full.hash_bytes > empty.hash_bytes && full.trade_bytes > empty.trade_bytes,
+           "Resting orders, deep queues and trades should show up in the stats");
+
+    for (int i = 0; i < 20000; i++) {
+        snprintf(order_id, sizeof(order_id), "mem%d", i);
+        OrderBook_remove_order(book, order_id);
+    }
+    /* The string pool keeps its blocks for the next orders; the hash buckets shrink. */
+    ASSERT(OrderBook_get_memory_stats(book, &drained) && drained.hash_bytes < full.hash_bytes / 2,
+           "The ID tables should shrink once the book empties");
+    ASSERT(drained.trade_bytes == full.trade_bytes, "Trade history should stay counted after the orders go");
+    ASSERT(!OrderBook_get_memory_stats(NULL, &drained) && !OrderBook_get_memory_stats(book, NULL),
+           "Memory stats should reject invalid arguments");
+    OrderBook_destroy(&book);
+}
+
+/* ===========================
+ * Test: Trade Log Spill
+ * ===========================
+ * A spilling log writes its trades' IDs out with them, so a long session of
+ * one-off order and user IDs runs in flat memory and spilled trades still
+ * report their IDs. */
+#define SPILL_PATH "TestOrderBook.spill"
+
+static void add_spill_trades(OrderBook book, int from, int to)
+{
+    char maker_id[32], taker_id[32], user_id[32];
+    for (int i = from; i < to; i++) {
+        snprintf(maker_id, sizeof(maker_id), "sm%d", i);
+        snprintf(taker_id, sizeof(taker_id), "st%d", i);
+        snprintf(user_id, sizeof(user_id), "su%d", i);
+        add_test_order(book, maker_id, user_id, 1, '0', 100.0);
+        add_test_order(book, taker_id, user_id, 1, '1', 100.0);
+    }
+}
+
+static void test_trade_log_spill(void)
+{
+    struct OrderBookConfig config = { .trade_log = { TRADE_LOG_SPILL, 64, SPILL_PATH } };
+    OrderBook book = OrderBook_create_with_config(&config);
+    ASSERT(book != NULL, "Failed to create OrderBook in test_trade_log_spill");
+
+    /* Measure at chunk boundaries, once spilling is under way and again much later. */
+    struct OrderBookMemoryStats early, late;
+    add_spill_trades(book, 0, 640);
+    ASSERT(OrderBook_get_memory_stats(book, &early), "Memory stats should be available");
+    add_spill_trades(book, 640, 6400);
+    ASSERT(OrderBook_get_memory_stats(book, &late), "Memory stats should be available");
+    ASSERT(late.total_bytes == early.total_bytes && late.hash_bytes == early.hash_bytes,
+           "Spilling trades should release their IDs, keeping memory flat");
+    ASSERT(OrderBook_trade_count(book) == 6400, "A spilling log should retain every trade");
+
+    Trade first = OrderBook_get_trade(book, "TRADE-00000000");
+    ASSERT(first && strcmp(first->sell_order_id, "sm0") == 0 && strcmp(first->buy_order_id, "st0") == 0 &&
+           strcmp(first->sell_user_id, "su0") == 0, "A spilled trade should keep its IDs");
+    free(first);
+
+    /* A cursor resolves the IDs of each spilled trade it reads back. */
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, 0);
+    const struct TradeRecord *record;
+    int matching = 0;
+    char expected[32];
+    while ((record = OrderBook_next_trade(book, &cursor))) {
+        snprintf(expected, sizeof(expected), "sm%ld", record->sequence);
+        const char *seller = OrderBook_get_id_string(book, record->sell_order_id);
+        if (seller && strcmp(seller, expected) == 0) matching++;
+    }
+    ASSERT(matching == 6400, "Every trade read back should resolve its seller");
+
+    struct TradeRecord copy;
+    ASSERT(OrderBook_get_trade_record(book, 100, &copy), "A spilled trade record should be readable");
+    const char *buyer = OrderBook_get_id_string(book, copy.buy_user_id);
+    ASSERT(buyer && strcmp(buyer, "su100") == 0, "A spilled trade record should resolve its buyer");
+
+    OrderBook_destroy(&book);
+    remove(SPILL_PATH);
+}
+
 /* ===========================
  * MAIN: Run All Tests
  * =========================== */
@@ -496,6 +1660,21 @@ int main(void)
     test_get_all_trades();
     test_stress();
     test_get_trade();
+    test_create_with_config();
+    test_price_ladder();
+    test_ladder_band();
+    test_add_order_with_result();
+    test_trade_log_ring();
+    test_snapshot();
+    test_batch();
+    test_level_updates();
+    test_depth_queries();
+    test_order_types();
+    test_modify_order();
+    test_cancel_all_for_user();
+    test_clocks();
+    test_memory_stats();
+    test_trade_log_spill();
 
     printf("\n--- Test Results ---\n");
     printf("Tests Passed: %d\n", testsPassed);
@@ -2,7 +2,7 @@
  * 
  * This file contains a main function that rigorously tests the functionality of
  * the OrderBookLevel module. The tests cover adding, removing, retrieving, and
- * checking total quantities of orders.
+ * checking total quantities of orders, as well as growth and compaction of the queue.
  *
  * Author: Adam Rubinstein
  * Date: January 2025
@@ -17,6 +17,22 @@ void print_test_result(const char *test_name, int result) {
     printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
 }
 
+// Records compaction moves by order ID
+static void record_move(void *context, uint32_t order_id, OrderSlot slot) {
+    OrderSlot *moved = context;
+    moved[order_id] = slot;
+}
+
+// Total quantity of the orders that still have live slots
+static int sum_live(const OrderSlot *slots, int count) {
+    int total = 0;
+    struct BookOrder order;
+    for (int i = 0; i < count; i++) {
+        if (OrderBookLevel_read_order(slots[i], &order)) total += order.quantity;
+    }
+    return total;
+}
+
 int main() {
     OrderBookLevel level = OrderBookLevel_create(100.50);
     if (!level) {
@@ -25,9 +41,9 @@ int main() {
     }
 
     // Test 1: Add orders
-    struct Order order1 = {"order1", "user1", 10, 'B', 100.50, 1622515800};
-    struct Order order2 = {"order2", "user2", 20, 'B', 100.50, 1622515900};
-    struct Order order3 = {"order3", "user3", 30, 'B', 100.50, 1622516000};
+    struct BookOrder order1 = {1, 1, 10, 'B', 100.50, 1622515800};
+    struct BookOrder order2 = {2, 2, 20, 'B', 100.50, 1622515900};
+    struct BookOrder order3 = {3, 3, 30, 'B', 100.50, 1622516000};
 
     print_test_result("Add 1st order", OrderBookLevel_add_order(level, &order1));
     print_test_result("Add 2nd order", OrderBookLevel_add_order(level, &order2));
@@ -37,15 +53,15 @@ int main() {
     print_test_result("Total quantity check", OrderBookLevel_get_total_quantity(level) == 60);
 
     // Test 3: Remove orders
-    struct Order ro = {0};
-    Order removed_order = &ro;
-    print_test_result("Remove 1st order", OrderBookLevel_remove_order(level, removed_order) && strcmp(removed_order->order_id, "order1") == 0);
+    struct BookOrder ro = {0};
+    BookOrder removed_order = &ro;
+    print_test_result("Remove 1st order", OrderBookLevel_remove_order(level, removed_order) && removed_order->order_id == 1);
     print_test_result("Total quantity after 1st removal", OrderBookLevel_get_total_quantity(level) == 50);
 
-    print_test_result("Remove 2nd order", OrderBookLevel_remove_order(level, removed_order) && strcmp(removed_order->order_id, "order2") == 0);
+    print_test_result("Remove 2nd order", OrderBookLevel_remove_order(level, removed_order) && removed_order->order_id == 2);
     print_test_result("Total quantity after 2nd removal", OrderBookLevel_get_total_quantity(level) == 30);
 
-    print_test_result("Remove 3rd order", OrderBookLevel_remove_order(level, removed_order) && strcmp(removed_order->order_id, "order3") == 0);
+    print_test_result("Remove 3rd order", OrderBookLevel_remove_order(level, removed_order) && removed_order->order_id == 3);
     print_test_result("Total quantity after 3rd removal", OrderBookLevel_get_total_quantity(level) == 0);
 
     // Test 4: Remove from empty level
@@ -57,8 +73,7 @@ int main() {
     // Test 6: Add and remove many orders
     int passed = 1;
     for (int i = 0; i < 100; i++) {
-        struct Order order = {"", "user", i + 1, 'B', 100.50, 1622516000 + i};
-        snprintf(order.order_id, sizeof(order.order_id), "order%d", i + 1);
+        struct BookOrder order = {i + 1, 1, i + 1, 'B', 100.50, 1622516000 + i};
         passed &= OrderBookLevel_add_order(level, &order);
     }
     print_test_result("Add 100 orders", passed);
@@ -71,6 +86,129 @@ int main() {
     print_test_result("Remove 100 orders", passed);
     print_test_result("Level is empty after removing 100 orders", OrderBookLevel_is_empty(level));
 
+    // Test 7: Unlink orders by slot from the middle, head and tail
+    struct BookOrder order4 = {4, 4, 40, 'B', 100.50, 1622516100};
+    struct BookOrder order5 = {5, 5, 50, 'B', 100.50, 1622516200};
+    struct BookOrder order6 = {6, 6, 60, 'B', 100.50, 1622516300};
+    OrderSlot slot4, slot5, slot6;
+    print_test_result("Push returns slots", OrderBookLevel_push_order(level, &order4, &slot4) &&
+                      OrderBookLevel_push_order(level, &order5, &slot5) &&
+                      OrderBookLevel_push_order(level, &order6, &slot6));
+    print_test_result("Slot holds order", OrderBookLevel_read_order(slot5, removed_order) && removed_order->order_id == 5 &&
+                      removed_order->user_id == 5 && removed_order->timestamp == 1622516200 && removed_order->side == 'B');
+    print_test_result("Slot knows its level", slot5.level == level);
+
+    print_test_result("Unlink middle slot", OrderBookLevel_unlink_order(level, slot5));
+    print_test_result("Total quantity after unlinking middle", OrderBookLevel_get_total_quantity(level) == 100);
+    print_test_result("Unlinked order is gone", !OrderBookLevel_get_order_by_id(level, 5, NULL) &&
+                      !OrderBookLevel_read_order(slot5, NULL) && !OrderBookLevel_unlink_order(level, slot5));
+
+    print_test_result("Unlink tail slot", OrderBookLevel_unlink_order(level, slot6));
+    struct BookOrder order7 = {7, 7, 70, 'B', 100.50, 1622516400};
+    OrderBookLevel_add_order(level, &order7);
+    print_test_result("Unlink head slot", OrderBookLevel_unlink_order(level, slot4));
+    print_test_result("Queue order kept after unlinks", OrderBookLevel_remove_order(level, removed_order) && removed_order->order_id == 7);
+    print_test_result("Level is empty after unlinks", OrderBookLevel_is_empty(level) && OrderBookLevel_get_total_quantity(level) == 0);
+
+    OrderBookLevel other_level = OrderBookLevel_create(101.00);
+    OrderSlot foreign;
+    OrderBookLevel_push_order(other_level, &order4, &foreign);
+    print_test_result("Unlink rejects slot from another level", !OrderBookLevel_unlink_order(level, foreign));
+    struct BookOrder empty_order = {8, 8, 0, 'B', 100.50, 1622516500};
+    print_test_result("Push rejects empty order", !OrderBookLevel_push_order(level, &empty_order, NULL) &&
+                      OrderBookLevel_is_empty(level));
+
+    // Test 8: Reduce orders in place and keep the aggregates without rescanning
+    OrderSlot slot8;
+    OrderBookLevel_push_order(level, &order4, &slot8);
+    OrderBookLevel_push_order(level, &order5, NULL);
+    print_test_result("Order count after pushes", OrderBookLevel_get_order_count(level) == 2);
+    print_test_result("Reduce order", OrderBookLevel_reduce_order(level, slot8, 15) &&
+                      OrderBookLevel_read_order(slot8, removed_order) && removed_order->quantity == 25);
+    print_test_result("Total quantity after reduce", OrderBookLevel_get_total_quantity(level) == 75 &&
+                      OrderBookLevel_get_order_count(level) == 2);
+    print_test_result("Reduce rejects out-of-range quantity", !OrderBookLevel_reduce_order(level, slot8, 25) &&
+                      !OrderBookLevel_reduce_order(level, slot8, 0) &&
+                      OrderBookLevel_read_order(slot8, removed_order) && removed_order->quantity == 25);
+    print_test_result("Reduce rejects slot from another level", !OrderBookLevel_reduce_order(level, foreign, 1));
+    print_test_result("Reduced order keeps its place", OrderBookLevel_get_order(level, removed_order) && removed_order->order_id == 4);
+    OrderBookLevel_unlink_order(level, slot8);
+    print_test_result("Order count after unlink", OrderBookLevel_get_order_count(level) == 1 &&
+                      OrderBookLevel_get_total_quantity(level) == 50);
+    OrderBookLevel_reset_total_quantity(level);
+    print_test_result("Reset agrees with kept aggregates", OrderBookLevel_get_order_count(level) == 1 &&
+                      OrderBookLevel_get_total_quantity(level) == 50);
+    OrderBookLevel_remove_order(level, NULL);
+    OrderBookLevel_destroy(&other_level);
+
+    // Test 9: A queue deeper than the inline capacity grows and keeps time priority
+    int count = (int)OrderBookLevel_inline_orders() * 4 + 3;
+    OrderSlot slots[64];
+    passed = 1;
+    for (int i = 0; i < count; i++) {
+        struct BookOrder order = {i + 1, 100 + i, i + 1, 'B', 100.50, 1622517000 + i};
+        passed &= OrderBookLevel_push_order(level, &order, &slots[i]);
+    }
+    print_test_result("Push past inline capacity", passed && OrderBookLevel_get_order_count(level) == count);
+    passed = 1;
+    for (int i = 0; i < count; i++) {
+        passed &= OrderBookLevel_read_order(slots[i], removed_order) && removed_order->order_id == (uint32_t)(i + 1) &&
+                  removed_order->user_id == (uint32_t)(100 + i) && removed_order->timestamp == 1622517000 + i;
+    }
+    print_test_result("Slots survive growth", passed);
+    OrderSlot walk;
+    int walked = 0;
+    passed = OrderBookLevel_front(level, &walk);
+    while (passed) {
+        OrderBookLevel_read_order(walk, removed_order);
+        if (removed_order->order_id != (uint32_t)(++walked)) break;
+        passed = OrderBookLevel_next(&walk);
+    }
+    print_test_result("Walk visits every order in time priority", walked == count);
+
+    // Test 10: Compaction closes the gaps left by cancels and reports moved orders
+    for (int i = 1; i < count - 1; i++) {
+        if (i % 4 != 0) OrderBookLevel_unlink_order(level, slots[i]);
+    }
+    int live = OrderBookLevel_get_order_count(level);
+    int live_total = sum_live(slots, count);
+    print_test_result("Dead entries call for compaction", OrderBookLevel_needs_compaction(level) &&
+                      live_total == OrderBookLevel_get_total_quantity(level));
+    walked = 0;
+    passed = OrderBookLevel_front(level, &walk);
+    while (passed) {
+        walked++;
+        passed = OrderBookLevel_next(&walk);
+    }
+    print_test_result("Walk skips dead entries", walked == live);
+
+    OrderSlot moved[64] = {{0}};
+    OrderBookLevel_compact(level, record_move, moved);
+    passed = !OrderBookLevel_needs_compaction(level) && OrderBookLevel_get_order_count(level) == live &&
+             OrderBookLevel_get_total_quantity(level) == live_total;
+    for (int i = 0; i < count; i++) {
+        if (i != 0 && i != count - 1 && i % 4 != 0) continue;
+        OrderSlot slot = moved[i + 1].level ? moved[i + 1] : slots[i];
+        passed &= OrderBookLevel_read_order(slot, removed_order) && removed_order->order_id == (uint32_t)(i + 1);
+    }
+    print_test_result("Compaction relocates in place", passed && !moved[1].level);
+    passed = 1;
+    for (int i = 0; i < count; i++) {
+        if (i != 0 && i != count - 1 && i % 4 != 0) continue;
+        passed &= OrderBookLevel_remove_order(level, removed_order) && removed_order->order_id == (uint32_t)(i + 1);
+    }
+    print_test_result("Compaction keeps time priority", passed && OrderBookLevel_is_empty(level));
+
+    // Test 11: Levels from a pool
+    Pool pool = Pool_create(OrderBookLevel_block_size(), 4);
+    OrderBookLevel pooled = OrderBookLevel_create_with_pool(99.0, pool);
+    print_test_result("Pooled level allocated", pooled && Pool_in_use(pool) == 1);
+    OrderBookLevel_add_order(pooled, &order4);
+    print_test_result("Pooled level reads its price", OrderBookLevel_get_order(pooled, removed_order) && removed_order->price == 99.0);
+    OrderBookLevel_destroy(&pooled);
+    print_test_result("Pooled level released", !pooled && Pool_in_use(pool) == 0);
+    Pool_destroy(&pool);
+
     // Cleanup
     OrderBookLevel_destroy(&level);
     printf("All tests completed.\n");
@@ -0,0 +1,195 @@
+/* TestOrderBookManager.c - Unit tests for the OrderBookManager and SpscRing modules
+ *
+ * This file contains a main function that tests the SpscRing module on its own and across
+ * two threads, then the OrderBookManager: sharding symbols across workers, routing CSV
+ * lines, and comparing every sharded book with the same flow applied single-threaded.
+ */
+
+#include "OrderBookManager.h"
+#include "SpscRing.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_RECORDS 100000
+#define SYMBOL_COUNT 12
+#define FLOW_LENGTH 20000
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+// Pushes 0..RING_RECORDS-1 in order, retrying while the ring is full
+static void *produce(void *argument) {
+    SpscRing ring = argument;
+    for (long i = 0; i < RING_RECORDS; i++) {
+        while (!SpscRing_push(ring, &i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// One generated line of order flow
+static void flow_line(int i, char *line, size_t size, char *symbol) {
+    // A remove cancels the order added three lines earlier, on that order's symbol
+    unsigned int state = (unsigned int)(i % 5 == 4 ? i - 3 : i) * 2654435761u;
+    snprintf(symbol, ORDER_BOOK_MANAGER_MAX_SYMBOL + 1, "SYM%u", (state >> 4) % SYMBOL_COUNT);
+    if (i % 5 == 4) {
+        snprintf(line, size, "REMOVE,%s,o%d", symbol, i - 3);
+    } else {
+        snprintf(line, size, "ADD,%s,o%d,u%u,%s,%u.%02u,%u,%d", symbol, i, (state >> 8) % 9,
+                 (state >> 12) & 1 ? "buy" : "sell", 99 + (state >> 13) % 3, (state >> 16) % 100,
+                 1 + (state >> 20) % 50, 1000 + i);
+    }
+}
+
+// Whether two books have the same levels on both sides
+static int same_levels(OrderBook a, OrderBook b) {
+    struct OrderBookLevelView *a_bids, *a_asks, *b_bids, *b_asks;
+    int a_bid_count, a_ask_count, b_bid_count, b_ask_count;
+    OrderBook_get_top_levels(a, 0, &a_bids, &a_bid_count, &a_asks, &a_ask_count);
+    OrderBook_get_top_levels(b, 0, &b_bids, &b_bid_count, &b_asks, &b_ask_count);
+
+    int same = a_bid_count == b_bid_count && a_ask_count == b_ask_count;
+    for (int i = 0; same && i < a_bid_count; i++) {
+        same = a_bids[i].price == b_bids[i].price && a_bids[i].size == b_bids[i].size;
+    }
+    for (int i = 0; same && i < a_ask_count; i++) {
+        same = a_asks[i].price == b_asks[i].price && a_asks[i].size == b_asks[i].size;
+    }
+    free(a_bids);
+    free(a_asks);
+    free(b_bids);
+    free(b_asks);
+    return same;
+}
+
+int main() {
+    // Test 1: SpscRing on one thread
+    SpscRing ring = SpscRing_create(sizeof(long), 5);
+    if (!ring) {
+        printf("Failed to create SpscRing instance\n");
+        return 1;
+    }
+    print_test_result("Capacity rounds up", SpscRing_capacity(ring) == 8);
+
+    long value, out;
+    int ok = 1;
+    for (value = 0; value < 8; value++) ok &= SpscRing_push(ring, &value);
+    print_test_result("Fill ring", ok && SpscRing_size(ring) == 8);
+    print_test_result("Push to full ring fails", !SpscRing_push(ring, &value));
+    ok = 1;
+    for (long i = 0; i < 8; i++) ok &= SpscRing_pop(ring, &out) && out == i;
+    print_test_result("Pop in order", ok);
+    print_test_result("Pop from empty ring fails", !SpscRing_pop(ring, &out) && SpscRing_size(ring) == 0);
+
+    // Batches wrap around the end of the array
+    long batch[6] = { 10, 11, 12, 13, 14, 15 }, batch_out[8];
+    for (value = 0; value < 5; value++) SpscRing_push(ring, &value);
+    for (int i = 0; i < 5; i++) SpscRing_pop(ring, &out);
+    print_test_result("Push batch up to free space", SpscRing_push_batch(ring, batch, 6) == 6 &&
+                      SpscRing_push_batch(ring, batch, 6) == 2 && SpscRing_push_batch(ring, batch, 6) == 0);
+    size_t popped = SpscRing_pop_batch(ring, batch_out, 8);
+    ok = popped == 8;
+    for (int i = 0; ok && i < 8; i++) ok = batch_out[i] == (i < 6 ? 10 + i : 4 + i);
+    print_test_result("Pop batch across the wrap", ok && SpscRing_pop_batch(ring, batch_out, 8) == 0);
+    SpscRing_destroy(&ring);
+    print_test_result("Destroy clears pointer", ring == NULL);
+    print_test_result("Reject zero sizes", SpscRing_create(0, 8) == NULL && SpscRing_create(8, 0) == NULL);
+
+    // Test 2: SpscRing across two threads
+    ring = SpscRing_create(sizeof(long), 64);
+    pthread_t producer;
+    ok = pthread_create(&producer, NULL, produce, ring) == 0;
+    for (long expected = 0; ok && expected < RING_RECORDS;) {
+        if (SpscRing_pop(ring, &out)) {
+            ok = out == expected++;
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+    print_test_result("Records cross threads in order", ok);
+    SpscRing_destroy(&ring);
+
+    // Test 3: Sharding symbols across workers
+    struct OrderBookManagerConfig config;
+    memset(&config, 0, sizeof(config));
+    config.workers = 3;
+    config.queue_capacity = 64; // Small, so the producer has to wait for the workers
+    config.pin_threads = 1;
+    OrderBookManager manager = OrderBookManager_create(&config);
+    if (!manager) {
+        printf("Failed to create OrderBookManager instance\n");
+        return 1;
+    }
+
+    OrderBook single[SYMBOL_COUNT];
+    for (int s = 0; s < SYMBOL_COUNT; s++) single[s] = OrderBook_create();
+
+    char line[128], symbol[ORDER_BOOK_MANAGER_MAX_SYMBOL + 1];
+    int routed = 1;
+    for (int i = 0; i < FLOW_LENGTH; i++) {
+        flow_line(i, line, sizeof(line), symbol);
+        routed &= OrderBookManager_route_csv(manager, line, strlen(line));
+
+        // The same line applied directly to the symbol's single-threaded book
+        int s = atoi(symbol + 3);
+        char order_id[37], user_id[37], side[8];
+        struct Order order;
+        memset(&order, 0, sizeof(order));
+        if (sscanf(line, "REMOVE,%*[^,],%36s", order_id) == 1) {
+            OrderBook_remove_order(single[s], order_id);
+        } else if (sscanf(line, "ADD,%*[^,],%36[^,],%36[^,],%7[^,],%lf,%d,%ld", order_id, user_id, side,
+                          &order.price, &order.quantity, &order.timestamp) == 6) {
+            strcpy(order.order_id, order_id);
+            strcpy(order.user_id, user_id);
+            order.side = strcmp(side, "buy") == 0 ? '1' : '0';
+            OrderBook_add_order(single[s], &order, NULL);
+        }
+    }
+    OrderBookManager_drain(manager);
+    print_test_result("Route every line", routed);
+
+    struct OrderBookManagerStats stats;
+    OrderBookManager_get_stats(manager, &stats);
+    long single_trades = 0;
+    int same = stats.symbols == SYMBOL_COUNT;
+    for (int s = 0; same && s < SYMBOL_COUNT; s++) {
+        snprintf(symbol, sizeof(symbol), "SYM%d", s);
+        OrderBook book = OrderBookManager_get_book(manager, symbol);
+        same = book && same_levels(book, single[s]) && OrderBook_trade_count(book) == OrderBook_trade_count(single[s]);
+        single_trades += (long)OrderBook_trade_count(single[s]);
+    }
+    print_test_result("Sharded books match single-threaded books", same);
+    print_test_result("Stats", stats.adds == FLOW_LENGTH / 5 * 4 && stats.rejected == 0 &&
+                      stats.trades == single_trades && stats.removes > 0);
+
+    int shards[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < stats.symbols; i++) {
+        int shard = OrderBookManager_get_shard(manager, OrderBookManager_get_symbol(manager, i));
+        if (shard >= 0 && shard < 3) shards[shard]++;
+    }
+    print_test_result("Symbols spread over workers", shards[0] == 4 && shards[1] == 4 && shards[2] == 4);
+
+    // Test 4: Invalid input
+    print_test_result("Reject malformed lines", !OrderBookManager_route_csv(manager, "ADD,SYM0,x,u,buy,1x,5", 21) &&
+                      !OrderBookManager_route_csv(manager, "ADD,o1,u1,buy,100.00,5", 22) &&
+                      !OrderBookManager_route_csv(manager, "SHOW_BEST,SYM0", 14));
+    print_test_result("Reject quantity beyond int", !OrderBookManager_route_csv(manager, "ADD,SYM0,big,u,buy,100.00,4294967297", 36));
+    print_test_result("Reject long symbol", !OrderBookManager_route_csv(manager, "REMOVE,ABCDEFGHIJKLMNOPQ,o1", 26));
+    print_test_result("Remove for unknown symbol", !OrderBookManager_remove_order(manager, "NONE", "o1"));
+    print_test_result("Unknown symbol has no book", OrderBookManager_get_book(manager, "NONE") == NULL &&
+                      OrderBookManager_get_shard(manager, "NONE") == -1 && OrderBookManager_get_symbol(manager, 99) == NULL);
+
+    // Cleanup
+    for (int s = 0; s < SYMBOL_COUNT; s++) OrderBook_destroy(&single[s]);
+    OrderBookManager_destroy(&manager);
+    print_test_result("Destroy clears pointer", manager == NULL);
+    printf("All tests completed.\n");
+
+    return 0;
+}
@@ -13,12 +13,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+// Order IDs used by the tests; the side works on interned integer IDs
+enum { ORDER1 = 1, ORDER2, ORDER3, ORDER4, ORDER5, ORDER6, INCOMING, INCOMING2, INCOMING3, INCOMING4, INCOMING5,
+       BID1, BID2, BID3, BID4, BID5, BID6 };
 
 // Helper function to create an order
-struct Order create_order(const char *order_id, const char *user_id, int quantity, char side, double price, long timestamp) {
-    struct Order order;
-    strncpy(order.order_id, order_id, sizeof(order.order_id) - 1);
-    strncpy(order.user_id, user_id, sizeof(order.user_id) - 1);
+struct BookOrder create_order(uint32_t order_id, uint32_t user_id, int quantity, char side, double price, long timestamp) {
+    struct BookOrder order;
+    order.order_id = order_id;
+    order.user_id = user_id;
     order.quantity = quantity;
     order.side = side;
     order.price = price;
@@ -27,8 +32,8 @@ struct Order create_order(const char *order_id, const char *user_id, int quantit
 }
 
 // Function to print an order
-void print_order(const Order order) {
-    printf("Order ID: %s, User ID: %s, Quantity: %d, Side: %c, Price: %.2f, Timestamp: %ld\n",
+void print_order(const BookOrder order) {
+    printf("Order ID: %u, User ID: %u, Quantity: %d, Side: %c, Price: %.2f, Timestamp: %ld\n",
            order->order_id, order->user_id, order->quantity, order->side, order->price, order->timestamp);
 }
 
@@ -41,6 +46,273 @@ void log_test_result(const char *test_name, int condition, const char *expected,
     }
 }
 
+// Fill handler that accepts a fixed number of fills, then stops matching
+static int limited_fill_handler(void *context, const BookOrder maker, int filled_quantity) {
+    int *remaining = context;
+    (void)maker;
+    (void)filled_quantity;
+    if (*remaining == 0) return 0;
+    (*remaining)--;
+    return 1;
+}
+
+// Order visitor that records the visited order IDs
+struct VisitedOrders {
+    uint32_t ids[8];
+    int count;
+};
+
+static int record_order(void *context, const BookOrder order) {
+    struct VisitedOrders *visited = context;
+    if (visited->count == 8) return 0;
+    visited->ids[visited->count++] = order->order_id;
+    return 1;
+}
+
+// Answers a depth query the slow way, from a copy of every level
+static void brute_force_fill(OrderBookSide side, long quantity, struct OrderBookFillEstimate *estimate) {
+    struct OrderBookLevelView *levels = NULL;
+    int level_count = 0;
+    memset(estimate, 0, sizeof(*estimate));
+    OrderBookSide_get_levels(side, 0, &levels, &level_count);
+    for (int i = 0; i < level_count && estimate->quantity < quantity; i++) {
+        long take = quantity - estimate->quantity < levels[i].size ? quantity - estimate->quantity : levels[i].size;
+        estimate->quantity += take;
+        estimate->notional += take * levels[i].price;
+        estimate->worst_price = levels[i].price;
+        estimate->levels++;
+    }
+    if (estimate->quantity) estimate->vwap = estimate->notional / estimate->quantity;
+    free(levels);
+}
+
+static int same_estimate(const struct OrderBookFillEstimate *a, const struct OrderBookFillEstimate *b) {
+    return a->quantity == b->quantity && a->levels == b->levels && a->worst_price == b->worst_price &&
+           fabs(a->vwap - b->vwap) < 1e-9 && fabs(a->notional - b->notional) < 1e-6 * (1.0 + fabs(b->notional));
+}
+
+// Builds the same sparse side as a ladder and as a map, then checks the depth queries of
+// both against the levels they report, for every quantity up to past the side's total
+static int check_depth_queries(int is_buy_side) {
+    struct OrderBookSideConfig config;
+    memset(&config, 0, sizeof(config));
+    config.tick_size = 0.01;
+    config.min_price = 99.0;
+    config.max_price = 101.0;
+    OrderBookSide ladder = OrderBookSide_create_with_config(is_buy_side, &config);
+    OrderBookSide map = OrderBookSide_create(is_buy_side);
+
+    unsigned int state = is_buy_side ? 7 : 11;
+    long total = 0;
+    for (uint32_t id = 1; id <= 120; id++) {
+        state = state * 1103515245u + 12345u;
+        double price = (9900 + (long)((state >> 8) % 201)) / 100.0; // Exactly a ladder tick price
+        struct BookOrder order = create_order(id, 1, 1 + (int)((state >> 20) % 40), is_buy_side ? 'B' : 'S', price, id);
+        OrderBookSide_add_order(ladder, &order);
+        OrderBookSide_add_order(map, &order);
+    }
+    for (uint32_t id = 3; id <= 120; id += 7) {
+        OrderBookSide_delete_order_by_id(ladder, id);
+        OrderBookSide_delete_order_by_id(map, id);
+    }
+    // Trade away the best few levels on both
+    struct BookOrder incoming = create_order(INCOMING, 2, 150, is_buy_side ? 'S' : 'B', is_buy_side ? 99.0 : 101.0, 200);
+    OrderBookSide_execute_with_handler(ladder, &incoming, limited_fill_handler, &(int){ 1000 });
+    incoming.quantity = 150;
+    OrderBookSide_execute_with_handler(map, &incoming, limited_fill_handler, &(int){ 1000 });
+
+    int ok = 1;
+    struct OrderBookFillEstimate expected, from_ladder, from_map;
+    brute_force_fill(map, 1L << 40, &expected);
+    total = expected.quantity;
+    for (long quantity = 0; quantity <= total + 5 && ok; quantity++) {
+        brute_force_fill(map, quantity, &expected);
+        ok = OrderBookSide_estimate_fill(ladder, quantity, &from_ladder) && same_estimate(&from_ladder, &expected) &&
+             OrderBookSide_estimate_fill(map, quantity, &from_map) && same_estimate(&from_map, &expected);
+    }
+    for (long tick = 9890; tick <= 10110 && ok; tick++) {
+        double limit = tick / 100.0;
+        long through = 0;
+        struct OrderBookLevelView *levels = NULL;
+        int level_count = 0;
+        OrderBookSide_get_levels(map, 0, &levels, &level_count);
+        for (int i = 0; i < level_count; i++) {
+            if (is_buy_side ? levels[i].price >= limit : levels[i].price <= limit) through += levels[i].size;
+        }
+        free(levels);
+        ok = OrderBookSide_size_through_price(ladder, limit) == through &&
+             OrderBookSide_size_through_price(map, limit) == through;
+    }
+    ok = ok && total > 0 && !OrderBookSide_estimate_fill(ladder, -1, &from_ladder);
+
+    OrderBookSide_destroy(&ladder);
+    OrderBookSide_destroy(&map);
+    return ok;
+}
+
+// Cancels most of a deep queue so its level compacts, then checks that the orders left are
+// still found, cancelled and filled in time priority through the side's index
+static int check_cancel_compaction(void) {
+    enum { QUEUED = 40, FIRST_ID = 100 };
+    OrderBookSide side = OrderBookSide_create(0);
+    if (!side) return 0;
+
+    int ok = 1;
+    for (int i = 0; i < QUEUED; i++) {
+        struct BookOrder order = create_order(FIRST_ID + i, 1, i + 1, 'S', 100.0, i);
+        ok &= OrderBookSide_add_order(side, &order);
+    }
+    // Keep every fifth order; the cancels reach the compaction threshold part way through
+    for (int i = 0; i < QUEUED; i++) {
+        if (i % 5 != 0) ok &= OrderBookSide_delete_order_by_id(side, FIRST_ID + i);
+    }
+    struct BookOrder found;
+    for (int i = 0; i < QUEUED; i++) {
+        int rests = OrderBookSide_get_order_by_id(side, FIRST_ID + i, &found);
+        ok &= i % 5 == 0 ? rests && found.quantity == i + 1 && found.timestamp == i : !rests;
+    }
+    ok &= OrderBookSide_delete_order_by_id(side, FIRST_ID + 15);
+
+    BookOrder *filled_orders = NULL;
+    int filled_count = 0;
+    struct BookOrder incoming = create_order(FIRST_ID + QUEUED, 2, 1000, 'B', 100.0, QUEUED);
+    OrderBookSide_execute_against(side, &incoming, &filled_orders, &filled_count);
+    uint32_t expected[] = { 0, 5, 10, 20, 25, 30, 35 };
+    ok &= filled_count == 7;
+    for (int i = 0; ok && i < filled_count; i++) ok &= filled_orders[i]->order_id == FIRST_ID + expected[i];
+    OrderBookSide_release_filled_orders(side, filled_orders, filled_count);
+    ok &= OrderBookSide_get_best_price(side) == 0.0;
+
+    OrderBookSide_destroy(&side);
+    return ok;
+}
+
+// Modifies resting orders on a map or ladder side: a reduce keeps its place in the queue,
+// a larger quantity or new level sends the order to the back, and the levels and depth
+// cache follow
+static int check_modify(int use_ladder) {
+    struct OrderBookSideConfig config = { .depth_cache = 4 };
+    if (use_ladder) {
+        config.tick_size = 0.5;
+        config.min_price = 90.0;
+        config.max_price = 110.0;
+    }
+    OrderBookSide side = OrderBookSide_create_with_config(0, &config);
+    if (!side) return 0;
+
+    struct BookOrder a = create_order(ORDER1, 1, 10, 'S', 100.0, 1);
+    struct BookOrder b = create_order(ORDER2, 2, 20, 'S', 100.0, 2);
+    struct BookOrder c = create_order(ORDER3, 3, 5, 'S', 101.0, 3);
+    int ok = OrderBookSide_add_order(side, &a) && OrderBookSide_add_order(side, &b) && OrderBookSide_add_order(side, &c);
+
+    // Reduce A in place, then grow it so it queues behind B
+    struct BookOrder found;
+    ok &= OrderBookSide_modify_order(side, ORDER1, 100.0, 4) &&
+          OrderBookSide_get_order_by_id(side, ORDER1, &found) && found.quantity == 4 && found.timestamp == 1;
+    ok &= OrderBookSide_size_through_price(side, 100.0) == 24;
+    ok &= OrderBookSide_modify_order(side, ORDER1, 100.0, 12);
+    // Move C down to 100 and B up to a new level at 102
+    ok &= OrderBookSide_modify_order(side, ORDER3, 100.0, 5) && OrderBookSide_modify_order(side, ORDER2, 102.0, 20);
+
+    int cached_count;
+    const struct OrderBookLevelView *cached = OrderBookSide_peek_levels(side, &cached_count);
+    ok &= cached_count == 2 && cached[0].price == 100.0 && cached[0].size == 17 && cached[0].order_count == 2 &&
+          cached[1].price == 102.0 && cached[1].size == 20;
+
+    // Rejected modifies leave the order where it was
+    ok &= !OrderBookSide_modify_order(side, ORDER1, 100.0, 0) && !OrderBookSide_modify_order(side, ORDER4, 100.0, 1);
+    if (use_ladder) ok &= !OrderBookSide_modify_order(side, ORDER1, 120.0, 12);
+    ok &= OrderBookSide_get_order_by_id(side, ORDER1, &found) && found.quantity == 12 && found.price == 100.0;
+
+    BookOrder *filled_orders = NULL;
+    int filled_count = 0;
+    struct BookOrder incoming = create_order(INCOMING, 4, 17, 'B', 100.0, 4);
+    OrderBookSide_execute_against(side, &incoming, &filled_orders, &filled_count);
+    ok &= filled_count == 2 && filled_orders[0]->order_id == ORDER1 && filled_orders[1]->order_id == ORDER3;
+    OrderBookSide_release_filled_orders(side, filled_orders, filled_count);
+    ok &= OrderBookSide_get_best_price(side) == 102.0;
+
+    OrderBookSide_destroy(&side);
+    return ok;
+}
+
+// Counts the orders a mass delete visits, keeping the first order after limit visits
+struct DeleteCounter {
+    int visited;
+    int limit;
+};
+
+static int count_delete(void *context, const BookOrder order) {
+    struct DeleteCounter *counter = context;
+    (void)order;
+    if (counter->visited == counter->limit) return 0;
+    counter->visited++;
+    return 1;
+}
+
+// Deletes one user's orders spread over several levels, one deep enough to compact, and
+// checks the other user's orders, the levels and the depth cache are left as they should be
+static int check_delete_for_user(int use_ladder) {
+    enum { FIRST_ID = 200, ALICE = 1, BOB = 2 };
+    struct OrderBookSideConfig config = { .depth_cache = 2 };
+    if (use_ladder) {
+        config.tick_size = 0.5;
+        config.min_price = 90.0;
+        config.max_price = 110.0;
+    }
+    OrderBookSide side = OrderBookSide_create_with_config(1, &config);
+    if (!side) return 0;
+
+    // Alice: 3 orders at 100, 1 at 101, 12 at 99; Bob: one at 100 and one at 99
+    uint32_t id = FIRST_ID;
+    int ok = 1;
+    for (int i = 0; i < 3; i++) {
+        struct BookOrder order = create_order(id++, ALICE, 1, 'B', 100.0, 1);
+        ok &= OrderBookSide_add_order(side, &order);
+    }
+    struct BookOrder bob1 = create_order(id++, BOB, 7, 'B', 100.0, 1);
+    struct BookOrder bob2 = create_order(id++, BOB, 9, 'B', 99.0, 1);
+    ok &= OrderBookSide_add_order(side, &bob1) && OrderBookSide_add_order(side, &bob2);
+    struct BookOrder alice_top = create_order(id++, ALICE, 2, 'B', 101.0, 1);
+    ok &= OrderBookSide_add_order(side, &alice_top);
+    for (int i = 0; i < 12; i++) {
+        struct BookOrder order = create_order(id++, ALICE, 1, 'B', 99.0, 1);
+        ok &= OrderBookSide_add_order(side, &order);
+    }
+
+    struct DeleteCounter counter = { 0, 1 };
+    ok &= OrderBookSide_delete_orders_for_user(side, ALICE, count_delete, &counter) == 1 && counter.visited == 1;
+    counter = (struct DeleteCounter){ 0, -1 };
+    ok &= OrderBookSide_delete_orders_for_user(side, ALICE, count_delete, &counter) == 15 && counter.visited == 15;
+    ok &= OrderBookSide_delete_orders_for_user(side, ALICE, NULL, NULL) == 0;
+
+    int cached_count;
+    const struct OrderBookLevelView *cached = OrderBookSide_peek_levels(side, &cached_count);
+    ok &= OrderBookSide_get_best_price(side) == 100.0 && cached_count == 2 &&
+          cached[0].price == 100.0 && cached[0].size == 7 && cached[0].order_count == 1 &&
+          cached[1].price == 99.0 && cached[1].size == 9 && cached[1].order_count == 1;
+    ok &= OrderBookSide_size_through_price(side, 99.0) == 16;
+    struct BookOrder found;
+    ok &= OrderBookSide_get_order_by_id(side, bob2.order_id, &found) && found.quantity == 9 &&
+          !OrderBookSide_get_order_by_id(side, FIRST_ID, NULL) && !OrderBookSide_delete_order_by_id(side, alice_top.order_id);
+
+    // Orders that traded or were deleted one by one leave the user's list too
+    ok &= OrderBookSide_delete_order_by_id(side, bob1.order_id);
+    struct BookOrder bob3 = create_order(id++, BOB, 3, 'B', 98.0, 1);
+    ok &= OrderBookSide_add_order(side, &bob3);
+    struct BookOrder incoming = create_order(INCOMING, 3, 9, 'S', 99.0, 1);
+    BookOrder *filled_orders = NULL;
+    int filled_count = 0;
+    OrderBookSide_execute_against(side, &incoming, &filled_orders, &filled_count);
+    OrderBookSide_release_filled_orders(side, filled_orders, filled_count);
+    ok &= filled_count == 1 && OrderBookSide_delete_orders_for_user(side, BOB, NULL, NULL) == 1 &&
+          OrderBookSide_get_best_price(side) == 0.0;
+    ok &= OrderBookSide_delete_orders_for_user(side, 1u << 30, NULL, NULL) == 0;
+
+    OrderBookSide_destroy(&side);
+    return ok;
+}
+
 // Main function to test OrderBookSide
 int main() {
     printf("Testing OrderBookSide Module\n\n");
@@ -54,9 +326,9 @@ int main() {
 
     // Add orders
     printf("Adding orders...\n");
-    struct Order order1 = create_order("order1", "user1", 10, 'S', 100.0, 1);
-    struct Order order2 = create_order("order2", "user2", 15, 'S', 105.0, 2);
-    struct Order order3 = create_order("order3", "user3", 20, 'S', 100.0, 3);
+    struct BookOrder order1 = create_order(ORDER1, 1, 10, 'S', 100.0, 1);
+    struct BookOrder order2 = create_order(ORDER2, 2, 15, 'S', 105.0, 2);
+    struct BookOrder order3 = create_order(ORDER3, 3, 20, 'S', 100.0, 3);
     OrderBookSide_add_order(sell_side, &order1);
     OrderBookSide_add_order(sell_side, &order2);
     OrderBookSide_add_order(sell_side, &order3);
@@ -67,9 +339,9 @@ int main() {
 
     // Test get_order_by_id
     printf("Retrieving order by ID: order1\n");
-    Order retrieved_order = NULL;
-    if (OrderBookSide_get_order_by_id(sell_side, "order1", &retrieved_order)) {
-        log_test_result("Test get_order_by_id", retrieved_order->quantity == 10, "10", retrieved_order->quantity);
+    struct BookOrder retrieved_order = {0};
+    if (OrderBookSide_get_order_by_id(sell_side, ORDER1, &retrieved_order)) {
+        log_test_result("Test get_order_by_id", retrieved_order.quantity == 10, "10", retrieved_order.quantity);
     } else {
         printf("Test get_order_by_id: FAILED\nExpected: order found\nActual: order not found\n");
     }
@@ -90,13 +362,13 @@ int main() {
 
     // Test delete_order_by_id
     printf("Deleting order by ID: order1\n");
-    int delete_result = OrderBookSide_delete_order_by_id(sell_side, "order1");
+    int delete_result = OrderBookSide_delete_order_by_id(sell_side, ORDER1);
     log_test_result("Test delete_order_by_id", delete_result == 1, "1", delete_result);
 
     // Test execute_against
     printf("Executing against sell side...\n");
-    struct Order incoming_order = create_order("incoming", "user4", 25, 'B', 105.0, 4);
-    Order *filled_orders = NULL;
+    struct BookOrder incoming_order = create_order(INCOMING, 4, 25, 'B', 105.0, 4);
+    BookOrder *filled_orders = NULL;
     int filled_count = 0;
     if (OrderBookSide_execute_against(sell_side, &incoming_order, &filled_orders, &filled_count)) {
         printf("Filled orders:\n");
@@ -125,8 +397,162 @@ int main() {
         printf("Test get_levels_after_execution: FAILED\nExpected: successful retrieval\nActual: retrieval failed\n");
     }
 
+    // Test delete from the middle of a queue and level removal
+    printf("Deleting from the middle of a level...\n");
+    struct BookOrder order4 = create_order(ORDER4, 1, 5, 'S', 110.0, 5);
+    struct BookOrder order5 = create_order(ORDER5, 2, 6, 'S', 110.0, 6);
+    struct BookOrder order6 = create_order(ORDER6, 3, 7, 'S', 110.0, 7);
+    OrderBookSide_add_order(sell_side, &order4);
+    OrderBookSide_add_order(sell_side, &order5);
+    OrderBookSide_add_order(sell_side, &order6);
+    log_test_result("Test duplicate order_id rejected", !OrderBookSide_add_order(sell_side, &order5), "0", 1);
+    delete_result = OrderBookSide_delete_order_by_id(sell_side, ORDER5);
+    log_test_result("Test delete_middle_order", delete_result == 1, "1", delete_result);
+    log_test_result("Test deleted order not found", !OrderBookSide_get_order_by_id(sell_side, ORDER5, NULL), "0", 1);
+    int found = OrderBookSide_get_order_by_id(sell_side, ORDER6, &retrieved_order);
+    log_test_result("Test neighbour still found", found && retrieved_order.quantity == 7, "7", found ? retrieved_order.quantity : -1);
+
+    OrderBookSide_delete_order_by_id(sell_side, ORDER4);
+    OrderBookSide_delete_order_by_id(sell_side, ORDER6);
+    incoming_order = create_order(INCOMING2, 4, 100, 'B', 200.0, 8);
+    OrderBookSide_execute_against(sell_side, &incoming_order, &filled_orders, &filled_count);
+    log_test_result("Test emptied level removed", filled_count == 1 && incoming_order.quantity == 90, "one fill of 10", filled_count);
+    OrderBookSide_release_filled_orders(sell_side, filled_orders, filled_count);
+
+    // Fully filled orders leave the index
+    log_test_result("Test filled order not found", !OrderBookSide_get_order_by_id(sell_side, ORDER2, NULL), "0", 1);
+    delete_result = OrderBookSide_delete_order_by_id(sell_side, ORDER2);
+    log_test_result("Test delete filled order", delete_result == 0, "0", delete_result);
+    best_price = OrderBookSide_get_best_price(sell_side);
+    log_test_result("Test side empty", best_price == 0.0, "0.0", best_price);
+
     // Cleanup
     OrderBookSide_destroy(&sell_side);
+
+    // Test a price ladder buy side
+    printf("\nTesting price ladder side...\n");
+    struct OrderBookSideConfig ladder_config = { .tick_size = 0.01, .min_price = 90.0, .max_price = 110.0 };
+    OrderBookSide buy_side = OrderBookSide_create_with_config(1, &ladder_config);
+    if (!buy_side) {
+        printf("Failed to create ladder OrderBookSide\n");
+        return 1;
+    }
+    struct BookOrder bid1 = create_order(BID1, 1, 10, 'B', 100.07, 1);
+    struct BookOrder bid2 = create_order(BID2, 2, 20, 'B', 100.10, 2);
+    struct BookOrder bid3 = create_order(BID3, 3, 30, 'B', 100.07 + 1e-12, 3);
+    struct BookOrder bid4 = create_order(BID4, 4, 40, 'B', 120.0, 4);
+    OrderBookSide_add_order(buy_side, &bid1);
+    OrderBookSide_add_order(buy_side, &bid2);
+    OrderBookSide_add_order(buy_side, &bid3);
+    log_test_result("Test ladder rejects out-of-band order", !OrderBookSide_add_order(buy_side, &bid4), "0", 1);
+
+    best_price = OrderBookSide_get_best_price(buy_side);
+    log_test_result("Test ladder best price", best_price == 100.10, "100.10", best_price);
+
+    if (OrderBookSide_get_levels(buy_side, 0, &levels, &level_count)) {
+        log_test_result("Test ladder snaps nearly-equal prices to one level", level_count == 2, "2", level_count);
+        if (level_count == 2) {
+            log_test_result("Test ladder level order", levels[0].price == 100.10 && levels[1].price == 100.07, "100.10, 100.07", levels[1].price);
+            log_test_result("Test ladder level size", levels[1].size == 40, "40", levels[1].size);
+        }
+        free(levels);
+    }
+
+    OrderBookSide_delete_order_by_id(buy_side, BID2);
+    best_price = OrderBookSide_get_best_price(buy_side);
+    log_test_result("Test ladder best price after delete", best_price == 100.07, "100.07", best_price);
+
+    incoming_order = create_order(INCOMING3, 5, 15, 'S', 100.065, 5);
+    OrderBookSide_execute_against(buy_side, &incoming_order, &filled_orders, &filled_count);
+    log_test_result("Test ladder execution", filled_count == 2 && incoming_order.quantity == 0, "2 fills", filled_count);
+    if (filled_count == 2) {
+        log_test_result("Test ladder fill price", filled_orders[0]->price == 100.07 && filled_orders[1]->quantity == 5, "100.07", filled_orders[0]->price);
+    }
+    OrderBookSide_release_filled_orders(buy_side, filled_orders, filled_count);
+
+    incoming_order = create_order(INCOMING4, 5, 100, 'S', 95.0, 6);
+    OrderBookSide_execute_against(buy_side, &incoming_order, &filled_orders, &filled_count);
+    OrderBookSide_release_filled_orders(buy_side, filled_orders, filled_count);
+    best_price = OrderBookSide_get_best_price(buy_side);
+    log_test_result("Test ladder empty after sweep", best_price == 0.0 && incoming_order.quantity == 75, "0.0", best_price);
+
+    OrderBookSide_add_order(buy_side, &bid1);
+    best_price = OrderBookSide_get_best_price(buy_side);
+    log_test_result("Test ladder level reused", best_price == 100.07, "100.07", best_price);
+
+    // Test execute_with_handler stopping early
+    printf("Executing with a handler that stops after one fill...\n");
+    struct BookOrder bid5 = create_order(BID5, 1, 10, 'B', 100.0, 7);
+    struct BookOrder bid6 = create_order(BID6, 2, 10, 'B', 100.0, 8);
+    OrderBookSide_add_order(buy_side, &bid5);
+    OrderBookSide_add_order(buy_side, &bid6);
+    int allowed_fills = 1;
+    incoming_order = create_order(INCOMING5, 5, 100, 'S', 90.0, 9);
+    int handler_result = OrderBookSide_execute_with_handler(buy_side, &incoming_order, limited_fill_handler, &allowed_fills);
+    log_test_result("Test handler stop reported", handler_result == 0, "0", handler_result);
+    // bid1 at 100.07 is filled first, then the handler refuses bid5
+    log_test_result("Test handler stop applies earlier fills", incoming_order.quantity == 90, "90", incoming_order.quantity);
+    log_test_result("Test handler stop removes filled order", !OrderBookSide_get_order_by_id(buy_side, BID1, NULL), "0", 1);
+    log_test_result("Test handler stop leaves unapplied order", OrderBookSide_get_order_by_id(buy_side, BID5, NULL), "1", 0);
+    best_price = OrderBookSide_get_best_price(buy_side);
+    log_test_result("Test handler stop best price", best_price == 100.0, "100.0", best_price);
+
+    // Test visiting orders in priority order
+    OrderBookSide_add_order(buy_side, &bid2);
+    struct VisitedOrders visited = { { 0 }, 0 };
+    int visit_result = OrderBookSide_for_each_order(buy_side, record_order, &visited);
+    log_test_result("Test visit every order", visit_result && visited.count == 3, "3", visited.count);
+    log_test_result("Test visit order", visited.ids[0] == BID2 && visited.ids[1] == BID5 && visited.ids[2] == BID6, "BID2, BID5, BID6", visited.ids[0]);
+
+    OrderBookSide_destroy(&buy_side);
+
+    // Test the depth cache of a side that keeps its best two levels
+    struct OrderBookSideConfig cache_config = { 0 };
+    cache_config.depth_cache = 2;
+    OrderBookSide cached_side = OrderBookSide_create_with_config(0, &cache_config);
+    struct BookOrder ask1 = create_order(ORDER1, 1, 10, 'S', 101.0, 1);
+    struct BookOrder ask2 = create_order(ORDER2, 1, 20, 'S', 102.0, 2);
+    struct BookOrder ask3 = create_order(ORDER3, 1, 30, 'S', 103.0, 3);
+    struct BookOrder ask4 = create_order(ORDER4, 1, 5, 'S', 101.0, 4);
+    OrderBookSide_add_order(cached_side, &ask3);
+    OrderBookSide_add_order(cached_side, &ask1);
+    OrderBookSide_add_order(cached_side, &ask2);
+    OrderBookSide_add_order(cached_side, &ask4);
+    int cached_count = 0;
+    const struct OrderBookLevelView *cached = OrderBookSide_peek_levels(cached_side, &cached_count);
+    log_test_result("Test depth cache holds best levels", cached && cached_count == 2 && cached[0].price == 101.0 &&
+                    cached[0].size == 15 && cached[1].price == 102.0, "101 x 15, 102", cached_count);
+    OrderBookSide_delete_order_by_id(cached_side, ORDER1);
+    OrderBookSide_delete_order_by_id(cached_side, ORDER4);
+    cached = OrderBookSide_peek_levels(cached_side, &cached_count);
+    log_test_result("Test depth cache refills from below", cached_count == 2 && cached[0].price == 102.0 &&
+                    cached[1].price == 103.0 && cached[1].size == 30, "102, 103", cached_count);
+    incoming_order = create_order(INCOMING, 2, 25, 'B', 102.0, 5);
+    OrderBookSide_execute_against(cached_side, &incoming_order, &filled_orders, &filled_count);
+    OrderBookSide_release_filled_orders(cached_side, filled_orders, filled_count);
+    cached = OrderBookSide_peek_levels(cached_side, &cached_count);
+    log_test_result("Test depth cache after execution", cached_count == 1 && cached[0].price == 103.0, "103", cached_count);
+    OrderBookSide_destroy(&cached_side);
+    OrderBookSide plain_side = OrderBookSide_create(0);
+    OrderBookSide_add_order(plain_side, &ask1);
+    log_test_result("Test side without depth cache", OrderBookSide_peek_levels(plain_side, &cached_count) == NULL &&
+                    cached_count == 0, "NULL", cached_count);
+    OrderBookSide_destroy(&plain_side);
+
+    // Test depth queries on ladder and map sides
+    log_test_result("Test depth queries on a buy side", check_depth_queries(1), "1", 0);
+    log_test_result("Test depth queries on a sell side", check_depth_queries(0), "1", 0);
+    log_test_result("Test cancels compact a deep level", check_cancel_compaction(), "1", 0);
+    log_test_result("Test modify on a map side", check_modify(0), "1", 0);
+    log_test_result("Test modify on a ladder side", check_modify(1), "1", 0);
+    log_test_result("Test delete a user's orders on a map side", check_delete_for_user(0), "1", 0);
+    log_test_result("Test delete a user's orders on a ladder side", check_delete_for_user(1), "1", 0);
+    OrderBookSide empty_side = OrderBookSide_create(1);
+    struct OrderBookFillEstimate estimate;
+    log_test_result("Test depth queries on an empty side", OrderBookSide_estimate_fill(empty_side, 10, &estimate) &&
+                    estimate.quantity == 0 && estimate.vwap == 0.0 && OrderBookSide_size_through_price(empty_side, 100.0) == 0,
+                    "0", estimate.quantity);
+    OrderBookSide_destroy(&empty_side);
     printf("Testing completed\n");
 
     return 0;
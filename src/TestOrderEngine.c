@@ -0,0 +1,209 @@
+/* TestOrderEngine.c - Unit tests for the OrderEngine module
+ *
+ * This file contains a main function that runs an engine with two publisher threads,
+ * feeds it a generated order flow through a small command ring, and checks the events
+ * and the final book against the same flow applied to a book directly.
+ */
+
+#include "OrderEngine.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLOW_LENGTH 20000
+#define OUTPUTS 2
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+// What one publisher thread saw on its event ring
+struct Publisher {
+    OrderEngine engine;
+    int output;
+    long counts[ORDER_ENGINE_LEVEL + 1];
+    long volume;             // Sum of execution sizes
+    uint64_t last_sequence;
+    int in_order;            // Sequences never decrease
+    double best_bid, best_ask;
+};
+
+static void *publish(void *argument) {
+    struct Publisher *publisher = argument;
+    struct OrderEngineEvent events[32];
+    for (;;) {
+        // Check for the stop before polling, so the last poll sees every event
+        int stopped = OrderEngine_is_stopped(publisher->engine);
+        size_t count = OrderEngine_poll_events(publisher->engine, publisher->output, events, 32);
+        for (size_t i = 0; i < count; i++) {
+            const struct OrderEngineEvent *event = &events[i];
+            publisher->counts[event->type]++;
+            if (event->sequence < publisher->last_sequence) publisher->in_order = 0;
+            publisher->last_sequence = event->sequence;
+            if (event->type == ORDER_ENGINE_EXECUTION) publisher->volume += event->size;
+            if (event->type == ORDER_ENGINE_TOP_OF_BOOK) {
+                publisher->best_bid = event->best_bid;
+                publisher->best_ask = event->best_ask;
+            }
+        }
+        if (count == 0) {
+            if (stopped) break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Level handler of the direct book: counts its updates
+static void count_level_update(void *context, const struct OrderBookLevelUpdate *update) {
+    (void)update;
+    (*(long *)context)++;
+}
+
+// One generated order of the flow; every fifth message removes an earlier order instead
+static int flow_order(int i, struct Order *order) {
+    memset(order, 0, sizeof(*order));
+    if (i % 5 == 4) {
+        snprintf(order->order_id, sizeof(order->order_id), "o%d", i - 3);
+        return 0;
+    }
+    unsigned int state = (unsigned int)i * 2654435761u;
+    snprintf(order->order_id, sizeof(order->order_id), "o%d", i);
+    snprintf(order->user_id, sizeof(order->user_id), "u%u", (state >> 8) % 9);
+    order->side = (state >> 12) & 1 ? '1' : '0';
+    order->price = 99.0 + 0.01 * (double)((state >> 13) % 200);
+    order->quantity = 1 + (int)((state >> 20) % 50);
+    order->timestamp = 1000 + i;
+    return 1;
+}
+
+int main() {
+    // Test 1: Events reach every publisher
+    struct OrderEngineConfig config;
+    memset(&config, 0, sizeof(config));
+    config.command_capacity = 64; // Small, so the producer sees a full ring
+    config.event_capacity = 128;
+    config.outputs = OUTPUTS;
+    config.pin_thread = 1;
+    config.level_updates = 1;
+    OrderEngine engine = OrderEngine_create(&config);
+    if (!engine) {
+        printf("Failed to create OrderEngine instance\n");
+        return 1;
+    }
+
+    struct Publisher publishers[OUTPUTS];
+    pthread_t threads[OUTPUTS];
+    for (int i = 0; i < OUTPUTS; i++) {
+        memset(&publishers[i], 0, sizeof(publishers[i]));
+        publishers[i].engine = engine;
+        publishers[i].output = i;
+        publishers[i].in_order = 1;
+        pthread_create(&threads[i], NULL, publish, &publishers[i]);
+    }
+
+    OrderBook direct = OrderBook_create();
+    long level_updates = 0;
+    OrderBook_set_level_handler(direct, count_level_update, &level_updates);
+    struct OrderBookMatchResult result = { NULL, 0, 0 };
+    long adds = 0, removed = 0, not_found = 0, executions = 0, volume = 0, full = 0;
+    for (int i = 0; i < FLOW_LENGTH; i++) {
+        struct Order order;
+        int is_add = flow_order(i, &order);
+        while (!(is_add ? OrderEngine_submit_add(engine, &order) : OrderEngine_submit_remove(engine, order.order_id))) {
+            full++;
+            sched_yield();
+        }
+
+        if (is_add) {
+            adds += OrderBook_add_order_with_result(direct, &order, &result);
+            executions += result.count;
+            for (int f = 0; f < result.count; f++) volume += result.fills[f].size;
+        } else if (OrderBook_remove_order(direct, order.order_id)) {
+            removed++;
+        } else {
+            not_found++;
+        }
+    }
+    OrderEngine_stop(engine);
+    for (int i = 0; i < OUTPUTS; i++) pthread_join(threads[i], NULL);
+    print_test_result("Engine stopped", OrderEngine_is_stopped(engine));
+
+    int same = 1;
+    for (int i = 0; i < OUTPUTS; i++) {
+        const struct Publisher *p = &publishers[i];
+        same = same && p->counts[ORDER_ENGINE_ACCEPTED] == adds && p->counts[ORDER_ENGINE_REJECTED] == 0 &&
+               p->counts[ORDER_ENGINE_REMOVED] == removed && p->counts[ORDER_ENGINE_NOT_FOUND] == not_found &&
+               p->counts[ORDER_ENGINE_EXECUTION] == executions && p->volume == volume &&
+               p->counts[ORDER_ENGINE_LEVEL] == level_updates;
+    }
+    print_test_result("Every publisher sees every event", same && executions > 0 && removed > 0 && level_updates > 0);
+    print_test_result("Events in sequence order", publishers[0].in_order && publishers[1].in_order &&
+                      publishers[0].last_sequence == FLOW_LENGTH - 1);
+    print_test_result("Last top of book matches", publishers[0].best_bid == OrderBook_get_best_bid(direct) &&
+                      publishers[0].best_ask == OrderBook_get_best_ask(direct) &&
+                      publishers[0].counts[ORDER_ENGINE_TOP_OF_BOOK] > 0);
+    print_test_result("Producer saw a full ring", full > 0);
+
+    OrderBook book = OrderEngine_get_book(engine);
+    print_test_result("Engine book matches", book && OrderBook_trade_count(book) == OrderBook_trade_count(direct) &&
+                      OrderBook_message_sequence(book) == FLOW_LENGTH);
+
+    // Test 2: Event order within one command
+    OrderEngine_destroy(&engine);
+    print_test_result("Destroy clears pointer", engine == NULL);
+    engine = OrderEngine_create(NULL);
+    struct Order order;
+    memset(&order, 0, sizeof(order));
+    strcpy(order.order_id, "ask");
+    strcpy(order.user_id, "alice");
+    order.side = '0';
+    order.price = 101.0;
+    order.quantity = 5;
+    OrderEngine_submit_add(engine, &order);
+    strcpy(order.order_id, "bid");
+    order.side = '1';
+    order.quantity = 3;
+    OrderEngine_submit_add(engine, &order);
+    OrderEngine_submit_remove(engine, "missing");
+    OrderEngine_stop(engine);
+
+    struct OrderEngineEvent events[16];
+    size_t count = OrderEngine_poll_events(engine, 0, events, 16);
+    print_test_result("Event count", count == 5);
+    print_test_result("Add then top of book", count == 5 && events[0].type == ORDER_ENGINE_ACCEPTED &&
+                      events[1].type == ORDER_ENGINE_TOP_OF_BOOK && events[1].best_ask == 101.0 && events[1].best_bid == 0.0);
+    print_test_result("Execution before acceptance", count == 5 && events[2].type == ORDER_ENGINE_EXECUTION &&
+                      events[2].sequence == 1 && events[2].size == 3 && strcmp(events[2].maker_order_id, "ask") == 0 &&
+                      strcmp(events[2].order_id, "bid") == 0 && events[3].type == ORDER_ENGINE_ACCEPTED);
+    print_test_result("Unchanged top of book is not repeated", count == 5 && events[4].type == ORDER_ENGINE_NOT_FOUND);
+    print_test_result("Invalid arguments", !OrderEngine_submit_add(engine, NULL) &&
+                      OrderEngine_poll_events(engine, 1, events, 16) == 0);
+
+    // Test 3: Stopping with a full event ring nobody polls
+    OrderEngine_destroy(&engine);
+    memset(&config, 0, sizeof(config));
+    config.event_capacity = 16;
+    engine = OrderEngine_create(&config);
+    order.side = '0';
+    order.quantity = 1;
+    for (int i = 0; i < 200; i++) {
+        snprintf(order.order_id, sizeof(order.order_id), "rest%d", i);
+        order.price = 200.0 - i; // Each add improves the best ask
+        OrderEngine_submit_add(engine, &order);
+    }
+    OrderEngine_stop(engine);
+    count = OrderEngine_poll_events(engine, 0, events, 16);
+    print_test_result("Stop drops events a full ring cannot take", OrderEngine_is_stopped(engine) && count > 0 &&
+                      OrderBook_message_sequence(OrderEngine_get_book(engine)) == 200);
+
+    // Cleanup
+    OrderEngine_destroy(&engine);
+    OrderBook_destroy(&direct);
+    OrderBookMatchResult_free(&result);
+    printf("All tests completed.\n");
+
+    return 0;
+}
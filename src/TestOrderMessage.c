@@ -0,0 +1,153 @@
+/* TestOrderMessage.c - Unit tests for the OrderMessage module
+ *
+ * This file contains a main function that tests the OrderMessage module by converting
+ * CSV lines to binary records and replaying them: record layout, long IDs, dictionary
+ * slot reuse, query callbacks and invalid input.
+ */
+
+#include "OrderMessage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+// Records the query lines handed to the callback
+struct Queries {
+    int count;
+    char last[64];
+};
+
+static void on_query(void *context, OrderBook book, const char *line, size_t length) {
+    (void)book;
+    struct Queries *queries = context;
+    queries->count++;
+    if (length >= sizeof(queries->last)) length = sizeof(queries->last) - 1;
+    memcpy(queries->last, line, length);
+    queries->last[length] = '\0';
+}
+
+static int write_line(OrderMessageWriter writer, const char *line) {
+    return OrderMessageWriter_write_csv(writer, line, strlen(line));
+}
+
+// Reads everything written to a temporary stream; the caller frees the result
+static char *read_all(FILE *stream, size_t *length) {
+    *length = (size_t)ftell(stream);
+    char *data = malloc(*length);
+    rewind(stream);
+    if (data && fread(data, 1, *length, stream) != *length) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+int main() {
+    // Test 1: Converting lines
+    FILE *stream = tmpfile();
+    OrderMessageWriter writer = OrderMessageWriter_create(stream, 0.01);
+    if (!stream || !writer) {
+        printf("Failed to create OrderMessageWriter instance\n");
+        return 1;
+    }
+
+    const char *long_id = "0123456789abcdef0123456789abcdef0123"; // 36 characters
+    char add_long[128];
+    snprintf(add_long, sizeof(add_long), "ADD,%s,user2,sell,100.55,5", long_id);
+    char remove_long[64];
+    snprintf(remove_long, sizeof(remove_long), "REMOVE,%s", long_id);
+
+    int written = write_line(writer, "ADD,order1,user1,sell,100.50,10,1000\r") &
+                  write_line(writer, add_long) &
+                  write_line(writer, "ADD,order3,user1,buy,100.50,4,1000") &
+                  write_line(writer, "SHOW_TOP,5") &
+                  write_line(writer, remove_long) &
+                  write_line(writer, "GET_TRADE,TRADE-00000001") &
+                  write_line(writer, "best_bid");
+    print_test_result("Write valid lines", written);
+
+    int skipped = !write_line(writer, "") &&
+                  !write_line(writer, "ADD,order4,user1,buy,1x,4") &&
+                  !write_line(writer, "ADD,order4,user1,buy,100") &&
+                  !write_line(writer, "SHOW_TOP,k") &&
+                  !write_line(writer, "UNKNOWN,1");
+    print_test_result("Skip malformed lines", skipped);
+    print_test_result("Finish", OrderMessageWriter_finish(writer));
+
+    // Header, 5 definitions (the long ID takes two records), 3 timestamp changes, 7 commands
+    size_t length;
+    char *data = read_all(stream, &length);
+    size_t expected = sizeof(struct OrderMessageHeader) + (6 + 3 + 7) * sizeof(struct OrderMessage);
+    print_test_result("Records are fixed-width", data && length == expected);
+
+    // Test 2: Replaying the records
+    OrderBook book = OrderBook_create();
+    struct Queries queries;
+    memset(&queries, 0, sizeof(queries));
+    struct CsvReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    int ok = data && OrderMessage_replay_buffer(book, data, length, on_query, &queries, &stats);
+    print_test_result("Replay buffer", ok);
+    print_test_result("Count commands", stats.lines == 7 && stats.adds == 3 && stats.others == 3 && stats.errors == 0);
+    print_test_result("Long ID round trip", stats.removes == 1 && OrderBook_get_best_ask(book) == 100.50);
+    print_test_result("Trades executed", stats.trades == 1);
+    print_test_result("Queries go to the callback", queries.count == 3 && strcmp(queries.last, "BEST_BID") == 0);
+
+    const struct TradeRecord *trade;
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, 0);
+    trade = OrderBook_next_trade(book, &cursor);
+    print_test_result("Trade from replayed orders", trade && trade->price == 100.50 && trade->size == 4 &&
+                      strcmp(OrderBook_get_id_string(book, trade->sell_order_id), "order1") == 0);
+
+    // Test 3: Invalid input
+    memset(&stats, 0, sizeof(stats));
+    char bad[sizeof(struct OrderMessageHeader)];
+    memcpy(bad, data, sizeof(bad));
+    bad[0] = 'X';
+    print_test_result("Reject bad magic", !OrderMessage_replay_buffer(book, bad, sizeof(bad), NULL, NULL, &stats));
+    print_test_result("Reject short buffer", !OrderMessage_replay_buffer(book, data, 10, NULL, NULL, &stats));
+    // A fresh book, so the replayed adds are not duplicates of the orders resting above
+    OrderBook_destroy(&book);
+    book = OrderBook_create();
+    print_test_result("Truncated record is an error", OrderMessage_replay_buffer(book, data, length - 1, NULL, NULL, &stats) && stats.errors == 1);
+    print_test_result("Missing file", !OrderMessage_replay_file(book, "/nonexistent/file.bin", NULL, NULL, &stats));
+
+    OrderBook_destroy(&book);
+    OrderMessageWriter_destroy(&writer);
+    fclose(stream);
+    free(data);
+
+    // Test 4: Dictionary slots are reused and IDs defined again
+    stream = tmpfile();
+    writer = OrderMessageWriter_create(stream, 0.01);
+    char line[64];
+    written = 1;
+    for (int i = 0; i < ORDER_MESSAGE_ID_SLOTS + 10; i++) {
+        snprintf(line, sizeof(line), "ADD,o%d,u,buy,%d.00,1", i, 1 + i % 50);
+        written &= write_line(writer, line);
+    }
+    written &= write_line(writer, "REMOVE,o0") & write_line(writer, "REMOVE,o70000");
+    written &= OrderMessageWriter_finish(writer);
+    data = read_all(stream, &length);
+
+    book = OrderBook_create();
+    memset(&stats, 0, sizeof(stats));
+    ok = data && OrderMessage_replay_buffer(book, data, length, NULL, NULL, &stats);
+    print_test_result("Replay past dictionary size", written && ok && stats.adds == ORDER_MESSAGE_ID_SLOTS + 10 && stats.errors == 0);
+    print_test_result("Evicted ID defined again", stats.removes == 1);
+
+    // Cleanup
+    OrderBook_destroy(&book);
+    OrderMessageWriter_destroy(&writer);
+    print_test_result("Destroy clears pointer", writer == NULL);
+    fclose(stream);
+    free(data);
+    printf("All tests completed.\n");
+
+    return 0;
+}
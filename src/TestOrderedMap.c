@@ -93,7 +93,61 @@ int main() {
     }
     print_test_result("Remaining elements correct", remaining_elements_correct);
 
-    // Test 10: Cleanup
+    // Test 10: Iterate forwards and backwards after the removals
+    int ascending = 1, count = 0;
+    double key, last_key = -1.0;
+    OrderedMapCursor cursor;
+    for (int ok = OrderedMap_cursor_front(map, &cursor); ok; ok = OrderedMapCursor_next(&cursor)) {
+        OrderedMapCursor_get(&cursor, &key, NULL);
+        if (key <= last_key) ascending = 0;
+        last_key = key;
+        count++;
+    }
+    print_test_result("Cursor walks all keys in ascending order", ascending && count == 52);
+
+    int descending = 1;
+    count = 0;
+    last_key = 1e9;
+    OrderedMapIterator iter = OrderedMap_back(map);
+    do {
+        if (!OrderedMapIterator_get(iter, &key, NULL)) break;
+        if (key >= last_key) descending = 0;
+        last_key = key;
+        count++;
+    } while (OrderedMapIterator_prev(iter));
+    OrderedMapIterator_destroy(&iter);
+    print_test_result("Iterator walks all keys in descending order", descending && count == 52);
+
+    // Test 11: Iterate a large map built with interleaved inserts and removals
+    OrderedMap big = OrderedMap_create();
+    for (int i = 0; i < 2000; i++) OrderedMap_insert(big, (double)((i * 7919) % 2000), NULL);
+    for (int i = 0; i < 2000; i += 3) OrderedMap_remove(big, (double)i);
+    int ordered = 1;
+    count = 0;
+    last_key = -1.0;
+    for (int ok = OrderedMap_cursor_front(big, &cursor); ok; ok = OrderedMapCursor_next(&cursor)) {
+        OrderedMapCursor_get(&cursor, &key, NULL);
+        if (key <= last_key || ((int)key) % 3 == 0) ordered = 0;
+        last_key = key;
+        count++;
+    }
+    print_test_result("Cursor walks large map in order", ordered && count == (int)OrderedMap_size(big));
+    count = 0;
+    for (int ok = OrderedMap_cursor_back(big, &cursor); ok; ok = OrderedMapCursor_prev(&cursor)) count++;
+    print_test_result("Cursor walks large map backwards", count == (int)OrderedMap_size(big));
+    size_t size = OrderedMap_size(big);
+    OrderedMap_prefetch(big, 1.0);
+    OrderedMap_prefetch(big, 3.0);
+    OrderedMap_prefetch(NULL, 1.0);
+    print_test_result("Prefetch leaves the map unchanged", OrderedMap_size(big) == size && OrderedMap_get(big, 1.0, NULL) &&
+                      !OrderedMap_get(big, 3.0, NULL));
+    OrderedMap_destroy(&big);
+
+    OrderedMap empty = OrderedMap_create();
+    print_test_result("Cursor on empty map", !OrderedMap_cursor_front(empty, &cursor) && !OrderedMapCursor_get(&cursor, NULL, NULL));
+    OrderedMap_destroy(&empty);
+
+    // Test 12: Cleanup
     OrderedMap_destroy(&map);
     printf("All tests completed.\n");
 
@@ -0,0 +1,81 @@
+/* TestPool.c - Unit tests for the Pool module
+ *
+ * This file contains a main function that tests the Pool module: allocation,
+ * freelist reuse, reservation and growth across slabs.
+ */
+
+#include "Pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+int main() {
+    // Test 1: Create pools
+    print_test_result("Create with zero block size fails", Pool_create(0, 4) == NULL);
+
+    Pool pool = Pool_create(24, 4);
+    if (!pool) {
+        printf("Failed to create Pool instance\n");
+        return 1;
+    }
+    print_test_result("Block size is aligned", Pool_block_size(pool) >= 24 && Pool_block_size(pool) % _Alignof(max_align_t) == 0);
+    print_test_result("New pool is empty", Pool_capacity(pool) == 0 && Pool_in_use(pool) == 0);
+
+    // Test 2: Allocate and write blocks
+    void *blocks[10];
+    int passed = 1;
+    for (int i = 0; i < 10; i++) {
+        blocks[i] = Pool_alloc(pool);
+        passed &= blocks[i] != NULL && ((uintptr_t)blocks[i] % _Alignof(max_align_t)) == 0;
+        if (blocks[i]) memset(blocks[i], i, 24);
+    }
+    print_test_result("Allocate 10 aligned blocks", passed);
+    print_test_result("In use after allocation", Pool_in_use(pool) == 10);
+    print_test_result("Pool grew in slabs of 4", Pool_capacity(pool) == 12);
+
+    passed = 1;
+    for (int i = 0; i < 10; i++) {
+        for (int j = i + 1; j < 10; j++) passed &= blocks[i] != blocks[j];
+        passed &= ((unsigned char *)blocks[i])[23] == (unsigned char)i;
+    }
+    print_test_result("Blocks are distinct and intact", passed);
+
+    // Test 3: Freed blocks are reused without growing
+    void *freed = blocks[3];
+    Pool_free(pool, blocks[3]);
+    print_test_result("In use after free", Pool_in_use(pool) == 9);
+    blocks[3] = Pool_alloc(pool);
+    print_test_result("Freed block is reused", blocks[3] == freed);
+    print_test_result("Capacity unchanged by reuse", Pool_capacity(pool) == 12);
+
+    for (int i = 0; i < 10; i++) Pool_free(pool, blocks[i]);
+    print_test_result("All blocks returned", Pool_in_use(pool) == 0);
+
+    // Test 4: Reserve pre-sizes the pool
+    print_test_result("Reserve 100 blocks", Pool_reserve(pool, 100));
+    size_t reserved = Pool_capacity(pool);
+    print_test_result("Capacity after reserve", reserved >= 100);
+    passed = 1;
+    void *many[100];
+    for (int i = 0; i < 100; i++) passed &= (many[i] = Pool_alloc(pool)) != NULL;
+    print_test_result("Reserved blocks need no growth", passed && Pool_capacity(pool) == reserved);
+    for (int i = 0; i < 100; i++) Pool_free(pool, many[i]);
+    print_test_result("Reserve already satisfied", Pool_reserve(pool, 50) && Pool_capacity(pool) == reserved);
+
+    // Test 5: NULL handling
+    Pool_free(pool, NULL);
+    print_test_result("NULL pool alloc", Pool_alloc(NULL) == NULL);
+    print_test_result("NULL pool accessors", Pool_in_use(NULL) == 0 && Pool_capacity(NULL) == 0);
+
+    // Cleanup
+    Pool_destroy(&pool);
+    print_test_result("Destroy clears pointer", pool == NULL);
+    printf("All tests completed.\n");
+
+    return 0;
+}
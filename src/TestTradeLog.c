@@ -0,0 +1,155 @@
+/* TestTradeLog.c - Unit tests for the TradeLog module
+ *
+ * This file contains a main function that tests the TradeLog module in each
+ * retention mode: unbounded chunks, a ring of recent trades, and spilling to a file.
+ */
+
+#include "TradeLog.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SPILL_PATH "TestTradeLog.spill"
+
+void print_test_result(const char *test_name, int result) {
+    printf("%s: %s\n", test_name, result ? "PASSED" : "FAILED");
+}
+
+// Appends count trades whose size and price are derived from their sequence
+static int append_trades(TradeLog log, int count) {
+    for (int i = 0; i < count; i++) {
+        struct TradeRecord *record = TradeLog_append(log);
+        if (!record) return 0;
+        record->buy_order_id = (uint32_t)(2 * record->sequence + 1);
+        record->sell_order_id = (uint32_t)(2 * record->sequence + 2);
+        record->size = (int)(record->sequence % 100) + 1;
+        record->price = 100.0 + record->sequence;
+    }
+    return 1;
+}
+
+static int record_matches(const struct TradeRecord *record, long sequence) {
+    return record && record->sequence == sequence && record->size == (int)(sequence % 100) + 1 &&
+           record->price == 100.0 + sequence && record->sell_order_id == (uint32_t)(2 * sequence + 2);
+}
+
+int main() {
+    // Test 1: Invalid configurations
+    struct TradeLogConfig ring_zero = { TRADE_LOG_RING, 0, NULL };
+    struct TradeLogConfig spill_no_path = { TRADE_LOG_SPILL, 8, NULL };
+    print_test_result("Ring with zero capacity fails", TradeLog_create(&ring_zero) == NULL);
+    print_test_result("Spill without a path fails", TradeLog_create(&spill_no_path) == NULL);
+
+    // Test 2: Unbounded log across several chunks
+    TradeLog log = TradeLog_create(NULL);
+    if (!log) {
+        printf("Failed to create TradeLog instance\n");
+        return 1;
+    }
+    print_test_result("New log is empty", TradeLog_count(log) == 0 && TradeLog_next_sequence(log) == 0);
+    print_test_result("Reserve 3000 records", TradeLog_reserve(log, 3000));
+    print_test_result("Append 3000 records", append_trades(log, 3000));
+    print_test_result("Unbounded count", TradeLog_count(log) == 3000 && TradeLog_first_sequence(log) == 0);
+
+    const struct TradeRecord *early = TradeLog_peek(log, 5);
+    append_trades(log, 2000);
+    print_test_result("Resident records do not move", early == TradeLog_peek(log, 5) && record_matches(early, 5));
+
+    struct TradeRecord copy;
+    int passed = 1;
+    for (long seq = 0; seq < 5000; seq += 97) {
+        passed &= TradeLog_get(log, seq, &copy) && record_matches(&copy, seq);
+    }
+    print_test_result("Get by sequence", passed);
+    print_test_result("Get out of range", !TradeLog_get(log, 5000, &copy) && !TradeLog_get(log, -1, &copy));
+
+    TradeLogCursor cursor;
+    TradeLogCursor_init(&cursor, 4990);
+    passed = 1;
+    long expected = 4990;
+    const struct TradeRecord *record;
+    while ((record = TradeLogCursor_next(log, &cursor))) passed &= record_matches(record, expected++);
+    print_test_result("Cursor reads trades since a sequence", passed && expected == 5000);
+    append_trades(log, 1);
+    print_test_result("Cursor resumes after append", record_matches(TradeLogCursor_next(log, &cursor), 5000));
+    TradeLog_destroy(&log);
+    print_test_result("Destroy clears pointer", log == NULL);
+
+    // Test 3: Ring keeps only the most recent records
+    struct TradeLogConfig ring = { TRADE_LOG_RING, 8, NULL };
+    log = TradeLog_create(&ring);
+    append_trades(log, 5);
+    print_test_result("Ring before wrapping", TradeLog_count(log) == 5 && TradeLog_first_sequence(log) == 0);
+    append_trades(log, 3);
+    print_test_result("Full ring evicts its oldest record next", record_matches(TradeLog_peek_evicted(log), 0));
+    append_trades(log, 12);
+    print_test_result("Ring after wrapping", TradeLog_count(log) == 8 && TradeLog_first_sequence(log) == 12);
+    print_test_result("Dropped record is gone", !TradeLog_get(log, 11, &copy) && TradeLog_peek(log, 11) == NULL);
+    print_test_result("Retained record is intact", TradeLog_get(log, 12, &copy) && record_matches(&copy, 12));
+
+    TradeLogCursor_init(&cursor, 3);
+    record = TradeLogCursor_next(log, &cursor);
+    print_test_result("Cursor skips dropped records", record_matches(record, 12));
+    TradeLog_destroy(&log);
+
+    // Test 4: Spill writes old chunks to disk and reads them back
+    struct TradeLogConfig spill = { TRADE_LOG_SPILL, 10, SPILL_PATH };
+    log = TradeLog_create(&spill);
+    print_test_result("Create spilling log", log != NULL);
+    print_test_result("Spilling log never evicts", TradeLog_peek_evicted(log) == NULL);
+    print_test_result("Append 95 spilled records", append_trades(log, 95));
+    print_test_result("Spilling log retains everything", TradeLog_count(log) == 95 && TradeLog_first_sequence(log) == 0);
+    print_test_result("Old record is not resident", TradeLog_peek(log, 0) == NULL);
+    print_test_result("Recent record is resident", record_matches(TradeLog_peek(log, 94), 94));
+
+    passed = 1;
+    for (long seq = 0; seq < 95; seq++) {
+        passed &= TradeLog_get(log, seq, &copy) && record_matches(&copy, seq);
+    }
+    print_test_result("Get reads spilled records", passed);
+
+    TradeLogCursor_init(&cursor, 0);
+    passed = 1;
+    expected = 0;
+    while ((record = TradeLogCursor_next(log, &cursor))) passed &= record_matches(record, expected++);
+    print_test_result("Cursor reads across the spill file", passed && expected == 95);
+    TradeLog_destroy(&log);
+    remove(SPILL_PATH);
+
+    // Test 5: Numbering restarted from a restored sequence
+    log = TradeLog_create(NULL);
+    print_test_result("Start empty log at a sequence", TradeLog_start_at(log, 5000));
+    print_test_result("Restarted log is empty", TradeLog_count(log) == 0 && TradeLog_first_sequence(log) == 5000);
+    print_test_result("Append after restart", append_trades(log, 1500) && TradeLog_next_sequence(log) == 6500);
+    print_test_result("Restarted records by sequence", TradeLog_get(log, 5000, &copy) && record_matches(&copy, 5000) &&
+                      record_matches(TradeLog_peek(log, 6499), 6499) && !TradeLog_get(log, 4999, &copy));
+    print_test_result("Cannot restart a log with trades", !TradeLog_start_at(log, 0));
+    TradeLog_destroy(&log);
+
+    log = TradeLog_create(&ring);
+    TradeLog_start_at(log, 100);
+    append_trades(log, 7);
+    print_test_result("Restarted ring before wrapping", TradeLog_peek_evicted(log) == NULL && TradeLog_first_sequence(log) == 100);
+    append_trades(log, 3);
+    print_test_result("Restarted ring after wrapping", TradeLog_count(log) == 8 && TradeLog_first_sequence(log) == 102 &&
+                      TradeLog_get(log, 102, &copy) && record_matches(&copy, 102));
+    TradeLog_destroy(&log);
+
+    log = TradeLog_create(&spill);
+    TradeLog_start_at(log, 1000);
+    append_trades(log, 40);
+    passed = 1;
+    for (long seq = 1000; seq < 1040; seq++) {
+        passed &= TradeLog_get(log, seq, &copy) && record_matches(&copy, seq);
+    }
+    print_test_result("Restarted spill reads old records back", passed && TradeLog_peek(log, 1000) == NULL);
+    TradeLog_destroy(&log);
+    remove(SPILL_PATH);
+
+    // Test 6: NULL handling
+    print_test_result("NULL log", TradeLog_append(NULL) == NULL && TradeLog_count(NULL) == 0 &&
+                      TradeLogCursor_next(NULL, &cursor) == NULL);
+
+    printf("All tests completed.\n");
+
+    return 0;
+}
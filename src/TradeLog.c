@@ -0,0 +1,415 @@
+/*******************************************************************************************/
+/* TradeLog.c - Implementation file for the TradeLog module
+ *
+ * Unbounded and spilling logs store records in fixed-size chunks. A table indexed by
+ * chunk number ((sequence - base_sequence) / chunk_records, less table_base) points at
+ * each chunk, so a record is found with a division and an index. A spilling log drops
+ * the table entries of spilled chunks as the table grows, so it stays the size of the
+ * resident window. Chunks are never moved once written, so
+ * pointers to resident records stay valid. A spilling log writes its oldest chunk to the
+ * spill file at offset (sequence - base_sequence) * spill_record_size and reuses the
+ * chunk's memory. With ID hooks, each spilled record is followed by its four ID strings.
+ *
+ * Ring logs hold a single contiguous array of `capacity` records indexed by
+ * sequence % capacity.
+ */
+
+#include "TradeLog.h"
+#include "Instrument.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRADE_LOG_CHUNK_RECORDS 1024
+
+struct TradeLog {
+    enum TradeLogRetention retention; /**< Retention mode. */
+    size_t capacity;                  /**< Ring size, or records to keep in memory when spilling. */
+    long next_sequence;               /**< Sequence of the next appended record. */
+    long base_sequence;               /**< Sequence of the first record ever appended (see TradeLog_start_at). */
+
+    struct TradeRecord **chunks;      /**< Chunk table by chunk number less table_base; NULL for spilled chunks. */
+    size_t table_base;                /**< Chunk number of the table's first entry. */
+    size_t chunk_count;               /**< Chunks in use (including the one being filled). */
+    size_t chunk_slots;               /**< Allocated entries in the chunk table. */
+    size_t chunk_records;             /**< Records per chunk. */
+    size_t first_resident_chunk;      /**< Chunks below this have been spilled. */
+    size_t max_resident_chunks;       /**< Resident chunks kept before spilling (spill mode). */
+    void *spare_chunks;               /**< Reserved chunks not yet in use, linked through their first word. */
+
+    struct TradeRecord *ring;         /**< Ring storage (ring mode). */
+
+    FILE *spill;                      /**< Spill file (spill mode). */
+    size_t spill_record_size;         /**< Bytes per record in the spill file. */
+    struct TradeLogIdHooks id_hooks;  /**< Set by TradeLog_set_id_hooks. */
+    int has_id_hooks;                 /**< Whether spilled records store their IDs by value. */
+    uint32_t read_ids[4];             /**< References held for the last record read back. */
+};
+
+// A spilled record followed by its IDs, when the log has ID hooks
+struct SpilledTradeRecord {
+    struct TradeRecord record;
+    char ids[4][TRADE_LOG_ID_SIZE];   /**< Buy order, buyer, sell order, seller; "" for none. */
+};
+
+// Helper function prototypes
+static struct TradeRecord *new_chunk(TradeLog log);
+static int grow_chunk_table(TradeLog log, size_t min_chunks);
+static struct TradeRecord **chunk_slot(TradeLog log, size_t chunk_no);
+static struct TradeRecord **chunk_slot(TradeLog log, size_t chunk_no) {
+    return &log->chunks[chunk_no - log->table_base];
+}
+
+static void push_spare_chunk(TradeLog log, struct TradeRecord *chunk);
+static struct TradeRecord *pop_spare_chunk(TradeLog log);
+static int spill_oldest_chunk(TradeLog log);
+static int read_spilled(TradeLog log, long sequence, struct TradeRecord *record);
+static int write_spilled_ids(TradeLog log, const struct TradeRecord *chunk);
+static int intern_read_ids(TradeLog log, const struct SpilledTradeRecord *spilled, struct TradeRecord *record);
+static uint32_t *record_ids(struct TradeRecord *record, int index);
+
+// Public function implementations
+TradeLog TradeLog_create(const struct TradeLogConfig *config) {
+    enum TradeLogRetention retention = config ? config->retention : TRADE_LOG_UNBOUNDED;
+    size_t capacity = config ? config->capacity : 0;
+    if (retention != TRADE_LOG_UNBOUNDED && capacity == 0) return NULL;
+    if (retention == TRADE_LOG_SPILL && !config->spill_path) return NULL;
+
+    TradeLog log = malloc(sizeof(struct TradeLog));
+    if (!log) return NULL;
+    memset(log, 0, sizeof(struct TradeLog));
+    log->retention = retention;
+    log->capacity = capacity;
+    log->chunk_records = TRADE_LOG_CHUNK_RECORDS;
+
+    if (retention == TRADE_LOG_RING) {
+        log->ring = calloc(capacity, sizeof(struct TradeRecord));
+        if (!log->ring) {
+            free(log);
+            return NULL;
+        }
+    } else if (retention == TRADE_LOG_SPILL) {
+        // Keep at least `capacity` records resident, plus the chunk being filled
+        if (capacity < log->chunk_records) log->chunk_records = capacity;
+        log->max_resident_chunks = (capacity + log->chunk_records - 1) / log->chunk_records + 1;
+        log->spill = fopen(config->spill_path, "w+b");
+        log->spill_record_size = sizeof(struct TradeRecord);
+        if (!log->spill) {
+            free(log);
+            return NULL;
+        }
+    }
+    return log;
+}
+
+void TradeLog_destroy(TradeLog *log) {
+    if (!log || !*log) return;
+    TradeLog l = *log;
+
+    if (l->has_id_hooks) {
+        for (int i = 0; i < 4; ++i) {
+            if (l->read_ids[i]) l->id_hooks.release(l->id_hooks.context, l->read_ids[i]);
+        }
+    }
+    for (size_t i = l->first_resident_chunk; i < l->chunk_count; ++i) {
+        free(*chunk_slot(l, i));
+    }
+    struct TradeRecord *spare;
+    while ((spare = pop_spare_chunk(l))) free(spare);
+    free(l->chunks);
+    free(l->ring);
+    if (l->spill) fclose(l->spill);
+    free(l);
+
+    *log = NULL;
+}
+
+int TradeLog_reserve(TradeLog log, size_t count) {
+    if (!log) return 0;
+    if (log->retention == TRADE_LOG_RING || count == 0) return 1;
+
+    // Chunks needed to hold sequences up to next_sequence + count, beyond those already held
+    size_t last_chunk = (log->next_sequence - log->base_sequence + count - 1) / log->chunk_records;
+    if (last_chunk < log->chunk_count) return 1;
+    size_t needed = last_chunk + 1 - log->chunk_count;
+    if (log->retention == TRADE_LOG_SPILL && needed > log->max_resident_chunks) {
+        needed = log->max_resident_chunks;
+    }
+
+    if (!grow_chunk_table(log, last_chunk + 1)) return 0;
+    for (size_t i = 0; i < needed; ++i) {
+        struct TradeRecord *chunk = malloc(log->chunk_records * sizeof(struct TradeRecord));
+        if (!chunk) return 0;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+        push_spare_chunk(log, chunk);
+    }
+    return 1;
+}
+
+struct TradeRecord *TradeLog_append(TradeLog log) {
+    if (!log) return NULL;
+
+    long sequence = log->next_sequence;
+    struct TradeRecord *record;
+
+    if (log->ring) {
+        record = &log->ring[sequence % log->capacity];
+    } else {
+        size_t position = (size_t)(sequence - log->base_sequence);
+        size_t chunk_no = position / log->chunk_records;
+        if (chunk_no == log->chunk_count) {
+            if (!new_chunk(log)) return NULL;
+        }
+        record = &(*chunk_slot(log, chunk_no))[position % log->chunk_records];
+    }
+
+    memset(record, 0, sizeof(struct TradeRecord));
+    record->sequence = sequence;
+    log->next_sequence++;
+    return record;
+}
+
+const struct TradeRecord *TradeLog_peek_evicted(TradeLog log) {
+    if (!log || !log->ring || log->next_sequence - log->base_sequence < (long)log->capacity) return NULL;
+    return &log->ring[log->next_sequence % log->capacity];
+}
+
+int TradeLog_set_id_hooks(TradeLog log, const struct TradeLogIdHooks *hooks) {
+    if (!log || !hooks || !hooks->resolve || !hooks->intern || !hooks->release) return 0;
+    if (log->next_sequence != log->base_sequence) return 0;
+    log->id_hooks = *hooks;
+    log->has_id_hooks = 1;
+    if (log->spill) log->spill_record_size = sizeof(struct SpilledTradeRecord);
+    return 1;
+}
+
+int TradeLog_get(TradeLog log, long sequence, struct TradeRecord *record) {
+    if (!log || !record) return 0;
+    if (sequence < TradeLog_first_sequence(log) || sequence >= log->next_sequence) return 0;
+
+    const struct TradeRecord *resident = TradeLog_peek(log, sequence);
+    if (resident) {
+        memcpy(record, resident, sizeof(struct TradeRecord));
+        return 1;
+    }
+    return read_spilled(log, sequence, record);
+}
+
+const struct TradeRecord *TradeLog_peek(TradeLog log, long sequence) {
+    if (!log) return NULL;
+    if (sequence < TradeLog_first_sequence(log) || sequence >= log->next_sequence) return NULL;
+
+    if (log->ring) return &log->ring[sequence % log->capacity];
+
+    size_t position = (size_t)(sequence - log->base_sequence);
+    size_t chunk_no = position / log->chunk_records;
+    if (chunk_no < log->first_resident_chunk) return NULL;
+    return &(*chunk_slot(log, chunk_no))[position % log->chunk_records];
+}
+
+long TradeLog_first_sequence(const TradeLog log) {
+    if (!log) return 0;
+    if (log->ring && log->next_sequence - log->base_sequence > (long)log->capacity) {
+        return log->next_sequence - (long)log->capacity;
+    }
+    return log->base_sequence;
+}
+
+long TradeLog_next_sequence(const TradeLog log) {
+    return log ? log->next_sequence : 0;
+}
+
+int TradeLog_start_at(TradeLog log, long sequence) {
+    if (!log || sequence < 0 || log->next_sequence != log->base_sequence) return 0;
+    log->base_sequence = log->next_sequence = sequence;
+    return 1;
+}
+
+size_t TradeLog_count(const TradeLog log) {
+    return log ? (size_t)(log->next_sequence - TradeLog_first_sequence(log)) : 0;
+}
+
+size_t TradeLog_memory_usage(const TradeLog log) {
+    if (!log) return 0;
+    size_t chunks = log->chunk_count - log->first_resident_chunk;
+    for (void *spare = log->spare_chunks; spare; spare = *(void **)spare) chunks++;
+
+    size_t bytes = sizeof(struct TradeLog) + log->chunk_slots * sizeof(struct TradeRecord *) +
+                   chunks * log->chunk_records * sizeof(struct TradeRecord);
+    if (log->ring) bytes += log->capacity * sizeof(struct TradeRecord);
+    return bytes;
+}
+
+void TradeLogCursor_init(TradeLogCursor *cursor, long since_sequence) {
+    if (!cursor) return;
+    cursor->next_sequence = since_sequence < 0 ? 0 : since_sequence;
+}
+
+const struct TradeRecord *TradeLogCursor_next(TradeLog log, TradeLogCursor *cursor) {
+    if (!log || !cursor) return NULL;
+
+    long first = TradeLog_first_sequence(log);
+    if (cursor->next_sequence < first) cursor->next_sequence = first;
+    if (cursor->next_sequence >= log->next_sequence) return NULL;
+
+    const struct TradeRecord *record = TradeLog_peek(log, cursor->next_sequence);
+    if (!record) {
+        if (!read_spilled(log, cursor->next_sequence, &cursor->buffer)) return NULL;
+        record = &cursor->buffer;
+    }
+    cursor->next_sequence++;
+    return record;
+}
+
+// Helper function implementations
+
+// Makes chunk number chunk_count available, spilling or reusing memory as the mode requires
+static struct TradeRecord *new_chunk(TradeLog log) {
+    if (!grow_chunk_table(log, log->chunk_count + 1)) return NULL;
+
+    if (log->spill && log->chunk_count - log->first_resident_chunk >= log->max_resident_chunks) {
+        if (!spill_oldest_chunk(log)) return NULL;
+    }
+
+    struct TradeRecord *chunk = pop_spare_chunk(log);
+    if (!chunk) {
+        chunk = malloc(log->chunk_records * sizeof(struct TradeRecord));
+        if (!chunk) return NULL;
+        INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+    }
+
+    *chunk_slot(log, log->chunk_count++) = chunk;
+    return chunk;
+}
+
+// Makes the table reach chunk number min_chunks - 1, first dropping entries of spilled chunks
+static int grow_chunk_table(TradeLog log, size_t min_chunks) {
+    if (min_chunks <= log->table_base + log->chunk_slots) return 1;
+
+    size_t dropped = log->first_resident_chunk - log->table_base;
+    if (dropped > 0) {
+        size_t kept = log->chunk_count - log->first_resident_chunk;
+        memmove(log->chunks, log->chunks + dropped, kept * sizeof(struct TradeRecord *));
+        memset(log->chunks + kept, 0, dropped * sizeof(struct TradeRecord *));
+        log->table_base = log->first_resident_chunk;
+    }
+    size_t min_slots = min_chunks - log->table_base;
+    if (min_slots <= log->chunk_slots) return 1;
+
+    size_t new_slots = log->chunk_slots ? log->chunk_slots : 16;
+    while (new_slots < min_slots) new_slots *= 2;
+    struct TradeRecord **new_chunks = realloc(log->chunks, new_slots * sizeof(struct TradeRecord *));
+    if (!new_chunks) return 0;
+    INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+
+    memset(new_chunks + log->chunk_slots, 0, (new_slots - log->chunk_slots) * sizeof(struct TradeRecord *));
+    log->chunks = new_chunks;
+    log->chunk_slots = new_slots;
+    return 1;
+}
+
+static void push_spare_chunk(TradeLog log, struct TradeRecord *chunk) {
+    *(void **)chunk = log->spare_chunks;
+    log->spare_chunks = chunk;
+}
+
+static struct TradeRecord *pop_spare_chunk(TradeLog log) {
+    struct TradeRecord *chunk = log->spare_chunks;
+    if (chunk) log->spare_chunks = *(void **)chunk;
+    return chunk;
+}
+
+// Writes the oldest resident chunk to the spill file and keeps its memory for reuse
+static int spill_oldest_chunk(TradeLog log) {
+    size_t chunk_no = log->first_resident_chunk;
+    struct TradeRecord *chunk = *chunk_slot(log, chunk_no);
+    long offset = (long)(chunk_no * log->chunk_records * log->spill_record_size);
+
+    if (fseek(log->spill, offset, SEEK_SET) != 0) return 0;
+    if (log->has_id_hooks) {
+        if (!write_spilled_ids(log, chunk)) return 0;
+    } else if (fwrite(chunk, sizeof(struct TradeRecord), log->chunk_records, log->spill) != log->chunk_records) {
+        return 0;
+    }
+    if (fflush(log->spill) != 0) return 0;
+
+    // The strings are on disk, so the chunk's references can go
+    for (size_t i = 0; log->has_id_hooks && i < log->chunk_records; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            uint32_t id = *record_ids(&chunk[i], j);
+            if (id) log->id_hooks.release(log->id_hooks.context, id);
+        }
+    }
+
+    *chunk_slot(log, chunk_no) = NULL;
+    log->first_resident_chunk++;
+    push_spare_chunk(log, chunk);
+    return 1;
+}
+
+static int read_spilled(TradeLog log, long sequence, struct TradeRecord *record) {
+    if (!log->spill) return 0;
+    size_t position = (size_t)(sequence - log->base_sequence);
+    if (position / log->chunk_records >= log->first_resident_chunk) return 0;
+
+    long offset = (long)(position * log->spill_record_size);
+    if (fseek(log->spill, offset, SEEK_SET) != 0) return 0;
+    if (!log->has_id_hooks) return fread(record, sizeof(struct TradeRecord), 1, log->spill) == 1;
+
+    struct SpilledTradeRecord spilled;
+    if (fread(&spilled, sizeof(spilled), 1, log->spill) != 1) return 0;
+    return intern_read_ids(log, &spilled, record);
+}
+
+// Writes a chunk's records, each followed by the strings of its IDs
+static int write_spilled_ids(TradeLog log, const struct TradeRecord *chunk) {
+    for (size_t i = 0; i < log->chunk_records; ++i) {
+        struct SpilledTradeRecord spilled;
+        memset(&spilled, 0, sizeof(spilled));
+        spilled.record = chunk[i];
+        for (int j = 0; j < 4; ++j) {
+            uint32_t id = *record_ids(&spilled.record, j);
+            const char *str = id ? log->id_hooks.resolve(log->id_hooks.context, id) : NULL;
+            if (str) strncpy(spilled.ids[j], str, TRADE_LOG_ID_SIZE - 1);
+            *record_ids(&spilled.record, j) = 0;
+        }
+        if (fwrite(&spilled, sizeof(spilled), 1, log->spill) != 1) return 0;
+    }
+    return 1;
+}
+
+// Gives a record read back fresh handles, dropping those of the previous read
+static int intern_read_ids(TradeLog log, const struct SpilledTradeRecord *spilled, struct TradeRecord *record) {
+    uint32_t ids[4] = { 0, 0, 0, 0 };
+    for (int j = 0; j < 4; ++j) {
+        if (spilled->ids[j][0] == '\0') continue;
+        char str[TRADE_LOG_ID_SIZE];
+        memcpy(str, spilled->ids[j], TRADE_LOG_ID_SIZE - 1);
+        str[TRADE_LOG_ID_SIZE - 1] = '\0';
+        if (!(ids[j] = log->id_hooks.intern(log->id_hooks.context, str))) {
+            while (j-- > 0) {
+                if (ids[j]) log->id_hooks.release(log->id_hooks.context, ids[j]);
+            }
+            return 0;
+        }
+    }
+
+    // Intern before releasing, so an ID shared with the previous read keeps its handle
+    for (int j = 0; j < 4; ++j) {
+        if (log->read_ids[j]) log->id_hooks.release(log->id_hooks.context, log->read_ids[j]);
+        log->read_ids[j] = ids[j];
+    }
+    *record = spilled->record;
+    for (int j = 0; j < 4; ++j) *record_ids(record, j) = ids[j];
+    return 1;
+}
+
+// The record's ID fields by index: buy order, buyer, sell order, seller
+static uint32_t *record_ids(struct TradeRecord *record, int index) {
+    switch (index) {
+    case 0: return &record->buy_order_id;
+    case 1: return &record->buy_user_id;
+    case 2: return &record->sell_order_id;
+    default: return &record->sell_user_id;
+    }
+}
@@ -0,0 +1,212 @@
+/* TradeLog.h - Header file for the TradeLog module
+ *
+ * This module stores executed trades as fixed-size records, numbered by a dense
+ * sequence starting at 0. Looking a trade up by sequence is arithmetic on the
+ * sequence number, not a hash lookup. Order and user IDs are stored as interned
+ * handles (see IdTable.h); resolving them is up to the owner of the log, which can
+ * also give a spilling log TradeLogIdHooks so spilled trades store their IDs by value.
+ *
+ * Records live in one of three retention modes:
+ *  - TRADE_LOG_UNBOUNDED keeps every record in memory, in chunks that are never moved.
+ *  - TRADE_LOG_RING keeps only the most recent `capacity` records in a contiguous ring.
+ *  - TRADE_LOG_SPILL keeps about `capacity` recent records in memory and writes older
+ *    chunks to a file, from which they can still be read.
+ *
+ * Consumers can follow the log with a TradeLogCursor, which hands out pointers to
+ * resident records instead of copying the history.
+ */
+#ifndef TRADE_LOG_H
+#define TRADE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// TradeLog type definition
+typedef struct TradeLog *TradeLog;
+
+// A single executed trade
+struct TradeRecord {
+    long sequence;              /**< Position of the trade in the log; also its numeric trade ID. */
+    uint32_t buy_order_id;      /**< Interned ID of the buy order. */
+    uint32_t buy_user_id;       /**< Interned user ID of the buyer. */
+    uint32_t sell_order_id;     /**< Interned ID of the sell order. */
+    uint32_t sell_user_id;      /**< Interned user ID of the seller. */
+    int size;                   /**< Executed trade size (quantity). */
+    double price;               /**< Executed trade price. */
+    long timestamp;             /**< Timestamp of the trade. */
+};
+
+enum TradeLogRetention {
+    TRADE_LOG_UNBOUNDED = 0, /**< Keep every trade in memory. */
+    TRADE_LOG_RING,          /**< Keep the last `capacity` trades. */
+    TRADE_LOG_SPILL          /**< Keep about `capacity` trades in memory, the rest in `spill_path`. */
+};
+
+// Settings for TradeLog_create. A zeroed config is an unbounded log.
+struct TradeLogConfig {
+    enum TradeLogRetention retention; /**< Retention mode. */
+    size_t capacity;                  /**< Ring size, or records kept in memory when spilling. */
+    const char *spill_path;           /**< File to spill to (created or truncated), for TRADE_LOG_SPILL. */
+};
+
+// Longest order or user ID a spilled record stores, including the terminator
+#define TRADE_LOG_ID_SIZE 37
+
+// Callbacks that let a spilling log write IDs by value. See TradeLog_set_id_hooks.
+struct TradeLogIdHooks {
+    const char *(*resolve)(void *context, uint32_t id);  /**< String of a handle, or NULL if unknown. */
+    uint32_t (*intern)(void *context, const char *id);   /**< Handle for a string, with a new reference; 0 on failure. */
+    void (*release)(void *context, uint32_t id);         /**< Drops a reference taken by the owner or by intern. */
+    void *context;                                       /**< Passed to every callback. */
+};
+
+// Position in a TradeLog for reading trades in order. Fields are private to TradeLog.c.
+typedef struct TradeLogCursor {
+    long next_sequence;
+    struct TradeRecord buffer; /**< Holds the last record read back from the spill file. */
+} TradeLogCursor;
+
+/**
+ * Creates a new TradeLog instance.
+ *
+ * @param config Settings for the log, or NULL for an unbounded log.
+ * @return A newly allocated TradeLog instance, or NULL on failure (including a ring or
+ *         spill log with capacity 0, or a spill file that cannot be opened).
+ */
+TradeLog TradeLog_create(const struct TradeLogConfig *config);
+
+/**
+ * Destroys a TradeLog instance, freeing all records and closing any spill file.
+ *
+ * @param log A pointer to the TradeLog instance to destroy.
+ */
+void TradeLog_destroy(TradeLog *log);
+
+/**
+ * Pre-allocates memory for count more records so appending them does not allocate.
+ * Ring logs are fully allocated at creation, so this is a no-op for them.
+ *
+ * @param log The TradeLog instance.
+ * @param count The number of records to prepare for.
+ * @return 1 if the operation is successful, 0 on failure.
+ */
+int TradeLog_reserve(TradeLog log, size_t count);
+
+/**
+ * Appends a record to the log. The returned record has its sequence set and all other
+ * fields zeroed; the caller fills them in before the next call on the log.
+ *
+ * @param log The TradeLog instance.
+ * @return A pointer to the new record, or NULL on failure.
+ */
+struct TradeRecord *TradeLog_append(TradeLog log);
+
+/**
+ * Gets the record the next append will overwrite, so its owner can release anything
+ * the record refers to. Only a full ring overwrites records.
+ *
+ * @param log The TradeLog instance.
+ * @return A pointer to the record about to be dropped, or NULL if none will be.
+ */
+const struct TradeRecord *TradeLog_peek_evicted(TradeLog log);
+
+/**
+ * Makes a spilling log store the four IDs of each spilled record as strings. When a
+ * chunk spills, the log resolves each ID, writes the strings with the record and
+ * releases the record's references, so spilled trades hold no handles. A record read
+ * back gets fresh handles from intern; the log holds them until its next read from the
+ * spill file. The hooks must stay valid until the log is destroyed.
+ *
+ * @param log The TradeLog instance.
+ * @param hooks The callbacks to copy.
+ * @return 1 if successful, 0 on invalid arguments or if the log already holds trades.
+ */
+int TradeLog_set_id_hooks(TradeLog log, const struct TradeLogIdHooks *hooks);
+
+/**
+ * Copies the record with the given sequence, reading it from the spill file if needed.
+ *
+ * @param log The TradeLog instance.
+ * @param sequence The sequence of the trade.
+ * @param record Output pointer to store a copy of the record.
+ * @return 1 if the trade is retained, 0 otherwise.
+ */
+int TradeLog_get(TradeLog log, long sequence, struct TradeRecord *record);
+
+/**
+ * Gets a pointer to a record held in memory, without copying.
+ *
+ * @param log The TradeLog instance.
+ * @param sequence The sequence of the trade.
+ * @return A pointer to the record, valid until the next append, or NULL if the record
+ *         is not in memory.
+ */
+const struct TradeRecord *TradeLog_peek(TradeLog log, long sequence);
+
+/**
+ * Gets the sequence of the oldest retained trade.
+ *
+ * @param log The TradeLog instance.
+ * @return The oldest sequence that can still be read (equal to TradeLog_next_sequence if none).
+ */
+long TradeLog_first_sequence(const TradeLog log);
+
+/**
+ * Gets the sequence the next appended trade will receive.
+ *
+ * @param log The TradeLog instance.
+ * @return The next sequence, which is also the number of trades ever appended
+ *         (counting from the sequence given to TradeLog_start_at, if any).
+ */
+long TradeLog_next_sequence(const TradeLog log);
+
+/**
+ * Starts the numbering of an empty log at the given sequence, e.g. when a book is
+ * restored from a snapshot. Sequences before it are treated as never retained.
+ *
+ * @param log The TradeLog instance.
+ * @param sequence The sequence the next appended trade will receive.
+ * @return 1 if successful, 0 if the log already holds trades or sequence is negative.
+ */
+int TradeLog_start_at(TradeLog log, long sequence);
+
+/**
+ * Gets the number of trades that can still be read.
+ *
+ * @param log The TradeLog instance.
+ * @return The number of retained trades.
+ */
+size_t TradeLog_count(const TradeLog log);
+
+/**
+ * Gets the bytes the log holds in memory: resident and reserved chunks, the chunk
+ * table, or the ring. Spilled records are not counted.
+ *
+ * @param log The TradeLog instance.
+ * @return The bytes allocated, or 0 if log is NULL.
+ */
+size_t TradeLog_memory_usage(const TradeLog log);
+
+/**
+ * Positions a cursor so that the next read returns the trade with the given sequence.
+ *
+ * @param cursor The cursor to initialize (typically stack-allocated).
+ * @param since_sequence The first sequence to read (0 for the whole log).
+ */
+void TradeLogCursor_init(TradeLogCursor *cursor, long since_sequence);
+
+/**
+ * Reads the next trade from the log and advances the cursor. If the next trade has
+ * already been dropped from a ring, the cursor skips ahead to the oldest retained
+ * trade; compare the returned record's sequence to detect the gap.
+ *
+ * @param log The TradeLog instance.
+ * @param cursor The cursor.
+ * @return A pointer to the record (into the log, or into the cursor for spilled records),
+ *         valid until the next append or read, or NULL if the cursor has caught up. With
+ *         TradeLogIdHooks, the IDs of a spilled record stay valid until the log's next
+ *         read from the spill file.
+ */
+const struct TradeRecord *TradeLogCursor_next(TradeLog log, TradeLogCursor *cursor);
+
+#endif // TRADE_LOG_H